@@ -3,6 +3,8 @@
 
 /**
  * Wishbone arbitrator, with priority m0 > m1 > m2 > ...
+ * Grants are registered, so a request on idle bus reaches slaves one clock later, but the priority search is kept out
+ * of the paths from masters to slaves.
  * Author: Zhao, Hongyu  <power_zhy@foxmail.com>
  */
 module wb_arb (
@@ -52,6 +54,28 @@ module wb_arb (
 	input wire [31:0] m3_data_i,
 	output reg m3_ack_o,
 	output reg m3_err_o,
+	// wishbone master 4 - ICMU of the second core
+	input wire m4_cyc_i, m4_stb_i,
+	input wire [31:2] m4_addr_i,
+	input wire [2:0] m4_cti_i,
+	input wire [1:0] m4_bte_i,
+	input wire [3:0] m4_sel_i,
+	input wire m4_we_i,
+	output reg [31:0] m4_data_o,
+	input wire [31:0] m4_data_i,
+	output reg m4_ack_o,
+	output reg m4_err_o,
+	// wishbone master 5 - DCMU of the second core
+	input wire m5_cyc_i, m5_stb_i,
+	input wire [31:2] m5_addr_i,
+	input wire [2:0] m5_cti_i,
+	input wire [1:0] m5_bte_i,
+	input wire [3:0] m5_sel_i,
+	input wire m5_we_i,
+	output reg [31:0] m5_data_o,
+	input wire [31:0] m5_data_i,
+	output reg m5_ack_o,
+	output reg m5_err_o,
 	// wishbone slave 0 - RAM
 	output reg  s0_cyc_o, s0_stb_o,
 	output reg [31:2] s0_addr_o,
@@ -84,12 +108,16 @@ module wb_arb (
 	input wire [31:0] s2_data_i,
 	output reg [31:0] s2_data_o,
 	input wire s2_ack_i,
-	input wire s2_err_i
+	input wire s2_err_i,
+	// snooping, writes acknowledged on bus for caches of all masters
+	output wire [31:2] snoop_addr_o,
+	output wire snoop_we_o,
+	output wire [2:0] snoop_master_o
 	);
 	
 	`include "function.vh"
 	localparam
-		MASTER_COUNT = 4;
+		MASTER_COUNT = 6;
 	localparam
 		MASTER_COUNT_BITS = GET_WIDTH(MASTER_COUNT-1);
 	
@@ -122,10 +150,10 @@ module wb_arb (
 		s1_sel = f_t1 & ~f_t2,
 		s2_sel = f_t1 & f_t2;
 	
-	bit_searcher #(  // master priority: m0 > m1 > m2 > m3
-		.N(MASTER_COUNT)
+	bit_searcher #(  // master priority: m0 > m1 > m2 > m3 > m4 > m5
+		.N(8)
 		) BS (
-		.bits({m3_cyc_i, m2_cyc_i, m1_cyc_i, m0_cyc_i}),
+		.bits({2'b0, m5_cyc_i, m4_cyc_i, m3_cyc_i, m2_cyc_i, m1_cyc_i, m0_cyc_i}),
 		.target(1'b1),
 		.direction(1'b0),
 		.hit(next_cyc),
@@ -148,7 +176,13 @@ module wb_arb (
 	end
 	
 	assign
-		master = curr_cyc ? curr_master : next_master;  // ensure current bus operation can not be interrupted
+		master = curr_master;  // ensure current bus operation can not be interrupted
+	
+	// writes are broadcast when acknowledged, so that the data are already in memory for others to refill
+	assign
+		snoop_addr_o = m_addr_i,
+		snoop_we_o = m_cyc_i & m_stb_i & m_we_i & m_ack_o,
+		snoop_master_o = master;
 	
 	always @(*) begin
 		m_cyc_i = 0;
@@ -159,7 +193,7 @@ module wb_arb (
 		m_sel_i = 0;
 		m_we_i = 0;
 		m_data_i = 0;
-		if (curr_cyc || next_cyc) begin
+		if (curr_cyc) begin
 			case (master)
 				0: begin
 					m_cyc_i = m0_cyc_i;
@@ -201,6 +235,26 @@ module wb_arb (
 					m_we_i = m3_we_i;
 					m_data_i = m3_data_i;
 				end
+				4: begin
+					m_cyc_i = m4_cyc_i;
+					m_stb_i = m4_stb_i;
+					m_addr_i = m4_addr_i;
+					m_cti_i = m4_cti_i;
+					m_bte_i = m4_bte_i;
+					m_sel_i = m4_sel_i;
+					m_we_i = m4_we_i;
+					m_data_i = m4_data_i;
+				end
+				5: begin
+					m_cyc_i = m5_cyc_i;
+					m_stb_i = m5_stb_i;
+					m_addr_i = m5_addr_i;
+					m_cti_i = m5_cti_i;
+					m_bte_i = m5_bte_i;
+					m_sel_i = m5_sel_i;
+					m_we_i = m5_we_i;
+					m_data_i = m5_data_i;
+				end
 			endcase
 		end
 	end
@@ -218,7 +272,13 @@ module wb_arb (
 		m3_data_o = 0;
 		m3_ack_o = 0;
 		m3_err_o = 0;
-		if (curr_cyc || next_cyc) begin
+		m4_data_o = 0;
+		m4_ack_o = 0;
+		m4_err_o = 0;
+		m5_data_o = 0;
+		m5_ack_o = 0;
+		m5_err_o = 0;
+		if (curr_cyc) begin
 			case (master)
 				0: begin
 					m0_data_o = m_data_o;
@@ -240,6 +300,16 @@ module wb_arb (
 					m3_ack_o = m_ack_o;
 					m3_err_o = m_err_o;
 				end
+				4: begin
+					m4_data_o = m_data_o;
+					m4_ack_o = m_ack_o;
+					m4_err_o = m_err_o;
+				end
+				5: begin
+					m5_data_o = m_data_o;
+					m5_ack_o = m_ack_o;
+					m5_err_o = m_err_o;
+				end
 			endcase
 		end
 	end
@@ -269,7 +339,7 @@ module wb_arb (
 		s2_sel_o = 0;
 		s2_we_o = 0;
 		s2_data_o = 0;
-		if (curr_cyc || next_cyc) begin
+		if (curr_cyc) begin
 			case (1)
 				s0_sel: begin
 					s0_cyc_o = m_cyc_i;
@@ -309,7 +379,7 @@ module wb_arb (
 		m_data_o = 0;
 		m_ack_o = 0;
 		m_err_o = 0;
-		if (curr_cyc || next_cyc) begin
+		if (curr_cyc) begin
 			case (1)
 				s0_sel: begin
 					m_data_o = s0_data_i;
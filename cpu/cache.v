@@ -8,13 +8,20 @@
 module cache (
 	input wire clk,  // main clock
 	input wire rst,  // synchronous reset
+	input wire en,  // clock enable, keep all contents and outputs unchanged when disabled
 	input wire [ADDR_BITS-1:0] addr,  // address
+	input wire [ADDR_BITS-1:0] lookup_addr,  // address of hit, valid, dirty and tag, edits only take effect when it hits
 	input wire store,  // set valid to 1 and reset dirty to 0
 	input wire [WORD_BYTES-1:0] edit,  // set dirty to 1
 	input wire invalid,  // reset valid to 0
 	input wire [WORD_BITS-1:0] din,  // data write in
+	input wire [ADDR_BITS-1:0] snoop_addr,  // address written by other bus masters
+	input wire snoop_inv,  // reset valid to 0 if snoop address hits, works even when disabled
+	input wire [ADDR_BITS-1:0] probe_addr,  // address of probe_hit, for lines to be prefetched
 	output wire hit,  // hit or not
+	output wire probe_hit,  // whether the line of probe address is cached
 	output reg [WORD_BITS-1:0] dout,  // data read out
+	output reg [WORD_BITS-1:0] dout_next,  // data of the odd word next to the even one addressed, for instruction pairs
 	output reg valid,  // valid bit
 	output reg dirty,  // dirty bit
 	output reg [TAG_BITS-1:0] tag,  // tag bits
@@ -27,6 +34,8 @@ module cache (
 		WORD_BYTES = 4,  // number of bytes per-word
 		LINE_WORDS = 4,  // number of words per-line
 		LINE_NUM = 64;  // number of lines in cache, must be the power of 2
+	parameter
+		WRITE_THROUGH = 0;  // edits never set dirty as data is written to memory at the same time
 	localparam
 		WORD_BITS = 8 * WORD_BYTES,  // 32
 		LINE_WORDS_WIDTH = GET_WIDTH(LINE_WORDS-1),  // 2
@@ -38,13 +47,22 @@ module cache (
 	reg [LINE_NUM-1:0] inner_dirty = 0;
 	reg [TAG_BITS-1:0] inner_tag [0:LINE_NUM-1];
 	
+	// snooping, tags are read a second time for the address written by others
+	wire snoop_hit;
+	assign snoop_hit = snoop_inv
+		& inner_valid[snoop_addr[ADDR_BITS-TAG_BITS-1:LINE_WORDS_WIDTH+WORD_BYTES_WIDTH]]
+		& (inner_tag[snoop_addr[ADDR_BITS-TAG_BITS-1:LINE_WORDS_WIDTH+WORD_BYTES_WIDTH]] == snoop_addr[ADDR_BITS-1:ADDR_BITS-TAG_BITS]);
+	
 	genvar i;
 	generate for (i=0; i<WORD_BYTES; i=i+1) begin: DATA_CONTENT
 		reg [7:0] inner_data [0:LINE_NUM*LINE_WORDS-1];
 		always @(negedge clk) begin
-			dout[8*i+7-:8] <= inner_data[addr[ADDR_BITS-TAG_BITS-1:WORD_BYTES_WIDTH]];
-			if (store || (edit[i] && hit))
-				inner_data[addr[ADDR_BITS-TAG_BITS-1:WORD_BYTES_WIDTH]] <= din[8*i+7-:8];
+			if (en) begin
+				dout[8*i+7-:8] <= inner_data[addr[ADDR_BITS-TAG_BITS-1:WORD_BYTES_WIDTH]];
+				dout_next[8*i+7-:8] <= inner_data[{addr[ADDR_BITS-TAG_BITS-1:WORD_BYTES_WIDTH+1], 1'b1}];
+				if (store || (edit[i] && hit))
+					inner_data[addr[ADDR_BITS-TAG_BITS-1:WORD_BYTES_WIDTH]] <= din[8*i+7-:8];
+			end
 		end
 	end
 	endgenerate
@@ -54,27 +72,36 @@ module cache (
 			inner_valid <= 0;
 			inner_dirty <= 0;
 		end
-		else if (invalid) begin
-			inner_valid[addr[ADDR_BITS-TAG_BITS-1:LINE_WORDS_WIDTH+WORD_BYTES_WIDTH]] <= 0;
-			inner_dirty[addr[ADDR_BITS-TAG_BITS-1:LINE_WORDS_WIDTH+WORD_BYTES_WIDTH]] <= 0;
-		end
-		else if (store) begin
-			inner_valid[addr[ADDR_BITS-TAG_BITS-1:LINE_WORDS_WIDTH+WORD_BYTES_WIDTH]] <= 1;
-			inner_dirty[addr[ADDR_BITS-TAG_BITS-1:LINE_WORDS_WIDTH+WORD_BYTES_WIDTH]] <= 0;
-			inner_tag[addr[ADDR_BITS-TAG_BITS-1:LINE_WORDS_WIDTH+WORD_BYTES_WIDTH]] <= addr[ADDR_BITS-1:ADDR_BITS-TAG_BITS];
-		end
-		else if (|edit && hit) begin
-			inner_dirty[addr[ADDR_BITS-TAG_BITS-1:LINE_WORDS_WIDTH+WORD_BYTES_WIDTH]] <= 1;
+		else if (en) begin
+			if (invalid) begin
+				inner_valid[addr[ADDR_BITS-TAG_BITS-1:LINE_WORDS_WIDTH+WORD_BYTES_WIDTH]] <= 0;
+				inner_dirty[addr[ADDR_BITS-TAG_BITS-1:LINE_WORDS_WIDTH+WORD_BYTES_WIDTH]] <= 0;
+			end
+			else if (store) begin
+				inner_valid[addr[ADDR_BITS-TAG_BITS-1:LINE_WORDS_WIDTH+WORD_BYTES_WIDTH]] <= 1;
+				inner_dirty[addr[ADDR_BITS-TAG_BITS-1:LINE_WORDS_WIDTH+WORD_BYTES_WIDTH]] <= 0;
+				inner_tag[addr[ADDR_BITS-TAG_BITS-1:LINE_WORDS_WIDTH+WORD_BYTES_WIDTH]] <= addr[ADDR_BITS-1:ADDR_BITS-TAG_BITS];
+			end
+			else if (|edit && hit && !WRITE_THROUGH) begin
+				inner_dirty[addr[ADDR_BITS-TAG_BITS-1:LINE_WORDS_WIDTH+WORD_BYTES_WIDTH]] <= 1;
+			end
 		end
+		if (~rst && snoop_hit)
+			inner_valid[snoop_addr[ADDR_BITS-TAG_BITS-1:LINE_WORDS_WIDTH+WORD_BYTES_WIDTH]] <= 0;
 	end
 	
+	// looked up by its own address, so that hit never depends on how addr is chosen from it
 	always @(*) begin
-		valid = inner_valid[addr[ADDR_BITS-TAG_BITS-1:LINE_WORDS_WIDTH+WORD_BYTES_WIDTH]];
-		dirty = inner_dirty[addr[ADDR_BITS-TAG_BITS-1:LINE_WORDS_WIDTH+WORD_BYTES_WIDTH]];
-		tag = inner_tag[addr[ADDR_BITS-TAG_BITS-1:LINE_WORDS_WIDTH+WORD_BYTES_WIDTH]];
+		valid = inner_valid[lookup_addr[ADDR_BITS-TAG_BITS-1:LINE_WORDS_WIDTH+WORD_BYTES_WIDTH]];
+		dirty = inner_dirty[lookup_addr[ADDR_BITS-TAG_BITS-1:LINE_WORDS_WIDTH+WORD_BYTES_WIDTH]];
+		tag = inner_tag[lookup_addr[ADDR_BITS-TAG_BITS-1:LINE_WORDS_WIDTH+WORD_BYTES_WIDTH]];
 		dirty_map = inner_dirty;
 	end
 	
-	assign hit = valid & (tag == addr[ADDR_BITS-1:ADDR_BITS-TAG_BITS]);
+	assign hit = valid & (tag == lookup_addr[ADDR_BITS-1:ADDR_BITS-TAG_BITS]);
+	
+	// probing, tags are read once more for the line going to be prefetched
+	assign probe_hit = inner_valid[probe_addr[ADDR_BITS-TAG_BITS-1:LINE_WORDS_WIDTH+WORD_BYTES_WIDTH]]
+		& (inner_tag[probe_addr[ADDR_BITS-TAG_BITS-1:LINE_WORDS_WIDTH+WORD_BYTES_WIDTH]] == probe_addr[ADDR_BITS-1:ADDR_BITS-TAG_BITS]);
 	
 endmodule
@@ -24,9 +24,12 @@ module controller (
 	output reg mem_ext,  // whether using sign extended to memory data
 	output reg mem_ren,  // memory read enable signal
 	output reg mem_wen,  // memory write enable signal
+	output reg mem_link,  // whether memory access is linked, LL when reading and SC when writing
 	output reg [1:0] wb_addr_src,  // address source to write data back to registers
 	output reg [1:0] wb_data_src,  // data source of data being written back to registers
 	output reg wb_wen,  // register write enable signal
+	output reg is_jump,  // whether current instruction is a jump or branch instruction
+	output reg is_simple,  // whether current instruction only uses ALU and never causes exception, which can be issued as the second one of a pair
 	output reg is_delay_slot,  // whether current instruction is in delay slot
 	output reg is_privilege,  // whether current instruction is a privilege instruction
 	output reg syscall,  // whether current instruction is system call instruction
@@ -40,8 +43,6 @@ module controller (
 	
 	`include "mips_define.vh"
 	
-	reg is_jump;
-	
 	always @(*) begin
 		pc_src = PC_NEXT;
 		imm_ext = 0;
@@ -54,6 +55,7 @@ module controller (
 		mem_ext = 0;
 		mem_ren = 0;
 		mem_wen = 0;
+		mem_link = 0;
 		wb_addr_src = WB_ADDR_RD;
 		wb_data_src = WB_DATA_ALU;
 		wb_wen = 0;
@@ -451,6 +453,29 @@ module controller (
 				rs_used = 1;
 				rt_used = 1;
 			end
+			INST_LL: begin
+				imm_ext = 1;
+				exe_b_src = EXE_B_IMM;
+				mem_type = MEM_TYPE_WORD;
+				mem_ren = 1;
+				mem_link = 1;
+				wb_addr_src = WB_ADDR_RT;
+				wb_data_src = WB_DATA_MEM;
+				wb_wen = 1;
+				rs_used = 1;
+			end
+			INST_SC: begin
+				imm_ext = 1;
+				exe_b_src = EXE_B_IMM;
+				mem_type = MEM_TYPE_WORD;
+				mem_wen = 1;
+				mem_link = 1;
+				wb_addr_src = WB_ADDR_RT;
+				wb_data_src = WB_DATA_MEM;  // result given by CMU as read data
+				wb_wen = 1;
+				rs_used = 1;
+				rt_used = 1;
+			end
 			INST_CP0: begin
 				if (user_mode) begin
 					illegal = 1;
@@ -479,6 +504,9 @@ module controller (
 							CP0_CO_ERET: begin
 								exe_cp_oper = EXE_CP0_ERET;
 							end
+							CP0_CO_WAIT: begin
+								exe_cp_oper = EXE_CP0_WAIT;
+							end
 							default: begin
 								unrecognized = 1;
 							end
@@ -500,6 +528,9 @@ module controller (
 				unrecognized = 1;
 			end
 		endcase
+		is_simple = wb_wen & ~mem_ren & ~mem_wen & ~is_jump & ~is_privilege & ~syscall
+			& (wb_data_src == WB_DATA_ALU) & (exe_a_src != EXE_A_CP) & (exe_b_src != EXE_B_ZERO)
+			& ~(exe_signed & (exe_alu_oper == EXE_ALU_ADD || exe_alu_oper == EXE_ALU_SUB));
 	end
 	
 	always @(posedge clk) begin
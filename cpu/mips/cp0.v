@@ -56,6 +56,7 @@ module cp0 (
 	output reg id_rst,
 	output reg id_en,
 	input wire id_valid,
+	input wire id_split,  // ID stage is moving to the second instruction of a pair, which shares the fetch result with the first one
 	output reg exe_rst,
 	output reg exe_en,
 	input wire exe_valid,
@@ -67,14 +68,20 @@ module cp0 (
 	input wire wb_valid,
 	// MMU control
 	output reg mmu_inv,  // invalidate MMU signal
+	// power control
+	output reg sleep,  // pipeline halted by WAIT instruction, caches can be kept idle
 	// CP0 registers
-	output reg [31:0] sr, ear, epcr, ehbr, ier, icr, pdbr, tir, wdr
+	output reg [31:0] sr, ear, epcr, ehbr, ier, icr, pdbr, tir, wdr,
+	output reg [31:0] ivbr, iidr, ipr0, ipr1,
+	output reg [31:0] ccrl, ccrh, scr
 	);
 	
 	`include "mips_define.vh"
 	`include "function.vh"
 	parameter
 		CLK_FREQ = 100;  // main clock frequency in MHz
+	parameter
+		CPU_ID = 0;  // read-only core identification, distinguishes cores sharing the same boot code
 	localparam
 		WDR_CLK_DIV = CLK_FREQ * 1000000,
 		WDR_CLK_DIV_WIDTH = GET_WIDTH(WDR_CLK_DIV-1),
@@ -94,6 +101,14 @@ module cp0 (
 			CP0_PDBR: debug_data = pdbr;
 			CP0_TIR: debug_data = tir;
 			CP0_WDR: debug_data = wdr;
+			CP0_IVBR: debug_data = ivbr;
+			CP0_IIDR: debug_data = iidr;
+			CP0_IPR0: debug_data = ipr0;
+			CP0_IPR1: debug_data = ipr1;
+			CP0_CCRL: debug_data = ccrl;
+			CP0_CCRH: debug_data = ccrh;
+			CP0_SCR: debug_data = scr;
+			CP0_CIDR: debug_data = CPU_ID;
 			default: debug_data = 0;
 		endcase
 	end
@@ -111,6 +126,14 @@ module cp0 (
 			CP0_PDBR: data_r = pdbr;
 			CP0_TIR: data_r = tir;
 			CP0_WDR: data_r = wdr;
+			CP0_IVBR: data_r = ivbr;
+			CP0_IIDR: data_r = iidr;
+			CP0_IPR0: data_r = ipr0;
+			CP0_IPR1: data_r = ipr1;
+			CP0_CCRL: data_r = ccrl;
+			CP0_CCRH: data_r = ccrh;
+			CP0_SCR: data_r = scr;
+			CP0_CIDR: data_r = CPU_ID;
 			default: data_r = 0;
 		endcase
 	end
@@ -138,7 +161,7 @@ module cp0 (
 			inst_unauth_user_id <= 0;
 			unauth_exec_id <= 0;
 		end
-		else if (id_en) begin
+		else if (id_en && ~id_split) begin
 			inst_unalign_id <= inst_unalign;
 			inst_bus_err_id <= inst_bus_err;
 			inst_page_fault_id <= inst_page_fault;
@@ -271,10 +294,50 @@ module cp0 (
 		endcase
 	end
 	
+	// interrupt priority resolution, higher level wins and lower ID wins when levels are equal
+	wire [30:0] ir_pending;
+	wire [61:0] ir_levels;
+	reg ir_found;
+	reg [4:0] ir_id;
+	reg [1:0] ir_level;
+	integer i;
+	
+	assign
+		ir_pending = ier[30:0] & icr[30:0],
+		ir_levels = {ipr1[29:0], ipr0};
+	
+	always @(*) begin
+		ir_found = 0;
+		ir_id = 0;
+		ir_level = 0;
+		for (i=30; i>=0; i=i-1) begin
+			if (ir_pending[i] && (~ir_found || ir_levels[2*i+:2] >= ir_level)) begin
+				ir_found = 1;
+				ir_id = i;
+				ir_level = ir_levels[2*i+:2];
+			end
+		end
+	end
+	
 	wire ex, ir;
 	assign
 		ex = ex_code != EX_NONE,
-		ir = ier[31] & (|(ier[30:0] & icr[30:0]));
+		ir = ier[31] & ir_found & (~iidr[31] | (ir_level > iidr[9:8]));  // only higher level can preempt the one in service
+	
+	// WAIT instruction, halt the whole pipeline until any interrupt enabled in IER is pending
+	// the global enable bit is ignored, so that firmware can disable interrupts, check its condition and wait without losing wakeups
+	wire ir_wake;
+	assign
+		ir_wake = ir_found;
+	
+	always @(posedge clk) begin
+		if (rst || wd_rst)
+			sleep <= 0;
+		else if (sleep)
+			sleep <= ~ir_wake;
+		else if (oper == EXE_CP0_WAIT && exe_en && ~exception)
+			sleep <= ~ir_wake;
+	end
 	
 	// pipeline control
 	reg ir_en, ir_en_pending;
@@ -333,8 +396,18 @@ module cp0 (
 		end
 		else
 		`endif
+		// WAIT instruction is sleeping in MEM stage, freeze the whole pipeline.
+		// interrupt is not allowed in the cycle of waking up, so that WAIT retires and EPC points to the next instruction.
+		if (sleep) begin
+			if_en = 0;
+			id_en = 0;
+			exe_en = 0;
+			mem_en = 0;
+			wb_en = 0;
+			ir_en_pending = 0;
+		end
 		// these two stalls indicate that MMU/CACHE is fetching data, freeze the whole pipeline.
-		if (inst_stall || mem_stall) begin
+		else if (inst_stall || mem_stall) begin
 			if_en = 0;
 			id_en = 0;
 			exe_en = 0;
@@ -445,7 +518,10 @@ module cp0 (
 		end
 		else if (ir_valid) begin
 			exception = 1;
-			exception_target = {ehbr[31:2], 2'b00};
+			if (ivbr[0])
+				exception_target = {ivbr[31:8], ir_id, 3'b000};  // each vector has two instructions, jump and delay slot
+			else
+				exception_target = {ehbr[31:2], 2'b00};
 		end
 		else if (syscall_mem) begin
 			exception = 1;
@@ -511,6 +587,78 @@ module cp0 (
 			icr <= icr | {1'b0, ir_map, ir_timer};
 	end
 	
+	// Interrupt Vector Base Register
+	always @(posedge clk) begin
+		if (rst || wd_rst)
+			ivbr <= 0;
+		else if (oper == EXE_CP_STORE && addr_w == CP0_IVBR)
+			ivbr <= {data_w[31:8], 7'b0, data_w[0]};
+	end
+	
+	// Interrupt ID Register, in service flag and ID are kept for each level, so that ERET of a nested interrupt returns
+	// the service to the preempted one, {in service, 0[30:20], in service of each level[19:16], 0[15:10], level, 0[7:5], ID}
+	reg [3:0] ir_service;
+	reg [4:0] ir_service_id [0:3];
+	reg [1:0] ir_service_level;
+	
+	always @(*) begin
+		casez (ir_service)
+			4'b1???: ir_service_level = 3;
+			4'b01??: ir_service_level = 2;
+			4'b001?: ir_service_level = 1;
+			default: ir_service_level = 0;
+		endcase
+		iidr = {|ir_service, 11'b0, ir_service, 6'b0, ir_service_level, 3'b0, ir_service_id[ir_service_level]};
+	end
+	
+	always @(posedge clk) begin
+		if (rst || wd_rst) begin
+			ir_service <= 0;
+		end
+		else if (ir_valid) begin
+			ir_service[ir_level] <= 1;
+			ir_service_id[ir_level] <= ir_id;
+		end
+		else if (eret) begin
+			ir_service[ir_service_level] <= 0;  // the innermost one in service ends first
+		end
+		else if (oper == EXE_CP_STORE && addr_w == CP0_IIDR) begin
+			ir_service <= data_w[19:16] | ({3'b0, data_w[31]} << data_w[9:8]);
+			ir_service_id[data_w[9:8]] <= data_w[4:0];
+		end
+	end
+	
+	// Interrupt Priority Registers, two bits for each interrupt source
+	always @(posedge clk) begin
+		if (rst || wd_rst) begin
+			ipr0 <= 0;
+			ipr1 <= 0;
+		end
+		else if (oper == EXE_CP_STORE && addr_w == CP0_IPR0)
+			ipr0 <= data_w;
+		else if (oper == EXE_CP_STORE && addr_w == CP0_IPR1)
+			ipr1 <= {2'b0, data_w[29:0]};
+	end
+	
+	// Cycle Counter Registers (read only), 64-bit free-running counter of main clock
+	// read CCRH, CCRL and CCRH again, and retry if the two CCRH differ
+	always @(posedge clk) begin
+		if (rst)
+			{ccrh, ccrl} <= 0;
+		else
+			{ccrh, ccrl} <= {ccrh, ccrl} + 1'h1;
+	end
+	
+	// Sleep Counter Register, cycles spent in WAIT instruction
+	always @(posedge clk) begin
+		if (rst || wd_rst)
+			scr <= 0;
+		else if (oper == EXE_CP_STORE && addr_w == CP0_SCR)
+			scr <= data_w;
+		else if (sleep)
+			scr <= scr + 1'h1;
+	end
+	
 	// Page Directory Base Register
 	always @(posedge clk) begin
 		mmu_inv <= 0;
@@ -547,6 +695,10 @@ module cp0 (
 			wdr_sec_count <= 0;
 		end
 		`endif
+		else if (sleep) begin
+			wdr_clk_count <= 0;
+			wdr_sec_count <= 0;
+		end
 		else if (wdr_clk_count != WDR_CLK_DIV-1) begin
 			wdr_clk_count <= wdr_clk_count + 1'h1;
 		end
@@ -3,6 +3,8 @@
 
 /**
  * Data Path for MIPS 5-stage pipelined CPU.
+ * In dual-issue mode, an aligned pair of instructions is fetched at once, and the second one goes through another ALU pipe
+ * together with the first one if it is a simple ALU instruction independent of the first one, otherwise it is issued alone in the next cycle.
  * Author: Zhao, Hongyu  <power_zhy@foxmail.com>
  */
 module datapath (
@@ -29,9 +31,25 @@ module datapath (
 	input wire mem_ext_ctrl,  // whether using sign extended to memory data
 	input wire mem_ren_ctrl,  // memory read enable signal
 	input wire mem_wen_ctrl,  // memory write enable signal
+	input wire mem_link_ctrl,  // whether memory access is linked, LL when reading and SC when writing
 	input wire [1:0] wb_addr_src_ctrl,  // address source to write data back to registers
 	input wire [1:0] wb_data_src_ctrl,  // data source of data being written back to registers
 	input wire wb_wen_ctrl,  // register write enable signal
+	input wire is_jump_ctrl,  // whether current instruction is a jump or branch instruction
+	// control signals for the second instruction of pair
+	output reg [31:0] inst_data_b_ctrl,
+	output reg [31:0] data_rs_b_ctrl,
+	output reg [31:0] data_rt_b_ctrl,
+	input wire rs_used_b_ctrl,
+	input wire rt_used_b_ctrl,
+	input wire imm_ext_b_ctrl,
+	input wire [1:0] exe_a_src_b_ctrl,
+	input wire [1:0] exe_b_src_b_ctrl,
+	input wire [3:0] exe_alu_oper_b_ctrl,
+	input wire exe_signed_b_ctrl,
+	input wire [1:0] wb_addr_src_b_ctrl,
+	input wire wb_wen_b_ctrl,
+	input wire is_simple_b_ctrl,  // whether the second instruction can be issued together with the first one
 	// IF signals
 	input wire if_rst,  // stage reset signal
 	input wire if_en,  // stage enable signal
@@ -39,6 +57,8 @@ module datapath (
 	output reg inst_ren,  // instruction read enable signal
 	output reg [31:0] inst_addr,  // address of instruction needed
 	input wire [31:0] inst_data,  // instruction fetched
+	input wire [31:0] inst_data_next,  // the next instruction fetched together when address is aligned to 8 bytes
+	input wire inst_next_valid,  // whether the next instruction is valid
 	// ID signals
 	input wire id_rst,
 	input wire id_en,
@@ -46,6 +66,7 @@ module datapath (
 	output wire [4:0] cp_addr_r,  // address of co-processor register for data read
 	input wire [31:0] cp_data_r,  // data read from co-processor's register
 	output reg reg_stall,  // stall signal when LW instruction followed by an related R instruction
+	output reg id_split,  // the second instruction of pair can not be issued together and is going to be issued alone
 	// EXE signals
 	input wire exe_rst,
 	input wire exe_en,
@@ -61,6 +82,7 @@ module datapath (
 	output reg mem_valid,
 	output wire mem_ren,  // memory read enable signal
 	output wire mem_wen,  // memory write enable signal
+	output wire mem_link,  // whether memory access is linked, LL when reading and SC when writing
 	output wire [1:0] mem_type,  // memory access type (word, half, byte)
 	output wire mem_ext,  // whether using sign extended to memory data
 	output wire [31:0] mem_addr,  // address of memory
@@ -68,6 +90,7 @@ module datapath (
 	input wire [31:0] mem_din,  // data read from memory
 	output reg [31:0] inst_addr_mem,  // instruction address in MEM stage
 	output reg [31:0] inst_data_mem,  // instruction content in MEM stage
+	output reg pair_mem,  // whether the second instruction of a pair is in MEM stage together with the first one
 	// WB signals
 	input wire wb_rst,
 	input wire wb_en,
@@ -78,6 +101,8 @@ module datapath (
 	);
 	
 	`include "mips_define.vh"
+	parameter
+		DUAL_ISSUE = 0;  // whether to issue two instructions in one clock when possible
 	
 	// control signals
 	reg [1:0] exe_a_src_exe, exe_b_src_exe;
@@ -88,11 +113,13 @@ module datapath (
 	reg mem_ext_exe, mem_ext_mem;
 	reg mem_ren_exe, mem_ren_mem;
 	reg mem_wen_exe, mem_wen_mem;
+	reg mem_link_exe, mem_link_mem;
 	reg [1:0] wb_data_src_exe, wb_data_src_mem, wb_data_src_wb;
 	reg wb_wen_exe, wb_wen_mem, wb_wen_wb;
 	
 	// IF signals
 	wire [31:0] inst_addr_next;
+	reg fetch_pair;
 	
 	// ID signals
 	reg [31:0] inst_addr_id;
@@ -100,6 +127,12 @@ module datapath (
 	reg [4:0] regw_addr_id;
 	wire [4:0] addr_rs, addr_rt, addr_rd;
 	wire [31:0] data_rs, data_rt, data_imm;
+	reg b_pending;
+	reg pair_issue;
+	reg [4:0] regw_addr_b_id;
+	wire [4:0] addr_rs_b, addr_rt_b, addr_rd_b;
+	wire [31:0] data_rs_b, data_rt_b, data_imm_b;
+	reg reg_stall_b;
 	
 	// EXE signals
 	reg [31:0] inst_addr_exe;
@@ -109,17 +142,33 @@ module datapath (
 	reg [31:0] opa_exe, opb_exe;
 	reg [31:0] data_rs_exe, data_rt_exe, data_imm_exe, cp_data_exe;
 	wire [31:0] alu_out_exe;
+	reg [31:0] inst_data_b_exe;
+	reg [4:0] regw_addr_b_exe;
+	reg [31:0] opa_b_exe, opb_b_exe;
+	reg [31:0] data_rs_b_exe, data_rt_b_exe, data_imm_b_exe;
+	reg [1:0] exe_a_src_b_exe, exe_b_src_b_exe;
+	reg [3:0] exe_alu_oper_b_exe;
+	reg exe_signed_b_exe;
+	reg wb_wen_b_exe;
+	reg pair_exe;
+	wire [31:0] alu_out_b_exe;
 	
 	// MEM signals
 	reg [4:0] regw_addr_mem;
 	reg [31:0] data_rt_mem;
 	reg [31:0] alu_out_mem;
+	reg [4:0] regw_addr_b_mem;
+	reg [31:0] alu_out_b_mem;
+	reg wb_wen_b_mem;
 	
 	// WB signals
 	reg [31:0] alu_out_wb;
 	reg [31:0] mem_din_wb;
 	reg [4:0] regw_addr_wb;
 	reg [31:0] regw_data_wb;
+	reg [4:0] regw_addr_b_wb;
+	reg [31:0] alu_out_b_wb;
+	reg wb_wen_b_wb;
 	
 	// debug
 	`ifdef DEBUG
@@ -156,6 +205,11 @@ module datapath (
 		if_valid = ~if_rst & (if_en | exception);
 	end
 	
+	// privilege instructions are never fetched in pair, as the following one must be fetched after it completes
+	always @(*) begin
+		fetch_pair = DUAL_ISSUE && inst_next_valid && inst_addr[2:0] == 0 && inst_data[31:26] != INST_CP0 && inst_data[31:26] != INST_CACHE;
+	end
+	
 	always @(posedge clk) begin
 		if (if_rst) begin
 			inst_ren <= 0;
@@ -168,7 +222,14 @@ module datapath (
 		else if (if_en) begin
 			inst_ren <= 1;
 			case (pc_src_ctrl)
-				PC_NEXT: inst_addr <= inst_addr_next;
+				PC_NEXT: begin
+					if (id_split)
+						inst_addr <= inst_addr;
+					else if (fetch_pair)
+						inst_addr <= inst_addr + 8;
+					else
+						inst_addr <= inst_addr_next;
+				end
 				PC_JUMP: inst_addr <= {inst_addr_id[31:28], inst_data_ctrl[25:0], 2'b0};
 				PC_JR: inst_addr <= data_rs_ctrl;
 				PC_BRANCH: inst_addr <= inst_addr_next_id + {data_imm[29:0], 2'b0};
@@ -184,12 +245,25 @@ module datapath (
 			inst_addr_id <= 0;
 			inst_data_ctrl <= 0;
 			inst_addr_next_id <= 0;
+			inst_data_b_ctrl <= 0;
+			b_pending <= 0;
 		end
 		else if (id_en) begin
-			id_valid <= if_valid;
-			inst_addr_id <= inst_addr;
-			inst_data_ctrl <= inst_data;
-			inst_addr_next_id <= inst_addr_next;
+			if (id_split) begin  // move the second instruction to the first place, IF stage is kept
+				inst_addr_id <= inst_addr_next_id;
+				inst_data_ctrl <= inst_data_b_ctrl;
+				inst_addr_next_id <= inst_addr_next_id + 4;
+				inst_data_b_ctrl <= 0;
+				b_pending <= 0;
+			end
+			else begin
+				id_valid <= if_valid;
+				inst_addr_id <= inst_addr;
+				inst_data_ctrl <= inst_data;
+				inst_addr_next_id <= inst_addr_next;
+				inst_data_b_ctrl <= inst_data_next;
+				b_pending <= if_valid & fetch_pair & (pc_src_ctrl == PC_NEXT);  // drop the second one if the first one is a delay slot of a taken jump
+			end
 		end
 	end
 	
@@ -209,6 +283,21 @@ module datapath (
 		endcase
 	end
 	
+	assign
+		addr_rs_b = inst_data_b_ctrl[25:21],
+		addr_rt_b = inst_data_b_ctrl[20:16],
+		addr_rd_b = inst_data_b_ctrl[15:11],
+		data_imm_b = imm_ext_b_ctrl ? {{16{inst_data_b_ctrl[15]}}, inst_data_b_ctrl[15:0]} : {16'b0, inst_data_b_ctrl[15:0]};
+	
+	always @(*) begin
+		regw_addr_b_id = addr_rd_b;
+		case (wb_addr_src_b_ctrl)
+			WB_ADDR_RD: regw_addr_b_id = addr_rd_b;
+			WB_ADDR_RT: regw_addr_b_id = addr_rt_b;
+			WB_ADDR_LINK: regw_addr_b_id = GPR_RA;
+		endcase
+	end
+	
 	regfile #(
 		.ADDR_BITS(5),
 		.DATA_BITS(32)
@@ -222,23 +311,37 @@ module datapath (
 		.data_a(data_rs),
 		.addr_b(addr_rt),
 		.data_b(data_rt),
+		.addr_c(DUAL_ISSUE ? addr_rs_b : 5'b0),
+		.data_c(data_rs_b),
+		.addr_d(DUAL_ISSUE ? addr_rt_b : 5'b0),
+		.data_d(data_rt_b),
 		.en_w(wb_wen_wb),
 		.addr_w(regw_addr_wb),
-		.data_w(regw_data_wb)
+		.data_w(regw_data_wb),
+		.en_x(wb_wen_b_wb),
+		.addr_x(regw_addr_b_wb),
+		.data_x(alu_out_b_wb)
 		);
 	
+	// as the second instruction of pair is younger than the first one in the same stage, check it first
 	always @(*) begin  // use forwarding to reduce stall frequency
 		data_rs_ctrl = data_rs;
 		data_rt_ctrl = data_rt;
 		reg_stall = 0;
 		if (rs_used_ctrl && addr_rs != 0) begin
-			if (regw_addr_exe == addr_rs && wb_wen_exe) begin
+			if (regw_addr_b_exe == addr_rs && wb_wen_b_exe) begin
+				data_rs_ctrl = alu_out_b_exe;
+			end
+			else if (regw_addr_exe == addr_rs && wb_wen_exe) begin
 				case (wb_data_src_exe)
 					WB_DATA_ALU: data_rs_ctrl = alu_out_exe;
 					WB_DATA_MEM: reg_stall = 1;
 					WB_DATA_LINK: data_rs_ctrl = alu_out_exe;
 				endcase
 			end
+			else if (regw_addr_b_mem == addr_rs && wb_wen_b_mem) begin
+				data_rs_ctrl = alu_out_b_mem;
+			end
 			else if (regw_addr_mem == addr_rs && wb_wen_mem) begin
 				case (wb_data_src_mem)
 					WB_DATA_ALU: data_rs_ctrl = alu_out_mem;
@@ -248,13 +351,19 @@ module datapath (
 			end
 		end
 		if (rt_used_ctrl && addr_rt != 0) begin
-			if (regw_addr_exe == addr_rt && wb_wen_exe) begin
+			if (regw_addr_b_exe == addr_rt && wb_wen_b_exe) begin
+				data_rt_ctrl = alu_out_b_exe;
+			end
+			else if (regw_addr_exe == addr_rt && wb_wen_exe) begin
 				case (wb_data_src_exe)
 					WB_DATA_ALU: data_rt_ctrl = alu_out_exe;
 					WB_DATA_MEM: reg_stall = 1;
 					WB_DATA_LINK: data_rt_ctrl = alu_out_exe;
 				endcase
 			end
+			else if (regw_addr_b_mem == addr_rt && wb_wen_b_mem) begin
+				data_rt_ctrl = alu_out_b_mem;
+			end
 			else if (regw_addr_mem == addr_rt && wb_wen_mem) begin
 				case (wb_data_src_mem)
 					WB_DATA_ALU: data_rt_ctrl = alu_out_mem;
@@ -265,6 +374,73 @@ module datapath (
 		end
 	end
 	
+	always @(*) begin
+		data_rs_b_ctrl = data_rs_b;
+		data_rt_b_ctrl = data_rt_b;
+		reg_stall_b = 0;
+		if (rs_used_b_ctrl && addr_rs_b != 0) begin
+			if (regw_addr_b_exe == addr_rs_b && wb_wen_b_exe) begin
+				data_rs_b_ctrl = alu_out_b_exe;
+			end
+			else if (regw_addr_exe == addr_rs_b && wb_wen_exe) begin
+				case (wb_data_src_exe)
+					WB_DATA_ALU: data_rs_b_ctrl = alu_out_exe;
+					WB_DATA_MEM: reg_stall_b = 1;
+					WB_DATA_LINK: data_rs_b_ctrl = alu_out_exe;
+				endcase
+			end
+			else if (regw_addr_b_mem == addr_rs_b && wb_wen_b_mem) begin
+				data_rs_b_ctrl = alu_out_b_mem;
+			end
+			else if (regw_addr_mem == addr_rs_b && wb_wen_mem) begin
+				case (wb_data_src_mem)
+					WB_DATA_ALU: data_rs_b_ctrl = alu_out_mem;
+					WB_DATA_MEM: data_rs_b_ctrl = mem_din;
+					WB_DATA_LINK: data_rs_b_ctrl = alu_out_mem;
+				endcase
+			end
+		end
+		if (rt_used_b_ctrl && addr_rt_b != 0) begin
+			if (regw_addr_b_exe == addr_rt_b && wb_wen_b_exe) begin
+				data_rt_b_ctrl = alu_out_b_exe;
+			end
+			else if (regw_addr_exe == addr_rt_b && wb_wen_exe) begin
+				case (wb_data_src_exe)
+					WB_DATA_ALU: data_rt_b_ctrl = alu_out_exe;
+					WB_DATA_MEM: reg_stall_b = 1;
+					WB_DATA_LINK: data_rt_b_ctrl = alu_out_exe;
+				endcase
+			end
+			else if (regw_addr_b_mem == addr_rt_b && wb_wen_b_mem) begin
+				data_rt_b_ctrl = alu_out_b_mem;
+			end
+			else if (regw_addr_mem == addr_rt_b && wb_wen_mem) begin
+				case (wb_data_src_mem)
+					WB_DATA_ALU: data_rt_b_ctrl = alu_out_mem;
+					WB_DATA_MEM: data_rt_b_ctrl = mem_din;
+					WB_DATA_LINK: data_rt_b_ctrl = alu_out_mem;
+				endcase
+			end
+		end
+	end
+	
+	// pairing rules, the first one must not be a jump (whose delay slot is the second one), and the second one must not depend on the first one
+	always @(*) begin
+		pair_issue = 0;
+		if (DUAL_ISSUE && b_pending && is_simple_b_ctrl && ~is_jump_ctrl && ~reg_stall && ~reg_stall_b) begin
+			pair_issue = 1;
+			if (wb_wen_ctrl && regw_addr_id != 0) begin
+				if (rs_used_b_ctrl && addr_rs_b == regw_addr_id)
+					pair_issue = 0;
+				if (rt_used_b_ctrl && addr_rt_b == regw_addr_id)
+					pair_issue = 0;
+				if (wb_wen_b_ctrl && regw_addr_b_id == regw_addr_id)
+					pair_issue = 0;
+			end
+		end
+		id_split = b_pending & ~pair_issue;
+	end
+	
 	// EXE stage
 	always @(posedge clk) begin
 		if (exe_rst) begin
@@ -286,8 +462,20 @@ module datapath (
 			mem_ext_exe <= 0;
 			mem_ren_exe <= 0;
 			mem_wen_exe <= 0;
+			mem_link_exe <= 0;
 			wb_data_src_exe <= 0;
 			wb_wen_exe <= 0;
+			inst_data_b_exe <= 0;
+			regw_addr_b_exe <= 0;
+			data_rs_b_exe <= 0;
+			data_rt_b_exe <= 0;
+			data_imm_b_exe <= 0;
+			exe_a_src_b_exe <= 0;
+			exe_b_src_b_exe <= 0;
+			exe_alu_oper_b_exe <= 0;
+			exe_signed_b_exe <= 0;
+			wb_wen_b_exe <= 0;
+			pair_exe <= 0;
 		end
 		else if (exe_en) begin
 			exe_valid <= id_valid;
@@ -308,8 +496,20 @@ module datapath (
 			mem_ext_exe <= mem_ext_ctrl;
 			mem_ren_exe <= mem_ren_ctrl;
 			mem_wen_exe <= mem_wen_ctrl;
+			mem_link_exe <= mem_link_ctrl;
 			wb_data_src_exe <= wb_data_src_ctrl;
 			wb_wen_exe <= wb_wen_ctrl;
+			inst_data_b_exe <= inst_data_b_ctrl;
+			regw_addr_b_exe <= regw_addr_b_id;
+			data_rs_b_exe <= data_rs_b_ctrl;
+			data_rt_b_exe <= data_rt_b_ctrl;
+			data_imm_b_exe <= data_imm_b;
+			exe_a_src_b_exe <= exe_a_src_b_ctrl;
+			exe_b_src_b_exe <= exe_b_src_b_ctrl;
+			exe_alu_oper_b_exe <= exe_alu_oper_b_ctrl;
+			exe_signed_b_exe <= exe_signed_b_ctrl;
+			wb_wen_b_exe <= wb_wen_b_ctrl & pair_issue;
+			pair_exe <= id_valid & pair_issue;
 		end
 	end
 	
@@ -346,6 +546,28 @@ module datapath (
 	
 	assign math_divide_zero = 0;
 	
+	always @(*) begin
+		opa_b_exe = data_rs_b_exe;
+		opb_b_exe = data_rt_b_exe;
+		case (exe_a_src_b_exe)
+			EXE_A_RS: opa_b_exe = data_rs_b_exe;
+			EXE_A_SA: opa_b_exe = {27'b0, inst_data_b_exe[10:6]};
+		endcase
+		case (exe_b_src_b_exe)
+			EXE_B_RT: opb_b_exe = data_rt_b_exe;
+			EXE_B_IMM: opb_b_exe = data_imm_b_exe;
+		endcase
+	end
+	
+	alu ALU_B (
+		.a(opa_b_exe),
+		.b(opb_b_exe),
+		.sign(exe_signed_b_exe),
+		.oper(exe_alu_oper_b_exe),
+		.result(alu_out_b_exe),
+		.overflow()
+		);
+	
 	// MEM stage
 	always @(posedge clk) begin
 		if (mem_rst) begin
@@ -359,8 +581,13 @@ module datapath (
 			mem_ext_mem <= 0;
 			mem_ren_mem <= 0;
 			mem_wen_mem <= 0;
+			mem_link_mem <= 0;
 			wb_data_src_mem <= 0;
 			wb_wen_mem <= 0;
+			regw_addr_b_mem <= 0;
+			alu_out_b_mem <= 0;
+			wb_wen_b_mem <= 0;
+			pair_mem <= 0;
 		end
 		else if (mem_en) begin
 			mem_valid <= exe_valid;
@@ -373,14 +600,20 @@ module datapath (
 			mem_ext_mem <= mem_ext_exe;
 			mem_ren_mem <= mem_ren_exe;
 			mem_wen_mem <= mem_wen_exe;
+			mem_link_mem <= mem_link_exe;
 			wb_data_src_mem <= wb_data_src_exe;
 			wb_wen_mem <= wb_wen_exe;
+			regw_addr_b_mem <= regw_addr_b_exe;
+			alu_out_b_mem <= alu_out_b_exe;
+			wb_wen_b_mem <= wb_wen_b_exe;
+			pair_mem <= pair_exe;
 		end
 	end
 	
 	assign
 		mem_ren = mem_ren_mem,
 		mem_wen = mem_wen_mem,
+		mem_link = mem_link_mem,
 		mem_type = mem_type_mem,
 		mem_ext = mem_ext_mem,
 		mem_addr = alu_out_mem,
@@ -395,6 +628,9 @@ module datapath (
 			regw_addr_wb <= 0;
 			alu_out_wb <= 0;
 			mem_din_wb <= 0;
+			wb_wen_b_wb <= 0;
+			regw_addr_b_wb <= 0;
+			alu_out_b_wb <= 0;
 		end
 		else if (wb_en) begin
 			wb_valid <= mem_valid;
@@ -403,6 +639,9 @@ module datapath (
 			regw_addr_wb <= regw_addr_mem;
 			alu_out_wb <= alu_out_mem;
 			mem_din_wb <= mem_din;
+			wb_wen_b_wb <= wb_wen_b_mem;
+			regw_addr_b_wb <= regw_addr_b_mem;
+			alu_out_b_wb <= alu_out_b_mem;
 		end
 	end
 	
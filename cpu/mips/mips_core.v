@@ -25,6 +25,8 @@ module mips_core (
 	input wire inst_stall,  // stall signal when IMMU/ICACHE is fetching data
 	output wire [31:0] inst_addr,  // address of instruction needed
 	input wire [31:0] inst_data,  // instruction fetched
+	input wire [31:0] inst_data_next,  // the next instruction fetched together when address is aligned to 8 bytes, only used in dual-issue mode
+	input wire inst_next_valid,  // whether the next instruction is valid
 	input wire inst_unalign,  // instruction address unaligned exception
 	input wire inst_bus_err,  // instruction bus read error
 	input wire inst_page_fault,  // instruction page fault exception
@@ -35,6 +37,7 @@ module mips_core (
 	// memory interfaces
 	output wire mem_ren,  // memory read enable signal
 	output wire mem_wen,  // memory write enable signal
+	output wire mem_link,  // whether memory access is linked, LL when reading and SC when writing
 	input wire mem_stall,  // stall signal when DMMU/DCACHE is fetching data
 	output wire [1:0] mem_type,  // memory access type (word, half, byte)
 	output wire mem_ext,  // whether using sign extended to memory data
@@ -51,13 +54,23 @@ module mips_core (
 	// interrupt interfaces
 	input wire [30:1] ir_map,  // device interrupt signals
 	output wire wd_rst,  // watch dog reset, must not affect the global reset signal
-	output wire exception  // exception occurred signal
+	output wire exception,  // exception occurred signal
+	// power control
+	output wire sleep,  // pipeline halted by WAIT instruction
+	// trace interfaces
+	output wire retire_valid,  // one instruction left MEM stage without exception
+	output wire [31:0] retire_pc,  // address of the instruction retired
+	output wire retire_pair  // the second instruction of a pair at retire_pc+4 also retired, only in dual-issue mode
 	);
 	
 	parameter
 		CLK_FREQ = 100;  // main clock frequency in MHz
 	parameter
 		PAGE_ADDR_BITS = 12;  // address length inside one memory page
+	parameter
+		DUAL_ISSUE = 0;  // whether to issue two instructions in one clock when possible
+	parameter
+		CPU_ID = 0;  // core identification read from CP0
 	
 	// debug
 	`ifdef DEBUG
@@ -80,17 +93,32 @@ module mips_core (
 	wire mem_ext_ctrl;
 	wire mem_ren_ctrl;
 	wire mem_wen_ctrl;
+	wire mem_link_ctrl;
 	wire [1:0] wb_addr_src_ctrl;
 	wire [1:0] wb_data_src_ctrl;
 	wire wb_wen_ctrl;
 	
 	wire [31:0] data_rs_ctrl, data_rt_ctrl;
 	wire rs_used_ctrl, rt_used_ctrl;
+	wire is_jump_ctrl;
+	
+	// control signals for the second instruction of pair
+	wire [31:0] inst_data_b_ctrl;
+	wire imm_ext_b_ctrl;
+	wire [1:0] exe_a_src_b_ctrl;
+	wire [1:0] exe_b_src_b_ctrl;
+	wire [3:0] exe_alu_oper_b_ctrl;
+	wire exe_signed_b_ctrl;
+	wire [1:0] wb_addr_src_b_ctrl;
+	wire wb_wen_b_ctrl;
+	wire [31:0] data_rs_b_ctrl, data_rt_b_ctrl;
+	wire rs_used_b_ctrl, rt_used_b_ctrl;
+	wire is_simple_b_ctrl;
 	
 	wire is_delay_slot, is_privilege;
 	wire reg_stall;
 	wire if_rst, if_en, if_valid;
-	wire id_rst, id_en, id_valid;
+	wire id_rst, id_en, id_valid, id_split;
 	wire exe_rst, exe_en, exe_valid;
 	wire mem_rst, mem_en, mem_valid;
 	wire wb_rst, wb_en, wb_valid;
@@ -101,6 +129,7 @@ module mips_core (
 	wire syscall;
 	wire [31:0] exception_target;
 	wire [31:0] inst_addr_mem, inst_data_mem;
+	wire pair_mem;
 	
 	// co-processor signals
 	wire [1:0] cp_oper;
@@ -109,6 +138,8 @@ module mips_core (
 	
 	// CP0 registers
 	wire [31:0] sr, ear, epcr, ehbr, ier, icr, pdbr, tir, wdr;
+	wire [31:0] ivbr, iidr, ipr0, ipr1;
+	wire [31:0] ccrl, ccrh, scr;
 	
 	// controller
 	controller CONTROLLER (
@@ -130,9 +161,12 @@ module mips_core (
 		.mem_ext(mem_ext_ctrl),
 		.mem_ren(mem_ren_ctrl),
 		.mem_wen(mem_wen_ctrl),
+		.mem_link(mem_link_ctrl),
 		.wb_addr_src(wb_addr_src_ctrl),
 		.wb_data_src(wb_data_src_ctrl),
 		.wb_wen(wb_wen_ctrl),
+		.is_jump(is_jump_ctrl),
+		.is_simple(),
 		.is_delay_slot(is_delay_slot),
 		.is_privilege(is_privilege),
 		.syscall(syscall),
@@ -144,8 +178,47 @@ module mips_core (
 		.unrecognized(inst_unrecognize)
 	);
 	
+	// controller for the second instruction of pair, only simple ALU instructions are accepted
+	controller CONTROLLER_B (
+		.clk(clk),
+		.rst(id_rst),
+		.ctrl_en(1'b0),
+		.inst(inst_data_b_ctrl),
+		.data_rs(data_rs_b_ctrl),
+		.data_rt(data_rt_b_ctrl),
+		.user_mode(user_mode),
+		.pc_src(),
+		.imm_ext(imm_ext_b_ctrl),
+		.exe_a_src(exe_a_src_b_ctrl),
+		.exe_b_src(exe_b_src_b_ctrl),
+		.exe_alu_oper(exe_alu_oper_b_ctrl),
+		.exe_cp_oper(),
+		.exe_signed(exe_signed_b_ctrl),
+		.mem_type(),
+		.mem_ext(),
+		.mem_ren(),
+		.mem_wen(),
+		.mem_link(),
+		.wb_addr_src(wb_addr_src_b_ctrl),
+		.wb_data_src(),
+		.wb_wen(wb_wen_b_ctrl),
+		.is_jump(),
+		.is_simple(is_simple_b_ctrl),
+		.is_delay_slot(),
+		.is_privilege(),
+		.syscall(),
+		.ic_inv(),
+		.dc_inv(),
+		.rs_used(rs_used_b_ctrl),
+		.rt_used(rt_used_b_ctrl),
+		.illegal(),
+		.unrecognized()
+	);
+	
 	// data path
-	datapath DATAPATH (
+	datapath #(
+		.DUAL_ISSUE(DUAL_ISSUE)
+		) DATAPATH (
 		.clk(clk),
 		`ifdef DEBUG
 		.debug_addr(debug_addr[5:0]),
@@ -167,18 +240,36 @@ module mips_core (
 		.mem_ext_ctrl(mem_ext_ctrl),
 		.mem_ren_ctrl(mem_ren_ctrl),
 		.mem_wen_ctrl(mem_wen_ctrl),
+		.mem_link_ctrl(mem_link_ctrl),
 		.wb_addr_src_ctrl(wb_addr_src_ctrl),
 		.wb_data_src_ctrl(wb_data_src_ctrl),
 		.wb_wen_ctrl(wb_wen_ctrl),
+		.is_jump_ctrl(is_jump_ctrl),
+		.inst_data_b_ctrl(inst_data_b_ctrl),
+		.data_rs_b_ctrl(data_rs_b_ctrl),
+		.data_rt_b_ctrl(data_rt_b_ctrl),
+		.rs_used_b_ctrl(rs_used_b_ctrl),
+		.rt_used_b_ctrl(rt_used_b_ctrl),
+		.imm_ext_b_ctrl(imm_ext_b_ctrl),
+		.exe_a_src_b_ctrl(exe_a_src_b_ctrl),
+		.exe_b_src_b_ctrl(exe_b_src_b_ctrl),
+		.exe_alu_oper_b_ctrl(exe_alu_oper_b_ctrl),
+		.exe_signed_b_ctrl(exe_signed_b_ctrl),
+		.wb_addr_src_b_ctrl(wb_addr_src_b_ctrl),
+		.wb_wen_b_ctrl(wb_wen_b_ctrl),
+		.is_simple_b_ctrl(is_simple_b_ctrl),
 		.if_rst(if_rst),
 		.if_en(if_en),
 		.if_valid(if_valid),
 		.inst_ren(inst_ren),
 		.inst_addr(inst_addr),
 		.inst_data(inst_data),
+		.inst_data_next(inst_data_next),
+		.inst_next_valid(inst_next_valid),
 		.id_rst(id_rst),
 		.id_en(id_en),
 		.id_valid(id_valid),
+		.id_split(id_split),
 		.cp_addr_r(cp_addr_r),
 		.cp_data_r(cp_data_r),
 		.reg_stall(reg_stall),
@@ -195,6 +286,7 @@ module mips_core (
 		.mem_valid(mem_valid),
 		.mem_ren(mem_ren),
 		.mem_wen(mem_wen),
+		.mem_link(mem_link),
 		.mem_type(mem_type),
 		.mem_ext(mem_ext),
 		.mem_addr(mem_addr),
@@ -202,6 +294,7 @@ module mips_core (
 		.mem_din(mem_din),
 		.inst_addr_mem(inst_addr_mem),
 		.inst_data_mem(inst_data_mem),
+		.pair_mem(pair_mem),
 		.wb_rst(wb_rst),
 		.wb_en(wb_en),
 		.wb_valid(wb_valid),
@@ -211,7 +304,8 @@ module mips_core (
 	
 	// co-processor 0
 	cp0 #(
-		.CLK_FREQ(CLK_FREQ)
+		.CLK_FREQ(CLK_FREQ),
+		.CPU_ID(CPU_ID)
 		) CP0 (
 		.clk(clk),
 		`ifdef DEBUG
@@ -259,6 +353,7 @@ module mips_core (
 		.id_rst(id_rst),
 		.id_en(id_en),
 		.id_valid(id_valid),
+		.id_split(id_split),
 		.exe_rst(exe_rst),
 		.exe_en(exe_en),
 		.exe_valid(exe_valid),
@@ -269,6 +364,7 @@ module mips_core (
 		.wb_en(wb_en),
 		.wb_valid(wb_valid),
 		.mmu_inv(mmu_inv),
+		.sleep(sleep),
 		.sr(sr),
 		.ear(ear),
 		.epcr(epcr),
@@ -277,7 +373,14 @@ module mips_core (
 		.icr(icr),
 		.pdbr(pdbr),
 		.tir(tir),
-		.wdr(wdr)
+		.wdr(wdr),
+		.ivbr(ivbr),
+		.iidr(iidr),
+		.ipr0(ipr0),
+		.ipr1(ipr1),
+		.ccrl(ccrl),
+		.ccrh(ccrh),
+		.scr(scr)
 		);
 	
 	assign
@@ -287,5 +390,9 @@ module mips_core (
 	assign
 		ic_lock = ~if_en,
 		dc_lock = ~mem_en;
+	assign
+		retire_valid = mem_valid & mem_en & ~exception,
+		retire_pc = inst_addr_mem,
+		retire_pair = mem_valid & mem_en & ~exception & pair_mem;
 	
 endmodule
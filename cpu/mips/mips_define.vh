@@ -44,7 +44,8 @@ localparam
 localparam
 	EXE_CP_NONE   = 0,
 	EXE_CP_STORE  = 1,
-	EXE_CP0_ERET  = 2;
+	EXE_CP0_ERET  = 2,
+	EXE_CP0_WAIT  = 3;
 
 // WB address sources
 localparam
@@ -137,6 +138,7 @@ localparam  // bit 31:26 for instruction type
 	CP_FUNC_MF     = 4'b0000,
 	CP_FUNC_MT     = 4'b0100,
 	CP0_CO_ERET     = 6'b011000,
+	CP0_CO_WAIT     = 6'b100000,
 	INST_LB         = 6'b100000,
 	INST_LH         = 6'b100001,
 	INST_LW         = 6'b100011,
@@ -145,7 +147,9 @@ localparam  // bit 31:26 for instruction type
 	INST_SB         = 6'b101000,
 	INST_SH         = 6'b101001,
 	INST_SW         = 6'b101011,
-	INST_CACHE      = 6'B101111;
+	INST_CACHE      = 6'B101111,
+	INST_LL         = 6'b110000,  // load linked, word only
+	INST_SC         = 6'b111000;  // store conditional, word only, RT gets 1 when stored or 0 when failed
 
 // general registers
 localparam
@@ -192,4 +196,12 @@ localparam
 	CP0_ICR   = 5,
 	CP0_PDBR  = 6,
 	CP0_TIR   = 7,
-	CP0_WDR   = 8;
+	CP0_WDR   = 8,
+	CP0_IVBR  = 9,
+	CP0_IIDR  = 10,
+	CP0_IPR0  = 11,
+	CP0_IPR1  = 12,
+	CP0_CCRL  = 13,
+	CP0_CCRH  = 14,
+	CP0_SCR   = 15,
+	CP0_CIDR  = 16;
@@ -18,10 +18,20 @@ module regfile (
 	// read channel B
 	input wire [ADDR_BITS-1:0] addr_b,
 	output reg [DATA_BITS-1:0] data_b,
+	// read channel C
+	input wire [ADDR_BITS-1:0] addr_c,
+	output reg [DATA_BITS-1:0] data_c,
+	// read channel D
+	input wire [ADDR_BITS-1:0] addr_d,
+	output reg [DATA_BITS-1:0] data_d,
 	// write channel W
 	input wire en_w,
 	input wire [ADDR_BITS-1:0] addr_w,
-	input wire [DATA_BITS-1:0] data_w
+	input wire [DATA_BITS-1:0] data_w,
+	// write channel X, wins when writing the same register as channel W
+	input wire en_x,
+	input wire [ADDR_BITS-1:0] addr_x,
+	input wire [DATA_BITS-1:0] data_x
 	);
 	
 	parameter
@@ -34,12 +44,16 @@ module regfile (
 	always @(negedge clk) begin
 		if (en_w && addr_w != 0)
 			regfile[addr_w] <= data_w;
+		if (en_x && addr_x != 0)
+			regfile[addr_x] <= data_x;
 	end
 	
 	// read
 	always @(*) begin
 		data_a = addr_a == 0 ? 0 : regfile[addr_a];
 		data_b = addr_b == 0 ? 0 : regfile[addr_b];
+		data_c = addr_c == 0 ? 0 : regfile[addr_c];
+		data_d = addr_d == 0 ? 0 : regfile[addr_d];
 	end
 	
 	// debug
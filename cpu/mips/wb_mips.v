@@ -41,19 +41,41 @@ module wb_mips (
 	output wire [31:0] dcmu_data_o,
 	input wire dcmu_ack_i,
 	input wire dcmu_err_i,
+	// bus snooping, writes on bus by other masters invalidate cached copies
+	input wire [31:2] snoop_addr,  // address being written
+	input wire snoop_we,  // write acknowledged in this clock
+	input wire [2:0] snoop_master,  // master index of the write in arbitrator
 	// interrupt interfaces
 	input wire [30:1] ir_map,  // device interrupt signals
-	output wire wd_rst  // watch dog reset, must not affect the global reset signal
+	output wire wd_rst,  // watch dog reset, must not affect the global reset signal
+	// trace interfaces, for wb_trace
+	output wire retire_valid,  // one instruction retired in this clock
+	output wire [31:0] retire_pc,  // address of the instruction retired
+	output wire retire_pair,  // the second instruction of a dual issued pair at retire_pc+4 also retired
+	output wire retire_exception  // exception, interrupt or ERET taken in this clock
 	);
 	
 	`include "cpu_define.vh"
 	parameter
 		CLK_FREQ = 100;  // main clock frequency in MHz
+	parameter
+		DUAL_ISSUE = 0;  // whether to issue two instructions in one clock when possible
+	parameter
+		CPU_ID = 0,  // core identification read from CP0 register CIDR
+		COHERENT = 0,  // write through data cache and invalidate both caches by snooping, for multiple cores
+		ICMU_MASTER = 1,  // master index of ICMU in arbitrator, to ignore own writes in snooping
+		DCMU_MASTER = 2;  // master index of DCMU in arbitrator
 	parameter
 		IT_LINE_NUM = 16,  // number of lines in instruction TLB, must be the power of 2
 		DT_LINE_NUM = 16,  // number of lines in data TLB, must be the power of 2
 		IC_LINE_NUM = 64,  // number of lines in instruction cache, must be the power of 2
 		DC_LINE_NUM = 64;  // number of lines in data cache, must be the power of 2
+	parameter
+		IC_LINE_WORDS = 4,  // number of words per-line in instruction cache, must be the power of 2 and at least 2
+		IC_PREFETCH = 1;  // whether instruction cache prefetches the next line when fetching reaches the end of one
+	parameter
+		SPM_ADDR_BITS = 13,  // address length of scratchpad memory, 8KB
+		SPM_BASE = 32'hFE000000;  // physical base address of scratchpad memory, aligned to its size, never cached or seen on bus
 	localparam
 		PAGE_ADDR_BITS = 12;  // address length inside one memory page
 	
@@ -68,6 +90,8 @@ module wb_mips (
 	wire [31:PAGE_ADDR_BITS] inst_addr_logical, inst_addr_physical;
 	wire [PAGE_ADDR_BITS-1:0] inst_addr_page;
 	wire [31:0] inst_data;
+	wire [31:0] inst_data_next;
+	wire inst_next_valid;
 	wire inst_unalign, inst_bus_err, inst_page_fault;
 	wire inst_unauth_user, inst_unauth_exec;
 	wire ic_en, ic_lock;
@@ -78,7 +102,7 @@ module wb_mips (
 	reg [31:0] itlb_data;
 	
 	// memory signals
-	wire mem_ren, mem_wen, mem_suspend;
+	wire mem_ren, mem_wen, mem_link, mem_suspend;
 	wire dmmu_stall, dcache_stall, mem_stall;
 	wire [1:0] mem_type;
 	wire mem_ext;
@@ -95,10 +119,24 @@ module wb_mips (
 	reg dtlb_ack;
 	reg [31:0] dtlb_data;
 	
+	// scratchpad signals
+	wire [31:0] ispm_addr, dspm_addr;
+	wire [3:0] ispm_edit, dspm_edit;
+	wire [31:0] ispm_din, dspm_din;
+	wire [31:0] ispm_dout, ispm_dout_next, dspm_dout;
+	
 	wire exception;
+	wire sleep;
 	wire inst_auth_user, inst_auth_exec;
 	wire mem_auth_user, mem_auth_write;
 	
+	// snooping
+	wire ic_snoop_inv, dc_snoop_inv, dc_snoop_we;
+	assign
+		ic_snoop_inv = COHERENT && snoop_we && snoop_master != ICMU_MASTER,
+		dc_snoop_inv = COHERENT && snoop_we && snoop_master != DCMU_MASTER,
+		dc_snoop_we = snoop_we && snoop_master != DCMU_MASTER;  // breaks the link of LL even without coherent caches
+	
 	// mips core
 	assign
 		inst_stall = immu_stall | icache_stall,
@@ -108,7 +146,9 @@ module wb_mips (
 	
 	mips_core #(
 		.CLK_FREQ(CLK_FREQ),
-		.PAGE_ADDR_BITS(PAGE_ADDR_BITS)
+		.PAGE_ADDR_BITS(PAGE_ADDR_BITS),
+		.DUAL_ISSUE(DUAL_ISSUE),
+		.CPU_ID(CPU_ID)
 		) MIPS_CORE (
 		.clk(clk),
 		.rst(rst),
@@ -126,6 +166,8 @@ module wb_mips (
 		.inst_stall(inst_stall),
 		.inst_addr({inst_addr_logical, inst_addr_page}),
 		.inst_data(inst_data),
+		.inst_data_next(inst_data_next),
+		.inst_next_valid(inst_next_valid),
 		.inst_unalign(inst_unalign),
 		.inst_bus_err(inst_bus_err),
 		.inst_page_fault(inst_page_fault),
@@ -135,6 +177,7 @@ module wb_mips (
 		.ic_inv(ic_inv),
 		.mem_ren(mem_ren),
 		.mem_wen(mem_wen),
+		.mem_link(mem_link),
 		.mem_stall(mem_stall),
 		.mem_type(mem_type),
 		.mem_ext(mem_ext),
@@ -150,9 +193,16 @@ module wb_mips (
 		.dc_inv(dc_inv),
 		.ir_map(ir_map),
 		.wd_rst(wd_rst),
-		.exception(exception)
+		.exception(exception),
+		.sleep(sleep),
+		.retire_valid(retire_valid),
+		.retire_pc(retire_pc),
+		.retire_pair(retire_pair)
 		);
 	
+	assign
+		retire_exception = exception;
+	
 	`ifndef NO_MMU
 	// instruction MMU
 	mmu #(
@@ -232,28 +282,72 @@ module wb_mips (
 	
 	`endif
 	
+	`ifndef NO_SPM
+	localparam
+		SPM_USED_BITS = SPM_ADDR_BITS;
+	
+	// scratchpad memory, one port for each CMU
+	spm #(
+		.ADDR_BITS(SPM_ADDR_BITS)
+		) SPM (
+		.clk(clk),
+		.i_en(~sleep),
+		.i_addr(ispm_addr[SPM_ADDR_BITS-1:0]),
+		.i_edit(ispm_edit),
+		.i_din(ispm_din),
+		.i_dout(ispm_dout),
+		.i_dout_next(ispm_dout_next),
+		.d_en(~sleep),
+		.d_addr(dspm_addr[SPM_ADDR_BITS-1:0]),
+		.d_edit(dspm_edit),
+		.d_din(dspm_din),
+		.d_dout(dspm_dout),
+		.d_dout_next()
+		);
+	`else
+	localparam
+		SPM_USED_BITS = 0;
+	
+	assign
+		ispm_dout = 0,
+		ispm_dout_next = 0,
+		dspm_dout = 0;
+	`endif
+	
 	`ifndef NO_IC
 	// instruction cache
-	wb_cmu #(
+	assign
+		ispm_edit = 0,
+		ispm_din = 0;
+	
+	wb_icmu #(
 		.LINE_NUM(IC_LINE_NUM),
-		.LINE_WORDS(4)
+		.LINE_WORDS(IC_LINE_WORDS),
+		.PREFETCH(IC_PREFETCH),
+		.PREFETCH_AHEAD(DUAL_ISSUE ? 2 : 1),
+		.SPM_ADDR_BITS(SPM_USED_BITS),
+		.SPM_BASE(SPM_BASE)
 		) ICMU (
 		.clk(clk),
 		.rst(rst | wd_rst),
 		.suspend(inst_suspend),
+		.standby(sleep),
 		.en_cache(ic_en),
 		.addr_rw({inst_addr_physical, inst_addr_page}),
-		.addr_type(MEM_TYPE_WORD),
-		.sign_ext(1'b0),
 		.en_r(inst_ren),
 		.data_r(inst_data),
-		.en_w(1'b0),
-		.data_w(0),
+		.data_r_next(inst_data_next),
+		.next_valid(inst_next_valid),
 		.en_f(ic_inv),
+		.snoop_addr(snoop_addr),
+		.snoop_inv(ic_snoop_inv),
 		.lock(ic_lock),
 		.stall(icache_stall),
 		.align_err(inst_unalign),
 		.bus_err(inst_bus_err),
+		.spm_addr(ispm_addr),
+		.spm_dout(ispm_dout),
+		.spm_dout_next(ispm_dout_next),
 		.wbm_clk_i(icmu_clk_i),
 		.wbm_cyc_o(icmu_cyc_o),
 		.wbm_stb_o(icmu_stb_o),
@@ -268,7 +362,14 @@ module wb_mips (
 		.wbm_err_i(icmu_err_i)
 		);
 	`else
-	wb_cpu_conn ICMU (
+	assign
+		inst_data_next = 0,
+		inst_next_valid = 0;
+	
+	wb_cpu_conn #(
+		.SPM_ADDR_BITS(SPM_USED_BITS),
+		.SPM_BASE(SPM_BASE)
+		) ICMU (
 		.clk(clk),
 		.rst(rst | wd_rst),
 		.suspend(inst_suspend),
@@ -279,10 +380,18 @@ module wb_mips (
 		.data_r(inst_data),
 		.en_w(1'b0),
 		.data_w(0),
+		.en_link(1'b0),
+		.link_clear(1'b0),
+		.snoop_addr(0),
+		.snoop_we(1'b0),
 		.lock(ic_lock),
 		.stall(icache_stall),
 		.align_err(inst_unalign),
 		.bus_err(inst_bus_err),
+		.spm_addr(ispm_addr),
+		.spm_edit(ispm_edit),
+		.spm_din(ispm_din),
+		.spm_dout(ispm_dout),
 		.wbm_clk_i(icmu_clk_i),
 		.wbm_cyc_o(icmu_cyc_o),
 		.wbm_stb_o(icmu_stb_o),
@@ -307,6 +416,7 @@ module wb_mips (
 	reg dcmu_en_w;
 	reg [31:0] dcmu_data_w;
 	reg dcmu_en_f;
+	reg dcmu_en_link;
 	reg dcmu_lock;
 	
 	always @(*) begin
@@ -318,6 +428,7 @@ module wb_mips (
 		dcmu_en_w = 0;
 		dcmu_data_w = 0;
 		dcmu_en_f = 0;
+		dcmu_en_link = 0;
 		dcmu_lock = 0;
 		itlb_ack = 0;
 		itlb_data = 0;
@@ -349,6 +460,7 @@ module wb_mips (
 			dcmu_en_w = mem_wen;
 			dcmu_data_w = mem_data_w;
 			dcmu_en_f = dc_inv;
+			dcmu_en_link = mem_link;
 			dcmu_lock = dc_lock;
 			mem_data_r = dcmu_data_r;
 		end
@@ -358,24 +470,40 @@ module wb_mips (
 	// data cache
 	wb_cmu #(
 		.LINE_NUM(DC_LINE_NUM),
-		.LINE_WORDS(4)
+		.LINE_WORDS(4),
+		.WRITE_THROUGH(COHERENT),
+		.SPM_ADDR_BITS(SPM_USED_BITS),
+		.SPM_BASE(SPM_BASE)
 		) DCMU (
 		.clk(clk),
 		.rst(rst | wd_rst),
 		.suspend(mem_suspend),
+		.standby(sleep),
 		.en_cache(dcmu_en_cache),
 		.addr_rw(dcmu_addr_rw),
 		.addr_type(dcmu_addr_type),
 		.sign_ext(dcmu_sign_ext),
 		.en_r(dcmu_en_r),
 		.data_r(dcmu_data_r),
+		.data_r_next(),
+		.next_valid(),
 		.en_w(dcmu_en_w),
 		.data_w(dcmu_data_w),
 		.en_f(dcmu_en_f),
+		.en_link(dcmu_en_link),
+		.link_clear(exception),
+		.snoop_addr(snoop_addr),
+		.snoop_inv(dc_snoop_inv),
+		.snoop_we(dc_snoop_we),
 		.lock(dcmu_lock),
 		.stall(dcache_stall),
 		.align_err(mem_unalign),
 		.bus_err(mem_bus_err),
+		.spm_addr(dspm_addr),
+		.spm_edit(dspm_edit),
+		.spm_din(dspm_din),
+		.spm_dout(dspm_dout),
+		.spm_dout_next(32'b0),
 		.wbm_clk_i(dcmu_clk_i),
 		.wbm_cyc_o(dcmu_cyc_o),
 		.wbm_stb_o(dcmu_stb_o),
@@ -390,7 +518,10 @@ module wb_mips (
 		.wbm_err_i(dcmu_err_i)
 		);
 	`else
-	wb_cpu_conn DCMU (
+	wb_cpu_conn #(
+		.SPM_ADDR_BITS(SPM_USED_BITS),
+		.SPM_BASE(SPM_BASE)
+		) DCMU (
 		.clk(clk),
 		.rst(rst | wd_rst),
 		.suspend(mem_suspend),
@@ -401,10 +532,18 @@ module wb_mips (
 		.data_r(dcmu_data_r),
 		.en_w(dcmu_en_w),
 		.data_w(dcmu_data_w),
+		.en_link(dcmu_en_link),
+		.link_clear(exception),
+		.snoop_addr(snoop_addr),
+		.snoop_we(dc_snoop_we),
 		.lock(dcmu_lock),
 		.stall(dcache_stall),
 		.align_err(mem_unalign),
 		.bus_err(mem_bus_err),
+		.spm_addr(dspm_addr),
+		.spm_edit(dspm_edit),
+		.spm_din(dspm_din),
+		.spm_dout(dspm_dout),
 		.wbm_clk_i(dcmu_clk_i),
 		.wbm_cyc_o(dcmu_cyc_o),
 		.wbm_stb_o(dcmu_stb_o),
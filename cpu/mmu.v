@@ -3,6 +3,9 @@
 
 /**
  * Memory Management Unit.
+ * Page directory entry: {page table base[31:12], large[7], cache[4], exec[3], write[2], user[1], present[0]}.
+ * Page table entry: {page base[31:12], cache[4], exec[3], write[2], user[1], present[0]}.
+ * A present directory entry with large set maps a 4MB page at base[31:22] directly, and the walk ends there.
  * Author: Zhao, Hongyu  <power_zhy@foxmail.com>
  */
 module mmu (
@@ -30,26 +33,30 @@ module mmu (
 	parameter
 		LINE_NUM = 16;  // number of lines in TLB, must be the power of 2
 	
-	wire tlb_hit_r;
+	wire tlb_hit_r, tlb_large_r;
 	wire [24:0] tlb_data_r;
 	reg tlb_en_w;
 	reg [31:12] tlb_addr_w;
 	reg [24:0] tlb_data_w;
+	reg tlb_large_w;
 	
 	tlb #(
 		.ADDR_BITS(32),
 		.ENTRY_BITS(20),
 		.DATA_BITS(25),
-		.LINE_NUM(LINE_NUM)
+		.LINE_NUM(LINE_NUM),
+		.LARGE_BITS(10)
 		) TLB (
 		.clk(clk),
 		.rst(rst),
 		.addr_r(logical),
 		.hit_r(tlb_hit_r),
 		.data_r(tlb_data_r),
+		.large_r(tlb_large_r),
 		.en_w(tlb_en_w),
 		.addr_w(tlb_addr_w),
-		.data_w(tlb_data_w)
+		.data_w(tlb_data_w),
+		.large_w(tlb_large_w)
 		);
 	
 	localparam
@@ -83,7 +90,7 @@ module mmu (
 			S_OP1: begin
 				stall = 1;
 				if (ack) begin
-					if (data[0])
+					if (data[0] && ~data[7])
 						next_state = S_OP2;
 					else
 						next_state = S_IDLE;
@@ -150,11 +157,14 @@ module mmu (
 		tlb_en_w = 0;
 		tlb_addr_w = 0;
 		tlb_data_w = 0;
+		tlb_large_w = 0;
 		if (~suspend) case (state)
-			S_OP1: if (ack && ~data[0]) begin
+			S_OP1: if (ack && (~data[0] || data[7])) begin
+				// not present, or a large page
 				tlb_en_w = 1;
 				tlb_addr_w = logical;
 				tlb_data_w = {data[31:12], data[4:0]};
+				tlb_large_w = data[0];
 			end
 			S_OP2: if (ack) begin
 				tlb_en_w = 1;
@@ -173,7 +183,7 @@ module mmu (
 		auth_write = 1;
 		en_cache = 0;
 		if (en_mmu && ~stall) begin
-			physical = tlb_data_r[24:5];
+			physical = tlb_large_r ? {tlb_data_r[24:15], logical[21:12]} : tlb_data_r[24:5];
 			page_fault = ~tlb_data_r[0];
 			auth_user = tlb_data_r[1];
 			auth_exec = tlb_data_r[3];
@@ -0,0 +1,98 @@
+`include "define.vh"
+
+
+/**
+ * Scratchpad memory of one core, shared by instruction and data sides, read and written in one clock as cache.
+ * Words are kept in an even bank and an odd bank, so that the instruction side gets an instruction pair at once,
+ * and each bank has one port for each side.
+ * Author: Zhao, Hongyu  <power_zhy@foxmail.com>
+ */
+module spm (
+	input wire clk,  // main clock
+	// instruction side
+	input wire i_en,  // clock enable, keep outputs unchanged when disabled
+	input wire [ADDR_BITS-1:0] i_addr,  // address
+	input wire [WORD_BYTES-1:0] i_edit,  // bytes to write
+	input wire [WORD_BITS-1:0] i_din,  // data write in
+	output wire [WORD_BITS-1:0] i_dout,  // data read out
+	output wire [WORD_BITS-1:0] i_dout_next,  // data of the odd word next to the even one addressed
+	// data side
+	input wire d_en,
+	input wire [ADDR_BITS-1:0] d_addr,
+	input wire [WORD_BYTES-1:0] d_edit,
+	input wire [WORD_BITS-1:0] d_din,
+	output wire [WORD_BITS-1:0] d_dout,
+	output wire [WORD_BITS-1:0] d_dout_next
+	);
+	
+	`include "function.vh"
+	parameter
+		ADDR_BITS = 13,  // address length, 8KB by default
+		WORD_BYTES = 4;  // number of bytes per-word
+	localparam
+		WORD_BITS = 8 * WORD_BYTES,  // 32
+		WORD_BYTES_WIDTH = GET_WIDTH(WORD_BYTES-1),  // 2
+		BANK_WORDS = 1 << (ADDR_BITS - WORD_BYTES_WIDTH - 1);
+	
+	wire [ADDR_BITS-1:WORD_BYTES_WIDTH+1] i_index, d_index;
+	wire i_odd, d_odd;
+	assign
+		i_index = i_addr[ADDR_BITS-1:WORD_BYTES_WIDTH+1],
+		d_index = d_addr[ADDR_BITS-1:WORD_BYTES_WIDTH+1],
+		i_odd = i_addr[WORD_BYTES_WIDTH],
+		d_odd = d_addr[WORD_BYTES_WIDTH];
+	
+	reg i_odd_buf = 0, d_odd_buf = 0;
+	reg [WORD_BITS-1:0] i_even_dout, i_odd_dout, d_even_dout, d_odd_dout;
+	
+	always @(negedge clk) begin
+		if (i_en)
+			i_odd_buf <= i_odd;
+		if (d_en)
+			d_odd_buf <= d_odd;
+	end
+	
+	genvar i;
+	generate for (i=0; i<WORD_BYTES; i=i+1) begin: DATA_CONTENT
+		reg [7:0] even_data [0:BANK_WORDS-1];
+		reg [7:0] odd_data [0:BANK_WORDS-1];
+		// instruction side
+		always @(negedge clk) begin
+			if (i_en) begin
+				i_even_dout[8*i+7-:8] <= even_data[i_index];
+				if (i_edit[i] && ~i_odd)
+					even_data[i_index] <= i_din[8*i+7-:8];
+			end
+		end
+		always @(negedge clk) begin
+			if (i_en) begin
+				i_odd_dout[8*i+7-:8] <= odd_data[i_index];
+				if (i_edit[i] && i_odd)
+					odd_data[i_index] <= i_din[8*i+7-:8];
+			end
+		end
+		// data side
+		always @(negedge clk) begin
+			if (d_en) begin
+				d_even_dout[8*i+7-:8] <= even_data[d_index];
+				if (d_edit[i] && ~d_odd)
+					even_data[d_index] <= d_din[8*i+7-:8];
+			end
+		end
+		always @(negedge clk) begin
+			if (d_en) begin
+				d_odd_dout[8*i+7-:8] <= odd_data[d_index];
+				if (d_edit[i] && d_odd)
+					odd_data[d_index] <= d_din[8*i+7-:8];
+			end
+		end
+	end
+	endgenerate
+	
+	assign
+		i_dout = i_odd_buf ? i_odd_dout : i_even_dout,
+		i_dout_next = i_odd_dout,
+		d_dout = d_odd_buf ? d_odd_dout : d_even_dout,
+		d_dout_next = d_odd_dout;
+	
+endmodule
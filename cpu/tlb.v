@@ -3,6 +3,7 @@
 
 /**
  * Translation Look-aside Buffer for Memory Management Unit.
+ * Each line is tagged by page size, large lines ignore the low LARGE_BITS bits of page number when matching.
  * Author: Zhao, Hongyu  <power_zhy@foxmail.com>
  */
 module tlb (
@@ -11,9 +12,11 @@ module tlb (
 	input wire [ENTRY_BITS-1:0] addr_r,  // page number for reading
 	output wire hit_r,  // TLB hit flag
 	output wire [DATA_BITS-1:0] data_r,  // entry content read out
+	output wire large_r,  // whether the entry hit is a large page
 	input wire en_w,  // write enable signal
 	input wire [ENTRY_BITS-1:0] addr_w,  // page number for writing
-	input wire [DATA_BITS-1:0] data_w  // entry content write in
+	input wire [DATA_BITS-1:0] data_w,  // entry content write in
+	input wire large_w  // whether the entry written is a large page
 	);
 	
 	`include "function.vh"
@@ -22,10 +25,13 @@ module tlb (
 		ENTRY_BITS = 20,  // entry length
 		DATA_BITS = 25,  // data length
 		LINE_NUM = 16;  // number of lines in TLB, must be the power of 2
+	parameter
+		LARGE_BITS = 10;  // low bits of page number covered by one large page
 	localparam
 		LINE_NUM_WIDTH = GET_WIDTH(LINE_NUM-1);
 	
 	reg [LINE_NUM-1:0] valid = 0;
+	reg [LINE_NUM-1:0] large = 0;
 	reg [ENTRY_BITS-1:0] entry [0:LINE_NUM-1];
 	reg [DATA_BITS-1:0] data [0:LINE_NUM-1];
 	wire [LINE_NUM-1:0] hit_inner;
@@ -35,7 +41,8 @@ module tlb (
 	
 	genvar i;
 	generate for (i=0; i<LINE_NUM; i=i+1) begin: HIT_JUDGE
-		assign hit_inner[i] = valid[i] & (addr_r == entry[i]);
+		assign hit_inner[i] = valid[i] & (addr_r[ENTRY_BITS-1:LARGE_BITS] == entry[i][ENTRY_BITS-1:LARGE_BITS])
+			& (large[i] | (addr_r[LARGE_BITS-1:0] == entry[i][LARGE_BITS-1:0]));
 	end
 	endgenerate
 	
@@ -50,7 +57,8 @@ module tlb (
 		);
 	
 	assign
-		data_r = data[index_inner];
+		data_r = data[index_inner],
+		large_r = large[index_inner];
 	
 	always @(posedge clk) begin
 		if (rst) begin
@@ -59,6 +67,7 @@ module tlb (
 		end
 		else if (en_w) begin
 			valid[replace] <= 1'b1;
+			large[replace] <= large_w;
 			entry[replace] <= addr_w;
 			data[replace] <= data_w;
 			if (replace == LINE_NUM-1)
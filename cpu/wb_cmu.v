@@ -9,19 +9,33 @@ module wb_cmu (
 	input wire clk,  // main clock, should be exactly the same as wishbone clock in current version
 	input wire rst,  // synchronous reset
 	input wire suspend,  // force suspend current process
+	input wire standby,  // keep cache memory idle when no one is accessing, ignored until state machine is idle with nothing to store
 	input wire en_cache,  // whether using cache or access memory directly
 	input wire [31:0] addr_rw,  // address for data read or write
 	input wire [1:0] addr_type,  // memory access type (word, half, byte)
 	input wire sign_ext,  // whether to use sign extend or not for byte or half word reading
 	input wire en_r,  // read enable signal
 	output reg [31:0] data_r,  // data read out
+	output reg [31:0] data_r_next,  // the odd word next to an even word being read, only from cache
+	output reg next_valid,  // whether data_r_next is valid
 	input wire en_w,  // write enable signal
 	input wire [31:0] data_w,  // data write in
 	input wire en_f,  // flush enable signal
+	input wire en_link,  // whether access is linked, LL when reading and SC when writing, SC gets 1 in data_r when stored or 0 when failed
+	input wire link_clear,  // break the link, when exception occurred or returned
+	input wire [31:2] snoop_addr,  // address written on bus by other masters
+	input wire snoop_inv,  // invalidate the line of snoop address if cached
+	input wire snoop_we,  // snoop address is being written by other masters, which breaks the link
 	input wire lock,  // keep current data to avoid process repeating
 	output reg stall,  // stall other components when CMU is busy
 	output reg align_err,  // address unaligned error
 	output reg bus_err,  // bus error
+	// scratchpad memory, accessed in one clock instead of cache and bus when address falls in its range
+	output wire [31:0] spm_addr,
+	output reg [3:0] spm_edit,
+	output wire [31:0] spm_din,
+	input wire [31:0] spm_dout,
+	input wire [31:0] spm_dout_next,
 	// wishbone master interfaces
 	input wire wbm_clk_i,
 	output reg wbm_cyc_o,
@@ -42,18 +56,25 @@ module wb_cmu (
 	parameter
 		LINE_NUM = 64,  // number of lines in cache, must be the power of 2
 		LINE_WORDS = 4;  // number of words per-line
+	parameter
+		WRITE_THROUGH = 0;  // write cached data to memory immediately and never allocate on write miss, so that lines are never dirty
+	parameter
+		SPM_ADDR_BITS = 0,  // address length of scratchpad memory, 0 when there is none
+		SPM_BASE = 32'hFE000000;  // base address of scratchpad memory, aligned to its size
 	localparam
 		LINE_WORDS_WIDTH = GET_WIDTH(LINE_WORDS-1),  // 2
 		LINE_INDEX_WIDTH = GET_WIDTH(LINE_NUM-1),  // 6
 		TAG_BITS = 32 - LINE_INDEX_WIDTH - LINE_WORDS_WIDTH - 2;  // 22
 	
 	// cache core
+	wire cache_en;
 	reg cache_store;
 	reg [3:0] cache_edit;
 	reg cache_invalid;
 	reg [31:0] cache_addr;
+	wire [31:0] cache_lookup_addr;
 	reg [31:0] cache_din;
-	wire [31:0] cache_dout;
+	wire [31:0] cache_dout, cache_dout_next;
 	wire [TAG_BITS-1:0] cache_tag;
 	wire cache_hit, cache_valid, cache_dirty;
 	wire [LINE_NUM-1:0] cache_dirty_map;
@@ -62,38 +83,65 @@ module wb_cmu (
 		.ADDR_BITS(32),
 		.WORD_BYTES(4),
 		.LINE_WORDS(LINE_WORDS),
-		.LINE_NUM(LINE_NUM)
+		.LINE_NUM(LINE_NUM),
+		.WRITE_THROUGH(WRITE_THROUGH)
 		) CACHE (
 		.clk(clk),
 		.rst(rst),
+		.en(cache_en),
 		.addr(cache_addr),
+		.lookup_addr(cache_lookup_addr),
 		.store(cache_store),
 		.edit(cache_edit),
 		.invalid(cache_invalid),
 		.din(cache_din),
+		.snoop_addr({snoop_addr, 2'b00}),
+		.snoop_inv(snoop_inv),
+		.probe_addr(32'b0),
 		.hit(cache_hit),
+		.probe_hit(),
 		.dout(cache_dout),
+		.dout_next(cache_dout_next),
 		.valid(cache_valid),
 		.dirty(cache_dirty),
 		.tag(cache_tag),
 		.dirty_map(cache_dirty_map)
 		);
 	
-	wire need_flush;
-	wire [LINE_INDEX_WIDTH-1:0] need_flush_addr;
+	// dirty lines to flush, registered as the dirty map only changes at negative edge, which is already seen at next
+	// positive edge, so that the search is out of the paths to the state machine and cache address
+	wire dirty_found;
+	wire [LINE_INDEX_WIDTH-1:0] dirty_index;
+	reg need_flush = 0;
+	reg [LINE_INDEX_WIDTH-1:0] need_flush_addr = 0;
 	
 	bit_searcher #(LINE_NUM) BS (
 		.bits(cache_dirty_map),
 		.target(1'b1),
 		.direction(1'b1),
-		.hit(need_flush),
-		.index(need_flush_addr)
+		.hit(dirty_found),
+		.index(dirty_index)
 	);
 	
+	always @(posedge clk) begin
+		if (rst) begin
+			need_flush <= 0;
+			need_flush_addr <= 0;
+		end
+		else begin
+			need_flush <= dirty_found;
+			need_flush_addr <= dirty_index;
+		end
+	end
+	
 	// alignment
 	reg [3:0] sel_align;
 	reg [31:0] data_align_r, data_align_w;
 	reg unalign;
+	wire en_sc, sc_pass;
+	wire spm_hit;
+	
+	assign spm_hit = (SPM_ADDR_BITS != 0) && (addr_rw[31:SPM_ADDR_BITS] == SPM_BASE >> SPM_ADDR_BITS);
 	
 	always @(*)begin
 		sel_align = 0;
@@ -149,6 +197,8 @@ module wb_cmu (
 				end
 			endcase
 		endcase
+		if (en_sc)
+			data_r = {31'b0, sc_pass};
 	end
 	
 	// state machine
@@ -169,6 +219,21 @@ module wb_cmu (
 	reg [LINE_WORDS_WIDTH-1:0] word_count = 0;
 	reg [LINE_WORDS_WIDTH-1:0] next_word_count;
 	
+	// load linked and store conditional, the link covers one cache line
+	// SC fails without any bus or cache access when the link has been broken, otherwise it goes as an ordinary store
+	// SC going through bus is given up if other masters write the line before it is granted, as it would land after them
+	reg link_valid = 0;
+	reg [31:LINE_WORDS_WIDTH+2] link_addr = 0;
+	reg sc_held = 0;  // SC has been stored but is not taken by the locked pipeline yet, it must not be checked or stored again
+	reg sc_abort = 0;  // SC has been given up while waiting for bus
+	wire link_snoop, en_store;
+	
+	assign
+		link_snoop = snoop_we && snoop_addr[31:LINE_WORDS_WIDTH+2] == link_addr,
+		en_sc = en_w & en_link,
+		sc_pass = sc_held || ((state == S_IDLE) ? (link_valid && ~link_clear && link_addr == addr_rw[31:LINE_WORDS_WIDTH+2]) : ~sc_abort),
+		en_store = en_w & ~(en_sc & (sc_held | ~sc_pass));
+	
 	always @(*) begin
 		next_state = S_IDLE;
 		next_word_count = 0;
@@ -178,8 +243,10 @@ module wb_cmu (
 					if (need_flush)
 						next_state = S_INVALID;
 				end
-				else if ((en_r || en_w) && ~unalign) begin
-					if (~en_cache)
+				else if ((en_r || en_store) && ~unalign) begin
+					if (spm_hit)
+						next_state = S_IDLE;
+					else if (~en_cache || (WRITE_THROUGH && en_store))
 						next_state = S_UNCACHE;
 					else if (cache_hit)
 						next_state = S_IDLE;
@@ -226,6 +293,8 @@ module wb_cmu (
 					next_state = S_UNCACHE_LOCK;
 				else if (wbm_err_i)
 					next_state = S_ERROR;
+				else if (en_sc && (~link_valid || link_snoop))
+					next_state = S_UNCACHE_LOCK;  // give up SC, leave bus at once
 				else
 					next_state = S_UNCACHE;
 			end
@@ -272,6 +341,16 @@ module wb_cmu (
 	end
 	
 	// cache control
+	// lines are looked up by the current state instead of the next one, otherwise hit would go through the state machine
+	// back into the address looked up, lines flushed are searched above and others always come from addr_rw
+	assign
+		cache_lookup_addr = (state == S_INVALID || state == S_INVALID_WAIT || (state == S_IDLE && en_f))
+			? {{TAG_BITS{1'b0}}, need_flush_addr, {LINE_WORDS_WIDTH{1'b0}}, 2'b00} : addr_rw;
+	
+	// standby never cuts a fill, write back or flush in progress, otherwise words stored or read out would be lost
+	assign
+		cache_en = ~standby || state != S_IDLE || next_state != S_IDLE || cache_edit != 0;
+	
 	always @(*) begin
 		cache_store = 0;
 		cache_edit = 0;
@@ -281,8 +360,14 @@ module wb_cmu (
 		if (~suspend) case (next_state)
 			S_IDLE: begin
 				cache_addr = addr_rw;
-				cache_edit = en_w ? sel_align : 4'b0;
-				cache_din = data_w;
+				cache_edit = en_store ? sel_align : 4'b0;
+				cache_din = data_align_w;
+			end
+			S_UNCACHE: if (WRITE_THROUGH) begin
+				// update the cached copy if any while writing through
+				cache_addr = addr_rw;
+				cache_edit = (en_store && en_cache) ? sel_align : 4'b0;
+				cache_din = data_align_w;
 			end
 			S_BACK, S_BACK_WAIT: begin
 				cache_addr = {addr_rw[31:LINE_WORDS_WIDTH+2], next_word_count, 2'b00};
@@ -302,6 +387,17 @@ module wb_cmu (
 		endcase
 	end
 	
+	// scratchpad control
+	assign
+		spm_addr = addr_rw,
+		spm_din = data_align_w;
+	
+	always @(*) begin
+		spm_edit = 0;
+		if (~suspend && state == S_IDLE && ~en_f && spm_hit && en_store)
+			spm_edit = sel_align;
+	end
+	
 	// memory control
 	reg [31:0] uncache_buf;
 	
@@ -355,7 +451,7 @@ module wb_cmu (
 			S_UNCACHE: begin
 				wbm_cyc_o <= 1;
 				wbm_stb_o <= 1;
-				wbm_we_o <= en_w;
+				wbm_we_o <= en_store;
 				wbm_sel_o <= sel_align;
 				wbm_addr_o <= addr_rw[31:2];
 				wbm_data_o <= data_align_w;
@@ -383,15 +479,57 @@ module wb_cmu (
 		endcase
 	end
 	
+	// link, set when LL is taken by the pipeline, and broken by exceptions, writes of other masters and ordinary stores to the same line
+	always @(posedge clk) begin
+		if (rst) begin
+			link_valid <= 0;
+			link_addr <= 0;
+			sc_held <= 0;
+			sc_abort <= 0;
+		end
+		else begin
+			if (~lock)
+				sc_held <= 0;
+			else if (en_sc && en_store && state == S_IDLE && next_state == S_IDLE)
+				sc_held <= 1;
+			if (state == S_UNCACHE)
+				sc_abort <= next_state == S_UNCACHE_LOCK && ~wbm_ack_i;
+			else if (next_state != S_UNCACHE_LOCK)
+				sc_abort <= 0;
+			if (en_r && en_link && ~lock && ~suspend) begin
+				link_valid <= 1;
+				link_addr <= addr_rw[31:LINE_WORDS_WIDTH+2];
+			end
+			if (link_clear || link_snoop || (en_w && ~en_link && addr_rw[31:LINE_WORDS_WIDTH+2] == link_addr))
+				link_valid <= 0;
+		end
+	end
+	
 	// outputs
 	always @(*) begin
 		data_align_r = 0;
 		if (~suspend) case (state)
-			S_IDLE, S_FILL_WAIT: data_align_r = cache_dout;
+			S_IDLE: data_align_r = spm_hit ? spm_dout : cache_dout;
+			S_FILL_WAIT: data_align_r = cache_dout;
 			S_UNCACHE_LOCK: data_align_r = uncache_buf;
 		endcase
 	end
 	
+	always @(*) begin
+		data_r_next = 0;
+		next_valid = 0;
+		if (~suspend && en_r && (en_cache || spm_hit) && addr_type == MEM_TYPE_WORD && addr_rw[2:0] == 0) case (state)
+			S_IDLE: begin
+				data_r_next = spm_hit ? spm_dout_next : cache_dout_next;
+				next_valid = 1;
+			end
+			S_FILL_WAIT: begin
+				data_r_next = cache_dout_next;
+				next_valid = 1;
+			end
+		endcase
+	end
+	
 	// stall
 	always @(negedge clk) begin
 		stall <= 0;
@@ -17,10 +17,19 @@ module wb_cpu_conn (
 	output reg [31:0] data_r,  // data read out
 	input wire en_w,  // write enable signal
 	input wire [31:0] data_w,  // data write in
+	input wire en_link,  // whether access is linked, LL when reading and SC when writing, SC gets 1 in data_r when stored or 0 when failed
+	input wire link_clear,  // break the link, when exception occurred or returned
+	input wire [31:2] snoop_addr,  // address written on bus by other masters
+	input wire snoop_we,  // snoop address is being written by other masters, which breaks the link
 	input wire lock,  // keep current data to avoid process repeating
 	output reg stall,  // stall other component when CMU is busy
 	output reg align_err,  // address unaligned error
 	output reg bus_err,  // bus error
+	// scratchpad memory, accessed in one clock instead of bus when address falls in its range
+	output wire [31:0] spm_addr,
+	output reg [3:0] spm_edit,
+	output wire [31:0] spm_din,
+	input wire [31:0] spm_dout,
 	// wishbone master interfaces
 	input wire wbm_clk_i,
 	output reg wbm_cyc_o,
@@ -37,11 +46,18 @@ module wb_cpu_conn (
 	);
 	
 	`include "cpu_define.vh"
+	parameter
+		SPM_ADDR_BITS = 0,  // address length of scratchpad memory, 0 when there is none
+		SPM_BASE = 32'hFE000000;  // base address of scratchpad memory, aligned to its size
 	
 	// alignment
 	reg [3:0] sel_align;
 	reg [31:0] data_align_r, data_align_w;
 	reg unalign;
+	wire en_sc, sc_pass;
+	wire spm_hit;
+	
+	assign spm_hit = (SPM_ADDR_BITS != 0) && (addr_rw[31:SPM_ADDR_BITS] == SPM_BASE >> SPM_ADDR_BITS);
 	
 	always @(*)begin
 		sel_align = 0;
@@ -97,6 +113,8 @@ module wb_cpu_conn (
 				end
 			endcase
 		endcase
+		if (en_sc)
+			data_r = {31'b0, sc_pass};
 	end
 	
 	// state machine
@@ -109,11 +127,25 @@ module wb_cpu_conn (
 	reg [1:0] state = 0;
 	reg [1:0] next_state;
 	
+	// load linked and store conditional, the link covers one word
+	// SC fails without any bus access when the link has been broken, otherwise it goes as an ordinary store
+	// SC is given up if other masters write the word before it is granted, as it would land after them
+	reg link_valid = 0;
+	reg [31:2] link_addr = 0;
+	reg sc_abort = 0;  // SC has been given up while waiting for bus
+	wire link_snoop, en_store;
+	
+	assign
+		link_snoop = snoop_we && snoop_addr == link_addr,
+		en_sc = en_w & en_link,
+		sc_pass = (state == S_IDLE) ? (link_valid && ~link_clear && link_addr == addr_rw[31:2]) : ~sc_abort,
+		en_store = en_w & ~(en_sc & ~sc_pass);
+	
 	always @(*) begin
 		next_state = S_IDLE;
 		if (~suspend) case (state)
 			S_IDLE: begin
-				if ((en_r || en_w) && ~unalign) begin
+				if ((en_r || en_store) && ~unalign && ~spm_hit) begin
 					next_state = S_UNCACHE;
 				end
 			end
@@ -122,6 +154,8 @@ module wb_cpu_conn (
 					next_state = S_UNCACHE_LOCK;
 				else if (wbm_err_i)
 					next_state = S_ERROR;
+				else if (en_sc && (~link_valid || link_snoop))
+					next_state = S_UNCACHE_LOCK;  // give up SC, leave bus at once
 				else
 					next_state = S_UNCACHE;
 			end
@@ -146,7 +180,20 @@ module wb_cpu_conn (
 		end
 	end
 	
+	// scratchpad control
+	assign
+		spm_addr = addr_rw,
+		spm_din = data_align_w;
+	
+	always @(*) begin
+		spm_edit = 0;
+		if (~suspend && state == S_IDLE && spm_hit && en_store)
+			spm_edit = sel_align;
+	end
+	
 	// memory control
+	reg [31:0] uncache_buf;
+	
 	always @(posedge wbm_clk_i) begin
 		wbm_cyc_o <= 0;
 		wbm_stb_o <= 0;
@@ -157,27 +204,56 @@ module wb_cpu_conn (
 		wbm_addr_o <= 0;
 		wbm_data_o <= 0;
 		if (rst || suspend) begin
-			data_align_r <= 0;
+			uncache_buf <= 0;
 		end
 		else case (next_state)
 			S_IDLE: begin
-				data_align_r <= 0;
+				uncache_buf <= 0;
 			end
 			S_UNCACHE: begin
 				wbm_cyc_o <= 1;
 				wbm_stb_o <= 1;
-				wbm_we_o <= en_w;
+				wbm_we_o <= en_store;
 				wbm_sel_o <= sel_align;
 				wbm_addr_o <= addr_rw[31:2];
 				wbm_data_o <= data_align_w;
 			end
 			S_UNCACHE_LOCK: begin
 				if (wbm_cyc_o && wbm_ack_i)
-					data_align_r <= wbm_data_i;
+					uncache_buf <= wbm_data_i;
 			end
 		endcase
 	end
 	
+	always @(*) begin
+		data_align_r = 0;
+		if (~suspend) case (state)
+			S_IDLE: data_align_r = spm_hit ? spm_dout : 32'b0;
+			S_UNCACHE_LOCK: data_align_r = uncache_buf;
+		endcase
+	end
+	
+	// link, set when LL is taken by the pipeline, and broken by exceptions, writes of other masters and ordinary stores to the same word
+	always @(posedge clk) begin
+		if (rst) begin
+			link_valid <= 0;
+			link_addr <= 0;
+			sc_abort <= 0;
+		end
+		else begin
+			if (state == S_UNCACHE)
+				sc_abort <= next_state == S_UNCACHE_LOCK && ~wbm_ack_i;
+			else if (next_state != S_UNCACHE_LOCK)
+				sc_abort <= 0;
+			if (en_r && en_link && ~lock && ~suspend) begin
+				link_valid <= 1;
+				link_addr <= addr_rw[31:2];
+			end
+			if (link_clear || link_snoop || (en_w && ~en_link && addr_rw[31:2] == link_addr))
+				link_valid <= 0;
+		end
+	end
+	
 	// stall
 	always @(negedge clk) begin
 		stall <= 0;
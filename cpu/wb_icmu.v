@@ -0,0 +1,411 @@
+`include "define.vh"
+
+
+/**
+ * Instruction cache management unit, read only, with sequential next-line prefetch.
+ * When fetching reaches the end of a cached line and the next one is missing, the next line is read into a buffer of
+ * one line while the CPU goes on, fetches falling in it are served by the buffer as soon as their words arrive, and
+ * its words are copied into cache in clocks when the cache is not read by the CPU.
+ * Author: Zhao, Hongyu  <power_zhy@foxmail.com>
+ */
+module wb_icmu (
+	input wire clk,  // main clock, should be exactly the same as wishbone clock in current version
+	input wire rst,  // synchronous reset
+	input wire suspend,  // force suspend current process
+	input wire standby,  // keep cache memory idle when no one is accessing, ignored until state machine is idle with nothing to store
+	input wire en_cache,  // whether using cache or access memory directly
+	input wire [31:0] addr_rw,  // address for instruction fetching
+	input wire en_r,  // read enable signal
+	output reg [31:0] data_r,  // instruction read out
+	output reg [31:0] data_r_next,  // the odd word next to an even word being read, only from cache or buffer
+	output reg next_valid,  // whether data_r_next is valid
+	input wire en_f,  // invalidate all lines
+	input wire [31:2] snoop_addr,  // address written on bus by other masters
+	input wire snoop_inv,  // invalidate the line of snoop address if cached or buffered
+	input wire lock,  // keep current data to avoid process repeating
+	output reg stall,  // stall other components when ICMU is busy
+	output reg align_err,  // address unaligned error
+	output reg bus_err,  // bus error
+	// scratchpad memory, read in one clock instead of cache and bus when address falls in its range
+	output wire [31:0] spm_addr,
+	input wire [31:0] spm_dout,
+	input wire [31:0] spm_dout_next,
+	// wishbone master interfaces
+	input wire wbm_clk_i,
+	output reg wbm_cyc_o,
+	output reg wbm_stb_o,
+	output reg [31:2] wbm_addr_o,
+	output reg [2:0] wbm_cti_o,
+	output reg [1:0] wbm_bte_o,
+	output reg [3:0] wbm_sel_o,
+	output wire wbm_we_o,
+	input wire [31:0] wbm_data_i,
+	output wire [31:0] wbm_data_o,
+	input wire wbm_ack_i,
+	input wire wbm_err_i
+	);
+	
+	`include "function.vh"
+	parameter
+		LINE_NUM = 64,  // number of lines in cache, must be the power of 2
+		LINE_WORDS = 4;  // number of words per-line, must be the power of 2 and at least 2
+	parameter
+		PREFETCH = 1,  // whether to prefetch the next line
+		PREFETCH_AHEAD = 1;  // number of words at the end of a line whose fetching starts prefetching, 2 for dual issue which reads the last pair by its even address
+	parameter
+		SPM_ADDR_BITS = 0,  // address length of scratchpad memory, 0 when there is none
+		SPM_BASE = 32'hFE000000;  // base address of scratchpad memory, aligned to its size
+	localparam
+		LINE_WORDS_WIDTH = GET_WIDTH(LINE_WORDS-1),  // 2
+		LINE_INDEX_WIDTH = GET_WIDTH(LINE_NUM-1),  // 6
+		TAG_BITS = 32 - LINE_INDEX_WIDTH - LINE_WORDS_WIDTH - 2,  // 22
+		PAGE_ADDR_BITS = 12;  // address length inside one memory page, prefetching never crosses physical pages
+	
+	// cache core
+	wire cache_en;
+	reg cache_store;
+	reg cache_invalid;
+	reg [31:0] cache_addr;
+	reg [31:0] cache_din;
+	wire cache_clear;
+	wire [31:0] cache_dout, cache_dout_next;
+	wire cache_hit, probe_hit;
+	wire [31:LINE_WORDS_WIDTH+2] next_line;
+	
+	assign next_line = addr_rw[31:LINE_WORDS_WIDTH+2] + 1'h1;
+	
+	cache #(
+		.ADDR_BITS(32),
+		.WORD_BYTES(4),
+		.LINE_WORDS(LINE_WORDS),
+		.LINE_NUM(LINE_NUM),
+		.WRITE_THROUGH(1)
+		) CACHE (
+		.clk(clk),
+		.rst(rst | cache_clear),
+		.en(cache_en),
+		.addr(cache_addr),
+		.lookup_addr(addr_rw),
+		.store(cache_store),
+		.edit(4'b0),
+		.invalid(cache_invalid),
+		.din(cache_din),
+		.snoop_addr({snoop_addr, 2'b00}),
+		.snoop_inv(snoop_inv),
+		.probe_addr({next_line, {LINE_WORDS_WIDTH{1'b0}}, 2'b00}),
+		.hit(cache_hit),
+		.probe_hit(probe_hit),
+		.dout(cache_dout),
+		.dout_next(cache_dout_next),
+		.valid(),
+		.dirty(),
+		.tag(),
+		.dirty_map()
+		);
+	
+	// prefetch buffer, holds one line from the start of its burst until all its words are copied into cache
+	reg pf_valid = 0;
+	reg [31:LINE_WORDS_WIDTH+2] pf_line = 0;
+	reg [LINE_WORDS-1:0] pf_word_valid = 0;  // words arrived
+	reg [31:0] pf_data [0:LINE_WORDS-1];
+	reg [LINE_WORDS_WIDTH-1:0] pf_copy = 0;  // next word to copy into cache
+	wire [LINE_WORDS_WIDTH-1:0] word_index;
+	wire unalign, spm_hit;
+	wire buf_line, buf_hit, pf_snoop, pf_start;
+	
+	assign
+		word_index = addr_rw[LINE_WORDS_WIDTH+1:2],
+		unalign = en_r && addr_rw[1:0] != 0,
+		spm_hit = (SPM_ADDR_BITS != 0) && (addr_rw[31:SPM_ADDR_BITS] == SPM_BASE >> SPM_ADDR_BITS),
+		buf_line = pf_valid && addr_rw[31:LINE_WORDS_WIDTH+2] == pf_line,
+		buf_hit = buf_line && pf_word_valid[word_index],
+		pf_snoop = snoop_inv && snoop_addr[31:LINE_WORDS_WIDTH+2] == pf_line;
+	
+	// the next line is prefetched when it is in the same page, neither cached nor buffered
+	assign
+		pf_start = PREFETCH && en_r && en_cache && ~unalign && ~spm_hit
+			&& word_index >= LINE_WORDS - PREFETCH_AHEAD
+			&& ~(&addr_rw[PAGE_ADDR_BITS-1:LINE_WORDS_WIDTH+2])
+			&& ~probe_hit && ~(pf_valid && pf_line == next_line);
+	
+	// state machine
+	localparam
+		S_IDLE = 0,  // idle
+		S_PREFETCH = 1,  // read the next line into prefetch buffer, fetches are served as in idle state
+		S_FILL = 2,  // read data from memory
+		S_FILL_WAIT = 3,  // wait one clock to prepare new bus request
+		S_UNCACHE = 4,  // deal with data which do not go through cache
+		S_UNCACHE_LOCK = 5,  // lock on current state to avoid read memory twice
+		S_ERROR = 6;  // error occurred
+	
+	reg [2:0] state = 0;
+	reg [2:0] next_state;
+	reg [LINE_WORDS_WIDTH-1:0] word_count = 0;
+	reg [LINE_WORDS_WIDTH-1:0] next_word_count;
+	reg hold;  // current fetch is not served in this clock
+	
+	always @(*) begin
+		next_state = S_IDLE;
+		next_word_count = 0;
+		hold = 0;
+		if (~suspend) case (state)
+			S_IDLE, S_PREFETCH: begin
+				if (state == S_PREFETCH) begin
+					if (wbm_ack_i)
+						next_word_count = word_count + 1'h1;
+					else
+						next_word_count = word_count;
+					if ((wbm_ack_i && word_count == {LINE_WORDS_WIDTH{1'b1}}) || wbm_err_i)
+						next_state = S_IDLE;  // words not arrived when error occurred are read again on demand
+					else
+						next_state = S_PREFETCH;
+				end
+				if (en_f || ~en_r || unalign || spm_hit || (en_cache && (cache_hit || buf_hit))) begin
+					if (state == S_IDLE && ~en_f && pf_start)
+						next_state = S_PREFETCH;
+				end
+				else begin
+					// missed or waiting for a buffered word, new bus requests wait for the prefetch burst
+					hold = 1;
+					if (state == S_IDLE)
+						next_state = en_cache ? S_FILL : S_UNCACHE;
+				end
+			end
+			S_FILL: begin
+				if (wbm_ack_i)
+					next_word_count = word_count + 1'h1;
+				else
+					next_word_count = word_count;
+				if (wbm_ack_i && word_count == {LINE_WORDS_WIDTH{1'b1}})
+					next_state = S_FILL_WAIT;
+				else if (wbm_err_i)
+					next_state = S_ERROR;
+				else
+					next_state = S_FILL;
+			end
+			S_FILL_WAIT: begin
+				next_word_count = 0;
+				next_state = S_IDLE;
+			end
+			S_UNCACHE: begin
+				if (wbm_ack_i)
+					next_state = S_UNCACHE_LOCK;
+				else if (wbm_err_i)
+					next_state = S_ERROR;
+				else
+					next_state = S_UNCACHE;
+			end
+			S_UNCACHE_LOCK: begin
+				if (lock)
+					next_state = S_UNCACHE_LOCK;
+				else
+					next_state = S_IDLE;
+			end
+			S_ERROR: begin
+				next_state = S_IDLE;
+			end
+		endcase
+	end
+	
+	always @(posedge wbm_clk_i) begin
+		if (rst || suspend) begin
+			state <= 0;
+			word_count <= 0;
+		end
+		else begin
+			state <= next_state;
+			word_count <= next_word_count;
+		end
+	end
+	
+	// buffered words are copied in order, only when the CPU is reading the buffer, scratchpad or nothing from ICMU
+	// and is not sleeping, the line is kept invalid until its last word is copied
+	wire pf_copy_en;
+	
+	assign
+		pf_copy_en = ~suspend && ~standby && pf_valid && pf_word_valid[pf_copy] && ~pf_snoop && ~en_f
+			&& (state == S_IDLE || state == S_PREFETCH) && (next_state == S_IDLE || next_state == S_PREFETCH)
+			&& (~en_r || unalign || spm_hit || buf_line || lock || hold);
+	
+	always @(posedge clk) begin
+		if (rst) begin
+			pf_valid <= 0;
+			pf_line <= 0;
+			pf_word_valid <= 0;
+			pf_copy <= 0;
+		end
+		else begin
+			if (state == S_PREFETCH && wbm_ack_i) begin
+				pf_data[word_count] <= wbm_data_i;
+				pf_word_valid[word_count] <= 1;
+			end
+			if (pf_copy_en) begin
+				pf_copy <= pf_copy + 1'h1;
+				if (pf_copy == {LINE_WORDS_WIDTH{1'b1}})
+					pf_valid <= 0;
+			end
+			// lines filled on demand overwrite words copied, the copy starts over
+			if (state == S_FILL && addr_rw[31-TAG_BITS:LINE_WORDS_WIDTH+2] == pf_line[31-TAG_BITS:LINE_WORDS_WIDTH+2]) begin
+				pf_copy <= 0;
+				if (addr_rw[31:LINE_WORDS_WIDTH+2] == pf_line)
+					pf_valid <= 0;
+			end
+			if (pf_snoop || (en_f && ~suspend))
+				pf_valid <= 0;
+			if (state == S_IDLE && next_state == S_PREFETCH) begin
+				pf_valid <= 1;
+				pf_line <= next_line;
+				pf_word_valid <= 0;
+				pf_copy <= 0;
+			end
+		end
+	end
+	
+	// cache control
+	assign
+		cache_clear = ~suspend && en_f && (state == S_IDLE || state == S_PREFETCH);
+	
+	// standby never cuts a fill in progress, otherwise words stored would be lost
+	assign
+		cache_en = ~standby || state != S_IDLE || next_state != S_IDLE || cache_store;
+	
+	always @(*) begin
+		cache_store = 0;
+		cache_invalid = 0;
+		cache_addr = 0;
+		cache_din = 0;
+		if (~suspend) case (next_state)
+			S_IDLE, S_PREFETCH: begin
+				if (pf_copy_en) begin
+					cache_addr = {pf_line, pf_copy, 2'b00};
+					cache_din = pf_data[pf_copy];
+					cache_store = 1;
+					cache_invalid = pf_copy != {LINE_WORDS_WIDTH{1'b1}};
+				end
+				else begin
+					cache_addr = addr_rw;
+				end
+			end
+			S_FILL, S_FILL_WAIT: begin
+				cache_addr = {addr_rw[31:LINE_WORDS_WIDTH+2], word_count, 2'b00};
+				cache_din = wbm_data_i;
+				cache_store = wbm_ack_i;
+			end
+		endcase
+	end
+	
+	// scratchpad control
+	assign
+		spm_addr = addr_rw;
+	
+	// memory control
+	reg [31:0] uncache_buf;
+	
+	assign
+		wbm_we_o = 0,
+		wbm_data_o = 0;
+	
+	always @(posedge wbm_clk_i) begin
+		wbm_cyc_o <= 0;
+		wbm_stb_o <= 0;
+		wbm_cti_o <= 0;
+		wbm_bte_o <= 0;
+		wbm_sel_o <= 0;
+		wbm_addr_o <= 0;
+		if (rst || suspend) begin
+			uncache_buf <= 0;
+		end
+		else case (next_state)
+			S_IDLE, S_FILL_WAIT: begin
+				uncache_buf <= 0;
+			end
+			S_PREFETCH: begin
+				wbm_cyc_o <= 1;
+				wbm_stb_o <= 1;
+				if (next_word_count != {LINE_WORDS_WIDTH{1'b1}}) begin
+					wbm_cti_o <= 3'b010;  // incrementing burst
+					wbm_bte_o <= 2'b00;  // linear burst
+				end
+				else begin
+					wbm_cti_o <= 3'b111;  // end of burst
+					wbm_bte_o <= 0;
+				end
+				wbm_sel_o <= 4'b1111;
+				wbm_addr_o <= {(state == S_PREFETCH) ? pf_line : next_line, next_word_count};
+			end
+			S_FILL: begin
+				wbm_cyc_o <= 1;
+				wbm_stb_o <= 1;
+				if (next_word_count != {LINE_WORDS_WIDTH{1'b1}}) begin
+					wbm_cti_o <= 3'b010;  // incrementing burst
+					wbm_bte_o <= 2'b00;  // linear burst
+				end
+				else begin
+					wbm_cti_o <= 3'b111;  // end of burst
+					wbm_bte_o <= 0;
+				end
+				wbm_sel_o <= 4'b1111;
+				wbm_addr_o <= {addr_rw[31:LINE_WORDS_WIDTH+2], next_word_count};
+			end
+			S_UNCACHE: begin
+				wbm_cyc_o <= 1;
+				wbm_stb_o <= 1;
+				wbm_sel_o <= 4'b1111;
+				wbm_addr_o <= addr_rw[31:2];
+			end
+			S_UNCACHE_LOCK: begin
+				if (wbm_cyc_o && wbm_ack_i)
+					uncache_buf <= wbm_data_i;
+			end
+		endcase
+	end
+	
+	// outputs
+	always @(*) begin
+		data_r = 0;
+		if (~suspend && en_r && ~unalign) case (state)
+			S_IDLE, S_PREFETCH: data_r = spm_hit ? spm_dout : buf_hit ? pf_data[word_index] : cache_dout;
+			S_FILL_WAIT: data_r = cache_dout;
+			S_UNCACHE_LOCK: data_r = uncache_buf;
+		endcase
+	end
+	
+	always @(*) begin
+		data_r_next = 0;
+		next_valid = 0;
+		if (~suspend && en_r && (en_cache || spm_hit) && addr_rw[2:0] == 0) case (state)
+			S_IDLE, S_PREFETCH: begin
+				if (spm_hit) begin
+					data_r_next = spm_dout_next;
+					next_valid = 1;
+				end
+				else if (buf_hit) begin
+					data_r_next = pf_data[word_index | 1'b1];
+					next_valid = pf_word_valid[word_index | 1'b1];
+				end
+				else begin
+					data_r_next = cache_dout_next;
+					next_valid = 1;
+				end
+			end
+			S_FILL_WAIT: begin
+				data_r_next = cache_dout_next;
+				next_valid = 1;
+			end
+		endcase
+	end
+	
+	// stall
+	always @(negedge clk) begin
+		stall <= 0;
+		align_err <= unalign;
+		bus_err <= 0;
+		if (~suspend) case (next_state)
+			S_IDLE, S_PREFETCH: stall <= hold;
+			S_UNCACHE_LOCK: stall <= wbm_cyc_o & wbm_ack_i;
+			S_ERROR: bus_err <= 1;
+			default: stall <= 1;
+		endcase
+	end
+	
+endmodule
@@ -5,9 +5,14 @@
 `ifdef XILINX_ISIM
 	`define SIMULATING
 `endif
+`ifdef VERILATOR
+	`define SIMULATING
+`endif
 
 //`define NO_MMU  // disable memory management unit
 //`define NO_IC  // disable instruction cache
 //`define NO_DC  // disable data cache
+//`define NO_SPM  // disable scratchpad memory
 
 `define NO_PS2_WRITE
+//`define NO_PS2_DECODER  // disable key event decoder of keyboard, only raw scan codes are available
@@ -1,25 +1,36 @@
 #define DATA_ADDR		0xFF100000
 #define DATA_RANGE		0x00100000
-#define VRAM_ADDR		0x00100000
-#define VRAM_RANGE		0x00100000
 #define VGA_ADDR		0xFFFF0100
 #define BOARD_ADDR		0xFFFF0200
 #define KEYBOARD_ADDR	0xFFFF0300
+#define TIMER_ADDR		0xFFFF0400
 #define SPI_ADDR		0xFFFF0500
 #define UART_ADDR		0xFFFF0600
+#define ASSET_CACHE_ADDR	0x00400000  // tile patterns for the VGA tile mode
+#define MOVE_TABLE_ADDR	0x00440000  // above the asset cache, 256KB
 
 #include "types.h"
 #include "random.h"
 #include "keyboard.h"
 #include "2048_core.h"
+#include "asset.h"
 
 #define BLOCK_WIDTH  80
 #define BLOCK_HEIGHT 80
 #define BLOCK_RANGE  BLOCK_WIDTH * BLOCK_HEIGHT
+#define BLOCK_NUM    12  // 0, 2, 4, ..., 2048
+#define BLOCK_STRIDE_BITS 13  // patterns are 8KB apart, so that the tile mode finds them by shifting
+#define BORDER_BASE  BLOCK_NUM  // 8 patterns around the board, from top left to bottom right
+#define BORDER_NUM   8
+#define BORDER_WIDTH 16
+#define TILE_FILL    0xFF  // tile index without pattern, filled by color
+#define MAP_COLS     64
+#define MAP_ROWS     32
 
 
 void bootup();
 void exception();
+void ir_vectors();
 
 uint32 screen_width = 0;
 uint32 screen_height = 0;
@@ -28,38 +39,91 @@ uint32 board_width = BLOCK_WIDTH * 4;
 uint32 board_height = BLOCK_HEIGHT * 4;
 uint32 blank_top = 0;
 uint32 blank_left = 0;
+uint32 board_col = 0;  // map position of the top left block
+uint32 board_row = 0;
+uint8* asset_base = 0;
 
-uint32 ms_count = 0;
+// the band of each border pattern, {x, y, width, height}
+const uint8 border_rects[BORDER_NUM][4] = {
+	{BLOCK_WIDTH-BORDER_WIDTH, BLOCK_HEIGHT-BORDER_WIDTH, BORDER_WIDTH, BORDER_WIDTH},
+	{0, BLOCK_HEIGHT-BORDER_WIDTH, BLOCK_WIDTH, BORDER_WIDTH},
+	{0, BLOCK_HEIGHT-BORDER_WIDTH, BORDER_WIDTH, BORDER_WIDTH},
+	{BLOCK_WIDTH-BORDER_WIDTH, 0, BORDER_WIDTH, BLOCK_HEIGHT},
+	{0, 0, BORDER_WIDTH, BLOCK_HEIGHT},
+	{BLOCK_WIDTH-BORDER_WIDTH, 0, BORDER_WIDTH, BORDER_WIDTH},
+	{0, 0, BLOCK_WIDTH, BORDER_WIDTH},
+	{0, 0, BORDER_WIDTH, BORDER_WIDTH}
+};
+
+// milliseconds of a counter value of timer, so that no periodic tick is needed
+uint32 counter_to_ms(uint32 high, uint32 low) {
+	volatile uint32* timer = (uint32*)TIMER_ADDR;
+	uint32 div = umul(timer[3], 1000);
+	uint32 rem, result = 0;
+	int8 i;
+	udiv(high, div, &rem);
+	for (i=31; i>=0; i--) {
+		rem = (rem << 1) | ((low >> i) & 0x1);
+		result <<= 1;
+		if (rem >= div) {
+			result += 1;
+			rem -= div;
+		}
+	}
+	return result;
+}
+
+// milliseconds since reset, interrupts are disabled as the keyboard handler reading counter low would latch the high part again
+uint32 get_ms_count() {
+	volatile uint32* timer = (uint32*)TIMER_ADDR;
+	uint32 ier = int_disable();
+	uint32 low = timer[0];  // latch high part
+	uint32 high = timer[1];
+	int_restore(ier);
+	return counter_to_ms(high, low);
+}
+
+// milliseconds since reset when counter low was read as 'counter', less than one wrap of it ago
+uint32 get_ms_count_at(uint32 counter) {
+	volatile uint32* timer = (uint32*)TIMER_ADDR;
+	uint32 ier = int_disable();
+	uint32 low = timer[0];  // latch high part
+	uint32 high = timer[1];
+	int_restore(ier);
+	if (counter > low)
+		high -= 1;
+	return counter_to_ms(high, counter);
+}
 
 void int_init() {
-	__asm__ ("mtc0 %0, $7": : "r"(20));
+	uint32 priority = 0;
+	priority |= 2 << (3 << 1);  // keyboard
+	__asm__ ("mtc0 %0, $11": : "r"(priority));
+	__asm__ ("mtc0 %0, $9": : "r"((uint32)ir_vectors | 1));  // vectored mode
 	uint32 mask = 1 << 31;
-	mask |= 1 << 0;  // timer
 	mask |= 1 << 3;  // keyboard
 	__asm__ ("mtc0 %0, $4": : "r"(mask));
+	// key events decoded by the keyboard controller, interrupt when 4 events are queued or the oldest one waits 10ms
+	volatile uint32* keyboard = (uint32*)KEYBOARD_ADDR;
+	keyboard[2] = (10 << 16) | (4 << 8) | 1;
 }
 
-void int_timer() {
-	ms_count += 20;
-}
-
-void int_keyboard() {
+FAST_TEXT void int_keyboard() {
 	volatile uint32* keyboard = (uint32*)KEYBOARD_ADDR;
-	if (keyboard[0] & (1<<2))
-		scancode_recv(keyboard[3], ms_count);
+	volatile uint32* timer = (uint32*)TIMER_ADDR;
+	__asm__ ("mtc0 %0, $5": : "r"(1<<3));
+	uint32 now = timer[0];  // only the raw counter low word here, converted to ms in main loop as the division is slow
+	uint32 device_now = keyboard[1] >> 16;  // timestamps of events come from the clock of the keyboard controller
+	uint32 event;
+	while ((event = keyboard[4]) != 0)
+		key_event_recv(event, now, device_now);
 }
 
-void int_dispatch() {
+FAST_TEXT void int_dispatch() {
 	uint32 ints;
 	__asm__ ("mfc0 %0, $5": "=r"(ints));
-	if (ints & (1<<0)) {  // timer
-		__asm__ ("mtc0 %0, $5": : "r"(1<<0));
-		int_timer();
-	}
-	if (ints & (1<<3)) {  // keyboard
-		__asm__ ("mtc0 %0, $5": : "r"(1<<3));
+	if (ints & (1<<3))  // keyboard
 		int_keyboard();
-	}
 }
 
 void disp_num(uint32 number) {
@@ -68,8 +132,15 @@ void disp_num(uint32 number) {
 	config[7] = 0x0000FF00;
 }
 
-void init_vga(uint32 mode, uint32 addr) {
+FAST_TEXT void set_tile(uint32 col, uint32 row, uint8 index) {
 	volatile uint32* config = (uint32*)VGA_ADDR;
+	config[8] = (((row & (MAP_ROWS-1)) << 6 | (col & (MAP_COLS-1))) << 16) | index;
+}
+
+// tile mode, the board is placed in the map so that its edges fall on tile edges, and the screen is scrolled to center it
+void init_vga(uint32 mode) {
+	volatile uint32* config = (uint32*)VGA_ADDR;
+	uint32 offset_x, offset_y, col, row, index;
 	if (mode & 0x7FFFFFF8)
 		mode = 0;
 	mode &= 0x7;
@@ -97,63 +168,81 @@ void init_vga(uint32 mode, uint32 addr) {
 	mode |= (1 << 31);
 	blank_left = (screen_width < board_width) ? 0 : (screen_width - board_width) >> 1;
 	blank_top = (screen_height < board_height) ? 0 : (screen_height - board_height) >> 1;
-	mem_set((uint32*)addr, 0, screen_range>>2);
-	config[1] = addr;
+	board_col = udiv(blank_left, BLOCK_WIDTH, &offset_x);
+	board_row = udiv(blank_top, BLOCK_HEIGHT, &offset_y);
+	if (offset_x) {
+		offset_x = BLOCK_WIDTH - offset_x;
+		board_col ++;
+	}
+	if (offset_y) {
+		offset_y = BLOCK_HEIGHT - offset_y;
+		board_row ++;
+	}
+	for (row=0; row<MAP_ROWS; row++) {
+		for (col=0; col<MAP_COLS; col++)
+			set_tile(col, row, TILE_FILL);
+	}
+	index = BORDER_BASE;
+	for (row=0; row<3; row++) {
+		for (col=0; col<3; col++) {
+			if (row == 1 && col == 1)
+				continue;
+			uint32 x, y, w = (col == 1) ? 4 : 1, h = (row == 1) ? 4 : 1;
+			uint32 map_col = (col == 0) ? board_col - 1 : (col == 1) ? board_col : board_col + 4;
+			uint32 map_row = (row == 0) ? board_row - 1 : (row == 1) ? board_row : board_row + 4;
+			for (y=0; y<h; y++) {
+				for (x=0; x<w; x++)
+					set_tile(map_col + x, map_row + y, index);
+			}
+			index ++;
+		}
+	}
+	config[5] = (uint32)asset_base;
+	config[6] = (offset_y << 16) | (offset_x >> 2);
+	config[7] = 0;  // black
+	config[4] = (1 << 31) | (BLOCK_STRIDE_BITS << 16) | ((BLOCK_HEIGHT - 1) << 8) | ((BLOCK_WIDTH >> 2) - 1);
 	config[0] = mode;  // graphic mode
 	config[2] = 0;
 	config[3] = 0;
 }
 
 
-void draw_board(bool all) {
-	static uint8 board_status[4][4];
-	uint8 x, y, dx, dy;
+// only tile indexes are written, the VGA fetches patterns by itself
+FAST_TEXT void draw_board(bool all) {
+	static FAST_DATA uint8 board_status[4][4];
+	uint8 x, y;
 	for (y=0; y<4; y++) {
 		for (x=0; x<4; x++) {
 			uint8 status = get_block(x, y);
 			if (all || board_status[y][x] != status) {
-				uint32* vram = (uint32*)(VRAM_ADDR + umul(blank_top + umul(BLOCK_HEIGHT, y), screen_width) + blank_left + umul(BLOCK_WIDTH, x));
-				uint32* asset = (uint32*)(DATA_ADDR + umul(BLOCK_RANGE, status));
-				for (dy=0; dy<BLOCK_HEIGHT; dy++) {
-					for (dx=0; dx<(BLOCK_WIDTH>>2); dx++) {
-						*vram = *asset;
-						vram++;
-						asset++;
-					}
-					vram += (screen_width - BLOCK_WIDTH) >> 2;
-				}
+				set_tile(board_col + x, board_row + y, status);
 				board_status[y][x] = status;
 			}
 		}
 	}
 }
 
+// the border is a band around the board, drawn in the bands of border patterns only
 void draw_border(uint8 color) {
+	static uint32 border_color = 0;
 	uint32 data = (color << 24) | (color << 16) | (color << 8) | color;
-	uint32 lx = blank_left - 8;
-	uint32 rx = blank_left + board_width + 8;
-	uint32 ly = blank_top - 8;
-	uint32 ry = blank_top + board_height + 8;
-	int y;
-	uint8* vram = (uint8*)(VRAM_ADDR + umul(ly - 8, screen_width) + lx - 8);
-	for (y=0; y<16; y++) {
-		mem_set((uint32*)vram, data, (rx - lx + 16) >> 2);
-		vram += screen_width;
-	}
-	for (y=0; y<ry-ly-16; y++) {
-		mem_set((uint32*)vram, data, 16 >> 2);
-		mem_set((uint32*)(vram + board_width + 16), data, 16 >> 2);
-		vram += screen_width;
-	}
-	for (y=0; y<16; y++) {
-		mem_set((uint32*)vram, data, (rx - lx + 16) >> 2);
-		vram += screen_width;
+	uint32 i, y;
+	if (data == border_color)
+		return;
+	for (i=0; i<BORDER_NUM; i++) {
+		const uint8* rect = border_rects[i];
+		uint8* line = asset_base + ((BORDER_BASE + i) << BLOCK_STRIDE_BITS) + umul(rect[1], BLOCK_WIDTH) + rect[0];
+		for (y=0; y<rect[3]; y++) {
+			mem_set((uint32*)line, data, rect[2] >> 2);
+			line += BLOCK_WIDTH;
+		}
 	}
+	border_color = data;
 }
 
 void game_loop() {
 	while (1) {
-		game_init(ms_count);
+		game_init(get_ms_count());
 		draw_board(true);
 		draw_border(0xFF);
 		disp_num(get_step_count());
@@ -186,7 +275,7 @@ void game_loop() {
 				case VK_5:
 				case VK_6:
 					if (key.ctrl_down) {
-						init_vga(key.key_code - VK_0, VRAM_ADDR);
+						init_vga(key.key_code - VK_0);
 						draw_board(true);
 						if (result == GAME_SUCCESS)
 							draw_border(0x7C);
@@ -216,9 +305,11 @@ void game_loop() {
 
 void bootup() {
 	disp_num(0);
-	init_vga(1, VRAM_ADDR);
+	asset_base = asset_load((uint8*)DATA_ADDR, (uint8*)ASSET_CACHE_ADDR, BLOCK_RANGE, 1 << BLOCK_STRIDE_BITS, BLOCK_NUM);
+	mem_set((uint32*)(asset_base + (BORDER_BASE << BLOCK_STRIDE_BITS)), 0, (BORDER_NUM << BLOCK_STRIDE_BITS) >> 2);
+	init_vga(1);
 	int_init();
-	rand_init((uint32*)0x00200000, 0x00200000, 0);  // use uninitialized ram for random source
+	game_setup((uint32*)MOVE_TABLE_ADDR);
 	game_loop();
 }
 
@@ -10,6 +10,7 @@
 #define GAME_SUCCESS  1
 #define GAME_FAILED   2
 
+void game_setup(uint32* table);  // table of BOARD_TABLE_SIZE bytes for moves, called once
 void game_init(uint32 time);
 uint8 game_step(uint8 step);
 uint8 get_block(uint8 x, uint8 y);
@@ -0,0 +1,66 @@
+#include "types.h"
+#include "asset.h"
+
+
+// byte aligned run length decoding, long runs are filled by words
+void unpack_rle(uint8* src, uint8* dst, uint32 size) {
+	uint8* end = dst + size;
+	while (dst < end) {
+		uint32 code = *src;
+		src ++;
+		if (code < 0x80) {  // literal bytes
+			code ++;
+			while (code != 0) {
+				*dst = *src;
+				dst ++;
+				src ++;
+				code --;
+			}
+		}
+		else {  // repeated byte
+			uint32 value = *src;
+			src ++;
+			code -= 0x7D;
+			while (code != 0 && ((uint32)dst & 0x3)) {
+				*dst = value;
+				dst ++;
+				code --;
+			}
+			if (code >= 4) {
+				value |= value << 8;
+				value |= value << 16;
+				mem_set((uint32*)dst, value, code >> 2);
+				dst += code & ~0x3;
+				code &= 0x3;
+			}
+			while (code != 0) {
+				*dst = value;
+				dst ++;
+				code --;
+			}
+		}
+	}
+}
+
+// unpack all tiles into RAM once, so that drawing never waits for flash
+// uncompressed files are just copied, tiles are "tile_stride" bytes apart in the cache
+uint8* asset_load(uint8* file, uint8* cache, uint32 tile_range, uint32 tile_stride, uint32 tile_num) {
+	uint32* header = (uint32*)file;
+	uint8* dst = cache;
+	uint32 i;
+	if (header[0] != ASSET_MAGIC) {
+		for (i=0; i<tile_num; i++) {
+			mem_copy((uint32*)file, (uint32*)dst, tile_range >> 2);
+			file += tile_range;
+			dst += tile_stride;
+		}
+		return cache;
+	}
+	if (header[1] < tile_num)
+		tile_num = header[1];
+	for (i=0; i<tile_num; i++) {
+		unpack_rle(file + header[3+i], dst, tile_range);
+		dst += tile_stride;
+	}
+	return cache;
+}
@@ -0,0 +1,9 @@
+#ifndef __ASSET_H__
+#define __ASSET_H__
+
+#define ASSET_MAGIC 0x31454C52  // "RLE1", see assets/assemble.py for the format
+
+void unpack_rle(uint8* src, uint8* dst, uint32 size);
+uint8* asset_load(uint8* file, uint8* cache, uint32 tile_range, uint32 tile_stride, uint32 tile_num);  // returns address of the first tile
+
+#endif
@@ -1,18 +1,84 @@
+'''
+Compressed asset file (little endian):
+	0x00: "RLE1"
+	0x04: tile number N
+	0x08: tile width, tile height (16 bits each)
+	0x0C: N+1 offsets from the beginning of file, tile i is between offset i and i+1
+	then tiles, each is one stream of RGB332 pixels row by row, coded byte by byte as:
+	0x00 - 0x7F: X+1 literal bytes follow
+	0x80 - 0xFF: the following byte repeats X-0x7D times (3 - 130)
+
+Usage: assemble.py [raw], "raw" writes the uncompressed tiles one after another instead
+'''
+
 origs = ["0", "2", "4", "8", "16", "32", "64", "128", "256", "512", "1024", "2048"]
 format = "bmp"
 width = 80
 height = 80
 
-from PIL import Image
-with open("asset.bin", "wb") as result:
-	count = 0
+RUN_MIN = 3
+RUN_MAX = 130
+LITERAL_MAX = 128
+
+import struct
+
+def compress(pixels):
+	contents = []
+	literal = []
+	i = 0
+	while (i < len(pixels)):
+		run = 1
+		while (i+run < len(pixels) and run < RUN_MAX and pixels[i+run] == pixels[i]):
+			run += 1
+		if (run >= RUN_MIN):
+			if (literal):
+				contents += [len(literal) - 1] + literal
+				literal = []
+			contents += [0x7D + run, pixels[i]]
+			i += run
+		else:
+			literal.append(pixels[i])
+			i += 1
+			if (len(literal) == LITERAL_MAX):
+				contents += [len(literal) - 1] + literal
+				literal = []
+	if (literal):
+		contents += [len(literal) - 1] + literal
+	return contents
+
+if __name__ == "__main__":
+	import sys
+	from PIL import Image
+	raw = (len(sys.argv) > 1 and sys.argv[1] == "raw")
+	tiles = []
 	for index, orig in enumerate(origs):
 		name = orig + "." + format
 		with Image.open(name) as img:
 			assert(img.size == (width, height))
+			pixels = []
 			for y in range(width):
 				for x in range(height):
 					pixel = img.getpixel((x, y))
 					pixel = ((pixel[0]&0xE0) | ((pixel[1]&0xE0)>>3) | ((pixel[2]&0xC0)>>6))
-					count += result.write(bytes([pixel]))
-	print("Total size:", count);
+					pixels.append(pixel)
+			tiles.append(pixels)
+	with open("asset.bin", "wb") as result:
+		count = 0
+		if (raw):
+			for pixels in tiles:
+				count += result.write(bytes(pixels))
+		else:
+			streams = [compress(pixels) for pixels in tiles]
+			count += result.write(b"RLE1")
+			count += result.write(struct.pack("<IHH", len(streams), width, height))
+			offset = 12 + 4 * (len(streams) + 1)
+			for stream in streams:
+				count += result.write(struct.pack("<I", offset))
+				offset += len(stream)
+			count += result.write(struct.pack("<I", offset))
+			for stream in streams:
+				count += result.write(bytes(stream))
+			# whole words for bin_split.py
+			while (count & 0x3):
+				count += result.write(b"\0")
+	print("Total size:", count, "of", len(tiles) * width * height, "pixels");
@@ -0,0 +1,139 @@
+#include "types.h"
+#include "bitboard.h"
+
+#define ROW_NUM 65536
+#define ENTRY_MAX_MERGED (1 << 16)
+#define ENTRY_READY (1 << 17)
+
+
+FAST_DATA uint32* move_table = 0;
+
+// move one row towards cell 0 (the lowest nibble), the same as compacting, merging and compacting again
+uint32 row_merge(uint32 row) {
+	uint32 line[4];
+	uint32 result = 0;
+	uint32 flags = ENTRY_READY;
+	int8 i, size = 0, pos = 0;
+	for (i=0; i<4; i++) {
+		uint32 cell = (row >> (i << 2)) & 0xF;
+		if (cell)
+			line[size++] = cell;
+	}
+	for (i=0; i<size; i++) {
+		uint32 cell = line[i];
+		if (i+1 < size && line[i+1] == cell) {
+			if (cell < 0xF)  // saturates, as cells never go beyond BOARD_MAX_MERGE in game
+				cell ++;
+			if (cell == BOARD_MAX_MERGE)
+				flags |= ENTRY_MAX_MERGED;
+			i ++;
+		}
+		result |= cell << (pos << 2);
+		pos ++;
+	}
+	return result | flags;
+}
+
+void board_init(uint32* table, bool fill) {
+	uint32 row;
+	move_table = table;
+	if (!fill) {
+		mem_set(table, 0, ROW_NUM);
+		return;
+	}
+	for (row=0; row<ROW_NUM; row++)
+		table[row] = row_merge(row);
+}
+
+FAST_TEXT uint32 row_entry(uint32 row) {
+	uint32 entry = move_table[row];
+	if (!(entry & ENTRY_READY)) {
+		entry = row_merge(row);
+		move_table[row] = entry;
+	}
+	return entry;
+}
+
+FAST_TEXT uint32 row_reverse(uint32 row) {
+	return ((row & 0xF) << 12) | ((row & 0xF0) << 4) | ((row >> 4) & 0xF0) | (row >> 12);
+}
+
+// two rows in one word, only constant shifts of 64 bits are used, so no libgcc routine is needed
+FAST_TEXT uint32 move_rows(uint32 rows, bool reverse, uint32* flags) {
+	uint32 low = rows & 0xFFFF;
+	uint32 high = rows >> 16;
+	if (reverse) {
+		low = row_entry(row_reverse(low));
+		high = row_entry(row_reverse(high));
+		*flags |= low | high;
+		return row_reverse(low & 0xFFFF) | (row_reverse(high & 0xFFFF) << 16);
+	}
+	low = row_entry(low);
+	high = row_entry(high);
+	*flags |= low | high;
+	return (low & 0xFFFF) | (high << 16);
+}
+
+FAST_TEXT uint64 board_transpose(uint64 board) {
+	uint64 a = (board & 0xF0F00F0FF0F00F0FULL) | ((board & 0x0000F0F00000F0F0ULL) << 12) | ((board >> 12) & 0x0000F0F00000F0F0ULL);
+	return (a & 0xFF00FF0000FF00FFULL) | ((a >> 24) & 0x00000000FF00FF00ULL) | ((a & 0x00000000FF00FF00ULL) << 24);
+}
+
+FAST_TEXT uint64 board_move(uint64 board, uint8 dir, bool* max_merged) {
+	uint32 flags = 0;
+	bool reverse = (dir == MOVE_DOWN || dir == MOVE_RIGHT);
+	bool column = (dir == MOVE_UP || dir == MOVE_DOWN);
+	if (column)
+		board = board_transpose(board);
+	uint32 low = move_rows((uint32)board, reverse, &flags);
+	uint32 high = move_rows((uint32)(board >> 32), reverse, &flags);
+	board = ((uint64)high << 32) | low;
+	if (column)
+		board = board_transpose(board);
+	*max_merged = (flags & ENTRY_MAX_MERGED) ? true : false;
+	return board;
+}
+
+// one bit per empty cell, then add them up by halves
+uint32 half_free_bits(uint32 half) {
+	half |= half >> 2;
+	half |= half >> 1;
+	return ~half & 0x11111111;
+}
+
+uint32 board_free_count(uint64 board) {
+	uint32 count = half_free_bits((uint32)board) + half_free_bits((uint32)(board >> 32));
+	count = (count & 0x0F0F0F0F) + ((count >> 4) & 0x0F0F0F0F);
+	count += count >> 8;
+	count += count >> 16;
+	return count & 0xFF;
+}
+
+uint64 board_put(uint64 board, uint32 index, uint8 value) {
+	uint32 half = (uint32)board;
+	uint32 bits = half_free_bits(half);
+	uint32 shift;
+	bool high = false;
+	for (shift=0; shift<64; shift+=4) {
+		if (shift == 32) {
+			half = (uint32)(board >> 32);
+			bits = half_free_bits(half);
+			high = true;
+		}
+		if (bits & (1 << (shift & 31))) {
+			if (index == 0) {
+				half |= (uint32)value << (shift & 31);
+				if (high)
+					return (board & 0xFFFFFFFFULL) | ((uint64)half << 32);
+				return (board & 0xFFFFFFFF00000000ULL) | half;
+			}
+			index --;
+		}
+	}
+	return board;
+}
+
+FAST_TEXT uint8 board_get(uint64 board, uint8 x, uint8 y) {
+	uint32 half = (y < 2) ? (uint32)board : (uint32)(board >> 32);
+	return (half >> (((y & 1) << 4) | (x << 2))) & 0xF;
+}
@@ -0,0 +1,21 @@
+#ifndef __BITBOARD_H__
+#define __BITBOARD_H__
+
+// 4x4 board in 64 bits, cell (x, y) is the nibble at bit (y*4+x)*4, value v means tile 2^v and 0 means empty
+// moves look up a table of 65536 words indexed by one row, which is filled on first use or all at once
+
+#define MOVE_UP    1  // the same as STEP_*
+#define MOVE_DOWN  2
+#define MOVE_LEFT  3
+#define MOVE_RIGHT 4
+
+#define BOARD_MAX_MERGE 11  // 2048
+#define BOARD_TABLE_SIZE (65536 * 4)  // in bytes
+
+void board_init(uint32* table, bool fill);  // table is not filled in advance if "fill" is false
+uint64 board_move(uint64 board, uint8 dir, bool* max_merged);  // "max_merged" is set if a 2048 tile is merged
+uint32 board_free_count(uint64 board);
+uint64 board_put(uint64 board, uint32 index, uint8 value);  // put value at the index-th free cell in row-major order
+uint8 board_get(uint64 board, uint8 x, uint8 y);
+
+#endif
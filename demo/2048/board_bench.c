@@ -0,0 +1,272 @@
+// Host benchmark of the 2048 engine, checks the bitboard engine against the former array one and measures both
+// Build with "make board_bench", usage: board_bench [games] [lazy]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "types.h"
+#include "2048_core.h"
+#include "bitboard.h"
+
+
+uint32 rand_state = 2048;
+uint32 table[BOARD_TABLE_SIZE >> 2];
+
+void mem_set(uint32* addr, uint32 value, uint32 count) {
+	while (count != 0) {
+		*addr = value;
+		addr ++;
+		count --;
+	}
+}
+
+uint32 next_rand() {
+	rand_state ^= rand_state << 13;
+	rand_state ^= rand_state >> 17;
+	rand_state ^= rand_state << 5;
+	return rand_state;
+}
+
+double now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+// the former engine of 2048_core.c
+uint8 array_status[4][4];
+
+bool array_block_gen(uint32 rand) {
+	int8 i, j;
+	uint8 count = 0;
+	for (i=0; i<4; i++) {
+		for (j=0; j<4; j++) {
+			if (!array_status[i][j])
+				count++;
+		}
+	}
+	if (count == 0)
+		return false;
+	uint8 selected = rand % count;
+	for (i=0; i<4; i++) {
+		for (j=0; j<4; j++) {
+			if (!array_status[i][j]) {
+				if (!selected) {
+					array_status[i][j] = 1;
+					return true;
+				}
+				selected--;
+			}
+		}
+	}
+	return false;
+}
+
+bool line_merge(uint8 line[4]) {
+	bool success = false;
+	int8 i;
+	int8 size = 0;
+	for (i=0; i<4; i++) {
+		if (line[i])
+			line[size++] = line[i];
+	}
+	for (i=size; i<4; i++) {
+		line[i] = 0;
+	}
+	for (i=0; i<size-1; i++) {
+		if (line[i] == line[i+1]) {
+			line[i] ++;
+			if (line[i] == BOARD_MAX_MERGE)
+				success = true;
+			line[i+1] = 0;
+			i++;
+		}
+	}
+	size = 0;
+	for (i=0; i<4; i++) {
+		if (line[i])
+			line[size++] = line[i];
+	}
+	for (i=size; i<4; i++) {
+		line[i] = 0;
+	}
+	return success;
+}
+
+uint8 array_step(uint8 step, uint32 rand) {
+	bool success = false;
+	uint8 line[4];
+	int8 i, j;
+	for (i=0; i<4; i++) {
+		switch (step) {
+			case STEP_UP:
+				for (j=0; j<4; j++)
+					line[j] = array_status[j][i];
+				success |= line_merge(line);
+				for (j=0; j<4; j++)
+					array_status[j][i] = line[j];
+				break;
+			case STEP_DOWN:
+				for (j=0; j<4; j++)
+					line[j] = array_status[3-j][i];
+				success |= line_merge(line);
+				for (j=0; j<4; j++)
+					array_status[3-j][i] = line[j];
+				break;
+			case STEP_LEFT:
+				for (j=0; j<4; j++)
+					line[j] = array_status[i][j];
+				success |= line_merge(line);
+				for (j=0; j<4; j++)
+					array_status[i][j] = line[j];
+				break;
+			case STEP_RIGHT:
+				for (j=0; j<4; j++)
+					line[j] = array_status[i][3-j];
+				success |= line_merge(line);
+				for (j=0; j<4; j++)
+					array_status[i][3-j] = line[j];
+				break;
+		}
+	}
+	bool valid = array_block_gen(rand);
+	if (success)
+		return GAME_SUCCESS;
+	if (!valid)
+		return GAME_FAILED;
+	return GAME_CONTINUE;
+}
+
+
+uint8 board_step(uint64* board, uint8 step, uint32 rand) {
+	bool success = false;
+	*board = board_move(*board, step, &success);
+	uint32 count = board_free_count(*board);
+	if (count)
+		*board = board_put(*board, rand % count, 1);
+	if (success)
+		return GAME_SUCCESS;
+	if (!count)
+		return GAME_FAILED;
+	return GAME_CONTINUE;
+}
+
+// games end when failed or after 5000 steps, as random moves rarely reach 2048
+#define GAME_STEPS 5000
+
+// play the same games with both engines and compare every step
+uint32 check(uint32 games) {
+	uint32 game, steps = 0, x, y;
+	for (game=0; game<games; game++) {
+		uint64 board = 0;
+		uint32 rand = next_rand();
+		memset(array_status, 0, sizeof(array_status));
+		array_block_gen(rand);
+		board = board_put(board, rand % board_free_count(board), 1);
+		uint8 result = GAME_CONTINUE;
+		uint32 step;
+		for (step=0; step<GAME_STEPS && result == GAME_CONTINUE; step++) {
+			uint8 dir = 1 + (next_rand() & 3);
+			rand = next_rand();
+			result = array_step(dir, rand);
+			if (board_step(&board, dir, rand) != result) {
+				printf("result differs in game %u step %u\n", game, step);
+				return 0;
+			}
+			for (y=0; y<4; y++) {
+				for (x=0; x<4; x++) {
+					if (board_get(board, x, y) != array_status[y][x]) {
+						printf("board differs in game %u step %u at (%u, %u)\n", game, step, x, y);
+						return 0;
+					}
+				}
+			}
+			steps ++;
+		}
+	}
+	return steps;
+}
+
+// every row in every direction, in all rows or all columns of the board
+// rows with cell 15 are skipped, two of them merge into 16 in the array, which does not fit into a nibble
+bool check_rows() {
+	uint32 row, dir, x, y;
+	for (row=0; row<65536; row++) {
+		if (((row & 0xF) == 0xF) || ((row & 0xF0) == 0xF0) || ((row & 0xF00) == 0xF00) || ((row & 0xF000) == 0xF000))
+			continue;
+		for (dir=STEP_UP; dir<=STEP_RIGHT; dir++) {
+			bool column = (dir == STEP_UP || dir == STEP_DOWN);
+			uint64 board = 0;
+			for (y=0; y<4; y++) {
+				for (x=0; x<4; x++) {
+					uint8 cell = (row >> ((column ? y : x) << 2)) & 0xF;
+					array_status[y][x] = cell;
+					board |= (uint64)cell << ((y << 4) | (x << 2));
+				}
+			}
+			if (board_step(&board, dir, row) != array_step(dir, row)) {
+				printf("row %04x result differs in direction %u\n", row, dir);
+				return false;
+			}
+			for (y=0; y<4; y++) {
+				for (x=0; x<4; x++) {
+					if (board_get(board, x, y) != array_status[y][x]) {
+						printf("row %04x differs in direction %u\n", row, dir);
+						return false;
+					}
+				}
+			}
+		}
+	}
+	return true;
+}
+
+// play games with random moves, the same random numbers for both engines
+double run(uint32 games, bool bitboard, uint32* steps) {
+	uint32 game;
+	double start = now();
+	*steps = 0;
+	rand_state = 2048;
+	for (game=0; game<games; game++) {
+		uint64 board = 0;
+		uint8 result = GAME_CONTINUE;
+		uint32 step;
+		if (bitboard)
+			board = board_put(board, next_rand() % 16, 1);
+		else {
+			memset(array_status, 0, sizeof(array_status));
+			array_block_gen(next_rand());
+		}
+		for (step=0; step<GAME_STEPS && result == GAME_CONTINUE; step++) {
+			uint32 rand = next_rand();
+			if (bitboard)
+				result = board_step(&board, 1 + (rand >> 30), rand);
+			else
+				result = array_step(1 + (rand >> 30), rand);
+		}
+		*steps += step;
+	}
+	return now() - start;
+}
+
+int main(int argc, char** argv) {
+	uint32 games = (argc > 1) ? atoi(argv[1]) : 20000;
+	bool lazy = (argc > 2 && strcmp(argv[2], "lazy") == 0);
+	uint32 steps;
+	double start = now();
+	board_init(table, !lazy);
+	printf("table: %u bytes, %s in %.3f ms\n", BOARD_TABLE_SIZE, lazy ? "cleared" : "filled", (now() - start) * 1e3);
+	if (!check_rows())
+		return 1;
+	steps = check(games >> 4);
+	if (!steps)
+		return 1;
+	printf("check: all rows in all directions and %u steps of %u games identical\n", steps, games >> 4);
+	double array_time = run(games, false, &steps);
+	printf("array:    %u moves in %.3f s, %.2f M moves per second\n", steps, array_time, steps / array_time * 1e-6);
+	double board_time = run(games, true, &steps);
+	printf("bitboard: %u moves in %.3f s, %.2f M moves per second, %.1f times\n", steps, board_time, steps / board_time * 1e-6, array_time / board_time);
+	return 0;
+}
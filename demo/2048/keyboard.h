@@ -202,10 +202,6 @@
 
 #include "types.h"
 
-typedef struct _scancode {
-	uint8 scan_code;
-	uint32 time;
-} scancode;
 typedef struct _keycode {
 	uint8 key_code;
 	uint8 ascii;
@@ -216,7 +212,16 @@ typedef struct _keycode {
 	uint32 time;
 } keycode;
 
-void scancode_recv(uint8 scan_code, uint32 time);
+// key events from the keyboard controller, {time in ms[31:16], 0[15:14], win, alt, ctrl, shift, repeat, key_up, key_code[7:0]}
+#define KEY_EVENT_UP     (1 << 8)
+#define KEY_EVENT_REPEAT (1 << 9)
+#define KEY_EVENT_SHIFT  (1 << 10)
+#define KEY_EVENT_CTRL   (1 << 11)
+#define KEY_EVENT_ALT    (1 << 12)
+
+void key_event_recv(uint32 event, uint32 counter, uint32 device_now);
+// provided by the application, milliseconds since reset when timer counter low was read as 'counter'
+uint32 get_ms_count_at(uint32 counter);
 keycode get_key(uint8 type, bool block);
 uint8 get_char(bool block);
 
@@ -2,25 +2,29 @@
 #include "random.h"
 
 
-uint32* pos = 0;
-uint32 size = 1 << 20;
-uint32* index = 0;
+#define RANDOM_ADDR 0xFFFF0700  // wb_random
 
-void rand_init(uint32* ram_pos, uint32 ram_size, uint32 time) {
-	if (ram_size) {
-		pos = ram_pos;
-		size = ram_size >> 2;
-	}
-	time = time >> 4;
-	udiv(time, size, &time);
-	index = pos + time;
+uint32 range_begin = 0;
+uint32 range_end = 0;
+
+void rand_init(uint32 seed) {
+	volatile uint32* rng = (uint32*)RANDOM_ADDR;
+	rng[4] = 1;  // free-running, so numbers also depend on when keys are pressed
+	rng[8] ^= seed;
+	rng[2] = 0;
+	rng[3] = 0;
+	range_begin = 0;
+	range_end = 0;
 }
 
+// bounded by hardware, the range is written only when it changes
 uint32 random(uint32 begin, uint32 end) {
-	uint32 data = *index;
-	index++;
-	if (index - pos == size)
-		index = pos;
-	udiv(data, end-begin, &data);
-	return begin + data;
+	volatile uint32* rng = (uint32*)RANDOM_ADDR;
+	if (begin != range_begin || end != range_end) {
+		rng[2] = begin;
+		rng[3] = end;
+		range_begin = begin;
+		range_end = end;
+	}
+	return rng[1];
 }
@@ -38,19 +38,19 @@ uint32 udiv(uint32 a, uint32 b, uint32* rem) {
 	return result;
 }
 
-void mem_set(uint32* addr, uint32 value, uint32 count) {
-	while (count != 0) {
-		*addr = value;
-		addr ++;
-		count --;
-	}
+uint32 int_disable() {
+	uint32 ier;
+	__asm__ __volatile__ ("mfc0 %0, $4": "=r"(ier));
+	__asm__ __volatile__ ("mtc0 %0, $4": : "r"(ier & ~(1<<31)): "memory");
+	return ier;
 }
 
-void mem_copy(uint32* src, uint32* dst, uint32 count) {
-	while (count != 0) {
-		*dst = *src;
-		src ++;
-		dst ++;
-		count --;
-	}
+void int_restore(uint32 ier) {
+	__asm__ __volatile__ ("mtc0 %0, $4": : "r"(ier): "memory");
+}
+
+// sleep until any interrupt enabled in IER is pending, even if interrupts are disabled globally
+// so call it with interrupts disabled after checking the condition, and no wakeup would be lost
+void cpu_wait() {
+	__asm__ __volatile__ ("wait": : : "memory");
 }
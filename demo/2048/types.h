@@ -7,14 +7,32 @@ typedef unsigned short uint16;
 typedef signed short int16;
 typedef unsigned int uint32;
 typedef signed int int32;
+typedef unsigned long long uint64;
 
 typedef unsigned char bool;
 #define false 0
 #define true 1
 #define null 0
 
+// hot code and data placed in the scratchpad memory at 0xFE000000 by boot.lds and boot.S, nothing on host
+#ifdef __mips__
+#define FAST_TEXT __attribute__((section(".fasttext")))
+#define FAST_DATA __attribute__((section(".fastdata")))
+#else
+#define FAST_TEXT
+#define FAST_DATA
+#endif
+
 int32 mul(int32 a, int32 b);
+uint32 umul(uint32 a, uint32 b);
+uint32 udiv(uint32 a, uint32 b, uint32* rem);
+// mem_* are in ../common/mem.S, counts in words, sizes in bytes
 void mem_set(uint32* addr, uint32 value, uint32 count);
 void mem_copy(uint32* src, uint32* dst, uint32 count);
+void mem_set_bytes(void* addr, uint32 value, uint32 size);
+void mem_copy_bytes(void* src, void* dst, uint32 size);
+uint32 int_disable();
+void int_restore(uint32 ier);
+void cpu_wait();
 
 #endif
@@ -0,0 +1,28 @@
+#ifndef __SD_H__
+#define __SD_H__
+
+// SD card over SPI in sd.S, types come from each demo
+
+#define SD_BLOCK_SIZE 512
+
+// blocks read by CMD18 into two buffers in turn, buf and size are set by the caller
+typedef struct _sd_stream {
+	uint8* buf[2];
+	uint32 size;  // bytes of each buffer, multiple of SD_BLOCK_SIZE
+	uint32 fill;  // buffer being filled
+	uint32 offset;  // bytes filled in it
+	uint32 full;  // buffers filled and not released yet
+	uint32 state;  // 0 while waiting for the data token, then data and CRC bytes left in the block
+	uint32 inflight;  // bytes sent to the card and not received yet
+	uint32 error;  // data error token from the card
+} sd_stream;
+
+int32 sd_init();  // 0 on success, negative if there is no card or it is not supported
+int32 sd_read(uint32 block, uint8* buf, uint32 count);  // 0 on success
+int32 sd_stream_start(sd_stream* s, uint32 block);  // returns R1 of CMD18, 0 on success
+int32 sd_stream_pump(sd_stream* s);  // never waits, returns number of full buffers, negative on error
+uint8* sd_stream_get(sd_stream* s);  // the older full buffer, 0 if none
+void sd_stream_release(sd_stream* s);  // give the older full buffer back to be filled
+int32 sd_stream_stop(sd_stream* s);  // returns R1 of CMD12
+
+#endif
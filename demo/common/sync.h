@@ -0,0 +1,29 @@
+#ifndef __SYNC_H__
+#define __SYNC_H__
+
+// lock-free rings and spin locks in sync.S, types come from types.h of each demo
+
+typedef struct _ring {
+	volatile uint32 head;  // written by producers
+	uint32 head_pad[3];  // head and tail live in different cache lines, so that they never break links of each other
+	volatile uint32 tail;  // written by the consumer
+	uint32 tail_pad[3];
+	uint32 mask;  // number of slots - 1
+	uint32* slots;
+} __attribute__((aligned(16))) ring;
+
+// static initializer of SPSC ring, size must be the power of 2
+#define SPSC_RING(slots, size) {0, {0}, 0, {0}, (size) - 1, (slots)}
+
+void spsc_init(ring* r, uint32* slots, uint32 size);
+bool spsc_push(ring* r, uint32 value);
+bool spsc_pop(ring* r, uint32* value);
+void mpsc_init(ring* r, uint32* slots, uint32 size);  // slots has 2 * size words
+bool mpsc_push(ring* r, uint32 value);
+bool mpsc_pop(ring* r, uint32* value);
+uint32 atomic_add(uint32* addr, uint32 value);  // returns the former value
+void spin_lock(uint32* lock);  // never in interrupt handlers
+bool spin_trylock(uint32* lock);
+void spin_unlock(uint32* lock);
+
+#endif
@@ -0,0 +1,211 @@
+"""
+Flat profile from the dump of the trace unit (wb_trace), printed by "trace_dump" in "trace.S" through UART.
+Author: Zhao, Hongyu  <power_zhy@foxmail.com>
+
+Usage: trace_profile.py symbols [log_path | --port device [--baud rate]] [--top n]
+	symbols: ELF file, or objdump listing like "demo/2048/2048.txt"
+	log_path: text captured from UART, the last dump in it is used, standard input if omitted
+	--port: read a dump directly from the serial port, needs pyserial
+Samples are counted per function. Branch entries split the time into runs of straight code, and each run is
+charged to the function of the branch target starting it, so that the cycles are exact as long as the buffer
+has not dropped any entry.
+"""
+
+import struct
+import sys
+
+HISTOGRAM_WIDTH = 20
+TYPE_SAMPLE = 0
+TYPE_BRANCH = 1
+TYPE_EXCEPTION = 2
+
+
+class Symbols:
+	def __init__(self):
+		self.table = []  # (address, size, name)
+
+	def load(self, path):
+		with open(path, "rb") as input:
+			data = input.read()
+		if (data[:4] == b"\x7fELF"):
+			self.load_elf(data)
+		else:
+			self.load_listing(data.decode("latin-1"))
+		self.table.sort()
+		merged = []
+		for sym in self.table:
+			if (merged and merged[-1][0] == sym[0]):
+				continue
+			merged.append(sym)
+		# labels without size reach the next symbol, and no symbol overlaps the next one
+		for i in range(len(merged) - 1):
+			addr, size, name = merged[i]
+			gap = merged[i+1][0] - addr
+			if (size == 0 or size > gap):
+				merged[i] = (addr, gap, name)
+		if (merged and merged[-1][1] == 0):
+			merged[-1] = (merged[-1][0], 4, merged[-1][2])
+		self.table = merged
+
+	# functions and labels in symbol table of 32-bit ELF
+	def load_elf(self, data):
+		endian = "<" if data[5] == 1 else ">"
+		shoff, = struct.unpack_from(endian + "I", data, 32)
+		shentsize, shnum = struct.unpack_from(endian + "HH", data, 46)
+		for i in range(shnum):
+			sh = shoff + i * shentsize
+			type, = struct.unpack_from(endian + "I", data, sh + 4)
+			if (type != 2):  # SHT_SYMTAB
+				continue
+			offset, size, link = struct.unpack_from(endian + "III", data, sh + 16)
+			str_offset, = struct.unpack_from(endian + "I", data, shoff + link * shentsize + 16)
+			for j in range(offset, offset + size - 15, 16):
+				name, value, sym_size, info, other, shndx = struct.unpack_from(endian + "IIIBBH", data, j)
+				if ((info & 0xF) not in (0, 2) or shndx == 0 or name == 0):  # STT_NOTYPE and STT_FUNC
+					continue
+				end = data.index(b"\0", str_offset + name)
+				self.table.append((value, sym_size, data[str_offset+name:end].decode("latin-1")))
+
+	# "ff000210 <mul>:" starts a symbol, "ff000214:\t..." is an instruction
+	def load_listing(self, text):
+		end = 0
+		for line in text.splitlines():
+			words = line.split()
+			if (len(words) == 2 and words[1].startswith("<") and words[1].endswith(">:")):
+				try:
+					self.table.append((int(words[0], 16), 0, words[1][1:-2]))
+				except ValueError:
+					pass
+			elif (words and words[0].endswith(":")):
+				try:
+					end = max(end, int(words[0][:-1], 16) + 4)
+				except ValueError:
+					pass
+		# the last symbol ends at the last instruction
+		if (self.table and end > self.table[-1][0]):
+			self.table[-1] = (self.table[-1][0], end - self.table[-1][0], self.table[-1][2])
+
+	def find(self, pc):
+		low, high = 0, len(self.table)
+		while (low < high):
+			mid = (low + high) // 2
+			if (self.table[mid][0] <= pc):
+				low = mid + 1
+			else:
+				high = mid
+		if (low > 0):
+			addr, size, name = self.table[low-1]
+			if (pc - addr < size):
+				return name
+		return "(unknown)"
+
+
+# the last complete dump, as (count, capacity, dropped, entries), entries are (pc, type, timestamp)
+def parse_dump(lines):
+	dump = None
+	current = None
+	for line in lines:
+		words = line.split()
+		if (not words):
+			continue
+		if (words[0] == "TRACE" and len(words) >= 4):
+			current = (int(words[1], 16), int(words[2], 16), int(words[3], 16), [])
+		elif (words[0] == "END"):
+			if (current is not None):
+				dump = current
+			current = None
+		elif (current is not None and len(words) >= 2):
+			word, timestamp = int(words[0], 16), int(words[1], 16)
+			current[3].append((word & ~3, word & 3, timestamp))
+	return dump
+
+
+def read_port(port, baud):
+	import serial
+	lines = []
+	with serial.Serial(port, baud) as device:
+		while (True):
+			line = device.readline().decode("latin-1")
+			lines.append(line)
+			if (line.strip() == "END"):
+				return lines
+
+
+def report(symbols, dump, top):
+	count, capacity, dropped, entries = dump
+	print("Trace: {} entries recorded, capacity {}, {} dropped".format(count, capacity, dropped))
+	if (count > capacity):
+		print("Buffer has wrapped, only the latest {} entries are kept".format(capacity))
+	samples = {}
+	cycles = {}
+	enters = {}
+	branches = [e for e in entries if e[1] != TYPE_SAMPLE]
+	for pc, type, timestamp in entries:
+		if (type == TYPE_SAMPLE):
+			name = symbols.find(pc)
+			samples[name] = samples.get(name, 0) + 1
+	for i in range(len(branches)):
+		name = symbols.find(branches[i][0])
+		enters[name] = enters.get(name, 0) + 1
+		if (i + 1 < len(branches)):
+			cycles[name] = cycles.get(name, 0) + ((branches[i+1][2] - branches[i][2]) & 0xFFFFFFFF)
+	if (samples):
+		print_table("Sampled profile", "samples", samples, None, top)
+	if (cycles):
+		print_table("Branch trace profile", "cycles", cycles, enters, top)
+	if (not samples and not cycles):
+		print("No entries")
+
+
+def print_table(title, unit, counts, enters, top):
+	total = sum(counts.values())
+	print("")
+	print("{}: {} {}".format(title, total, unit))
+	print("{:>14} {:>7} {:>7} {:>10}  {:<{}}  {}".format(unit, "%", "cumul%", "branches" if enters else "", "", HISTOGRAM_WIDTH, "function"))
+	if (total == 0):
+		return
+	cumul = 0
+	ranked = sorted(counts.items(), key=lambda item: item[1], reverse=True)
+	if (top > 0):
+		ranked = ranked[:top]
+	for name, value in ranked:
+		cumul += value
+		share = 100.0 * value / total
+		bar = "#" * int(share * HISTOGRAM_WIDTH / 100 + 0.5)
+		print("{:>14} {:>6.2f}% {:>6.2f}% {:>10}  {:<{}}  {}".format(value, share, 100.0 * cumul / total,
+			enters.get(name, 0) if enters else "", bar, HISTOGRAM_WIDTH, name))
+
+
+if __name__ == "__main__":
+	args = sys.argv[1:]
+	port = None
+	baud = 115200
+	top = 30
+	paths = []
+	while (args):
+		arg = args.pop(0)
+		if (arg == "--port" and args):
+			port = args.pop(0)
+		elif (arg == "--baud" and args):
+			baud = int(args.pop(0))
+		elif (arg == "--top" and args):
+			top = int(args.pop(0))
+		else:
+			paths.append(arg)
+	if (not paths):
+		print("Usage: {} symbols [log_path | --port device [--baud rate]] [--top n]".format(sys.argv[0]))
+		sys.exit(1)
+	symbols = Symbols()
+	symbols.load(paths[0])
+	if (port):
+		lines = read_port(port, baud)
+	elif (len(paths) > 1):
+		with open(paths[1], "r", errors="replace") as input:
+			lines = input.readlines()
+	else:
+		lines = sys.stdin.readlines()
+	dump = parse_dump(lines)
+	if (dump is None):
+		print("No complete dump found")
+		sys.exit(1)
+	report(symbols, dump, top)
@@ -0,0 +1,165 @@
+#define SRC_ADDR		0x00100000
+#define DST_ADDR		0x00120000
+#define BOARD_ADDR		0xFFFF0200
+#define UART_ADDR		0xFFFF0600
+
+#define UART_BAUD_DIV	10  // 115200 with 10MHz UART clock
+#define TRACE_SAMPLE	2  // mode of trace_start
+#define TRACE_INTERVAL	4096  // in CPU cycles, so that 1024 samples cover about 4M cycles
+#define REPEAT_BITS		2  // each measurement is averaged over 4 calls
+#define SIZE_NUM		7
+
+
+typedef unsigned char uint8;
+typedef signed char int8;
+typedef unsigned short uint16;
+typedef signed short int16;
+typedef unsigned int uint32;
+typedef signed int int32;
+
+
+void bootup();
+void exception();
+// ../common/mem.S
+void mem_set(uint32* addr, uint32 value, uint32 count);
+void mem_copy(uint32* src, uint32* dst, uint32 count);
+void mem_set_bytes(void* addr, uint32 value, uint32 size);
+void mem_copy_bytes(void* src, void* dst, uint32 size);
+// ../common/trace.S
+void trace_start(uint32 mode, uint32 interval);
+void trace_stop();
+void trace_dump();
+
+const uint32 sizes[SIZE_NUM] = {4, 16, 64, 256, 1024, 4096, 16384};
+uint32 overhead = 0;
+
+
+// the loops used by demos before, for comparison
+void __attribute__((noinline)) old_mem_set(uint32* addr, uint32 value, uint32 count) {
+	while (count != 0) {
+		*addr = value;
+		addr ++;
+		count --;
+	}
+}
+
+void __attribute__((noinline)) old_mem_copy(uint32* src, uint32* dst, uint32 count) {
+	while (count != 0) {
+		*dst = *src;
+		src ++;
+		dst ++;
+		count --;
+	}
+}
+
+uint32 udiv(uint32 a, uint32 b, uint32* rem) {
+	uint32 result = 0;
+	int8 i;
+	for (i=31; i>=0; i--) {
+		result <<= 1;
+		if ((a >> i) >= b) {
+			result += 1;
+			a -= b << i;
+		}
+	}
+	*rem = a;
+	return result;
+}
+
+uint32 get_cycles() {
+	uint32 count;
+	__asm__ __volatile__ ("mfc0 %0, $13": "=r"(count));
+	return count;
+}
+
+void uart_putc(char ch) {
+	volatile uint32* uart = (uint32*)UART_ADDR;
+	while ((uart[1] & 0xFFFF) == 0);
+	uart[3] = ch;
+}
+
+void uart_puts(const char* str) {
+	while (*str) {
+		if (*str == '\n')
+			uart_putc('\r');
+		uart_putc(*str);
+		str ++;
+	}
+}
+
+void uart_putd(uint32 value, uint32 width) {
+	char buf[12];
+	uint32 len = 0;
+	uint32 rem;
+	do {
+		value = udiv(value, 10, &rem);
+		buf[len++] = '0' + rem;
+	} while (value);
+	while (width > len) {
+		uart_putc(' ');
+		width --;
+	}
+	while (len) {
+		len --;
+		uart_putc(buf[len]);
+	}
+}
+
+// bytes per cycle with three decimals
+void print_rate(uint32 bytes, uint32 cycles) {
+	uint32 integer, rem, frac;
+	cycles = (cycles > overhead) ? (cycles - overhead) : 1;
+	integer = udiv(bytes, cycles, &rem);
+	frac = udiv((rem << 10) - (rem << 4) - (rem << 3), cycles, &rem);  // rem * 1000
+	uart_putd(integer, 4);
+	uart_putc('.');
+	uart_putc('0' + udiv(frac, 100, &rem));
+	uart_putc('0' + udiv(rem, 10, &rem));
+	uart_putc('0' + rem);
+}
+
+#define MEASURE(call) ({ \
+	uint32 start, i; \
+	start = get_cycles(); \
+	for (i=0; i<(1<<REPEAT_BITS); i++) \
+		call; \
+	(get_cycles() - start) >> REPEAT_BITS; \
+})
+
+void bootup() {
+	volatile uint32* board = (uint32*)BOARD_ADDR;
+	volatile uint32* uart = (uint32*)UART_ADDR;
+	uint8* src = (uint8*)SRC_ADDR;
+	uint8* dst = (uint8*)DST_ADDR;
+	uint32 i, size;
+
+	uart[2] = (UART_BAUD_DIV << 8) | 1;
+	for (i=0; i<16384; i++)
+		src[i+4] = i;
+	overhead = MEASURE(old_mem_set((uint32*)dst, 0, 0));
+	trace_start(TRACE_SAMPLE, TRACE_INTERVAL);
+
+	uart_puts("\nMemory primitives, bytes per cycle, averaged over 4 calls\n");
+	uart_puts("          set                     copy\n");
+	uart_puts(" size     old     new  byte+1     old     new  same+1  diff+1\n");
+	for (i=0; i<SIZE_NUM; i++) {
+		size = sizes[i];
+		uart_putd(size, 5);
+		print_rate(size, MEASURE(old_mem_set((uint32*)dst, 0x5A5A5A5A, size >> 2)));
+		print_rate(size, MEASURE(mem_set((uint32*)dst, 0x5A5A5A5A, size >> 2)));
+		print_rate(size, MEASURE(mem_set_bytes(dst + 1, 0x5A5A5A5A, size)));
+		print_rate(size, MEASURE(old_mem_copy((uint32*)src, (uint32*)dst, size >> 2)));
+		print_rate(size, MEASURE(mem_copy((uint32*)src, (uint32*)dst, size >> 2)));
+		print_rate(size, MEASURE(mem_copy_bytes(src + 1, dst + 1, size)));
+		print_rate(size, MEASURE(mem_copy_bytes(src + 1, dst + 2, size)));
+		uart_puts("\n");
+	}
+	uart_puts("Done!\n");
+	trace_stop();
+	trace_dump();
+	board[4] = 0xFF;
+}
+
+void exception() {
+	while (1);
+}
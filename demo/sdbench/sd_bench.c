@@ -0,0 +1,149 @@
+#define BUF_ADDR		0x00100000
+#define BUF_SIZE		0x00002000  // bytes of each stream buffer
+#define BOARD_ADDR		0xFFFF0200
+#define UART_ADDR		0xFFFF0600
+
+#define UART_BAUD_DIV	10  // 115200 with 10MHz UART clock
+#define BENCH_BYTES		0x00020000  // read from block 0 of the card
+
+
+typedef unsigned char uint8;
+typedef signed char int8;
+typedef unsigned short uint16;
+typedef signed short int16;
+typedef unsigned int uint32;
+typedef signed int int32;
+
+#include "../common/sd.h"
+
+
+void bootup();
+void exception();
+
+sd_stream stream = {{(uint8*)BUF_ADDR, (uint8*)(BUF_ADDR + BUF_SIZE)}, BUF_SIZE};
+
+
+uint32 udiv(uint32 a, uint32 b, uint32* rem) {
+	uint32 result = 0;
+	int8 i;
+	for (i=31; i>=0; i--) {
+		result <<= 1;
+		if ((a >> i) >= b) {
+			result += 1;
+			a -= b << i;
+		}
+	}
+	*rem = a;
+	return result;
+}
+
+uint32 get_cycles() {
+	uint32 count;
+	__asm__ __volatile__ ("mfc0 %0, $13": "=r"(count));
+	return count;
+}
+
+void uart_putc(char ch) {
+	volatile uint32* uart = (uint32*)UART_ADDR;
+	while ((uart[1] & 0xFFFF) == 0);
+	uart[3] = ch;
+}
+
+void uart_puts(const char* str) {
+	while (*str) {
+		if (*str == '\n')
+			uart_putc('\r');
+		uart_putc(*str);
+		str ++;
+	}
+}
+
+void uart_putd(uint32 value) {
+	char buf[12];
+	uint32 len = 0;
+	uint32 rem;
+	do {
+		value = udiv(value, 10, &rem);
+		buf[len++] = '0' + rem;
+	} while (value);
+	while (len) {
+		len --;
+		uart_putc(buf[len]);
+	}
+}
+
+void uart_puth(uint32 value) {
+	int8 i;
+	for (i=28; i>=0; i-=4)
+		uart_putc("0123456789ABCDEF"[(value >> i) & 0xF]);
+}
+
+// value with three decimals
+void print_ratio(uint32 a, uint32 b) {
+	uint32 integer, rem, frac;
+	integer = udiv(a, b, &rem);
+	frac = udiv((rem << 10) - (rem << 4) - (rem << 3), b, &rem);  // rem * 1000
+	uart_putd(integer);
+	uart_putc('.');
+	uart_putc('0' + udiv(frac, 100, &rem));
+	uart_putc('0' + udiv(rem, 10, &rem));
+	uart_putc('0' + rem);
+}
+
+// the consumer sums every word of a full buffer, and keeps the stream going only between buffers
+void bootup() {
+	volatile uint32* board = (uint32*)BOARD_ADDR;
+	volatile uint32* uart = (uint32*)UART_ADDR;
+	uint32 start, cycles, bytes, sum, i;
+	int32 full;
+	uint32* buf;
+
+	uart[2] = (UART_BAUD_DIV << 8) | 1;
+	uart_puts("\nSD card sustained read by CMD18 into two buffers\n");
+	if (sd_init() != 0) {
+		uart_puts("No SD card!\n");
+		return;
+	}
+	start = get_cycles();
+	if (sd_stream_start(&stream, 0) != 0) {
+		uart_puts("CMD18 failed!\n");
+		return;
+	}
+	bytes = 0;
+	sum = 0;
+	while (bytes < BENCH_BYTES) {
+		full = sd_stream_pump(&stream);
+		if (full < 0) {
+			uart_puts("Data error!\n");
+			return;
+		}
+		if (full == 0)
+			continue;
+		buf = (uint32*)sd_stream_get(&stream);
+		for (i=0; i<(BUF_SIZE>>2); i++)
+			sum += buf[i];
+		sd_stream_release(&stream);
+		bytes += BUF_SIZE;
+	}
+	cycles = get_cycles() - start;
+	sd_stream_stop(&stream);
+
+	uart_puts("bytes: ");
+	uart_putd(bytes);
+	uart_puts(", buffer: ");
+	uart_putd(BUF_SIZE);
+	uart_puts(", cycles: ");
+	uart_putd(cycles);
+	uart_puts("\ncycles per byte: ");
+	print_ratio(cycles, bytes);
+	uart_puts(", bytes per cycle: ");
+	print_ratio(bytes, cycles);
+	uart_puts("\nchecksum: ");
+	uart_puth(sum);
+	uart_puts("\nDone!\n");
+	board[4] = 0xFF;
+}
+
+void exception() {
+	while (1);
+}
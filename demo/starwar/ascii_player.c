@@ -2,11 +2,20 @@
 #define DATA_RANGE		0x00100000
 #define VRAM_ADDR		0x00100000
 #define VRAM_RANGE		0x00010000
+#define SHADOW_ADDR		0x00110000  // one byte per character cell, what is displayed in VRAM
 #define VGA_ADDR		0xFFFF0100
 #define BOARD_ADDR		0xFFFF0200
 #define KEYBOARD_ADDR	0xFFFF0300
+#define TIMER_ADDR		0xFFFF0400
 #define SPI_ADDR		0xFFFF0500
 #define UART_ADDR		0xFFFF0600
+#define SD_INDEX_ADDR	0x00120000  // header and frame index of the movie on SD card
+#define SD_INDEX_RANGE	0x00020000
+#define SD_RING_ADDR	0x00140000  // two stream buffers and a guard after them
+#define SD_RING_SIZE	0x00001000  // bytes of each stream buffer
+#define SD_GUARD_SIZE	0x00000200  // longest frame, beginning of the first buffer is mirrored here
+
+#define MOVIE_V2_MAGIC	0x32565753  // "SWV2"
 
 
 typedef unsigned char uint8;
@@ -16,14 +25,30 @@ typedef signed short int16;
 typedef unsigned int uint32;
 typedef signed int int32;
 
+#include "../common/sd.h"
+
 
 void bootup();
 void exception();
+// ../common/mem.S
+void mem_set(int32* addr, int32 value, uint32 count);
+void mem_copy(int32* src, int32* dst, uint32 count);
 
 uint32 frame_count = 0;
 uint8* file_index = 0;
 uint32 movie_width = 0;
 uint32 movie_height = 0;
+uint32 movie_version = 0;
+uint32 frame_num = 0;  // version 2 only
+uint32* frame_index = 0;  // version 2 only, offsets of frames from DATA_ADDR
+uint32 key_interval = 0;  // version 2 only, every frame at a multiple of it is a key frame
+uint32 whole_frame = 0;  // frame contains the whole picture, cells jumped over or after line end are blank
+
+// version 2 movie streamed from SD card, frames are decoded in the stream buffers
+uint32 movie_sd = 0;
+sd_stream movie_stream = {{(uint8*)SD_RING_ADDR, (uint8*)(SD_RING_ADDR + SD_RING_SIZE)}, SD_RING_SIZE};
+uint32 stream_active = 0;
+uint32 stream_base = 0;  // offset in the movie of the buffer being decoded
 
 uint32 screen_width = 0;
 uint32 screen_height = 0;
@@ -89,23 +114,6 @@ int32 mul(int32 a, int32 b) {
 	return result;
 }
 
-void mem_set(int32* addr, int32 value, uint32 count) {
-	while (count != 0) {
-		*addr = value;
-		addr ++;
-		count --;
-	}
-}
-
-void mem_copy(int32* src, int32* dst, uint32 count) {
-	while (count != 0) {
-		*dst = *src;
-		src ++;
-		dst ++;
-		count --;
-	}
-}
-
 void update_position() {
 	uint32 dw = screen_width - movie_width;
 	uint32 dh = screen_height - movie_height;
@@ -145,6 +153,7 @@ void init_vga(uint32 mode, uint32 addr) {
 			break;
 	}
 	mem_set((int32*)addr, 0x07200720, screen_range>>1);
+	mem_set((int32*)SHADOW_ADDR, 0x20202020, screen_range>>2);
 	config[1] = addr;
 	config[0] = mode;  // text mode
 	config[2] = 0;
@@ -174,41 +183,81 @@ int32 find_frame(uint32 backward) {
 	}
 }
 
+// only cells different from the shadow are written to VRAM, so the traffic scales with the motion
+void put_cell(uint16* row_base, uint8* shadow_row, uint32 col, uint8 data) {
+	if (shadow_row[col] != data) {
+		shadow_row[col] = data;
+		row_base[col] = 0x0700 | data;
+	}
+}
+
+void blank_cells(uint16* row_base, uint8* shadow_row, uint32 from, uint32 to) {
+	if (row_num >= screen_height)
+		return;
+	if (to > screen_width)
+		to = screen_width;
+	while (from < to) {
+		put_cell(row_base, shadow_row, from, ' ');
+		from ++;
+	}
+}
+
 int32 render(uint16* frame_base) {
-	uint16* row_base = frame_base + mul(screen_width, row_num);
-	uint16* col_curr = row_base + col_num;
+	uint32 offset = mul(screen_width, row_num);
+	uint16* row_base = frame_base + offset;
+	uint8* shadow_row = (uint8*)SHADOW_ADDR + offset;
 	while (1) {
 		uint8 data = *file_index;
 		if (data < 0x80) {  // normal character
-			if (col_num < screen_width && row_num < screen_height) {
-				*col_curr = 0x0700 | data;
-				col_curr ++;
-				col_num ++;
-			}
+			if (col_num < screen_width && row_num < screen_height)
+				put_cell(row_base, shadow_row, col_num, data);
+			col_num ++;
 		}
 		else if (data >= 0xF0) {  // control
 			if (data == 0xF0) {  // movie size info
 				movie_height = *(file_index+1);
 				movie_width = *(file_index+2);
 				update_position();
-				row_base = frame_base + mul(screen_width, row_num);
-				col_curr = row_base + col_num;
+				row_num = blank_top;
+				col_num = blank_left;
+				offset = mul(screen_width, row_num);
+				row_base = frame_base + offset;
+				shadow_row = (uint8*)SHADOW_ADDR + offset;
 				file_index += 2;
 			}
 			else if (data == 0xF1) {  // move cursor
 				row_num = *(file_index+1) + blank_top;
 				col_num = *(file_index+2) + blank_left;
-				row_base = frame_base + mul(screen_width, row_num);
-				col_curr = row_base + col_num;
+				offset = mul(screen_width, row_num);
+				row_base = frame_base + offset;
+				shadow_row = (uint8*)SHADOW_ADDR + offset;
 				file_index += 2;
 			}
+			else if (data == 0xF2) {  // clear screen, key frame
+				whole_frame = 1;
+				row_num = blank_top;
+				col_num = blank_left;
+				offset = mul(screen_width, row_num);
+				row_base = frame_base + offset;
+				shadow_row = (uint8*)SHADOW_ADDR + offset;
+			}
 			else if (data == 0xFD) {  // new line
+				if (whole_frame)
+					blank_cells(row_base, shadow_row, col_num, blank_left + movie_width);
 				row_num ++;
 				col_num = blank_left;
 				row_base += screen_width;
-				col_curr = row_base + col_num;
+				shadow_row += screen_width;
 			}
 			else if (data == 0xFE) {  // new frame
+				// rows not given by a whole frame are blank
+				while (whole_frame && row_num < blank_top + movie_height) {
+					blank_cells(row_base, shadow_row, col_num, blank_left + movie_width);
+					row_num ++;
+					col_num = blank_left;
+					row_base += screen_width;
+					shadow_row += screen_width;
+				}
 				return 0;
 			}
 			else if (data == 0xFF) {  // movie end
@@ -218,7 +267,8 @@ int32 render(uint16* frame_base) {
 		else {
 			data -= 0x7f;
 			if (data <= 80) {  // jump over
-				col_curr += data;
+				if (whole_frame)
+					blank_cells(row_base, shadow_row, col_num, col_num + data);
 				col_num += data;
 			}
 			else {  // time delay
@@ -229,37 +279,132 @@ int32 render(uint16* frame_base) {
 	}
 }
 
+// read header and frame index of a version 2 movie from SD card, returns 1 if found
+int32 load_sd_movie() {
+	if (sd_init() != 0)
+		return 0;
+	if (sd_read(0, (uint8*)SD_INDEX_ADDR, 1) != 0 || *(uint32*)SD_INDEX_ADDR != MOVIE_V2_MAGIC)
+		return 0;
+	uint32 blocks = (12 + (*(uint32*)(SD_INDEX_ADDR + 4) << 2) + SD_BLOCK_SIZE - 1) >> 9;
+	if (blocks > (SD_INDEX_RANGE >> 9) || sd_read(0, (uint8*)SD_INDEX_ADDR, blocks) != 0)
+		return 0;
+	return 1;
+}
+
+void stream_restart(uint32 offset) {
+	if (stream_active)
+		sd_stream_stop(&movie_stream);
+	stream_base = offset & ~(SD_BLOCK_SIZE - 1);
+	stream_active = (sd_stream_start(&movie_stream, stream_base >> 9) == 0);
+}
+
+// frame in the stream buffers, the stream only goes forward and restarts for frames behind or far ahead,
+// a frame running over the end of the second buffer continues in the guard, 0 on error
+uint8* stream_frame(uint32 frame) {
+	uint32 start = frame_index[frame];
+	uint32 end = (frame + 1 < frame_num) ? frame_index[frame+1] : start + SD_GUARD_SIZE;
+	if (end < start || end - start > SD_GUARD_SIZE)
+		return 0;
+	if (!stream_active || start < stream_base || start >= stream_base + (SD_RING_SIZE << 1))
+		stream_restart(start);
+	if (!stream_active)
+		return 0;
+	int32 full;
+	while (1) {
+		full = sd_stream_pump(&movie_stream);
+		if (full < 0)
+			return 0;
+		if (full == 0)
+			continue;
+		if (start < stream_base + SD_RING_SIZE)
+			break;
+		sd_stream_release(&movie_stream);
+		stream_base += SD_RING_SIZE;
+	}
+	uint8* buf = sd_stream_get(&movie_stream);
+	if (end > stream_base + SD_RING_SIZE) {
+		while (full < 2) {
+			full = sd_stream_pump(&movie_stream);
+			if (full < 0)
+				return 0;
+		}
+		if (buf != (uint8*)SD_RING_ADDR)
+			mem_copy((int32*)SD_RING_ADDR, (int32*)(SD_RING_ADDR + (SD_RING_SIZE << 1)), (end - stream_base - SD_RING_SIZE + 3) >> 2);
+	}
+	return buf + (start - stream_base);
+}
+
+uint8* frame_data(uint32 frame) {
+	if (movie_sd)
+		return stream_frame(frame);
+	return (uint8*)(DATA_ADDR + frame_index[frame]);
+}
+
+// decode frames from the nearest key frame to the one before target silently, version 2 only
+void seek_frame(uint32 target) {
+	uint32 key = target;
+	if (movie_sd) {
+		// looking back for the key frame would restart the stream for each frame
+		key = 0;
+		while (key + key_interval <= target)
+			key += key_interval;
+	}
+	else {
+		while (key > 0 && *(uint8*)(DATA_ADDR + frame_index[key]) != 0xF2)
+			key --;
+	}
+	for (frame_count=key; frame_count<target; frame_count++) {
+		file_index = frame_data(frame_count);
+		if (!file_index)
+			return;
+		whole_frame = 0;
+		while (render((uint16*)VRAM_ADDR) < 0)
+			file_index ++;
+	}
+}
+
 int32 sleep(uint32 value) {
-	volatile uint32* vga_config = (uint32*)VGA_ADDR;
 	volatile uint32* board_config = (uint32*)BOARD_ADDR;
-	vga_config[1] = VRAM_ADDR + VRAM_RANGE;
-	mem_copy((int32*)(VRAM_ADDR + VRAM_RANGE), (int32*)VRAM_ADDR, screen_range>>1);
-	vga_config[1] = VRAM_ADDR;
-	value = (value<<ctrl_play_speed) - 1;
-	__asm__ ("mtc0 %0, $7": : "r"(value));
-	__asm__ ("mtc0 %0, $5": : "r"(1<<0));
+	// set a one-shot deadline on timer channel 0
+	volatile uint32* timer_config = (uint32*)TIMER_ADDR;
+	value = mul(value<<ctrl_play_speed, mul(timer_config[3], 1000));
+	uint32 low = timer_config[0];
+	uint32 high = timer_config[1];
+	low += value;
+	if (low < value)
+		high ++;
+	timer_config[11] = 0;
+	timer_config[2] = 1<<0;
+	timer_config[8] = low;
+	timer_config[9] = high;
+	timer_config[11] = 5;  // one-shot with interrupt
+	// sleep until board inputs change or timer expires, interrupts are only used to wake up,
+	// and SPI wakes up to keep the SD card stream going when its buffer becomes empty
+	uint32 ir_mask = (1<<2) | (1<<4) | (movie_sd ? (1<<5) : 0);
+	__asm__ __volatile__ ("mtc0 %0, $4": : "r"(ir_mask));
 	uint32 data = 0;
 	while (1) {
+		__asm__ __volatile__ ("mtc0 %0, $5": : "r"(ir_mask): "memory");
+		if (movie_sd)
+			sd_stream_pump(&movie_stream);
 		// check board input
 		data = board_config[0];
 		ctrl_play_back = (data & 0x800) ? 1 : 0;
 		ctrl_play_speed = (data & 0xC00) ? 2 : ((data & 0x200) ? 7 : 6);
 		if ((data & 0x100) && ((data & 0xF) != ctrl_vga_mode)) {
-			vga_config[1] = VRAM_ADDR + VRAM_RANGE;
 			init_vga(data & 0xF, VRAM_ADDR);
 			update_position();
 			ctrl_vga_mode = data & 0xF;
-			__asm__ ("mtc0 %0, $7": : "r"(0));
-			__asm__ ("mtc0 %0, $5": : "r"(1<<0));
+			timer_config[11] = 0;
+			timer_config[2] = 1<<0;
 			return 1;
 		}
 		// check timer
-		__asm__ __volatile__ ("mfc0 %0, $5": "=r"(data));
-		if (data & (1<<0)) {
-			__asm__ ("mtc0 %0, $7": : "r"(0));
-			__asm__ ("mtc0 %0, $5": : "r"(1<<0));
+		if (timer_config[2] & (1<<0)) {
+			timer_config[2] = 1<<0;
 			return 0;
 		}
+		__asm__ __volatile__ ("wait": : : "memory");
 	}
 }
 
@@ -272,12 +417,40 @@ int32 paly_movie() {
 	blank_left = 0;
 	row_num = 0;
 	col_num = 0;
-	if (!find_frame(0))
-		return -2;
+	if (movie_sd || *(uint32*)DATA_ADDR == MOVIE_V2_MAGIC) {
+		uint8* header = movie_sd ? (uint8*)SD_INDEX_ADDR : (uint8*)DATA_ADDR;
+		movie_version = 2;
+		frame_num = *(uint32*)(header + 4);
+		movie_height = header[8];
+		movie_width = header[9];
+		key_interval = header[10] ? header[10] : 1;
+		frame_index = (uint32*)(header + 12);
+		update_position();
+	}
+	else {
+		movie_version = 1;
+		whole_frame = 1;
+		if (!find_frame(0))
+			return -2;
+	}
 	int32 state = 0;
 	while (1) {
-		if (state == 0) {
-			mem_set((int32*)(VRAM_ADDR + VRAM_RANGE), 0x07200720, screen_range>>1);
+		if (state == 0 && movie_version == 2) {
+			// delta frames are drawn on the previous picture on screen
+			if (ctrl_play_back) {
+				if (frame_count < 2)
+					return -1;
+				seek_frame(frame_count - 2);
+			}
+			if (frame_count >= frame_num)
+				return 0;
+			file_index = frame_data(frame_count);
+			if (!file_index)
+				return -2;
+			file_index --;
+			whole_frame = 0;
+		}
+		else if (state == 0) {
 			row_num = blank_top;
 			col_num = blank_left;
 			if (ctrl_play_back) {
@@ -291,7 +464,7 @@ int32 paly_movie() {
 			}
 		}
 		file_index ++;
-		state = render((uint16*)(VRAM_ADDR + VRAM_RANGE));
+		state = render((uint16*)VRAM_ADDR);
 		if (state == 0) {
 			frame_count ++;
 			disp_num(frame_count);
@@ -301,12 +474,15 @@ int32 paly_movie() {
 		}
 		else if (state < 0) {
 			if (sleep(-state)) {
-				if (!find_frame(1))
+				// screen size changed, draw current frame again from scratch
+				if (movie_version == 2)
+					seek_frame(frame_count);
+				else if (!find_frame(1))
 					return -1;
 				state = 0;
 			}
 		}
-		if ((int)file_index >= DATA_ADDR+DATA_RANGE)
+		if (!movie_sd && (int)file_index >= DATA_ADDR+DATA_RANGE)
 			return -2;
 	}
 }
@@ -315,6 +491,7 @@ void bootup() {
 	disp_num(0);
 	init_vga(1, VRAM_ADDR);
 	ctrl_vga_mode = 1;
+	movie_sd = load_sd_movie();
 	while (1) {
 		paly_movie();
 		sleep(1);
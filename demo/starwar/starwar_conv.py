@@ -6,57 +6,163 @@ Code Standard:
 0xF0 - 0xFF: Control
 	0xF0 h w: Movie size info (height, weight), should be at the beginning of one frame
 	0xF1 r c: Move cursor to (row, column)
+	0xF2: Clear screen and move cursor to (0, 0), starts a key frame (version 2 only)
 	0xFD: New line
 	0xFE: New frame
 	0xFF: Movie end
 	others: Reversed
+
+Version 2 container (little endian):
+	0x00: "SWV2"
+	0x04: frame number N
+	0x08: height, width, key frame interval, 0
+	0x0C: N frame offsets from the beginning of file
+	then N frames, each ends with 0xFE, and 0xFF after the last one
+	Key frames start with 0xF2 and contain the whole picture, other frames only contain cells changed since the
+	previous frame, with "0xF1 r c" to the first changed cell of each row and jumps over unchanged cells.
+
+Usage: starwar_conv.py [1|2], version 1 is written to "starwar.dat" and version 2 to "starwar_v2.dat"
 '''
 
 MOVIE_WIDTH = 68
 MOVIE_HEIGHT = 14
+KEY_INTERVAL = 16  # the longest chain of delta frames to decode when seeking
 
-import itertools
-frames = []
-with open("starwar.txt", "r") as infile:
-	lines = infile.readlines()
-	i = 0
-	while (i<len(lines)):
-		frames.append(lines[i:i+MOVIE_HEIGHT])
-		i += MOVIE_HEIGHT
-with open("starwar.dat", "wb") as outfile:
-	outfile.write(b"Star Wars Asciimation\n")
-	outfile.write(b"www.asciimation.co.nz presents\n")
-	outfile.write(b"Ported by zhy@swanspace.org\n")
-	contents = [0xFE, 0xF0, MOVIE_HEIGHT, MOVIE_WIDTH]
-	outfile.write(bytes(contents))
-	ii = 0
-	for frame in frames:
-		assert (len(frame) <= MOVIE_HEIGHT)
-		contents = []
-		ii += 1
-		delay = int(frame[0])
-		for line in frame[1:]:
-			line = line.replace('\n', '')
-			assert (len(line) <= MOVIE_WIDTH)
-			count = 0
-			for ch in line:
-				if (ch == ' '):
+import struct
+
+def read_frames():
+	frames = []
+	with open("starwar.txt", "r") as infile:
+		lines = infile.readlines()
+		i = 0
+		while (i<len(lines)):
+			frames.append(lines[i:i+MOVIE_HEIGHT])
+			i += MOVIE_HEIGHT
+	return frames
+
+def encode_delay(delay):
+	contents = []
+	while (delay > 32):
+		contents.append(0xCF + 32)
+		delay -= 32
+	if (delay > 0):
+		contents.append(0xCF + delay)
+	return contents
+
+def encode_jump(count):
+	contents = []
+	while (count > 80):
+		contents.append(0x7F + 80)
+		count -= 80
+	if (count > 0):
+		contents.append(0x7F + count)
+	return contents
+
+def encode_lines(lines):
+	contents = []
+	for line in lines:
+		line = line.replace('\n', '')
+		assert (len(line) <= MOVIE_WIDTH)
+		count = 0
+		for ch in line:
+			assert (ord(ch) < 0x80)
+			if (ch == ' '):
+				count += 1
+			else:
+				if (count == 1):
+					contents.append(ord(' '))
+				elif (count > 1):
+					contents.append(0x7F + count)
+				count = 0
+				contents.append(ord(ch))
+		contents.append(0xFD)
+	return contents
+
+# frame as a list of rows padded with spaces, for comparison
+def picture(lines):
+	rows = [line.replace('\n', '').ljust(MOVIE_WIDTH) for line in lines]
+	return rows + [' ' * MOVIE_WIDTH] * (MOVIE_HEIGHT - 1 - len(rows))
+
+def encode_delta(prev, curr):
+	contents = []
+	for r in range(len(curr)):
+		changed = [c for c in range(MOVIE_WIDTH) if prev[r][c] != curr[r][c]]
+		if (not changed):
+			continue
+		contents += [0xF1, r, changed[0]]
+		c = changed[0]
+		while (c <= changed[-1]):
+			if (prev[r][c] != curr[r][c]):
+				contents.append(ord(curr[r][c]))
+				c += 1
+			else:
+				count = 0
+				while (prev[r][c+count] == curr[r][c+count]):
 					count += 1
-				else:
-					if (count == 1):
-						contents.append(ord(' '))
-					elif (count > 1):
-						contents.append(0x7F + count)
-					count = 0
-					contents.append(ord(ch))
-			contents.append(0xFD)
-		while (delay > 32):
-			contents.append(0xCF + 32)
-			delay -= 32
-		if (delay > 0):
-			contents.append(0xCF + delay)
-		contents.append(0xFE)
+				contents += encode_jump(count)
+				c += count
+	return contents
+
+def write_v1(frames):
+	with open("starwar.dat", "wb") as outfile:
+		outfile.write(b"Star Wars Asciimation\n")
+		outfile.write(b"www.asciimation.co.nz presents\n")
+		outfile.write(b"Ported by zhy@swanspace.org\n")
+		contents = [0xFE, 0xF0, MOVIE_HEIGHT, MOVIE_WIDTH]
+		outfile.write(bytes(contents))
+		for frame in frames:
+			assert (len(frame) <= MOVIE_HEIGHT)
+			contents = encode_lines(frame[1:])
+			contents += encode_delay(int(frame[0]))
+			contents.append(0xFE)
+			outfile.write(bytes(contents))
+		contents = [0xFF]
 		outfile.write(bytes(contents))
-	contents = [0xFF]
-	outfile.write(bytes(contents))
-print("Done!", len(frames), "frames converted.")
+
+def write_v2(frames):
+	bodies = []
+	prev = None
+	key_count = 0
+	seek_bytes = 0  # bytes decoded to seek to every frame, from its key frame
+	chain_bytes = 0
+	for i, frame in enumerate(frames):
+		assert (len(frame) <= MOVIE_HEIGHT)
+		curr = picture(frame[1:])
+		body = [0xF2] + encode_lines(frame[1:])
+		if (i % KEY_INTERVAL != 0):
+			delta = encode_delta(prev, curr)
+			if (len(delta) < len(body)):
+				body = delta
+		if (body[0] == 0xF2):
+			key_count += 1
+			chain_bytes = 0
+		seek_bytes += chain_bytes
+		chain_bytes += len(body) + 1
+		body += encode_delay(int(frame[0]))
+		body.append(0xFE)
+		bodies.append(body)
+		prev = curr
+	with open("starwar_v2.dat", "wb") as outfile:
+		outfile.write(b"SWV2")
+		outfile.write(struct.pack("<I", len(bodies)))
+		outfile.write(bytes([MOVIE_HEIGHT, MOVIE_WIDTH, KEY_INTERVAL, 0]))
+		offset = 12 + 4 * len(bodies)
+		for body in bodies:
+			outfile.write(struct.pack("<I", offset))
+			offset += len(body)
+		for body in bodies:
+			outfile.write(bytes(body))
+		outfile.write(bytes([0xFF]))
+	size = offset + 1
+	print("Version 2:", size, "bytes,", key_count, "key frames,", len(bodies) - key_count, "delta frames,",
+		"{:.1f} bytes per frame, {:.1f} bytes decoded before each seek on average".format(size / len(bodies), seek_bytes / len(bodies)))
+
+if __name__ == "__main__":
+	import sys
+	version = int(sys.argv[1]) if (len(sys.argv) > 1) else 1
+	frames = read_frames()
+	if (version == 2):
+		write_v2(frames)
+	else:
+		write_v1(frames)
+	print("Done!", len(frames), "frames converted.")
@@ -2,7 +2,13 @@
 
 
 /**
- * Flash memory core, read only.
+ * Flash memory core, with command writing and buffered programming.
+ * A write with "prog" set goes into the program buffer, which holds one write buffer page of the flash,
+ * and takes one clock only. Contiguous words are collected, and the page is programmed by the "write to buffer" command
+ * when it is full, when another request comes or when no more word comes for a while and the flash is ready.
+ * The sector is erased first if "erase" is set with the first word of the page.
+ * Busy status of the flash is only checked before its next operation, so that the next page can be filled
+ * while the last one is being programmed.
  * Author: Zhao, Hongyu  <power_zhy@foxmail.com>
  */
 module flash_core_program (
@@ -10,9 +16,11 @@ module flash_core_program (
 	input wire rst,  // synchronous reset
 	input wire cs,  // chip select
 	input wire we,  // write enable
+	input wire prog,  // write data into program buffer instead of writing command, only valid with write enable
+	input wire erase,  // erase the sector before programming, sampled with the first word of the page
 	input wire [ADDR_BITS-1:1] addr,  // address
 	input wire burst,  // burst mode flag
-	input wire [15:0] din,  // command to write
+	input wire [15:0] din,  // command or data to write
 	output reg [15:0] dout,  // data read in
 	output reg busy,  // busy flag
 	output reg ack,  // acknowledge
@@ -32,40 +40,113 @@ module flash_core_program (
 	parameter
 		CLK_FREQ = 100,  // main clock frequency in MHz
 		ADDR_BITS = 24,  // address length for flash memory
-		ADDR_BURST = 4;  // address length in which burst can be used
+		ADDR_BURST = 4,  // address length in which burst can be used
+		PAGE_BITS = 5;  // address length of write buffer page in words, should not exceed the one of flash
 	localparam
 		DELAY_INIT = 300000,  // delay time to complete initialization after reset, in ns
 		DELAY_PRE_READ = 100,  // delay time to get the first data, in ns
 		DELAY_READ = 30,  // delay time to get latter data within block, in ns
 		DELAY_WRITE = 30,  // delay time to write one command, in ns
-		DELAY_DONE = 80;  // delay time to wait between two operations, in ns
+		DELAY_DONE = 80,  // delay time to wait between two operations, in ns
+		DELAY_BUSY = 100,  // delay time before ready signal is valid after writing, in ns
+		DELAY_FLUSH = 1000;  // delay time to program a partial page after the last word filled, in ns
 	localparam
 		COUNT_INIT = 1 + CLK_FREQ * DELAY_INIT / 1000,
 		COUNT_PRE_READ = 1 + CLK_FREQ * DELAY_PRE_READ / 1000,
 		COUNT_READ = 1 + CLK_FREQ * DELAY_READ / 1000,
 		COUNT_WRITE = 1 + CLK_FREQ * DELAY_WRITE / 1000,
 		COUNT_DONE = 1 + CLK_FREQ * DELAY_DONE / 1000,
+		COUNT_BUSY = 1 + CLK_FREQ * DELAY_BUSY / 1000,
+		COUNT_FLUSH = 1 + CLK_FREQ * DELAY_FLUSH / 1000,
 		COUNT_BITS = GET_WIDTH(COUNT_INIT-1);
 	
 	wire flash_burst;
 	assign flash_burst = cs && burst && (flash_addr[ADDR_BURST:1] != {ADDR_BURST{1'b1}});
 	
+	// flash is treated as busy for a while after each write, until its ready signal becomes valid
+	reg [COUNT_BITS-1:0] busy_count = 0;
+	wire flash_idle;
+	assign flash_idle = flash_ready && (busy_count == 0);
+	
+	// program buffer, words from pend_start to pend_end-1 are waiting to be programmed
+	reg [15:0] prog_buf [0:(1<<PAGE_BITS)-1];
+	reg pend = 0;
+	reg pend_erase = 0;
+	reg [ADDR_BITS-1:PAGE_BITS+1] pend_page = 0;
+	reg [PAGE_BITS-1:0] pend_start = 0;
+	reg [PAGE_BITS:0] pend_end = 0;
+	reg [COUNT_BITS-1:0] flush_count = 0;
+	wire fill, append, flush, flush_idle;
+	
+	assign
+		fill = cs && we && prog,
+		append = ~pend || (addr[ADDR_BITS-1:PAGE_BITS+1] == pend_page && {1'b0, addr[PAGE_BITS:1]} == pend_end),
+		flush = pend && (pend_end[PAGE_BITS] || (cs && ~(fill && append))),
+		flush_idle = pend && flush_count == COUNT_FLUSH-1;
+	
+	// command sequence of sector erase and write to buffer programming
+	localparam
+		Q_ERASE = 0,  // 6 cycles of sector erase
+		Q_PROG = 6,  // 4 cycles before data, the last one is word count
+		Q_DATA = 10,  // data words
+		Q_CONFIRM = 11;  // program buffer to flash
+	
+	reg [3:0] seq = 0;
+	reg [3:0] next_seq;
+	reg [PAGE_BITS-1:0] seq_offset = 0;
+	reg [PAGE_BITS-1:0] next_offset;
+	reg [ADDR_BITS-1:1] cmd_addr;
+	reg [15:0] cmd_data;
+	
+	always @(*) begin
+		cmd_addr = {pend_page, {PAGE_BITS{1'b0}}};  // sector address
+		cmd_data = 0;
+		case (next_seq)
+			Q_ERASE+0, Q_ERASE+3, Q_PROG+0: begin
+				cmd_addr = 'h555;
+				cmd_data = 16'hAA;
+			end
+			Q_ERASE+1, Q_ERASE+4, Q_PROG+1: begin
+				cmd_addr = 'h2AA;
+				cmd_data = 16'h55;
+			end
+			Q_ERASE+2: begin
+				cmd_addr = 'h555;
+				cmd_data = 16'h80;
+			end
+			Q_ERASE+5: cmd_data = 16'h30;
+			Q_PROG+2: cmd_data = 16'h25;
+			Q_PROG+3: cmd_data = pend_end - pend_start - 1'h1;
+			Q_DATA: begin
+				cmd_addr = {pend_page, next_offset};
+				cmd_data = prog_buf[next_offset];
+			end
+			Q_CONFIRM: cmd_data = 16'h29;
+		endcase
+	end
+	
 	localparam
 		S_INIT = 0,  // initialization
 		S_IDLE = 1,  // idle
 		S_PRE_READ = 2,  // wait for data
 		S_READ = 3,  // read data
 		S_WRITE = 4,  // write command
-		S_DONE = 5;  // acknowledge
+		S_DONE = 5,  // acknowledge
+		S_FILL = 6,  // write data into program buffer and acknowledge
+		S_SEQ = 7,  // write one cycle of command sequence
+		S_SEQ_GAP = 8,  // wait between two cycles of command sequence
+		S_SEQ_WAIT = 9;  // wait for sector erase to complete
 	
-	reg [2:0] state = 0;
-	reg [2:0] next_state;
+	reg [3:0] state = 0;
+	reg [3:0] next_state;
 	reg [COUNT_BITS-1:0] count = 0;
 	reg [COUNT_BITS-1:0] next_count;
 	
 	always @(*) begin
 		next_state = 0;
 		next_count = 0;
+		next_seq = seq;
+		next_offset = seq_offset;
 		case (state)
 			S_INIT: begin
 				if (count == COUNT_INIT-1) begin
@@ -84,7 +165,18 @@ module flash_core_program (
 				end
 			end
 			S_IDLE: begin
-				if (cs) begin
+				if (flush && ~flash_idle) begin
+					next_state = S_IDLE;
+				end
+				else if (flush || (flush_idle && ~fill && flash_idle)) begin
+					next_state = S_SEQ;
+					next_seq = pend_erase ? Q_ERASE : Q_PROG;
+					next_offset = pend_start;
+				end
+				else if (fill) begin
+					next_state = S_FILL;  // words coming while flash is busy are collected
+				end
+				else if (cs && flash_idle) begin
 					if (we)
 						next_state = S_WRITE;
 					else
@@ -129,7 +221,7 @@ module flash_core_program (
 			end
 			S_DONE: begin
 				if (count == COUNT_DONE-1) begin
-					if (flash_ready) begin
+					if (flash_idle) begin
 						next_state = S_IDLE;
 						next_count = 0;
 					end
@@ -143,6 +235,49 @@ module flash_core_program (
 					next_count = count + 1'h1;
 				end
 			end
+			S_FILL: begin
+				next_state = S_IDLE;
+			end
+			S_SEQ: begin
+				if (count == COUNT_WRITE-1) begin
+					next_state = S_SEQ_GAP;
+					next_count = 0;
+				end
+				else begin
+					next_state = S_SEQ;
+					next_count = count + 1'h1;
+				end
+			end
+			S_SEQ_GAP: begin
+				if (count == COUNT_DONE-1) begin
+					next_count = 0;
+					if (seq == Q_CONFIRM) begin
+						next_state = S_IDLE;  // no waiting for the programming here
+					end
+					else if (seq == Q_ERASE+5) begin
+						next_state = S_SEQ_WAIT;
+						next_seq = Q_PROG;
+					end
+					else if (seq == Q_DATA && {1'b0, seq_offset} + 1'h1 != pend_end) begin
+						next_state = S_SEQ;
+						next_offset = seq_offset + 1'h1;
+					end
+					else begin
+						next_state = S_SEQ;
+						next_seq = seq + 1'h1;
+					end
+				end
+				else begin
+					next_state = S_SEQ_GAP;
+					next_count = count + 1'h1;
+				end
+			end
+			S_SEQ_WAIT: begin
+				if (flash_idle)
+					next_state = S_SEQ;
+				else
+					next_state = S_SEQ_WAIT;
+			end
 		endcase
 	end
 	
@@ -150,10 +285,57 @@ module flash_core_program (
 		if (rst) begin
 			state <= 0;
 			count <= 0;
+			seq <= 0;
+			seq_offset <= 0;
 		end
 		else begin
 			state <= next_state;
 			count <= next_count;
+			seq <= next_seq;
+			seq_offset <= next_offset;
+		end
+	end
+	
+	always @(posedge clk) begin
+		if (rst)
+			busy_count <= 0;
+		else if ((state == S_WRITE || state == S_SEQ) && count == COUNT_WRITE-1)
+			busy_count <= COUNT_BUSY;
+		else if (busy_count != 0)
+			busy_count <= busy_count - 1'h1;
+	end
+	
+	always @(posedge clk) begin
+		if (next_state == S_FILL)
+			prog_buf[addr[PAGE_BITS:1]] <= din;
+	end
+	
+	always @(posedge clk) begin
+		if (rst) begin
+			pend <= 0;
+			pend_erase <= 0;
+			pend_page <= 0;
+			pend_start <= 0;
+			pend_end <= 0;
+			flush_count <= 0;
+		end
+		else begin
+			if (next_state == S_FILL) begin
+				pend <= 1;
+				pend_end <= {1'b0, addr[PAGE_BITS:1]} + 1'h1;
+				if (~pend) begin
+					pend_erase <= erase;
+					pend_page <= addr[ADDR_BITS-1:PAGE_BITS+1];
+					pend_start <= addr[PAGE_BITS:1];
+				end
+			end
+			else if (state == S_SEQ_GAP && next_state == S_IDLE) begin
+				pend <= 0;
+			end
+			if (state != S_IDLE || ~pend || cs)
+				flush_count <= 0;
+			else if (flush_count != COUNT_FLUSH-1)
+				flush_count <= flush_count + 1'h1;
 		end
 	end
 	
@@ -193,8 +375,16 @@ module flash_core_program (
 				flash_addr <= addr;
 				flash_dout <= din;
 			end
-			S_DONE: begin
+			S_DONE, S_FILL, S_SEQ_GAP, S_SEQ_WAIT: begin
+				busy <= 1;
+			end
+			S_SEQ: begin
 				busy <= 1;
+				flash_ce_n <= 0;
+				flash_oe_n <= 1;
+				flash_we_n <= 0;
+				flash_addr <= cmd_addr;
+				flash_dout <= cmd_data;
 			end
 		endcase
 	end
@@ -209,6 +399,9 @@ module flash_core_program (
 			S_DONE: if (state == S_WRITE) begin
 				ack <= 1;
 			end
+			S_FILL: begin
+				ack <= 1;
+			end
 		endcase
 	end
 	
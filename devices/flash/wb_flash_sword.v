@@ -2,7 +2,13 @@
 
 
 /**
- * Flash memory device with wishbone connection interfaces, including read buffers (read only).
+ * Flash memory device with wishbone connection interfaces, including read and write buffers.
+ * Writes are programmed through the program buffers of both chips, bytes not selected are written as 0xFF to keep
+ * their old values. Writes are dropped unless programming is enabled in the control register, so that stray stores
+ * never change the flash, and with erasing also enabled, a write to the first word of a sector erases the whole sector
+ * first, so that an image can be updated by writing it sequentially from the start of a sector.
+ * Control registers (word address, in I/O space):
+ *   0: bit 0 enables programming, bit 1 enables erasing, bit 31 for busy (read only)
  * Author: Zhao, Hongyu  <power_zhy@foxmail.com>
  */
 module wb_flash_sword (
@@ -30,35 +36,91 @@ module wb_flash_sword (
 	input wire wbs_we_i,
 	input wire [31:0] wbs_data_i,
 	output wire [31:0] wbs_data_o,
-	output wire wbs_ack_o
+	output wire wbs_ack_o,
+	// control interfaces in I/O space
+	input wire ctrl_cs_i,
+	input wire [DEV_ADDR_BITS-1:2] ctrl_addr_i,
+	input wire [3:0] ctrl_sel_i,
+	input wire [31:0] ctrl_data_i,
+	input wire ctrl_we_i,
+	output reg [31:0] ctrl_data_o,
+	output reg ctrl_ack_o
 	);
 	
 	parameter
 		CLK_FREQ = 100;  // main clock frequency in MHz
+	parameter
+		DEV_ADDR_BITS = 8;  // address length of I/O space
 	parameter
 		ADDR_BITS = 25,  // address length for Parallel PCM
 		HIGH_ADDR = 7'h7F,  // high address value, as the address length of wishbone is larger than device
 		ADDR_BURST = 4,  // address length in which burst can be used
-		BUF_ADDR_BITS = 4;  // address length for buffer
+		BUF_ADDR_BITS = 4,  // address length for buffer
+		PAGE_BITS = 5,  // address length of write buffer page of each chip in words
+		SECTOR_BITS = 18;  // address length of one sector of both chips, 128KB for each chip
 	
-	wire cs;
+	wire cs, we;
 	wire [ADDR_BITS-1:2] addr;
+	wire [3:0] sel;
 	wire burst;
+	wire [31:0] din, din_masked;
 	wire [31:0] dout;
 	wire adapter_busy, core_busy;
 	wire ack;
 	
+	// control registers, written in wishbone clock and used in main clock
+	reg prog_en = 0, erase_en = 0;
+	reg prog_en_mem = 0, erase_en_mem = 0;
+	
+	always @(posedge clk) begin
+		if (rst) begin
+			prog_en_mem <= 0;
+			erase_en_mem <= 0;
+		end
+		else begin
+			prog_en_mem <= prog_en;
+			erase_en_mem <= erase_en;
+		end
+	end
+	
+	always @(posedge wbs_clk_i) begin
+		ctrl_data_o <= 0;
+		ctrl_ack_o <= 0;
+		if (rst) begin
+			prog_en <= 0;
+			erase_en <= 0;
+		end
+		else if (ctrl_cs_i & ~ctrl_ack_o) begin
+			case (ctrl_addr_i)
+				0: begin
+					ctrl_data_o <= {flash_busy, 29'b0, erase_en, prog_en};
+					if (ctrl_we_i) begin  // ctrl_sel_i are ignored
+						prog_en <= ctrl_data_i[0];
+						erase_en <= ctrl_data_i[1];
+					end
+				end
+				default: ctrl_data_o <= 0;
+			endcase
+			ctrl_ack_o <= 1;
+		end
+	end
+	
 	// core
-	flash_core #(
+	flash_core_program #(
 		.CLK_FREQ(CLK_FREQ),
 		.ADDR_BITS(ADDR_BITS-1),
-		.ADDR_BURST(ADDR_BURST)
+		.ADDR_BURST(ADDR_BURST),
+		.PAGE_BITS(PAGE_BITS)
 		) FLASH_CORE0 (
 		.clk(clk),
 		.rst(rst),
 		.cs(cs),
+		.we(we & prog_en_mem),
+		.prog(1'b1),
+		.erase(erase_en_mem && addr[SECTOR_BITS-1:2] == 0),
 		.addr(addr),
 		.burst(burst),
+		.din(din_masked[15:0]),
 		.dout(dout[15:0]),
 		.busy(core_busy),
 		.ack(ack),
@@ -73,16 +135,21 @@ module wb_flash_sword (
 		.flash_dout(flash_dout[15:0])
 		);
 	
-	flash_core #(
+	flash_core_program #(
 		.CLK_FREQ(CLK_FREQ),
 		.ADDR_BITS(ADDR_BITS-1),
-		.ADDR_BURST(ADDR_BURST)
+		.ADDR_BURST(ADDR_BURST),
+		.PAGE_BITS(PAGE_BITS)
 		) FLASH_CORE1 (
 		.clk(clk),
 		.rst(rst),
 		.cs(cs),
+		.we(we & prog_en_mem),
+		.prog(1'b1),
+		.erase(erase_en_mem && addr[SECTOR_BITS-1:2] == 0),
 		.addr(addr),
 		.burst(burst),
+		.din(din_masked[31:16]),
 		.dout(dout[31:16]),
 		.busy(),
 		.ack(),
@@ -113,23 +180,30 @@ module wb_flash_sword (
 		.wbs_addr_i(wbs_addr_i),
 		.wbs_cti_i(wbs_cti_i),
 		.wbs_bte_i(wbs_bte_i),
-		.wbs_sel_i(4'b1111),
-		.wbs_we_i(1'b0),
-		.wbs_data_i(32'b0),
+		.wbs_sel_i(wbs_sel_i),
+		.wbs_we_i(wbs_we_i),
+		.wbs_data_i(wbs_data_i),
 		.wbs_data_o(wbs_data_o),
 		.wbs_ack_o(wbs_ack_o),
 		.mem_clk(clk),
 		.mem_cs(cs),
-		.mem_we(),
+		.mem_we(we),
 		.mem_addr(addr),
-		.mem_sel(),
+		.mem_sel(sel),
 		.mem_burst(burst),
-		.mem_din(),
+		.mem_din(din),
 		.mem_dout(dout),
 		.mem_busy(core_busy),
 		.mem_ack(ack)
 		);
 	
+	// programming a bit to 1 leaves it unchanged
+	assign
+		din_masked[31:24] = sel[3] ? din[31:24] : 8'hFF,
+		din_masked[23:16] = sel[2] ? din[23:16] : 8'hFF,
+		din_masked[15:8] = sel[1] ? din[15:8] : 8'hFF,
+		din_masked[7:0] = sel[0] ? din[7:0] : 8'hFF;
+	
 	assign
 		flash_busy = adapter_busy | core_busy;
 	
@@ -2,15 +2,24 @@
 
 
 /**
- * Parallel PCM core, read only.
+ * Parallel PCM core, with buffered programming.
+ * A write goes into the program buffer, which holds one buffer page of PCM, and takes one clock only.
+ * Contiguous words are collected, and the page is programmed by the "buffered program" command when it is full,
+ * when another request comes or when no more word comes for a while.
+ * The block is unlocked before programming, and erased first if "erase" is set with the first word of the page.
+ * PCM stays in status mode after programming, its status is only polled before its next operation,
+ * so that the next page can be filled while the last one is being programmed.
  * Author: Zhao, Hongyu  <power_zhy@foxmail.com>
  */
 module ppcm_core_nexys3 (
 	input wire clk,  // main clock
 	input wire rst,  // synchronous reset
 	input wire cs,  // chip select
+	input wire we,  // write enable
+	input wire erase,  // erase the block before programming, sampled with the first word of the page
 	input wire [ADDR_BITS-1:2] addr,  // address
 	input wire burst,  // burst mode flag
+	input wire [31:0] din,  // data to write
 	output reg [31:0] dout,  // data read in
 	output reg busy,  // busy flag
 	output reg ack,  // acknowledge
@@ -27,37 +36,140 @@ module ppcm_core_nexys3 (
 	`include "function.vh"
 	parameter
 		CLK_FREQ = 100,  // main clock frequency in MHz
-		ADDR_BITS = 24;  // address length for Parallel PCM
+		ADDR_BITS = 24,  // address length for Parallel PCM
+		PAGE_BITS = 5;  // address length of buffer page in 16-bit words, should not exceed the one of PCM
 	localparam
 		DELAY_INIT = 100000,  // delay time to complete initialization after reset, in ns
 		DELAY_START = 115,  // delay time to get the first data, in ns
-		DELAY_DATA = 25;  // delay time to get latter data within block, in ns
+		DELAY_DATA = 25,  // delay time to get latter data within block, in ns
+		DELAY_WRITE = 70,  // delay time to write one command, in ns
+		DELAY_GAP = 30,  // delay time to wait between two commands or status reads, in ns
+		DELAY_FLUSH = 1000;  // delay time to program a partial page after the last word filled, in ns
 	localparam
 		COUNT_INIT = 1 + CLK_FREQ * DELAY_INIT / 1000,
 		COUNT_START = 1 + CLK_FREQ * DELAY_START / 1000,
 		COUNT_DATA = 1 + CLK_FREQ * DELAY_DATA / 1000,
+		COUNT_WRITE = 1 + CLK_FREQ * DELAY_WRITE / 1000,
+		COUNT_GAP = 1 + CLK_FREQ * DELAY_GAP / 1000,
+		COUNT_FLUSH = 1 + CLK_FREQ * DELAY_FLUSH / 1000,
 		COUNT_BITS = GET_WIDTH(COUNT_INIT-1);
 	
 	always @(posedge clk) begin
 		pcm_rst_n <= ~rst;
 	end
 	
+	// program buffer in 32-bit words, words from pend_start to pend_end-1 are waiting to be programmed
+	reg [31:0] prog_buf [0:(1<<(PAGE_BITS-1))-1];
+	reg pend = 0;
+	reg pend_erase = 0;
+	reg [ADDR_BITS-1:PAGE_BITS+1] pend_page = 0;
+	reg [PAGE_BITS-2:0] pend_start = 0;
+	reg [PAGE_BITS-1:0] pend_end = 0;
+	reg [COUNT_BITS-1:0] flush_count = 0;
+	reg status_mode = 0;  // status register instead of memory array is read out, PCM may be still busy
+	reg status_ready = 0;  // bit 7 of status register polled
+	wire append, flush, flush_idle;
+	
+	assign
+		append = ~pend || (addr[ADDR_BITS-1:PAGE_BITS+1] == pend_page && {1'b0, addr[PAGE_BITS:2]} == pend_end),
+		flush = pend && (pend_end[PAGE_BITS-1] || (cs && ~(we && append))),
+		flush_idle = pend && flush_count == COUNT_FLUSH-1;
+	
+	// command sequence of programming, where steps of polling read status register until PCM is ready
+	localparam
+		Q_POLL = 0,  // wait for the last operation to complete
+		Q_ARRAY = 1,  // back to read array mode, the end of sequence if nothing to program
+		Q_CLEAR = 2,  // clear status register
+		Q_UNLOCK = 3,  // 2 cycles of block unlock
+		Q_ERASE = 5,  // 2 cycles of block erase, and then polling
+		Q_PROG = 8,  // buffered program, and then polling for buffer available
+		Q_COUNT = 10,  // word count
+		Q_DATA = 11,  // data words
+		Q_CONFIRM = 12;  // program buffer to PCM
+	
+	reg [3:0] seq = 0;
+	reg [3:0] next_seq;
+	reg [PAGE_BITS-1:0] seq_offset = 0;
+	reg [PAGE_BITS-1:0] next_offset;
+	reg [ADDR_BITS-1:1] cmd_addr;
+	reg [15:0] cmd_data;
+	
+	always @(*) begin
+		cmd_addr = {pend_page, {PAGE_BITS{1'b0}}};  // block address
+		cmd_data = 0;
+		case (next_seq)
+			Q_ARRAY: cmd_data = 16'hFF;
+			Q_CLEAR: cmd_data = 16'h50;
+			Q_UNLOCK+0: cmd_data = 16'h60;
+			Q_UNLOCK+1, Q_ERASE+1, Q_CONFIRM: cmd_data = 16'hD0;
+			Q_ERASE+0: cmd_data = 16'h20;
+			Q_PROG+0: cmd_data = 16'hE8;
+			Q_COUNT: cmd_data = {pend_end, 1'b0} - {pend_start, 1'b0} - 1'h1;
+			Q_DATA: begin
+				cmd_addr = {pend_page, next_offset};
+				cmd_data = next_offset[0] ? prog_buf[next_offset[PAGE_BITS-1:1]][31:16] : prog_buf[next_offset[PAGE_BITS-1:1]][15:0];
+			end
+		endcase
+	end
+	
+	// the step after the current one
+	reg seq_last, seq_poll;
+	reg [3:0] seq_after;
+	reg [PAGE_BITS-1:0] offset_after;
+	
+	always @(*) begin
+		seq_last = 0;
+		seq_after = seq + 1'h1;
+		offset_after = seq_offset;
+		case (seq)
+			Q_ARRAY: begin
+				seq_last = ~pend;
+			end
+			Q_UNLOCK+1: begin
+				seq_after = pend_erase ? Q_ERASE : Q_PROG;
+			end
+			Q_COUNT: begin
+				offset_after = {pend_start, 1'b0};
+			end
+			Q_DATA: begin
+				if ({1'b0, seq_offset} + 1'h1 != {pend_end, 1'b0}) begin
+					seq_after = Q_DATA;
+					offset_after = seq_offset + 1'h1;
+				end
+			end
+			Q_CONFIRM: begin
+				seq_last = 1;
+			end
+		endcase
+		seq_poll = (seq_after == Q_POLL) || (seq_after == Q_ERASE+2) || (seq_after == Q_PROG+1);
+	end
+	
 	localparam
 		S_INIT = 0,  // wait for the initialization of PPCM
 		S_IDLE = 1,  // idle
 		S_WAIT = 2,  // wait for data
 		S_OP1 = 3,  // read low 16-bits data
 		S_OP2 = 4,  // read high 16-bits data
-		S_DONE = 5;  // acknowledge
+		S_DONE = 5,  // acknowledge
+		S_FILL = 6,  // write data into program buffer and acknowledge
+		S_SEQ = 7,  // write one cycle of command sequence
+		S_SEQ_GAP = 8,  // wait between two cycles of command sequence
+		S_POLL = 9;  // read status register, and wait before the next read
 	
-	reg [2:0] state = 0;
-	reg [2:0] next_state;
+	reg [3:0] state = 0;
+	reg [3:0] next_state;
 	reg [COUNT_BITS-1:0] count = 0;
 	reg [COUNT_BITS-1:0] next_count;
+	wire step_done;
+	
+	assign
+		step_done = (state == S_SEQ_GAP && count == COUNT_GAP-1) || (state == S_POLL && count == COUNT_START+COUNT_GAP-1 && status_ready);
 	
 	always @(*) begin
 		next_state = 0;
 		next_count = 0;
+		next_seq = seq;
+		next_offset = seq_offset;
 		case (state)
 			S_INIT: begin
 				if (count == COUNT_INIT-1) begin
@@ -70,7 +182,24 @@ module ppcm_core_nexys3 (
 				end
 			end
 			S_IDLE: begin
-				if (cs) begin
+				if (flush || (flush_idle && ~(cs && we))) begin
+					if (status_mode) begin
+						next_state = S_POLL;
+						next_seq = Q_POLL;
+					end
+					else begin
+						next_state = S_SEQ;
+						next_seq = Q_CLEAR;
+					end
+				end
+				else if (cs && we) begin
+					next_state = S_FILL;
+				end
+				else if (cs && status_mode) begin
+					next_state = S_POLL;
+					next_seq = Q_POLL;
+				end
+				else if (cs) begin
 					next_state = S_WAIT;
 				end
 				else begin
@@ -113,6 +242,40 @@ module ppcm_core_nexys3 (
 			S_DONE: begin
 				next_state = S_IDLE;
 			end
+			S_FILL: begin
+				next_state = S_IDLE;
+			end
+			S_SEQ: begin
+				if (count == COUNT_WRITE-1) begin
+					next_state = S_SEQ_GAP;
+					next_count = 0;
+				end
+				else begin
+					next_state = S_SEQ;
+					next_count = count + 1'h1;
+				end
+			end
+			S_SEQ_GAP, S_POLL: begin
+				if (step_done) begin
+					next_count = 0;
+					next_seq = seq_after;
+					next_offset = offset_after;
+					if (seq_last)
+						next_state = S_IDLE;
+					else if (seq_poll)
+						next_state = S_POLL;
+					else
+						next_state = S_SEQ;
+				end
+				else if (state == S_POLL && count == COUNT_START+COUNT_GAP-1) begin
+					next_state = S_POLL;
+					next_count = 0;
+				end
+				else begin
+					next_state = state;
+					next_count = count + 1'h1;
+				end
+			end
 		endcase
 	end
 	
@@ -120,10 +283,57 @@ module ppcm_core_nexys3 (
 		if (rst) begin
 			state <= 0;
 			count <= 0;
+			seq <= 0;
+			seq_offset <= 0;
 		end
 		else begin
 			state <= next_state;
 			count <= next_count;
+			seq <= next_seq;
+			seq_offset <= next_offset;
+		end
+	end
+	
+	always @(posedge clk) begin
+		if (next_state == S_FILL)
+			prog_buf[addr[PAGE_BITS:2]] <= din;
+	end
+	
+	always @(posedge clk) begin
+		if (rst) begin
+			pend <= 0;
+			pend_erase <= 0;
+			pend_page <= 0;
+			pend_start <= 0;
+			pend_end <= 0;
+			flush_count <= 0;
+			status_mode <= 0;
+			status_ready <= 0;
+		end
+		else begin
+			if (next_state == S_FILL) begin
+				pend <= 1;
+				pend_end <= {1'b0, addr[PAGE_BITS:2]} + 1'h1;
+				if (~pend) begin
+					pend_erase <= erase;
+					pend_page <= addr[ADDR_BITS-1:PAGE_BITS+1];
+					pend_start <= addr[PAGE_BITS:2];
+				end
+			end
+			if (step_done && seq == Q_ARRAY)
+				status_mode <= 0;
+			if (step_done && seq == Q_CONFIRM) begin
+				pend <= 0;
+				status_mode <= 1;
+			end
+			if (state == S_POLL && count == COUNT_START-1)
+				status_ready <= pcm_din[7];
+			else if (state != S_POLL)
+				status_ready <= 0;
+			if (state != S_IDLE || ~pend || cs)
+				flush_count <= 0;
+			else if (flush_count != COUNT_FLUSH-1)
+				flush_count <= flush_count + 1'h1;
 		end
 	end
 	
@@ -153,12 +363,33 @@ module ppcm_core_nexys3 (
 				else
 					pcm_addr <= pcm_addr;
 			end
+			S_FILL, S_SEQ_GAP: begin
+				busy <= 1;
+			end
+			S_SEQ: begin
+				busy <= 1;
+				pcm_ce_n <= 0;
+				pcm_we_n <= 0;
+				pcm_addr <= cmd_addr;
+				pcm_dout <= cmd_data;
+			end
+			S_POLL: begin
+				busy <= 1;
+				if (next_count < COUNT_START) begin
+					pcm_ce_n <= 0;
+					pcm_oe_n <= 0;
+					pcm_addr <= cmd_addr;
+				end
+			end
 		endcase
 	end
 	
 	always @(posedge clk) begin
 		ack <= 0;
 		if (~rst) case (state)
+			S_IDLE: if (next_state == S_FILL) begin
+				ack <= 1;
+			end
 			S_OP1: if (count == COUNT_DATA-1) begin
 				dout <= {16'b0, pcm_din};
 			end
@@ -0,0 +1,221 @@
+`include "define.vh"
+
+
+/**
+ * PS2 keyboard decoder, converts scan codes of set 2 into key events with virtual-key codes.
+ * Prefixes (E0, F0) are tracked here, PAUSE key (E1 sequence) is skipped, and repeated events are filtered.
+ * Author: Zhao, Hongyu  <power_zhy@foxmail.com>
+ */
+module ps2_decoder (
+	input wire clk,  // main clock
+	input wire rst,  // synchronous reset
+	input wire drop_repeat,  // drop all typematic repeats, otherwise only repeats of modifier keys are dropped
+	input wire [15:0] time_ms,  // current time in ms, used as timestamp of events
+	input wire rx_ack,  // scan code received
+	input wire [7:0] rx_data,  // scan code
+	output reg event_ack,  // one key event decoded
+	output reg [31:0] event_data  // {timestamp, 2'b0, win, alt, ctrl, shift, repeat, key_up, key_code}
+	);
+	
+	parameter
+		MIN_REPEAT_TIME = 50;  // in ms, the same event of the same key within this time is treated as jitter and dropped
+	
+	localparam
+		VK_NONE = 8'hFF,
+		VK_LSHIFT = 8'hA0,
+		VK_RSHIFT = 8'hA1,
+		VK_LCONTROL = 8'hA2,
+		VK_RCONTROL = 8'hA3,
+		VK_LMENU = 8'hA4,
+		VK_RMENU = 8'hA5,
+		VK_LWIN = 8'h5B,
+		VK_RWIN = 8'h5C;
+	
+	reg extended, key_up;
+	reg [2:0] skip_count;
+	reg [255:0] key_down;  // keys being pressed, indexed by virtual-key codes
+	reg [7:0] last_code;
+	reg last_up;
+	reg [15:0] last_time;
+	
+	// virtual-key codes, see "demo/2048/keyboard.h"
+	reg [7:0] key_code;
+	always @(*) begin
+		key_code = VK_NONE;
+		case ({extended, rx_data})
+			9'h001: key_code = 8'h78;  // F9
+			9'h003: key_code = 8'h74;  // F5
+			9'h004: key_code = 8'h72;  // F3
+			9'h005: key_code = 8'h70;  // F1
+			9'h006: key_code = 8'h71;  // F2
+			9'h007: key_code = 8'h7B;  // F12
+			9'h009: key_code = 8'h79;  // F10
+			9'h00A: key_code = 8'h77;  // F8
+			9'h00B: key_code = 8'h75;  // F6
+			9'h00C: key_code = 8'h73;  // F4
+			9'h00D: key_code = 8'h09;  // TAB
+			9'h00E: key_code = 8'hC0;  // OEM_3
+			9'h011: key_code = 8'hA4;  // LMENU
+			9'h012: key_code = 8'hA0;  // LSHIFT
+			9'h014: key_code = 8'hA2;  // LCONTROL
+			9'h015: key_code = 8'h51;  // Q
+			9'h016: key_code = 8'h31;  // 1
+			9'h01A: key_code = 8'h5A;  // Z
+			9'h01B: key_code = 8'h53;  // S
+			9'h01C: key_code = 8'h41;  // A
+			9'h01D: key_code = 8'h57;  // W
+			9'h01E: key_code = 8'h32;  // 2
+			9'h021: key_code = 8'h43;  // C
+			9'h022: key_code = 8'h58;  // X
+			9'h023: key_code = 8'h44;  // D
+			9'h024: key_code = 8'h45;  // E
+			9'h025: key_code = 8'h34;  // 4
+			9'h026: key_code = 8'h33;  // 3
+			9'h029: key_code = 8'h20;  // SPACE
+			9'h02A: key_code = 8'h56;  // V
+			9'h02B: key_code = 8'h46;  // F
+			9'h02C: key_code = 8'h54;  // T
+			9'h02D: key_code = 8'h52;  // R
+			9'h02E: key_code = 8'h35;  // 5
+			9'h031: key_code = 8'h4E;  // N
+			9'h032: key_code = 8'h42;  // B
+			9'h033: key_code = 8'h48;  // H
+			9'h034: key_code = 8'h47;  // G
+			9'h035: key_code = 8'h59;  // Y
+			9'h036: key_code = 8'h36;  // 6
+			9'h03A: key_code = 8'h4D;  // M
+			9'h03B: key_code = 8'h4A;  // J
+			9'h03C: key_code = 8'h55;  // U
+			9'h03D: key_code = 8'h37;  // 7
+			9'h03E: key_code = 8'h38;  // 8
+			9'h041: key_code = 8'hBC;  // OEM_COMMA
+			9'h042: key_code = 8'h4B;  // K
+			9'h043: key_code = 8'h49;  // I
+			9'h044: key_code = 8'h4F;  // O
+			9'h045: key_code = 8'h30;  // 0
+			9'h046: key_code = 8'h39;  // 9
+			9'h049: key_code = 8'hBE;  // OEM_PERIOD
+			9'h04A: key_code = 8'hBF;  // OEM_2
+			9'h04B: key_code = 8'h4C;  // L
+			9'h04C: key_code = 8'hBA;  // OEM_1
+			9'h04D: key_code = 8'h50;  // P
+			9'h04E: key_code = 8'hBD;  // OEM_MINUS
+			9'h052: key_code = 8'hDE;  // OEM_7
+			9'h054: key_code = 8'hDB;  // OEM_4
+			9'h055: key_code = 8'hBB;  // OEM_PLUS
+			9'h058: key_code = 8'h14;  // CAPITAL
+			9'h059: key_code = 8'hA1;  // RSHIFT
+			9'h05A: key_code = 8'h0D;  // RETURN
+			9'h05B: key_code = 8'hDD;  // OEM_6
+			9'h05D: key_code = 8'hDC;  // OEM_5
+			9'h066: key_code = 8'h08;  // BACK
+			9'h069: key_code = 8'h61;  // NUMPAD1
+			9'h06B: key_code = 8'h64;  // NUMPAD4
+			9'h06C: key_code = 8'h67;  // NUMPAD7
+			9'h070: key_code = 8'h60;  // NUMPAD0
+			9'h071: key_code = 8'h6E;  // DECIMAL
+			9'h072: key_code = 8'h62;  // NUMPAD2
+			9'h073: key_code = 8'h65;  // NUMPAD5
+			9'h074: key_code = 8'h66;  // NUMPAD6
+			9'h075: key_code = 8'h68;  // NUMPAD8
+			9'h076: key_code = 8'h1B;  // ESCAPE
+			9'h077: key_code = 8'h90;  // NUMLOCK
+			9'h078: key_code = 8'h7A;  // F11
+			9'h079: key_code = 8'h6B;  // ADD
+			9'h07A: key_code = 8'h63;  // NUMPAD3
+			9'h07B: key_code = 8'h6D;  // SUBTRACT
+			9'h07C: key_code = 8'h6A;  // MULTIPLY
+			9'h07D: key_code = 8'h69;  // NUMPAD9
+			9'h083: key_code = 8'h76;  // F7
+			9'h110: key_code = 8'hAA;  // BROWSER_SEARCH
+			9'h111: key_code = 8'hA5;  // RMENU
+			9'h114: key_code = 8'hA3;  // RCONTROL
+			9'h115: key_code = 8'hB1;  // MEDIA_PREV_TRACK
+			9'h118: key_code = 8'hAB;  // BROWSER_FAVORITES
+			9'h11F: key_code = 8'h5B;  // LWIN
+			9'h120: key_code = 8'hA8;  // BROWSER_REFRESH
+			9'h121: key_code = 8'hAE;  // VOLUME_DOWN
+			9'h123: key_code = 8'hAD;  // VOLUME_MUTE
+			9'h127: key_code = 8'h5C;  // RWIN
+			9'h128: key_code = 8'hA9;  // BROWSER_STOP
+			9'h12F: key_code = 8'h5D;  // APPS
+			9'h130: key_code = 8'hA7;  // BROWSER_FORWARD
+			9'h132: key_code = 8'hAF;  // VOLUME_UP
+			9'h134: key_code = 8'hB3;  // MEDIA_PLAY_PAUSE
+			9'h138: key_code = 8'hA6;  // BROWSER_BACK
+			9'h13A: key_code = 8'hAC;  // BROWSER_HOME
+			9'h13B: key_code = 8'hB2;  // MEDIA_STOP
+			9'h148: key_code = 8'hB4;  // LAUNCH_MAIL
+			9'h14A: key_code = 8'h6F;  // DIVIDE
+			9'h14D: key_code = 8'hB0;  // MEDIA_NEXT_TRACK
+			9'h150: key_code = 8'hB5;  // LAUNCH_MEDIA_SELECT
+			9'h15A: key_code = 8'h0D;  // RETURN
+			9'h169: key_code = 8'h23;  // END
+			9'h16B: key_code = 8'h25;  // LEFT
+			9'h16C: key_code = 8'h24;  // HOME
+			9'h170: key_code = 8'h2D;  // INSERT
+			9'h171: key_code = 8'h2E;  // DELETE
+			9'h172: key_code = 8'h28;  // DOWN
+			9'h174: key_code = 8'h27;  // RIGHT
+			9'h175: key_code = 8'h26;  // UP
+			9'h17A: key_code = 8'h22;  // NEXT
+			9'h17D: key_code = 8'h21;  // PRIOR
+		endcase
+	end
+	
+	wire shift_down, ctrl_down, alt_down, win_down;
+	wire [15:0] elapsed;
+	wire modifier, repeated, jitter;
+	
+	assign
+		shift_down = key_down[VK_LSHIFT] | key_down[VK_RSHIFT],
+		ctrl_down = key_down[VK_LCONTROL] | key_down[VK_RCONTROL],
+		alt_down = key_down[VK_LMENU] | key_down[VK_RMENU],
+		win_down = key_down[VK_LWIN] | key_down[VK_RWIN],
+		elapsed = time_ms - last_time,
+		modifier = (key_code >= VK_LSHIFT && key_code <= VK_RMENU) || key_code == VK_LWIN || key_code == VK_RWIN,
+		repeated = (key_down[key_code] == ~key_up),
+		jitter = (key_code == last_code) && (key_up == last_up) && (elapsed < MIN_REPEAT_TIME);
+	
+	always @(posedge clk) begin
+		event_ack <= 0;
+		if (rst) begin
+			extended <= 0;
+			key_up <= 0;
+			skip_count <= 0;
+			key_down <= 0;
+			last_code <= VK_NONE;
+			last_up <= 0;
+			last_time <= 0;
+			event_data <= 0;
+		end
+		else if (rx_ack) begin
+			if (skip_count != 0) begin
+				skip_count <= skip_count - 1'h1;
+			end
+			else if (rx_data == 8'hE1) begin
+				skip_count <= 7;
+			end
+			else if (rx_data == 8'hE0) begin
+				extended <= 1;
+			end
+			else if (rx_data == 8'hF0) begin
+				key_up <= 1;
+			end
+			else begin
+				// scan codes not in table (including responses to host commands) are dropped with their prefixes
+				extended <= 0;
+				key_up <= 0;
+				if (key_code != VK_NONE && ~jitter && ~(repeated && (drop_repeat || modifier || key_up))) begin
+					event_ack <= 1;
+					event_data <= {time_ms, 2'b0, win_down, alt_down, ctrl_down, shift_down, repeated, key_up, key_code};
+					key_down[key_code] <= ~key_up;
+					last_code <= key_code;
+					last_up <= key_up;
+					last_time <= time_ms;
+				end
+			end
+		end
+	end
+	
+endmodule
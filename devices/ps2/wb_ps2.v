@@ -3,6 +3,8 @@
 
 /**
  * PS2 host with wishbone connection interfaces, including read/write buffers.
+ * In decode mode, scan codes are converted into key events by ps2_decoder and queued in a FIFO, and the interrupt is
+ * raised when enough events are queued or the oldest one has waited for a while, instead of once per scan code.
  * Author: Zhao, Hongyu  <power_zhy@foxmail.com>
  */
 module wb_ps2 (
@@ -24,13 +26,31 @@ module wb_ps2 (
 	output reg interrupt
 	);
 	
+	`include "function.vh"
 	parameter
 		CLK_FREQ = 100;  // main clock frequency in MHz, should be multiple of 10M
 	parameter
 		DEV_ADDR_BITS = 8;  // address length of I/O space
+	parameter
+		EVENT_BUF_ADDR_WIDTH = 4,  // key event buffer address length
+		MIN_REPEAT_TIME = 50;  // in ms, see ps2_decoder
+	localparam
+		MS_COUNT = CLK_FREQ * 1000,
+		MS_COUNT_WIDTH = GET_WIDTH(MS_COUNT-1);
 	
 	// control registers
 	reg data_valid, tx_error, rx_error;
+	reg event_of = 0;
+	reg [31:0] reg_mode = 0;  // [0] decode mode, [1] drop all repeats, [15:8] event count and [23:16] timeout in ms to interrupt
+	
+	wire decode_en, drop_repeat;
+	wire [7:0] ir_count, ir_timeout_ms;
+	
+	assign
+		decode_en = reg_mode[0],
+		drop_repeat = reg_mode[1],
+		ir_count = reg_mode[15:8],
+		ir_timeout_ms = reg_mode[23:16];
 	
 	wire [7:0] rx_data;
 	reg [7:0] din, dout;
@@ -41,6 +61,7 @@ module wb_ps2 (
 	wire tx_err, rx_err;
 	wire tx_ack, rx_ack;
 	reg read, write;
+	reg event_read, event_rst;
 	
 	// host
 	ps2_host #(
@@ -63,7 +84,7 @@ module wb_ps2 (
 		);
 	
 	`ifndef NO_PS2_WRITE
-	assign rx_en = ~data_valid;
+	assign rx_en = ~data_valid | decode_en;
 	`else
 	assign rx_en = 1;
 	`endif
@@ -104,20 +125,131 @@ module wb_ps2 (
 			tx_en <= 1;
 	end
 	
+	// timestamp of key events
+	reg [MS_COUNT_WIDTH-1:0] clk_count = 0;
+	reg [15:0] time_ms = 0;
+	wire ms_tick;
+	
+	assign
+		ms_tick = (clk_count == MS_COUNT-1);
+	
+	always @(posedge clk) begin
+		if (rst || ms_tick)
+			clk_count <= 0;
+		else
+			clk_count <= clk_count + 1'h1;
+	end
+	
+	always @(posedge clk) begin
+		if (rst)
+			time_ms <= 0;
+		else if (ms_tick)
+			time_ms <= time_ms + 1'h1;
+	end
+	
+	// decoder and event buffer
+	wire event_ack;
+	wire [31:0] event_data, event_dout;
+	wire event_full, event_empty;
+	wire [EVENT_BUF_ADDR_WIDTH-1:0] event_count;
+	reg event_read_prev;
+	wire event_read_raise;
+	
+	always @(posedge clk) begin
+		if (rst)
+			event_read_prev <= 0;
+		else
+			event_read_prev <= event_read;
+	end
+	
+	assign
+		event_read_raise = ~event_read_prev & event_read;
+	
+	`ifndef NO_PS2_DECODER
+	ps2_decoder #(
+		.MIN_REPEAT_TIME(MIN_REPEAT_TIME)
+		) PS2_DECODER (
+		.clk(clk),
+		.rst(rst | event_rst),
+		.drop_repeat(drop_repeat),
+		.time_ms(time_ms),
+		.rx_ack(rx_ack & decode_en),
+		.rx_data(rx_data),
+		.event_ack(event_ack),
+		.event_data(event_data)
+		);
+	
+	fifo #(
+		.DATA_BITS(32),
+		.ADDR_BITS(EVENT_BUF_ADDR_WIDTH),
+		.DETECT_WEN_EDGE(0),
+		.DETECT_REN_EDGE(0)
+		) FIFO_EVENT (
+		.clk(clk),
+		.rst(rst | event_rst),
+		.en_w(event_ack),
+		.data_w(event_data),
+		.full_w(event_full),
+		.near_full_w(),
+		.space_count(),
+		.en_r(event_read_raise),
+		.data_r(event_dout),
+		.empty_r(event_empty),
+		.near_empty_r(),
+		.data_count(event_count)
+		);
+	`else
+	assign
+		event_ack = 0,
+		event_data = 0,
+		event_dout = 0,
+		event_full = 0,
+		event_empty = 1,
+		event_count = 0;
+	`endif
+	
+	always @(posedge clk) begin
+		if (rst || event_rst)
+			event_of <= 0;
+		else if (event_full && event_ack)
+			event_of <= 1;
+	end
+	
 	// wishbone controller
 	always @(posedge wbs_clk_i) begin
 		read <= 0;
 		write <= 0;
+		event_read <= 0;
+		event_rst <= 0;
 		wbs_data_o <= 0;
 		wbs_ack_o <= 0;
 		if (rst) begin
+			reg_mode <= 0;
 			wbs_data_o <= 0;
 			wbs_ack_o <= 0;
 		end
 		else if (wbs_cs_i & ~wbs_ack_o) begin
 			case (wbs_addr_i)
 				0: begin
-					wbs_data_o <= {rx_busy, tx_busy, 27'b0, data_valid, rx_error, tx_error};
+					wbs_data_o <= {rx_busy, tx_busy, 25'b0, event_of, ~event_empty, data_valid, rx_error, tx_error};
+				end
+				1: begin
+					wbs_data_o[31:16] <= time_ms;
+					wbs_data_o[15:0] <= event_count;
+				end
+				2: begin
+					wbs_data_o <= reg_mode;
+					if (wbs_we_i) begin
+						event_rst <= 1;
+						if (wbs_sel_i[3])
+							reg_mode[31:24] <= wbs_data_i[31:24];
+						if (wbs_sel_i[2])
+							reg_mode[23:16] <= wbs_data_i[23:16];
+						if (wbs_sel_i[1])
+							reg_mode[15:8] <= wbs_data_i[15:8];
+						if (wbs_sel_i[0])
+							reg_mode[7:0] <= wbs_data_i[7:0];
+					end
 				end
 				3: begin
 					wbs_data_o <= {24'h0, din};
@@ -127,6 +259,12 @@ module wb_ps2 (
 					else
 						read <= 1;
 				end
+				4: begin
+					// 0 when there is no event, as virtual-key codes are never 0
+					wbs_data_o <= event_empty ? 32'h0 : event_dout;
+					if (~wbs_we_i)
+						event_read <= 1;
+				end
 				default: begin
 					wbs_data_o <= 0;
 				end
@@ -136,9 +274,35 @@ module wb_ps2 (
 	end
 	
 	// interrupt
+	reg [EVENT_BUF_ADDR_WIDTH-1:0] event_count_prev = 0;
+	reg [7:0] wait_ms = 0;
+	wire ir_event_count, ir_event_timeout, ir_event_of;
+	
+	always @(posedge clk) begin
+		if (rst)
+			event_count_prev <= 0;
+		else
+			event_count_prev <= event_count;
+	end
+	
+	// time the oldest event has waited
+	always @(posedge clk) begin
+		if (rst || event_empty || event_read)
+			wait_ms <= 0;
+		else if (ms_tick && wait_ms != 8'hFF)
+			wait_ms <= wait_ms + 1'h1;
+	end
+	
+	assign
+		ir_event_count = (event_count_prev < ir_count) && (event_count >= ir_count),
+		ir_event_timeout = ms_tick && (ir_timeout_ms != 0) && (wait_ms == ir_timeout_ms-1),
+		ir_event_of = event_full & event_ack;
+	
 	always @(posedge clk) begin
 		if (rst)
 			interrupt <= 0;
+		else if (decode_en)
+			interrupt <= ir_event_count | ir_event_timeout | ir_event_of | tx_err | rx_err;
 		else
 			interrupt <= rx_ack | tx_err | rx_err;
 	end
@@ -17,6 +17,8 @@ module psram_core_nexys3 (
 	output reg [31:0] dout,  // data read in
 	output reg busy,  // busy flag
 	output reg ack,  // acknowledge
+	output reg suspended,  // burst is suspended with PSRAM still selected, sequential access can be continued without initial latency
+	input wire suspend_end,  // end the suspended burst and deselect PSRAM, as the shared memory lines are wanted by others
 	// PSRAM interfaces
 	output reg ram_ce_n = 1,
 	output wire ram_clk,
@@ -39,12 +41,17 @@ module psram_core_nexys3 (
 	localparam
 		DELAY_INIT = 150000,  // delay time to complete initialization, in ns
 		DELAY_CONFIG = 85,  // delay time to complete configuration, in ns
-		DELAY_DONE = 50;  // delay time to wait when burst ended, in ns
+		DELAY_DONE = 50,  // delay time to wait when burst ended, in ns
+		DELAY_CEM = 4000;  // maximum time for chip enable being kept low (tCEM), in ns
 	localparam
 		COUNT_INIT = 1 + CLK_FREQ * DELAY_INIT / 1000,
 		COUNT_CONFIG = 1 + CLK_FREQ * DELAY_CONFIG / 1000,
 		COUNT_DONE = 1 + CLK_FREQ * DELAY_DONE / 1000,
-		COUNT_BITS = GET_WIDTH(COUNT_INIT-1);
+		COUNT_CEM = CLK_FREQ * DELAY_CEM / 1000 - 8,  // leave some margin for the burst to be closed
+		COUNT_BITS = GET_WIDTH(COUNT_INIT-1),
+		COUNT_CEM_BITS = GET_WIDTH(COUNT_CEM-1);
+	parameter
+		SUSPEND_EN = 1;  // whether to suspend burst instead of ending it, so that the next sequential access can skip the initial latency
 	localparam
 		BCR_CONFIG = 16'b0_0_011_1_0_1_00_01_1_111;  // set 'ram_wait' to be asserted one data cycle before delay
 	
@@ -53,6 +60,8 @@ module psram_core_nexys3 (
 		wait_buf <= ram_wait;
 	end
 	
+	reg ram_clk_en = 0;  // stop RAM's clock (held low) when burst is suspended
+	
 	ODDR2 #(
 		.DDR_ALIGNMENT("NONE"),
 		.INIT(1'b0),
@@ -63,7 +72,7 @@ module psram_core_nexys3 (
 		.C1(~clk),
 		.CE(1'b1),
 		.D0(1'b0),  // RAM's clock is reversed from the input clock
-		.D1(1'b1),
+		.D1(ram_clk_en),
 		.R(rst),
 		.S(1'b0)
 		);
@@ -76,13 +85,26 @@ module psram_core_nexys3 (
 		S_WAIT = 4,  // wait for ram_wait signal
 		S_OP1 = 5,  // low 16-bits data
 		S_OP2 = 6,  // high 16-bits data
-		S_DONE = 7;  // acknowledge
+		S_DONE = 7,  // acknowledge
+		S_SUSPEND = 8,  // burst suspended, RAM's clock stopped while chip enable kept low
+		S_RESUME = 9;  // enable output or write before RAM's clock restarts
 	
-	reg [2:0] state = 0;
-	reg [2:0] next_state;
+	reg [3:0] state = 0;
+	reg [3:0] next_state;
 	reg [COUNT_BITS-1:0] count = 0;
 	reg [COUNT_BITS-1:0] next_count;
 	
+	// open burst tracking, the address and direction that the suspended burst will continue with
+	reg open_we = 0;
+	reg [ADDR_BITS-1:2] open_addr = 0;
+	reg [COUNT_CEM_BITS-1:0] cem_count = 0;
+	wire cem_timeout;
+	wire open_hit;
+	
+	assign
+		cem_timeout = (cem_count >= COUNT_CEM),
+		open_hit = (we == open_we) && (addr == open_addr);
+	
 	always @(*) begin
 		next_state = 0;
 		next_count = 0;
@@ -126,11 +148,31 @@ module psram_core_nexys3 (
 				next_state = S_OP2;
 			end
 			S_OP2: begin
-				if (cs && burst && ~ram_wait)
-					next_state = S_OP1;
+				if (cem_timeout)
+					next_state = S_DONE;
+				else if (cs && burst)
+					next_state = ram_wait ? S_WAIT : S_OP1;  // 'ram_wait' here means crossing row boundary, keep waiting instead of ending the burst
+				else if (SUSPEND_EN)
+					next_state = S_SUSPEND;
 				else
 					next_state = S_DONE;
 			end
+			S_SUSPEND: begin
+				if (cem_timeout || suspend_end)
+					next_state = S_DONE;
+				else if (cs && open_hit)
+					next_state = S_RESUME;
+				else if (cs)
+					next_state = S_DONE;
+				else
+					next_state = S_SUSPEND;
+			end
+			S_RESUME: begin
+				if (ram_wait || wait_buf)
+					next_state = S_WAIT;
+				else
+					next_state = S_OP1;
+			end
 			S_DONE: begin
 				if (count == COUNT_DONE-1) begin
 					next_state = S_IDLE;
@@ -155,9 +197,36 @@ module psram_core_nexys3 (
 		end
 	end
 	
+	always @(posedge clk) begin
+		if (rst) begin
+			open_we <= 0;
+			open_addr <= 0;
+			cem_count <= 0;
+		end
+		else case (next_state)
+			S_START: begin
+				open_we <= we;
+				open_addr <= addr;
+				cem_count <= 0;
+			end
+			S_WAIT, S_OP1, S_SUSPEND, S_RESUME: begin
+				cem_count <= cem_count + 1'h1;
+			end
+			S_OP2: begin
+				open_addr <= open_addr + 1'h1;
+				cem_count <= cem_count + 1'h1;
+			end
+			default: begin
+				cem_count <= 0;
+			end
+		endcase
+	end
+	
 	always @(posedge clk) begin
 		busy <= 0;
 		ack <= 0;
+		suspended <= 0;
+		ram_clk_en <= 1;
 		ram_ce_n <= 1;
 		ram_oe_n <= 1;
 		ram_we_n <= 1;
@@ -221,6 +290,22 @@ module psram_core_nexys3 (
 			end
 			S_DONE: begin
 			end
+			S_SUSPEND: begin
+				// release the data lines and stop RAM's clock to keep burst position, PSRAM is still selected so that the
+				// shared memory lines must not be given to others until the burst is ended by 'suspend_end'
+				suspended <= 1;
+				ram_clk_en <= 0;
+				ram_ce_n <= 0;
+			end
+			S_RESUME: begin
+				busy <= 1;
+				ram_clk_en <= 0;
+				ram_ce_n <= 0;
+				ram_we_n <= ~we;
+				ram_oe_n <= we;
+				ram_lb_n <= 0;
+				ram_ub_n <= 0;
+			end
 		endcase
 	end
 	
@@ -229,7 +314,7 @@ module psram_core_nexys3 (
 		if (~rst) case (state)  // read data must be buffered at the negative edge, so that use 'state' instead of 'next_state'
 			S_OP1: dout <= {16'b0, ram_din};
 			S_OP2: dout <= {ram_din, dout[15:0]};
-			S_DONE: dout <= dout;
+			S_DONE, S_SUSPEND: dout <= dout;
 		endcase
 	end
 	
@@ -9,6 +9,8 @@ module wb_psram_nexys3 (
 	input wire clk,  // main clock, should be faster than or equal to wishbone clock
 	input wire rst,  // synchronous reset
 	output wire ram_busy,  // busy flag
+	output wire ram_suspended,  // burst is suspended with PSRAM still selected
+	input wire ram_suspend_end,  // end the suspended burst to deselect PSRAM
 	// PSRAM interfaces
 	output wire ram_clk,
 	output wire ram_ce_n,
@@ -42,7 +44,8 @@ module wb_psram_nexys3 (
 	parameter
 		ADDR_BITS = 24,  // address length for PSRAM
 		HIGH_ADDR = 8'h00,  // high address value, as the address length of wishbone is larger than device
-		BUF_ADDR_BITS = 4;  // address length for buffer
+		BUF_ADDR_BITS = 4,  // address length for buffer
+		SUSPEND_EN = 1;  // whether to suspend burst so that sequential accesses can skip the initial latency
 	
 	wire cs;
 	wire we;
@@ -57,7 +60,8 @@ module wb_psram_nexys3 (
 	// core
 	psram_core_nexys3 #(
 		.CLK_FREQ(CLK_FREQ),
-		.ADDR_BITS(ADDR_BITS)
+		.ADDR_BITS(ADDR_BITS),
+		.SUSPEND_EN(SUSPEND_EN)
 		) PSRAM_CORE (
 		.clk(clk),
 		.rst(rst),
@@ -70,6 +74,8 @@ module wb_psram_nexys3 (
 		.dout(dout),
 		.busy(core_busy),
 		.ack(ack),
+		.suspended(ram_suspended),
+		.suspend_end(ram_suspend_end),
 		.ram_ce_n(ram_ce_n),
 		.ram_clk(ram_clk),
 		.ram_oe_n(ram_oe_n),
@@ -0,0 +1,180 @@
+`include "define.vh"
+
+
+/**
+ * Pseudo random number generator (xoshiro128**) with a bounded output, which needs no division.
+ * Registers (word address):
+ *   0: random number, read only, each read gets a new one
+ *   1: random number in [begin, end), read only, each read gets a new one, taken from the high part of number * (end - begin)
+ *   2: begin of the bounded range
+ *   3: end of the bounded range, end - begin of 0 means the whole 2^32
+ *   4: control, bit 0 for free-running (default), when the generator steps on every clock so that numbers depend on when they are read,
+ *      otherwise it steps only when address 0 or 1 is read, so that the same seed gives the same sequence
+ *   8-11: generator state, write them to seed, a state of all zero is replaced by the reset value
+ * Author: Zhao, Hongyu  <power_zhy@foxmail.com>
+ */
+module wb_random (
+	input wire clk,  // main clock, should be faster than or equal to wishbone clock
+	input wire rst,  // synchronous reset
+	// peripheral wishbone interfaces
+	input wire wbs_clk_i,
+	input wire wbs_cs_i,
+	input wire [DEV_ADDR_BITS-1:2] wbs_addr_i,
+	input wire [3:0] wbs_sel_i,
+	input wire [31:0] wbs_data_i,
+	input wire wbs_we_i,
+	output reg [31:0] wbs_data_o,
+	output reg wbs_ack_o
+	);
+	
+	parameter
+		DEV_ADDR_BITS = 8;  // address length of I/O space
+	parameter
+		SEED = 128'h9E3779B9_7F4A7C15_F39CC060_5CEDC834;  // reset value of state
+	
+	// control registers
+	reg [31:0] s0 = SEED[127:96], s1 = SEED[95:64], s2 = SEED[63:32], s3 = SEED[31:0];
+	reg [31:0] range_begin = 0, range_end = 0;
+	reg free_run = 1;
+	reg [31:0] number = 0;  // output of the generator, registered so that it is ready at any time
+	
+	// write requests and reads of numbers are issued in wishbone clock and committed in main clock
+	reg write, take;
+	reg [DEV_ADDR_BITS-1:2] write_addr;
+	reg [31:0] write_data;
+	reg write_prev, take_prev;
+	wire write_raise, take_raise;
+	
+	always @(posedge clk) begin
+		if (rst) begin
+			write_prev <= 0;
+			take_prev <= 0;
+		end
+		else begin
+			write_prev <= write;
+			take_prev <= take;
+		end
+	end
+	
+	assign
+		write_raise = ~write_prev & write,
+		take_raise = ~take_prev & take;
+	
+	// generator, x*5 and x*9 are done by shifts and adds
+	wire [31:0] s1_x5, s1_x5_rot, result;
+	wire [31:0] t, n0, n1, n2, n3;
+	
+	assign
+		s1_x5 = s1 + {s1[29:0], 2'b0},
+		s1_x5_rot = {s1_x5[24:0], s1_x5[31:25]},
+		result = s1_x5_rot + {s1_x5_rot[28:0], 3'b0};
+	
+	assign
+		t = {s1[22:0], 9'b0},
+		n2 = s2 ^ s0,
+		n3 = s3 ^ s1,
+		n1 = s1 ^ n2,
+		n0 = s0 ^ n3;
+	
+	always @(posedge clk) begin
+		if (rst) begin
+			s0 <= SEED[127:96];
+			s1 <= SEED[95:64];
+			s2 <= SEED[63:32];
+			s3 <= SEED[31:0];
+		end
+		else if (write_raise && write_addr[DEV_ADDR_BITS-1:4] == 2) begin
+			case (write_addr[3:2])
+				0: s0 <= write_data;
+				1: s1 <= write_data;
+				2: s2 <= write_data;
+				3: s3 <= write_data;
+			endcase
+		end
+		else if (s0 == 0 && s1 == 0 && s2 == 0 && s3 == 0) begin
+			s0 <= SEED[127:96];
+			s1 <= SEED[95:64];
+			s2 <= SEED[63:32];
+			s3 <= SEED[31:0];
+		end
+		else if (free_run || take_raise) begin
+			s0 <= n0;
+			s1 <= n1;
+			s2 <= n2 ^ t;
+			s3 <= {n3[20:0], n3[31:21]};
+		end
+	end
+	
+	always @(posedge clk) begin
+		if (rst)
+			free_run <= 1;
+		else if (write_raise && write_addr == 4)
+			free_run <= write_data[0];
+	end
+	
+	always @(posedge clk) begin
+		if (rst)
+			number <= 0;
+		else
+			number <= result;
+	end
+	
+	// bounded number is the high part of number * range, range of 0 means 2^32, range registers live in wishbone clock
+	wire [32:0] range;
+	wire [63:0] product;
+	
+	assign
+		range = (range_end == range_begin) ? 33'h1_0000_0000 : {1'b0, range_end - range_begin},
+		product = number * range;
+	
+	// wishbone controller
+	always @(posedge wbs_clk_i) begin
+		write <= 0;
+		take <= 0;
+		wbs_data_o <= 0;
+		wbs_ack_o <= 0;
+		if (rst) begin
+			range_begin <= 0;
+			range_end <= 0;
+			write_addr <= 0;
+			write_data <= 0;
+			wbs_data_o <= 0;
+			wbs_ack_o <= 0;
+		end
+		else if (wbs_cs_i & ~wbs_ack_o) begin
+			case (wbs_addr_i)
+				0: begin
+					wbs_data_o <= number;
+					take <= ~wbs_we_i;
+				end
+				1: begin
+					wbs_data_o <= range_begin + product[63:32];
+					take <= ~wbs_we_i;
+				end
+				2: begin
+					wbs_data_o <= range_begin;
+					if (wbs_we_i)
+						range_begin <= wbs_data_i;
+				end
+				3: begin
+					wbs_data_o <= range_end;
+					if (wbs_we_i)
+						range_end <= wbs_data_i;
+				end
+				4: wbs_data_o <= {31'b0, free_run};
+				8: wbs_data_o <= s0;
+				9: wbs_data_o <= s1;
+				10: wbs_data_o <= s2;
+				11: wbs_data_o <= s3;
+				default: wbs_data_o <= 0;
+			endcase
+			if (wbs_we_i) begin  // wbs_sel_i are ignored
+				write <= 1;
+				write_addr <= wbs_addr_i;
+				write_data <= wbs_data_i;
+			end
+			wbs_ack_o <= 1;
+		end
+	end
+	
+endmodule
@@ -0,0 +1,186 @@
+`include "define.vh"
+
+
+/**
+ * Timer with a 64-bit free-running counter and several one-shot/periodic compare channels.
+ * Registers (word address):
+ *   0: counter low, reading it also latches the high part for address 1
+ *   1: counter high, latched when address 0 is read
+ *   2: pending flags of all channels, write 1 to clear
+ *   3: counter frequency in MHz (read only)
+ *   4*i+8: compare value low of channel i
+ *   4*i+9: compare value high of channel i
+ *   4*i+10: period of channel i, reloaded into compare value on each match in periodic mode
+ *   4*i+11: control of channel i, bit 0 for enable, bit 1 for periodic mode and bit 2 for interrupt enable
+ * A channel matches when counter reaches its compare value, so deadlines already passed fire at once.
+ * One-shot channels disable themselves after matching.
+ * Interrupt stays high while any pending channel has interrupt enabled, until its flag is cleared through address 2.
+ * Author: Zhao, Hongyu  <power_zhy@foxmail.com>
+ */
+module wb_timer (
+	input wire clk,  // main clock, should be faster than or equal to wishbone clock
+	input wire rst,  // synchronous reset
+	// peripheral wishbone interfaces
+	input wire wbs_clk_i,
+	input wire wbs_cs_i,
+	input wire [DEV_ADDR_BITS-1:2] wbs_addr_i,
+	input wire [3:0] wbs_sel_i,
+	input wire [31:0] wbs_data_i,
+	input wire wbs_we_i,
+	output reg [31:0] wbs_data_o,
+	output reg wbs_ack_o,
+	// interrupt
+	output reg interrupt
+	);
+	
+	parameter
+		CLK_FREQ = 100;  // main clock frequency in MHz
+	parameter
+		DEV_ADDR_BITS = 8;  // address length of I/O space
+	parameter
+		CHANNEL_NUM = 4;  // number of compare channels, no more than (2^(DEV_ADDR_BITS-2)-8)/4
+	
+	// control registers
+	reg [63:0] counter = 0;
+	reg [31:0] counter_high;
+	reg [63:0] cmp [0:CHANNEL_NUM-1];
+	reg [31:0] period [0:CHANNEL_NUM-1];
+	reg [CHANNEL_NUM-1:0] enable = 0, periodic = 0, ir_en = 0;
+	reg [CHANNEL_NUM-1:0] pending = 0;
+	
+	// write requests are issued in wishbone clock and committed in main clock
+	reg write;
+	reg [DEV_ADDR_BITS-1:2] write_addr;
+	reg [31:0] write_data;
+	reg write_prev;
+	wire write_raise;
+	
+	always @(posedge clk) begin
+		if (rst)
+			write_prev <= 0;
+		else
+			write_prev <= write;
+	end
+	
+	assign write_raise = ~write_prev & write;
+	
+	// counter
+	always @(posedge clk) begin
+		if (rst)
+			counter <= 0;
+		else
+			counter <= counter + 1'h1;
+	end
+	
+	// channels
+	reg [CHANNEL_NUM-1:0] match;
+	integer i;
+	
+	always @(*) begin
+		for (i=0; i<CHANNEL_NUM; i=i+1)
+			match[i] = enable[i] && (counter >= cmp[i]);
+	end
+	
+	always @(posedge clk) begin
+		if (rst) begin
+			enable <= 0;
+			periodic <= 0;
+			ir_en <= 0;
+			pending <= 0;
+			for (i=0; i<CHANNEL_NUM; i=i+1) begin
+				cmp[i] <= 0;
+				period[i] <= 0;
+			end
+		end
+		else begin
+			for (i=0; i<CHANNEL_NUM; i=i+1) begin
+				if (match[i]) begin
+					pending[i] <= 1;
+					if (periodic[i] && period[i] != 0)
+						cmp[i] <= cmp[i] + period[i];
+					else
+						enable[i] <= 0;
+				end
+			end
+			if (write_raise) begin
+				if (write_addr == 2) begin
+					pending <= (pending | match) & ~write_data[CHANNEL_NUM-1:0];  // avoid read-modify-write problem
+				end
+				for (i=0; i<CHANNEL_NUM; i=i+1) begin
+					if (write_addr == 4*i+8)
+						cmp[i][31:0] <= write_data;
+					if (write_addr == 4*i+9)
+						cmp[i][63:32] <= write_data;
+					if (write_addr == 4*i+10)
+						period[i] <= write_data;
+					if (write_addr == 4*i+11) begin
+						enable[i] <= write_data[0];
+						periodic[i] <= write_data[1];
+						ir_en[i] <= write_data[2];
+					end
+				end
+			end
+		end
+	end
+	
+	// wishbone controller
+	integer j;
+	
+	always @(posedge wbs_clk_i) begin
+		write <= 0;
+		wbs_data_o <= 0;
+		wbs_ack_o <= 0;
+		if (rst) begin
+			counter_high <= 0;
+			write_addr <= 0;
+			write_data <= 0;
+			wbs_data_o <= 0;
+			wbs_ack_o <= 0;
+		end
+		else if (wbs_cs_i & ~wbs_ack_o) begin
+			case (wbs_addr_i)
+				0: begin
+					wbs_data_o <= counter[31:0];
+					counter_high <= counter[63:32];
+				end
+				1: begin
+					wbs_data_o <= counter_high;
+				end
+				2: begin
+					wbs_data_o <= pending;
+				end
+				3: begin
+					wbs_data_o <= CLK_FREQ;
+				end
+				default: begin
+					wbs_data_o <= 0;
+					for (j=0; j<CHANNEL_NUM; j=j+1) begin
+						if (wbs_addr_i == 4*j+8)
+							wbs_data_o <= cmp[j][31:0];
+						if (wbs_addr_i == 4*j+9)
+							wbs_data_o <= cmp[j][63:32];
+						if (wbs_addr_i == 4*j+10)
+							wbs_data_o <= period[j];
+						if (wbs_addr_i == 4*j+11)
+							wbs_data_o <= {29'b0, ir_en[j], periodic[j], enable[j]};
+					end
+				end
+			endcase
+			if (wbs_we_i) begin  // wbs_sel_i are ignored
+				write <= 1;
+				write_addr <= wbs_addr_i;
+				write_data <= wbs_data_i;
+			end
+			wbs_ack_o <= 1;
+		end
+	end
+	
+	// interrupt
+	always @(posedge clk) begin
+		if (rst)
+			interrupt <= 0;
+		else
+			interrupt <= |(pending & ir_en);
+	end
+	
+endmodule
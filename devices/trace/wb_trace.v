@@ -0,0 +1,195 @@
+`include "define.vh"
+
+
+/**
+ * Trace unit of the CPU, which records PCs into a circular buffer in block RAM, for profiling on board.
+ * Two kinds of entries can be recorded at the same time:
+ *   branch: target of every taken branch, jump, exception and ERET, found as a retired PC not following the last one
+ *   sample: the last retired PC, once per sample interval
+ * Each entry has two words, {pc[31:2], type[1:0]} with type 0 for sample, 1 for branch and 2 for exception or ERET,
+ * and then the timestamp in clocks since cleared.
+ * Registers (word address):
+ *   0: control, bit 0 enables branch trace, bit 1 enables sampling, bit 2 stops recording when the buffer is full
+ *      instead of overwriting the oldest entries, write bit 31 to clear the buffer and the timestamp
+ *   1: sample interval in clocks
+ *   2: number of entries recorded since cleared, read only, the oldest entry is at this number modulo capacity
+ *   3: timestamp, read only
+ *   4: read index in words
+ *   5: word of the buffer at read index, read only, read index increases after each read
+ *   6: capacity in entries, read only
+ *   7: number of entries dropped as the buffer is full, read only
+ * The second instruction of a dual issued pair retires in the same clock as the first one, it is never a branch target
+ * and becomes the last retired PC.
+ * Author: Zhao, Hongyu  <power_zhy@foxmail.com>
+ */
+module wb_trace (
+	input wire clk,  // main clock, the same as CPU clock, should be exactly the same as wishbone clock in current version
+	input wire rst,  // synchronous reset
+	// CPU trace interfaces
+	input wire retire_valid,  // one instruction retired in this clock
+	input wire [31:0] retire_pc,  // address of the instruction retired
+	input wire retire_pair,  // the second instruction of a dual issued pair at retire_pc+4 also retired
+	input wire retire_exception,  // exception, interrupt or ERET taken in this clock
+	// peripheral wishbone interfaces
+	input wire wbs_clk_i,
+	input wire wbs_cs_i,
+	input wire [DEV_ADDR_BITS-1:2] wbs_addr_i,
+	input wire [3:0] wbs_sel_i,
+	input wire [31:0] wbs_data_i,
+	input wire wbs_we_i,
+	output reg [31:0] wbs_data_o,
+	output reg wbs_ack_o
+	);
+	
+	parameter
+		DEV_ADDR_BITS = 8;  // address length of I/O space
+	parameter
+		ENTRY_BITS = 10;  // address length of buffer in entries, 1024 entries (8KB) by default
+	localparam
+		ENTRY_NUM = 1 << ENTRY_BITS;
+	localparam
+		TYPE_SAMPLE = 0,
+		TYPE_BRANCH = 1,
+		TYPE_EXCEPTION = 2;
+	
+	// control registers, written in wishbone clock
+	reg branch_en = 0, sample_en = 0, stop_full = 0;
+	reg clear = 0;
+	reg [31:0] interval = 0;
+	reg [ENTRY_BITS:0] read_index = 0;
+	
+	// capture
+	reg [31:0] timestamp = 0;
+	reg [31:0] count = 0, dropped = 0;
+	reg [31:2] last_pc = 0;
+	reg exception_seen = 0;  // exception taken since the last retired instruction
+	reg [31:0] sample_count = 0;
+	reg sample_pending = 0;
+	wire branch_hit, sample_tick, full;
+	wire [31:2] sample_pc;
+	
+	assign
+		branch_hit = branch_en && retire_valid && retire_pc[31:2] != last_pc + 1'h1,
+		sample_tick = sample_en && sample_count + 1 >= interval,
+		sample_pc = retire_valid ? retire_pc[31:2] + retire_pair : last_pc,
+		full = count[31:ENTRY_BITS] != 0;
+	
+	always @(posedge clk) begin
+		if (rst || clear) begin
+			timestamp <= 0;
+			last_pc <= 0;
+			exception_seen <= 0;
+			sample_count <= 0;
+		end
+		else begin
+			timestamp <= timestamp + 1'h1;
+			if (retire_valid) begin
+				last_pc <= retire_pc[31:2] + retire_pair;
+				exception_seen <= 0;
+			end
+			else if (retire_exception) begin
+				exception_seen <= 1;
+			end
+			if (~sample_en || sample_tick)
+				sample_count <= 0;
+			else
+				sample_count <= sample_count + 1'h1;
+		end
+	end
+	
+	// buffer, entries of branches go first and a sample waits for a clock without branch
+	reg [63:0] buffer [0:ENTRY_NUM-1];
+	reg [63:0] read_entry;
+	wire record;
+	wire [1:0] entry_type;
+	wire [63:0] entry;
+	
+	assign
+		record = branch_hit | sample_pending,
+		entry_type = branch_hit ? (exception_seen ? TYPE_EXCEPTION : TYPE_BRANCH) : TYPE_SAMPLE,
+		entry = {timestamp, branch_hit ? retire_pc[31:2] : sample_pc, entry_type};
+	
+	always @(posedge clk) begin
+		if (rst || clear) begin
+			count <= 0;
+			dropped <= 0;
+			sample_pending <= 0;
+		end
+		else begin
+			if (sample_tick)
+				sample_pending <= 1;
+			else if (~branch_hit)
+				sample_pending <= 0;
+			if (record) begin
+				if (stop_full && full) begin
+					dropped <= dropped + 1'h1;
+				end
+				else begin
+					buffer[count[ENTRY_BITS-1:0]] <= entry;
+					count <= count + 1'h1;
+				end
+			end
+		end
+	end
+	
+	// read index of the next clock is used as address, so that the entry is ready when it is accessed
+	reg [ENTRY_BITS:0] read_index_next;
+	
+	always @(*) begin
+		read_index_next = read_index;
+		if (wbs_cs_i & ~wbs_ack_o) begin
+			if (wbs_addr_i == 4 && wbs_we_i)
+				read_index_next = wbs_data_i[ENTRY_BITS:0];
+			else if (wbs_addr_i == 5 && ~wbs_we_i)
+				read_index_next = read_index + 1'h1;
+		end
+	end
+	
+	always @(posedge wbs_clk_i) begin
+		read_entry <= buffer[read_index_next[ENTRY_BITS:1]];
+	end
+	
+	// wishbone controller
+	always @(posedge wbs_clk_i) begin
+		clear <= 0;
+		wbs_data_o <= 0;
+		wbs_ack_o <= 0;
+		if (rst) begin
+			branch_en <= 0;
+			sample_en <= 0;
+			stop_full <= 0;
+			interval <= 0;
+			read_index <= 0;
+			wbs_data_o <= 0;
+			wbs_ack_o <= 0;
+		end
+		else if (wbs_cs_i & ~wbs_ack_o) begin
+			case (wbs_addr_i)
+				0: begin
+					wbs_data_o <= {29'b0, stop_full, sample_en, branch_en};
+					if (wbs_we_i) begin
+						branch_en <= wbs_data_i[0];
+						sample_en <= wbs_data_i[1];
+						stop_full <= wbs_data_i[2];
+						clear <= wbs_data_i[31];
+					end
+				end
+				1: begin
+					wbs_data_o <= interval;
+					if (wbs_we_i)
+						interval <= wbs_data_i;
+				end
+				2: wbs_data_o <= count;
+				3: wbs_data_o <= timestamp;
+				4: wbs_data_o <= read_index;
+				5: wbs_data_o <= read_index[0] ? read_entry[63:32] : read_entry[31:0];
+				6: wbs_data_o <= ENTRY_NUM;
+				7: wbs_data_o <= dropped;
+				default: wbs_data_o <= 0;
+			endcase
+			read_index <= read_index_next;
+			wbs_ack_o <= 1;
+		end
+	end
+	
+endmodule
@@ -3,6 +3,9 @@
 
 /**
  * VGA graphic mode with wishbone connection interfaces and inner buffer.
+ * Pixels are RGB332 bytes, or 4/2/1-bit indexes to a palette of 16 colors, which reduces memory and bus bandwidth.
+ * In tile mode, the screen is composed of tiles whose indexes are kept in an inner map, patterns are fetched from memory
+ * for each tile line, and index 0xFF fills the whole tile with one color without any fetch.
  * Author: Zhao, Hongyu  <power_zhy@foxmail.com>
  */
 module wb_vga_graphic (
@@ -10,12 +13,30 @@ module wb_vga_graphic (
 	input wire rst,  // synchronous reset
 	input wire vga_clk,  // VGA clock generated by VGA core
 	input wire [H_COUNT_WIDTH-1:0] h_count_core,  // horizontal sync count from VGA core
+	input wire [H_COUNT_WIDTH-1:0] h_disp_max,  // maximum display range for horizontal pixels
+	input wire [V_COUNT_WIDTH-1:0] v_disp_max,  // maximum display range for vertical lines
 	input wire [P_COUNT_WIDTH-1:0] p_disp_max,  // maximum display range for pixels
 	input wire h_sync_core,  // horizontal sync from VGA core
 	input wire v_sync_core,  // vertical sync from VGA core
 	input wire h_en_core,  // scan line inside horizontal display range from VGA core
 	input wire v_en_core,  // scan line inside vertical display range from VGA core
 	input wire [31:20] vram_base,  // base address for VRAM
+	input wire [1:0] depth,  // pixel depth, 8 >> depth bits per pixel, the lowest bits of a word are the leftmost pixel
+	input wire [127:0] palette,  // 16 RGB332 colors for pixels below 8 bits, color 0 in the lowest byte
+	input wire [BUF_ADDR_WIDTH-1:0] refill_threshold,  // refill buffer when less words are left, 0 for default
+	// tile mode
+	input wire tile_en,  // use tile map instead of VRAM
+	input wire [6:0] tile_width,  // number of words per tile line minus one
+	input wire [7:0] tile_height,  // number of lines per tile minus one
+	input wire [4:0] tile_stride,  // distance between patterns in memory, as log2 of bytes
+	input wire [31:2] tile_base,  // address of pattern 0
+	input wire [7:0] tile_fill,  // color used by index 0xFF
+	input wire [15:0] scroll_x,  // map position of the left screen edge, tile column and word inside tile
+	input wire [15:0] scroll_y,  // map position of the top screen edge, tile row and line inside tile
+	input wire map_clk,
+	input wire map_we,
+	input wire [MAP_ADDR_BITS-1:0] map_addr,  // tile row and tile column
+	input wire [7:0] map_data,  // pattern index
 	// VGA interfaces
 	output reg h_sync,
 	output reg v_sync,
@@ -41,6 +62,11 @@ module wb_vga_graphic (
 	localparam
 		BUF_ADDR_WIDTH = 8,
 		REFILL_THRESHOLD = 64;
+	localparam
+		MAP_COL_BITS = 6,  // 64 tiles per map row
+		MAP_ROW_BITS = 5,  // 32 map rows
+		MAP_ADDR_BITS = MAP_ROW_BITS + MAP_COL_BITS,
+		TILE_FILL_INDEX = 8'hFF;
 	
 	// delay core signals 1 clock for fetching pixels
 	reg [H_COUNT_WIDTH-1:0] h_count_d1;
@@ -67,7 +93,12 @@ module wb_vga_graphic (
 	end
 	
 	// buffer
+	wire [BUF_ADDR_WIDTH-1:0] refill_level;
+	assign
+		refill_level = (refill_threshold == 0) ? REFILL_THRESHOLD : refill_threshold;
+	
 	reg fifo_clear;
+	wire fill_beat;
 	wire full_w, near_full_w;
 	wire [7:0] space_count;
 	wire en_r;
@@ -79,8 +110,8 @@ module wb_vga_graphic (
 		) FIFO_ASY (
 		.rst(rst | fifo_clear),
 		.clk_w(wbm_clk_i),
-		.en_w(wbm_cyc_o & wbm_ack_i),
-		.data_w(wbm_data_i),
+		.en_w((wbm_cyc_o & wbm_ack_i) | fill_beat),
+		.data_w(fill_beat ? {4{tile_fill}} : wbm_data_i),
 		.full_w(full_w),
 		.near_full_w(near_full_w),
 		.space_count(space_count),
@@ -116,12 +147,46 @@ module wb_vga_graphic (
 		PD1 (.clk_i(vga_clk), .dat_i(vga_line_done), .clk_d(wbm_clk_i), .dat_d(vga_line_done_d)),
 		PD2 (.clk_i(vga_clk), .dat_i(vga_frame_done), .clk_d(wbm_clk_i), .dat_d(vga_frame_done_d));
 	
+	// fetching address in VRAM or in tile patterns
+	reg [19:2] vram_addr;
+	reg [31:2] tile_addr;
+	
+	// tile map, read one clock after the tile position changes
+	reg [7:0] tile_map [0:(1<<MAP_ADDR_BITS)-1];
+	reg [MAP_ROW_BITS-1:0] map_row;
+	reg [MAP_COL_BITS-1:0] map_col;
+	reg [7:0] map_index;
+	
+	always @(posedge map_clk) begin
+		if (map_we)
+			tile_map[map_addr] <= map_data;
+	end
+	
+	always @(posedge wbm_clk_i) begin
+		map_index <= tile_map[{map_row, map_col}];
+	end
+	
+	// tile position of the word being fetched
+	reg [H_COUNT_WIDTH-1:2] screen_word;
+	reg [V_COUNT_WIDTH-1:0] screen_line;
+	reg [6:0] tile_word;
+	reg [7:0] tile_line;
+	reg tile_frame_done;
+	wire tile_beat, span_last, line_last;
+	
+	assign
+		line_last = (screen_word == h_disp_max >> (2 + depth)),
+		span_last = (tile_word == tile_width) | line_last;
+	
 	localparam
 		S_IDLE = 0,  // idle
 		S_BURST = 1,  // read VRAM's data
 		S_WAIT = 2,  // wait for display
 		S_FRAME_END = 3,  // frame read complete, wait for display complete
-		S_CLEAR = 4;  // clear FIFO, prepare for next frame
+		S_CLEAR = 4,  // clear FIFO, prepare for next frame
+		S_NEXT = 5,  // tile mode, one tile line complete, read index of the next tile
+		S_LOAD = 6,  // tile mode, start the next tile line by fetching its pattern or filling its color
+		S_FILL = 7;  // tile mode, fill tile line with color
 	
 	reg [2:0] state = 0;
 	reg [2:0] next_state;
@@ -132,12 +197,14 @@ module wb_vga_graphic (
 		case (state)
 			S_IDLE: begin
 				if (~full_w && ~near_full_w)
-					next_state = S_BURST;
+					next_state = tile_en ? S_LOAD : S_BURST;
 				else
 					next_state = S_IDLE;
 			end
 			S_BURST: begin
-				if (wbm_addr_o[19:2] == p_disp_max>>2)
+				if (tile_en && tile_beat && span_last)
+					next_state = S_NEXT;
+				else if (~tile_en && vram_addr == p_disp_max >> (2 + depth))
 					next_state = S_FRAME_END;
 				else if (near_full_w && wbm_ack_i)
 					next_state = S_WAIT;
@@ -145,7 +212,7 @@ module wb_vga_graphic (
 					next_state = S_BURST;
 			end
 			S_WAIT: begin
-				if (space_count == ((1<<BUF_ADDR_WIDTH) - REFILL_THRESHOLD))
+				if (space_count >= ((1<<BUF_ADDR_WIDTH) - refill_level))
 					next_state = S_BURST;
 				else
 					next_state = S_WAIT;
@@ -163,6 +230,26 @@ module wb_vga_graphic (
 				else
 					next_state = S_CLEAR;
 			end
+			S_NEXT: begin
+				if (tile_frame_done)
+					next_state = S_FRAME_END;
+				else
+					next_state = S_LOAD;
+			end
+			S_LOAD: begin
+				if (near_full_w)
+					next_state = S_LOAD;
+				else if (map_index == TILE_FILL_INDEX)
+					next_state = S_FILL;
+				else
+					next_state = S_BURST;
+			end
+			S_FILL: begin
+				if (tile_beat && span_last)
+					next_state = S_NEXT;
+				else
+					next_state = S_FILL;
+			end
 		endcase
 	end
 	
@@ -173,11 +260,61 @@ module wb_vga_graphic (
 			state <= next_state;
 	end
 	
+	// tile position, advanced by every word fetched or filled
+	assign
+		fill_beat = (state == S_FILL) & ~near_full_w,
+		tile_beat = (state == S_BURST) ? (wbm_cyc_o & wbm_ack_i) : fill_beat;
+	
+	always @(posedge wbm_clk_i) begin
+		if (rst || state == S_IDLE || state == S_CLEAR) begin
+			screen_word <= 0;
+			screen_line <= 0;
+			map_col <= scroll_x[MAP_COL_BITS+7:8];
+			map_row <= scroll_y[MAP_ROW_BITS+7:8];
+			tile_word <= scroll_x[6:0];
+			tile_line <= scroll_y[7:0];
+			tile_frame_done <= 0;
+		end
+		else if (tile_beat) begin
+			if (line_last) begin
+				screen_word <= 0;
+				screen_line <= screen_line + 1'h1;
+				map_col <= scroll_x[MAP_COL_BITS+7:8];
+				tile_word <= scroll_x[6:0];
+				if (tile_line == tile_height) begin
+					map_row <= map_row + 1'h1;
+					tile_line <= 0;
+				end
+				else begin
+					tile_line <= tile_line + 1'h1;
+				end
+				if (screen_line == v_disp_max)
+					tile_frame_done <= 1;
+			end
+			else if (tile_word == tile_width) begin
+				screen_word <= screen_word + 1'h1;
+				map_col <= map_col + 1'h1;
+				tile_word <= 0;
+			end
+			else begin
+				screen_word <= screen_word + 1'h1;
+				tile_word <= tile_word + 1'h1;
+			end
+		end
+	end
+	
+	// address of the current tile line, pattern base + index * stride + line * words per line + word
+	wire [31:0] pattern_offset;
+	wire [31:2] tile_addr_start;
+	assign
+		pattern_offset = {24'h0, map_index} << tile_stride,
+		tile_addr_start = tile_base + pattern_offset[31:2] + tile_line * (tile_width + 1'h1) + tile_word;
+	
 	always @(*) begin
 		wbm_we_o <= 0;
 		wbm_sel_o <= 4'b1111;
 		wbm_data_o <= 0;
-		wbm_addr_o[31:20] <= vram_base;
+		wbm_addr_o <= tile_en ? tile_addr : {vram_base, vram_addr};
 	end
 	
 	always @(posedge wbm_clk_i) begin
@@ -186,34 +323,65 @@ module wb_vga_graphic (
 		wbm_cti_o <= 0;
 		wbm_bte_o <= 0;
 		if (rst) begin
-			wbm_addr_o[19:2] <= 0;
+			vram_addr <= 0;
+			tile_addr <= 0;
 		end
 		else case (next_state)
 			S_IDLE, S_CLEAR: begin
-				wbm_addr_o[19:2] <= 0;
+				vram_addr <= 0;
 			end
 			S_BURST: begin
 				wbm_cyc_o <= 1;
 				wbm_stb_o <= 1;
 				wbm_cti_o <= 3'b010;  // incrementing burst
 				wbm_bte_o <= 2'b00;  // linear burst
-				if (wbm_cyc_o && wbm_ack_i)
-					wbm_addr_o[19:2] <= wbm_addr_o[19:2] + 1'h1;
+				if (state == S_LOAD)
+					tile_addr <= tile_addr_start;
+				else if (wbm_cyc_o && wbm_ack_i) begin
+					vram_addr <= vram_addr + 1'h1;
+					tile_addr <= tile_addr + 1'h1;
+				end
 			end
 			S_WAIT: begin
-				if (wbm_cyc_o && wbm_ack_i)
-					wbm_addr_o[19:2] <= wbm_addr_o[19:2] + 1'h1;
+				if (wbm_cyc_o && wbm_ack_i) begin
+					vram_addr <= vram_addr + 1'h1;
+					tile_addr <= tile_addr + 1'h1;
+				end
 			end
 		endcase
 	end
 	
 	// pixel
-	assign
-		en_r = h_en_d1 & v_en_d1 & (h_count_d1[1:0] == 2'b11);  // "buf_data_r" is valid without "en_r", thus only uttered when next word is needed
+	reg word_last;
+	reg [3:0] pixel_index;
+	reg [7:0] pixel_data;
+	
+	always @(*) begin
+		word_last = 0;
+		pixel_index = 0;
+		case (depth)
+			0: word_last = (h_count_d1[1:0] == 2'b11);
+			1: begin
+				word_last = (h_count_d1[2:0] == 3'b111);
+				pixel_index = buf_data_r[{h_count_d1[2:0], 2'b0}+:4];
+			end
+			2: begin
+				word_last = (h_count_d1[3:0] == 4'b1111);
+				pixel_index = buf_data_r[{h_count_d1[3:0], 1'b0}+:2];
+			end
+			3: begin
+				word_last = (h_count_d1[4:0] == 5'b11111);
+				pixel_index = buf_data_r[h_count_d1[4:0]];
+			end
+		endcase
+		if (depth == 0)
+			pixel_data = buf_data_r[{h_count_d1[1:0], 3'b0}+:8];
+		else
+			pixel_data = palette[{pixel_index, 3'b0}+:8];
+	end
 	
-	wire [7:0] pixel_data;
 	assign
-		pixel_data = h_count_d1[1] ? (h_count_d1[0] ? buf_data_r[31:24] : buf_data_r[23:16]) : (h_count_d1[0] ? buf_data_r[15:8] : buf_data_r[7:0]);
+		en_r = h_en_d1 & v_en_d1 & word_last;  // "buf_data_r" is valid without "en_r", thus only uttered when next word is needed
 	
 	always @(posedge vga_clk) begin
 		if (rst) begin
@@ -49,6 +49,15 @@ module wb_vga_sword (
 	
 	// control registers
 	reg [31:0] reg_mode = 0, reg_vram_base = 0, reg_cursor_pos = 0, reg_cursor_flash = 0;
+	// graphic mode: pixel depth in mode[9:8], buffer refill threshold, and palette of 16 colors in 4 registers
+	reg [31:0] reg_refill = 0;
+	reg [31:0] reg_palette [0:3];
+	// tile mode: control {enable[31], stride[20:16], height-1[15:8], words per line-1[6:0]}, pattern base,
+	// scroll {tile row[31:24], line[23:16], tile column[15:8], word[7:0]}, fill color, map write {position[26:16], index[7:0]}
+	reg [31:0] reg_tile_ctrl = 0, reg_tile_base = 0, reg_tile_scroll = 0, reg_tile_fill = 0;
+	reg map_we;
+	reg [10:0] map_addr;
+	reg [7:0] map_data;
 	
 	// core
 	wire vga_clk, vga_valid;
@@ -159,12 +168,29 @@ module wb_vga_sword (
 		.rst(rst | ~graphic_en),
 		.vga_clk(vga_clk),
 		.h_count_core(h_count_core),
+		.h_disp_max(h_disp_max),
+		.v_disp_max(v_disp_max),
 		.p_disp_max(p_disp_max),
 		.h_sync_core(h_sync_core),
 		.v_sync_core(v_sync_core),
 		.h_en_core(h_en_core),
 		.v_en_core(v_en_core),
 		.vram_base(reg_vram_base[31:20]),
+		.depth(reg_mode[9:8]),
+		.palette({reg_palette[3], reg_palette[2], reg_palette[1], reg_palette[0]}),
+		.refill_threshold(reg_refill[7:0]),
+		.tile_en(reg_tile_ctrl[31]),
+		.tile_width(reg_tile_ctrl[6:0]),
+		.tile_height(reg_tile_ctrl[15:8]),
+		.tile_stride(reg_tile_ctrl[20:16]),
+		.tile_base(reg_tile_base[31:2]),
+		.tile_fill(reg_tile_fill[7:0]),
+		.scroll_x(reg_tile_scroll[15:0]),
+		.scroll_y(reg_tile_scroll[31:16]),
+		.map_clk(wbs_clk_i),
+		.map_we(map_we),
+		.map_addr(map_addr),
+		.map_data(map_data),
 		.h_sync(h_sync_graphic),
 		.v_sync(v_sync_graphic),
 		.r(r_graphic),
@@ -190,11 +216,21 @@ module wb_vga_sword (
 	always @(posedge wbs_clk_i) begin
 		wbs_data_o <= 0;
 		wbs_ack_o <= 0;
+		map_we <= 0;
 		if (rst) begin
 			reg_mode <= 0;
 			reg_vram_base <= 0;
 			reg_cursor_pos <= 0;
 			reg_cursor_flash <= 0;
+			reg_tile_ctrl <= 0;
+			reg_tile_base <= 0;
+			reg_tile_scroll <= 0;
+			reg_tile_fill <= 0;
+			reg_refill <= 0;
+			reg_palette[0] <= 0;
+			reg_palette[1] <= 0;
+			reg_palette[2] <= 0;
+			reg_palette[3] <= 0;
 			wbs_data_o <= 0;
 			wbs_ack_o <= 0;
 		end
@@ -252,6 +288,86 @@ module wb_vga_sword (
 							reg_cursor_flash[7:0] <= wbs_data_i[7:0];
 					end
 				end
+				4: begin
+					wbs_data_o <= reg_tile_ctrl;
+					if (wbs_we_i) begin
+						if (wbs_sel_i[3])
+							reg_tile_ctrl[31:24] <= wbs_data_i[31:24];
+						if (wbs_sel_i[2])
+							reg_tile_ctrl[23:16] <= wbs_data_i[23:16];
+						if (wbs_sel_i[1])
+							reg_tile_ctrl[15:8] <= wbs_data_i[15:8];
+						if (wbs_sel_i[0])
+							reg_tile_ctrl[7:0] <= wbs_data_i[7:0];
+					end
+				end
+				5: begin
+					wbs_data_o <= reg_tile_base;
+					if (wbs_we_i) begin
+						if (wbs_sel_i[3])
+							reg_tile_base[31:24] <= wbs_data_i[31:24];
+						if (wbs_sel_i[2])
+							reg_tile_base[23:16] <= wbs_data_i[23:16];
+						if (wbs_sel_i[1])
+							reg_tile_base[15:8] <= wbs_data_i[15:8];
+						if (wbs_sel_i[0])
+							reg_tile_base[7:0] <= wbs_data_i[7:0];
+					end
+				end
+				6: begin
+					wbs_data_o <= reg_tile_scroll;
+					if (wbs_we_i) begin
+						if (wbs_sel_i[3])
+							reg_tile_scroll[31:24] <= wbs_data_i[31:24];
+						if (wbs_sel_i[2])
+							reg_tile_scroll[23:16] <= wbs_data_i[23:16];
+						if (wbs_sel_i[1])
+							reg_tile_scroll[15:8] <= wbs_data_i[15:8];
+						if (wbs_sel_i[0])
+							reg_tile_scroll[7:0] <= wbs_data_i[7:0];
+					end
+				end
+				7: begin
+					wbs_data_o <= reg_tile_fill;
+					if (wbs_we_i) begin
+						if (wbs_sel_i[3])
+							reg_tile_fill[31:24] <= wbs_data_i[31:24];
+						if (wbs_sel_i[2])
+							reg_tile_fill[23:16] <= wbs_data_i[23:16];
+						if (wbs_sel_i[1])
+							reg_tile_fill[15:8] <= wbs_data_i[15:8];
+						if (wbs_sel_i[0])
+							reg_tile_fill[7:0] <= wbs_data_i[7:0];
+					end
+				end
+				8: begin
+					wbs_data_o <= 0;
+					if (wbs_we_i) begin
+						map_we <= 1;
+						map_addr <= wbs_data_i[26:16];
+						map_data <= wbs_data_i[7:0];
+					end
+				end
+				9: begin
+					wbs_data_o <= reg_refill;
+					if (wbs_we_i) begin
+						if (wbs_sel_i[0])
+							reg_refill[7:0] <= wbs_data_i[7:0];
+					end
+				end
+				12, 13, 14, 15: begin
+					wbs_data_o <= reg_palette[wbs_addr_i[3:2]];
+					if (wbs_we_i) begin
+						if (wbs_sel_i[3])
+							reg_palette[wbs_addr_i[3:2]][31:24] <= wbs_data_i[31:24];
+						if (wbs_sel_i[2])
+							reg_palette[wbs_addr_i[3:2]][23:16] <= wbs_data_i[23:16];
+						if (wbs_sel_i[1])
+							reg_palette[wbs_addr_i[3:2]][15:8] <= wbs_data_i[15:8];
+						if (wbs_sel_i[0])
+							reg_palette[wbs_addr_i[3:2]][7:0] <= wbs_data_i[7:0];
+					end
+				end
 				default: begin
 					wbs_data_o <= 0;
 				end
@@ -40,6 +40,13 @@ module wb_memory_nexys3 (
 	output wire [31:0] pcm_data_o,
 	output wire pcm_ack_o,
 	output wire pcm_err_o,
+	input wire pcm_ctrl_cs_i,  // PCM control register in I/O space, see wb_ppcm_nexys3
+	input wire [DEV_ADDR_BITS-1:2] pcm_ctrl_addr_i,
+	input wire [3:0] pcm_ctrl_sel_i,
+	input wire [31:0] pcm_ctrl_data_i,
+	input wire pcm_ctrl_we_i,
+	output wire [31:0] pcm_ctrl_data_o,
+	output wire pcm_ctrl_ack_o,
 	// memory interfaces
 	output wire ram_ce_n,
 	output wire ram_clk,
@@ -58,6 +65,8 @@ module wb_memory_nexys3 (
 	
 	parameter
 		CLK_FREQ = 100;  // main clock frequency in MHz
+	parameter
+		DEV_ADDR_BITS = 8;  // address length of I/O space
 	parameter
 		ADDR_BITS = 24,  // address length
 		RAM_HIGH_ADDR = 8'h00,  // high address value, as the address length of wishbone is larger than RAM
@@ -65,7 +74,8 @@ module wb_memory_nexys3 (
 		BUF_ADDR_BITS = 4;  // address length for buffer
 	
 	// RAM
-	wire ram_busy;
+	wire ram_busy, ram_suspended;
+	wire ram_suspend_end;
 	reg ram_en;
 	wire ram_oe_n, ram_we_n;
 	wire [ADDR_BITS-1:1] ram_addr;
@@ -80,6 +90,8 @@ module wb_memory_nexys3 (
 		.clk(clk),
 		.rst(rst),
 		.ram_busy(ram_busy),
+		.ram_suspended(ram_suspended),
+		.ram_suspend_end(ram_suspend_end),
 		.ram_clk(ram_clk),
 		.ram_ce_n(ram_ce_n),
 		.ram_oe_n(ram_oe_n),
@@ -117,7 +129,8 @@ module wb_memory_nexys3 (
 		.CLK_FREQ(CLK_FREQ),
 		.ADDR_BITS(ADDR_BITS),
 		.HIGH_ADDR(PCM_HIGH_ADDR),
-		.BUF_ADDR_BITS(BUF_ADDR_BITS)
+		.BUF_ADDR_BITS(BUF_ADDR_BITS),
+		.DEV_ADDR_BITS(DEV_ADDR_BITS)
 		) WB_PPCM (
 		.clk(clk),
 		.rst(rst),
@@ -140,7 +153,14 @@ module wb_memory_nexys3 (
 		.wbs_data_i(pcm_data_i),
 		.wbs_data_o(pcm_data_o),
 		.wbs_ack_o(pcm_ack_o),
-		.wbs_err_o(pcm_err_o)
+		.wbs_err_o(pcm_err_o),
+		.ctrl_cs_i(pcm_ctrl_cs_i),
+		.ctrl_addr_i(pcm_ctrl_addr_i),
+		.ctrl_sel_i(pcm_ctrl_sel_i),
+		.ctrl_data_i(pcm_ctrl_data_i),
+		.ctrl_we_i(pcm_ctrl_we_i),
+		.ctrl_data_o(pcm_ctrl_data_o),
+		.ctrl_ack_o(pcm_ctrl_ack_o)
 		);
 	
 	// control
@@ -156,12 +176,15 @@ module wb_memory_nexys3 (
 			next = 0;
 	end
 	
+	assign
+		ram_suspend_end = next;
+	
 	always @(posedge ram_clk_i) begin
 		if (rst) begin
 			curr <= 0;
 			working <= 0;
 		end
-		else if (~ram_busy && ~pcm_busy) begin
+		else if (~ram_busy && ~ram_suspended && ~pcm_busy) begin  // PSRAM keeps being selected in suspended burst, which is ended once PCM is wanted
 			curr <= next;
 			working <= ram_cyc_i | pcm_cyc_i;
 		end
@@ -68,6 +68,29 @@ module bit_searcher_4 (
 endmodule
 
 
+module bit_searcher_8 (
+	input wire [7:0] bits,
+	input wire target,
+	input wire direction,
+	output wire hit,
+	output wire [2:0] index
+	);
+	
+	wire [1:0] hit_inner;
+	wire [1:0] index_inner [1:0];
+	wire index_upper;
+	
+	bit_searcher_4
+		BS0 (.bits(bits[3:0]), .target(target), .direction(direction), .hit(hit_inner[0]), .index(index_inner[0])),
+		BS1 (.bits(bits[7:4]), .target(target), .direction(direction), .hit(hit_inner[1]), .index(index_inner[1]));
+	bit_searcher_2
+		BS4 (.bits(hit_inner[1:0]), .target(1'b1), .direction(direction), .hit(hit), .index(index_upper));
+	
+	assign index = {index_upper, index_inner[index_upper]};
+	
+endmodule
+
+
 module bit_searcher_16 (
 	input wire [15:0] bits,
 	input wire target,
@@ -184,6 +207,7 @@ module bit_searcher (
 		case (N)
 			2: bit_searcher_2 BS_2 (.bits(bits), .target(target), .direction(direction), .hit(hit), .index(index));
 			4: bit_searcher_4 BS_4 (.bits(bits), .target(target), .direction(direction), .hit(hit), .index(index));
+			8: bit_searcher_8 BS_8 (.bits(bits), .target(target), .direction(direction), .hit(hit), .index(index));
 			16: bit_searcher_16 BS_16 (.bits(bits), .target(target), .direction(direction), .hit(hit), .index(index));
 			32: bit_searcher_32 BS_32 (.bits(bits), .target(target), .direction(direction), .hit(hit), .index(index));
 			64: bit_searcher_64 BS_64 (.bits(bits), .target(target), .direction(direction), .hit(hit), .index(index));
@@ -0,0 +1,716 @@
+#include "iss_cpu.h"
+#include "iss_soc.h"
+#include <string.h>
+
+
+void iss_tlb::flush() {
+	memset(valid, 0, sizeof(valid));
+	replace = 0;
+}
+
+bool iss_tlb::lookup(uint32_t page_i, uint32_t &data_o) const {
+	for (int i=0; i<TLB_LINE_NUM; i++) {
+		bool large = (data[i] & PDE_LARGE) != 0;
+		if (valid[i] && (large ? (page[i] >> 10) == (page_i >> 10) : page[i] == page_i)) {
+			data_o = data[i];
+			return true;
+		}
+	}
+	return false;
+}
+
+void iss_tlb::insert(uint32_t page_i, uint32_t data_i) {
+	valid[replace] = true;
+	page[replace] = page_i;
+	data[replace] = data_i;
+	replace = (replace + 1) % TLB_LINE_NUM;
+}
+
+
+void iss_cache::flush() {
+	memset(valid, 0, sizeof(valid));
+	memset(dirty, 0, sizeof(dirty));
+}
+
+uint32_t iss_cache::access(iss_soc *soc, uint32_t addr, bool write) {
+	uint32_t index = (addr / CACHE_LINE_BYTES) % CACHE_LINE_NUM;
+	uint32_t tag_i = addr / (CACHE_LINE_BYTES * CACHE_LINE_NUM);
+	if (valid[index] && tag[index] == tag_i) {
+		dirty[index] |= write;
+		return 0;
+	}
+	uint32_t cycles = soc->line_latency(addr, CACHE_LINE_BYTES / 4);
+	if (valid[index] && dirty[index])
+		cycles += soc->line_latency((tag[index] * CACHE_LINE_NUM + index) * CACHE_LINE_BYTES, CACHE_LINE_BYTES / 4);
+	valid[index] = true;
+	dirty[index] = write;
+	tag[index] = tag_i;
+	miss_count++;
+	return cycles;
+}
+
+uint32_t iss_cache::invalidate(iss_soc *soc) {
+	uint32_t cycles = 0;
+	for (int i=0; i<CACHE_LINE_NUM; i++) {
+		if (valid[i] && dirty[i])
+			cycles += soc->line_latency((tag[i] * CACHE_LINE_NUM + i) * CACHE_LINE_BYTES, CACHE_LINE_BYTES / 4);
+	}
+	flush();
+	return cycles;
+}
+
+
+void iss_icache::flush() {
+	memset(valid, 0, sizeof(valid));
+	buf_valid = false;
+}
+
+bool iss_icache::cached(uint32_t line) const {
+	return valid[line % CACHE_LINE_NUM] && tag[line % CACHE_LINE_NUM] == line / CACHE_LINE_NUM;
+}
+
+uint32_t iss_icache::access(iss_soc *soc, uint32_t addr, uint64_t now) {
+	uint32_t line = addr / (line_words * 4);
+	uint32_t word = (addr / 4) % line_words;
+	uint32_t stall = 0;
+	if (!cached(line)) {
+		if (buf_valid && buf_line == line) {
+			uint64_t ready = buf_first + word * LATENCY_BURST;
+			if (ready > now)
+				stall = ready - now;
+			prefetch_hit_count++;
+		}
+		else {
+			// the prefetch burst in flight goes first, and one clock more to prepare the new request
+			if (buf_end > now)
+				stall = buf_end - now + 1;
+			stall += soc->line_latency(addr, line_words);
+			miss_count++;
+		}
+		valid[line % CACHE_LINE_NUM] = true;
+		tag[line % CACHE_LINE_NUM] = line / CACHE_LINE_NUM;
+		if (buf_line == line)
+			buf_valid = false;
+	}
+	uint32_t next = line + 1;
+	if (prefetch && word >= line_words - prefetch_ahead && (next * line_words * 4) % PAGE_BYTES != 0
+		&& !cached(next) && !(buf_valid && buf_line == next)) {
+		buf_valid = true;
+		buf_line = next;
+		buf_end = now + stall + soc->line_latency(next * line_words * 4, line_words);
+		buf_first = buf_end - LATENCY_BURST * (line_words - 1);
+		prefetch_count++;
+	}
+	return stall;
+}
+
+
+iss_cpu::iss_cpu(iss_soc *soc) : soc(soc) {
+	cycles = 0;
+	lockstep = false;
+	inst_count = 0;
+	sleep_count = 0;
+	exception_count = 0;
+	interrupt_count = 0;
+	fetch_stall_count = 0;
+	fetch_cached = false;
+	dual_issue = false;
+	pair_count = 0;
+	itlb.miss_count = 0;
+	dtlb.miss_count = 0;
+	icache.line_words = IC_LINE_WORDS;
+	icache.prefetch = true;
+	icache.prefetch_ahead = 1;
+	icache.buf_end = 0;
+	icache.miss_count = 0;
+	icache.prefetch_count = 0;
+	icache.prefetch_hit_count = 0;
+	dcache.miss_count = 0;
+	reset();
+}
+
+void iss_cpu::reset() {
+	memset(regs, 0, sizeof(regs));
+	memset(cp0, 0, sizeof(cp0));
+	memset(ir_service_id, 0, sizeof(ir_service_id));
+	memset(&last, 0, sizeof(last));
+	cp0[CP0_EHBR] = PC_RESET;
+	pc = PC_RESET;
+	npc = pc + 4;
+	delay_slot = false;
+	branch_pc = 0;
+	load_reg = 0;
+	fetch_wide = false;
+	pair_ready = false;
+	link_valid = false;
+	link_line = 0;
+	sleeping = false;
+	ccr_base = cycles;
+	tir_next = 0;
+	itlb.flush();
+	dtlb.flush();
+	icache.flush();
+	dcache.flush();
+}
+
+uint32_t iss_cpu::read_cp0(int addr) const {
+	switch (addr) {
+		case CP0_CCRL: return (uint32_t)(cycles - ccr_base);
+		case CP0_CCRH: return (uint32_t)((cycles - ccr_base) >> 32);
+	}
+	return addr < CP0_NUM ? cp0[addr] : 0;
+}
+
+void iss_cpu::write_cp0(int addr, uint32_t data) {
+	switch (addr) {
+		case CP0_EPCR:
+		case CP0_EHBR:
+		case CP0_IER:
+		case CP0_WDR:
+		case CP0_IPR0:
+		case CP0_SCR:
+			cp0[addr] = data;
+			break;
+		case CP0_ICR:
+			cp0[CP0_ICR] &= ~data;
+			break;
+		case CP0_PDBR:
+			cp0[CP0_PDBR] = data;
+			itlb.flush();
+			dtlb.flush();
+			break;
+		case CP0_TIR:
+			cp0[CP0_TIR] = data;
+			tir_next = cycles + (uint64_t)(data + 1) * soc->cpu_freq * 1000;
+			break;
+		case CP0_IVBR:
+			cp0[CP0_IVBR] = data & 0xFFFFFF01;
+			break;
+		case CP0_IIDR:
+			ir_service_id[(data >> 8) & 3] = data & 0x1F;
+			update_iidr(((data >> 16) & 0xF) | ((data >> 31) << ((data >> 8) & 3)));
+			break;
+		case CP0_IPR1:
+			cp0[CP0_IPR1] = data & 0x3FFFFFFF;
+			break;
+	}
+}
+
+uint64_t iss_cpu::next_event() const {
+	return cp0[CP0_TIR] ? tir_next : UINT64_MAX;
+}
+
+void iss_cpu::sleep_until(uint64_t cycle) {
+	if (!sleeping || cycle <= cycles)
+		return;
+	cp0[CP0_SCR] += cycle - cycles;
+	sleep_count += cycle - cycles;
+	cycles = cycle;
+}
+
+// higher level wins and lower ID wins when levels are equal, the global enable bit is not checked here
+bool iss_cpu::find_interrupt(int &id, int &level) const {
+	uint32_t pending = cp0[CP0_IER] & cp0[CP0_ICR] & 0x7FFFFFFF;
+	uint64_t levels = ((uint64_t)cp0[CP0_IPR1] << 32) | cp0[CP0_IPR0];
+	bool found = false;
+	for (int i=30; i>=0; i--) {
+		if (!((pending >> i) & 1))
+			continue;
+		int l = (levels >> (i * 2)) & 3;
+		if (!found || l >= level) {
+			found = true;
+			id = i;
+			level = l;
+		}
+	}
+	return found;
+}
+
+void iss_cpu::enter(uint32_t target, uint32_t epc) {
+	cp0[CP0_EPCR] = (epc & ~3) | (cp0[CP0_SR] & 1);
+	cp0[CP0_SR] &= ~1;
+	cp0[CP0_IER] &= ~0x80000000;
+	pc = target & ~3;
+	npc = pc + 4;
+	delay_slot = false;
+	load_reg = 0;
+	link_valid = false;
+	cycles += PENALTY_FLUSH;
+}
+
+// EPC points to the jump when an instruction in delay slot fails, so that the jump is executed again
+void iss_cpu::exception(int code, uint32_t ear) {
+	cp0[CP0_SR] = (cp0[CP0_SR] & ~0xF000F800) | 0x80000000 | (code << 11);
+	cp0[CP0_EAR] = ear;
+	enter(cp0[CP0_EHBR], delay_slot ? branch_pc : pc);
+	exception_count++;
+}
+
+// IIDR shows the highest level in service and its ID, and keeps the others for nested interrupts
+void iss_cpu::update_iidr(uint32_t service) {
+	int level = 0;
+	for (int i=0; i<4; i++)
+		if (service & (1 << i))
+			level = i;
+	cp0[CP0_IIDR] = (service ? 0x80000000 : 0) | (service << 16) | (level << 8) | ir_service_id[level];
+}
+
+void iss_cpu::take_interrupt(int id, int level) {
+	cp0[CP0_SR] = (cp0[CP0_SR] & ~0xF0000000) | 0x40000000;
+	ir_service_id[level] = id;
+	update_iidr(((cp0[CP0_IIDR] >> 16) & 0xF) | (1 << level));
+	uint32_t target = (cp0[CP0_IVBR] & 1) ? ((cp0[CP0_IVBR] & 0xFFFFFF00) | (id << 3)) : cp0[CP0_EHBR];
+	enter(target, delay_slot ? branch_pc : pc);
+	sleeping = false;
+	interrupt_count++;
+}
+
+uint32_t iss_cpu::page_walk(uint32_t addr) {
+	uint32_t pde = 0, pte = 0, latency = 0;
+	soc->read((cp0[CP0_PDBR] & 0xFFFFF000) | ((addr >> 22) << 2), 4, pde, latency);
+	cycles += latency;
+	if (!(pde & 1))
+		return pde & 0xFFFFF01F;  // not present, the fault is cached in TLB as the RTL does
+	if (pde & PDE_LARGE)
+		return (pde & 0xFFC00000) | PDE_LARGE | (pde & 0x1F);  // 4MB page, the walk ends here
+	soc->read((pde & 0xFFFFF000) | (((addr >> 12) & 0x3FF) << 2), 4, pte, latency);
+	cycles += latency;
+	return (pte & 0xFFFFF000) | (pte & pde & 0x1F);
+}
+
+int iss_cpu::translate(uint32_t addr, iss_tlb &tlb, bool exec, bool write, uint32_t &physical, bool &cached) {
+	if (!(cp0[CP0_PDBR] & 1)) {
+		physical = addr;
+		cached = false;
+		return EX_NONE;
+	}
+	uint32_t data;
+	if (!tlb.lookup(addr >> 12, data)) {
+		data = page_walk(addr);
+		tlb.insert(addr >> 12, data);
+		tlb.miss_count++;
+	}
+	if (!(data & 1))
+		return EX_PAGE_FAULT;
+	if ((cp0[CP0_SR] & 1) && !(data & 2))
+		return EX_UNAUTH_USER;
+	if (exec && !(data & 8))
+		return EX_UNAUTH_EXEC;
+	if (write && !(data & 4))
+		return EX_UNAUTH_WRITE;
+	if (data & PDE_LARGE)
+		physical = (data & 0xFFC00000) | (addr & 0x3FFFFF);
+	else
+		physical = (data & 0xFFFFF000) | (addr & 0xFFF);
+	cached = (data & 0x10) != 0;
+	return EX_NONE;
+}
+
+int iss_cpu::fetch(uint32_t addr, uint32_t &inst) {
+	if (addr & 3)
+		return EX_INST_UNALIGN;
+	uint32_t physical, latency;
+	bool cached;
+	int ex = translate(addr, itlb, true, false, physical, cached);
+	if (ex != EX_NONE)
+		return ex;
+	if (!soc->read(physical, 4, inst, latency))
+		return EX_INST_BUS_ERR;
+	if (fetch_cached && !(cp0[CP0_PDBR] & 1) && iss_soc::is_memory(physical))
+		cached = true;
+	uint32_t stall = (cached && !iss_soc::is_spm(physical)) ? icache.access(soc, physical, cycles) : latency;
+	fetch_wide = cached || iss_soc::is_spm(physical);
+	cycles += stall;
+	fetch_stall_count += stall;
+	return EX_NONE;
+}
+
+int iss_cpu::load(uint32_t addr, int size, bool ext, uint32_t &data) {
+	if (addr & (size - 1))
+		return EX_MEM_UNALIGN;
+	uint32_t physical, latency;
+	bool cached;
+	int ex = translate(addr, dtlb, false, false, physical, cached);
+	if (ex != EX_NONE)
+		return ex;
+	if (!soc->read(physical, size, data, latency))
+		return EX_MEM_BUS_ERR;
+	cycles += (cached && !iss_soc::is_spm(physical)) ? dcache.access(soc, physical, false) : latency;
+	if (ext && size == 1)
+		data = (int8_t)data;
+	else if (ext && size == 2)
+		data = (int16_t)data;
+	if (iss_soc::is_device(physical))
+		last.external = true;
+	return EX_NONE;
+}
+
+int iss_cpu::store(uint32_t addr, int size, uint32_t data) {
+	if (addr & (size - 1))
+		return EX_MEM_UNALIGN;
+	uint32_t physical, latency;
+	bool cached;
+	int ex = translate(addr, dtlb, false, true, physical, cached);
+	if (ex != EX_NONE)
+		return ex;
+	if (!soc->write(physical, size, data, latency))
+		return EX_MEM_BUS_ERR;
+	cycles += (cached && !iss_soc::is_spm(physical)) ? dcache.access(soc, physical, true) : latency;
+	return EX_NONE;
+}
+
+// is_simple of controller.v, ALU instructions writing a register, without MOVZ, MOVN and the ones trapping on overflow
+static bool is_simple(uint32_t op, uint32_t func) {
+	if (op == 0x00) {
+		switch (func) {
+			case 0x00: case 0x02: case 0x03: case 0x04: case 0x06: case 0x07:  // shifts and rotates
+			case 0x21: case 0x23: case 0x24: case 0x25: case 0x26: case 0x27: case 0x2A: case 0x2B:
+				return true;
+			default:
+				return false;
+		}
+	}
+	return op >= 0x09 && op <= 0x0F;  // ADDIU to LUI
+}
+
+step_result iss_cpu::step() {
+	uint64_t start = cycles;
+	last.pc = pc;
+	last.inst = 0;
+	last.wen = false;
+	last.mem_wen = false;
+	last.external = false;
+	last.cycles = 0;
+	last.paired = false;
+	bool pair_first = pair_ready;  // broken by interrupts and exceptions
+	pair_ready = false;
+
+	// interrupt sources
+	if (cp0[CP0_TIR] && cycles >= tir_next) {
+		uint64_t period = (uint64_t)(cp0[CP0_TIR] + 1) * soc->cpu_freq * 1000;
+		while (tir_next <= cycles)
+			tir_next += period;
+		cp0[CP0_ICR] |= 1;
+	}
+	cp0[CP0_ICR] |= soc->irq & 0x7FFFFFFE;
+	soc->irq = 0;
+	int ir_id = 0, ir_level = 0;
+	bool ir_found = find_interrupt(ir_id, ir_level);
+	if (sleeping) {
+		if (!ir_found)
+			return STEP_SLEEP;
+		sleeping = false;
+		cycles++;
+	}
+	else if (!lockstep && ir_found && (cp0[CP0_IER] >> 31)) {
+		uint32_t iidr = cp0[CP0_IIDR];
+		if (!(iidr >> 31) || ir_level > (int)((iidr >> 8) & 3)) {
+			take_interrupt(ir_id, ir_level);
+			last.cycles = cycles - start;
+			return STEP_EXCEPTION;
+		}
+	}
+
+	// fetch
+	uint32_t inst;
+	cycles++;
+	uint64_t fetch_start = cycles;
+	int ex = fetch(pc, inst);
+	if (ex != EX_NONE) {
+		exception(ex, pc);
+		last.cycles = cycles - start;
+		return STEP_EXCEPTION;
+	}
+	last.inst = inst;
+
+	// decode and execute
+	uint32_t op = inst >> 26;
+	uint32_t rs = (inst >> 21) & 0x1F;
+	uint32_t rt = (inst >> 16) & 0x1F;
+	uint32_t rd = (inst >> 11) & 0x1F;
+	uint32_t sa = (inst >> 6) & 0x1F;
+	uint32_t func = inst & 0x3F;
+	uint32_t vs = regs[rs];
+	uint32_t vt = regs[rt];
+	uint32_t imm = (int16_t)inst;
+	uint32_t uimm = inst & 0xFFFF;
+	bool user = cp0[CP0_SR] & 1;
+	int wreg = 0;
+	uint32_t wval = 0;
+	bool jump = false, taken = false;
+	uint32_t target = 0;
+	bool rs_used = false, rt_used = false;
+	bool privilege = false;
+	uint8_t new_load = 0;
+	uint32_t ear = pc;
+	int32_t sum;
+	switch (op) {
+		case 0x00:  // R
+			rs_used = true;
+			rt_used = true;
+			switch (func) {
+				case 0x00: wreg = rd; wval = vt << sa; break;  // SLL
+				case 0x02:  // SRL, ROTR
+					wreg = rd;
+					wval = (inst & (1 << 21)) ? ((vt >> sa) | (vt << ((32 - sa) & 31))) : (vt >> sa);
+					break;
+				case 0x03: wreg = rd; wval = (int32_t)vt >> sa; break;  // SRA
+				case 0x04: wreg = rd; wval = vt << (vs & 31); break;  // SLLV
+				case 0x06:  // SRLV, ROTRV
+					wreg = rd;
+					wval = (inst & (1 << 6)) ? ((vt >> (vs & 31)) | (vt << ((32 - vs) & 31))) : (vt >> (vs & 31));
+					break;
+				case 0x07: wreg = rd; wval = (int32_t)vt >> (vs & 31); break;  // SRAV
+				case 0x08: jump = true; taken = true; target = vs; break;  // JR
+				case 0x09: jump = true; taken = true; target = vs; wreg = 31; wval = pc + 8; break;  // JALR, always links to $31
+				case 0x0A: if (vt == 0) { wreg = rd; wval = vs; } break;  // MOVZ
+				case 0x0B: if (vt != 0) { wreg = rd; wval = vs; } break;  // MOVN
+				case 0x0C:  // SYSCALL
+					cp0[CP0_SR] = (cp0[CP0_SR] & ~0xF00007FE) | 0x20000000 | (((inst >> 6) & 0x3FF) << 1);
+					enter(cp0[CP0_EHBR], pc + 4);
+					exception_count++;
+					last.cycles = cycles - start;
+					return STEP_EXCEPTION;
+				case 0x20:  // ADD
+					if (__builtin_add_overflow((int32_t)vs, (int32_t)vt, &sum))
+						ex = EX_MATH_OVERFLOW;
+					wreg = rd;
+					wval = sum;
+					break;
+				case 0x21: wreg = rd; wval = vs + vt; break;  // ADDU
+				case 0x22:  // SUB
+					if (__builtin_sub_overflow((int32_t)vs, (int32_t)vt, &sum))
+						ex = EX_MATH_OVERFLOW;
+					wreg = rd;
+					wval = sum;
+					break;
+				case 0x23: wreg = rd; wval = vs - vt; break;  // SUBU
+				case 0x24: wreg = rd; wval = vs & vt; break;  // AND
+				case 0x25: wreg = rd; wval = vs | vt; break;  // OR
+				case 0x26: wreg = rd; wval = vs ^ vt; break;  // XOR
+				case 0x27: wreg = rd; wval = ~(vs | vt); break;  // NOR
+				case 0x2A: wreg = rd; wval = (int32_t)vs < (int32_t)vt; break;  // SLT
+				case 0x2B: wreg = rd; wval = vs < vt; break;  // SLTU
+				default: ex = EX_INST_UNRECOGNIZE; break;
+			}
+			break;
+		case 0x01:  // I, branch with optional link, link only when taken
+			rs_used = true;
+			jump = true;
+			target = pc + 4 + (imm << 2);
+			switch (rt) {
+				case 0x00: taken = (int32_t)vs < 0; break;  // BLTZ
+				case 0x01: taken = (int32_t)vs >= 0; break;  // BGEZ
+				case 0x10: taken = (int32_t)vs < 0; if (taken) { wreg = 31; wval = pc + 8; } break;  // BLTZAL
+				case 0x11: taken = (int32_t)vs >= 0; if (taken) { wreg = 31; wval = pc + 8; } break;  // BGEZAL
+				default: jump = false; ex = EX_INST_UNRECOGNIZE; break;
+			}
+			break;
+		case 0x02:  // J
+			jump = true;
+			taken = true;
+			target = (pc & 0xF0000000) | ((inst & 0x03FFFFFF) << 2);
+			break;
+		case 0x03:  // JAL
+			jump = true;
+			taken = true;
+			target = (pc & 0xF0000000) | ((inst & 0x03FFFFFF) << 2);
+			wreg = 31;
+			wval = pc + 8;
+			break;
+		case 0x04:  // BEQ
+		case 0x05:  // BNE
+		case 0x06:  // BLEZ
+		case 0x07:  // BGTZ
+			rs_used = true;
+			rt_used = op < 0x06;
+			jump = true;
+			target = pc + 4 + (imm << 2);
+			switch (op) {
+				case 0x04: taken = vs == vt; break;
+				case 0x05: taken = vs != vt; break;
+				case 0x06: taken = (int32_t)vs <= 0; break;
+				default: taken = (int32_t)vs > 0; break;
+			}
+			break;
+		case 0x08:  // ADDI
+			rs_used = true;
+			if (__builtin_add_overflow((int32_t)vs, (int32_t)imm, &sum))
+				ex = EX_MATH_OVERFLOW;
+			wreg = rt;
+			wval = sum;
+			break;
+		case 0x09: rs_used = true; wreg = rt; wval = vs + imm; break;  // ADDIU
+		case 0x0A: rs_used = true; wreg = rt; wval = (int32_t)vs < (int32_t)imm; break;  // SLTI
+		case 0x0B: rs_used = true; wreg = rt; wval = vs < imm; break;  // SLTIU, sign extended and compared as unsigned
+		case 0x0C: rs_used = true; wreg = rt; wval = vs & uimm; break;  // ANDI
+		case 0x0D: rs_used = true; wreg = rt; wval = vs | uimm; break;  // ORI
+		case 0x0E: rs_used = true; wreg = rt; wval = vs ^ uimm; break;  // XORI
+		case 0x0F: wreg = rt; wval = uimm << 16; break;  // LUI
+		case 0x10:  // CP0
+			if (user) {
+				ex = EX_INST_ILLEGAL;
+				break;
+			}
+			privilege = true;
+			if (!(inst & (1 << 25))) {
+				switch (rs) {
+					case 0x00:  // MFC0
+						wreg = rt;
+						wval = read_cp0(rd);
+						last.external = (rd == CP0_ICR || rd == CP0_CCRL || rd == CP0_CCRH || rd == CP0_SCR);
+						break;
+					case 0x04:  // MTC0
+						rt_used = true;
+						write_cp0(rd, vt);
+						break;
+					default:
+						ex = EX_INST_UNRECOGNIZE;
+						break;
+				}
+			}
+			else if (func == 0x18) {  // ERET
+				cp0[CP0_SR] = (cp0[CP0_SR] & ~0xF0000001) | (cp0[CP0_EPCR] & 1);
+				cp0[CP0_IER] |= 0x80000000;
+				update_iidr(((cp0[CP0_IIDR] >> 16) & 0xF) & ~(1 << ((cp0[CP0_IIDR] >> 8) & 3)));  // the innermost one ends first
+				pc = cp0[CP0_EPCR] & ~3;
+				npc = pc + 4;
+				delay_slot = false;
+				load_reg = 0;
+				link_valid = false;
+				cycles += PENALTY_PRIVILEGE + PENALTY_FLUSH;
+				last.cycles = cycles - start;
+				return STEP_EXCEPTION;
+			}
+			else if (func == 0x20) {  // WAIT, halt until any interrupt enabled in IER is pending
+				if (!lockstep && !find_interrupt(ir_id, ir_level))
+					sleeping = true;
+			}
+			else {
+				ex = EX_INST_UNRECOGNIZE;
+			}
+			break;
+		case 0x20:  // LB
+		case 0x21:  // LH
+		case 0x23:  // LW
+		case 0x24:  // LBU
+		case 0x25:  // LHU
+			rs_used = true;
+			ex = load(vs + imm, (op & 3) == 3 ? 4 : (op & 1) + 1, !(op & 4), wval);
+			if (ex != EX_NONE)
+				ear = vs + imm;
+			wreg = rt;
+			new_load = rt;
+			break;
+		case 0x28:  // SB
+		case 0x29:  // SH
+		case 0x2B:  // SW
+			rs_used = true;
+			rt_used = true;
+			ex = store(vs + imm, (op & 3) == 3 ? 4 : (op & 1) + 1, vt);
+			if (ex != EX_NONE) {
+				ear = vs + imm;
+			}
+			else {
+				last.mem_wen = true;
+				last.mem_addr = vs + imm;
+				last.mem_data = vt;
+				if (((vs + imm) / CACHE_LINE_BYTES) == link_line)
+					link_valid = false;
+			}
+			break;
+		case 0x30:  // LL
+			rs_used = true;
+			ex = load(vs + imm, 4, false, wval);
+			if (ex != EX_NONE) {
+				ear = vs + imm;
+			}
+			else {
+				link_valid = true;
+				link_line = (vs + imm) / CACHE_LINE_BYTES;
+			}
+			wreg = rt;
+			new_load = rt;
+			break;
+		case 0x38:  // SC, fails without storing when the link is broken, but still checked by MMU as the RTL does
+			rs_used = true;
+			rt_used = true;
+			if (link_valid && ((vs + imm) / CACHE_LINE_BYTES) == link_line) {
+				ex = store(vs + imm, 4, vt);
+				if (ex == EX_NONE) {
+					last.mem_wen = true;
+					last.mem_addr = vs + imm;
+					last.mem_data = vt;
+				}
+				wval = 1;
+			}
+			else {
+				uint32_t physical;
+				bool cached;
+				ex = ((vs + imm) & 3) ? EX_MEM_UNALIGN : translate(vs + imm, dtlb, false, true, physical, cached);
+				wval = 0;
+			}
+			if (ex != EX_NONE)
+				ear = vs + imm;
+			wreg = rt;
+			new_load = rt;  // the result comes from CMU as loaded data
+			break;
+		case 0x2F:  // CACHE, invalidate both caches
+			if (user) {
+				ex = EX_INST_ILLEGAL;
+				break;
+			}
+			privilege = true;
+			icache.flush();
+			cycles += dcache.invalidate(soc);
+			break;
+		default:
+			ex = EX_INST_UNRECOGNIZE;
+			break;
+	}
+	if (ex != EX_NONE) {
+		last.external = false;
+		exception(ex, ear);
+		last.cycles = cycles - start;
+		return STEP_EXCEPTION;
+	}
+
+	// write back and move to next instruction
+	bool load_use = load_reg && ((rs_used && rs == load_reg) || (rt_used && rt == load_reg));
+	if (load_use)
+		cycles += PENALTY_LOAD_USE;
+	if (pair_first && cycles == fetch_start && is_simple(op, func)) {
+		// the second one of pair, unless it depends on the first one or on the load before it
+		bool depend = pair_wreg && ((rs_used && rs == pair_wreg) || (rt_used && rt == pair_wreg) || wreg == pair_wreg);
+		depend |= pair_load && ((rs_used && rs == pair_load) || (rt_used && rt == pair_load));
+		if (!depend) {
+			cycles--;
+			pair_count++;
+			last.paired = true;
+		}
+	}
+	else if (dual_issue && fetch_wide && !(pc & 7) && !jump && op != 0x10 && op != 0x2F && npc == pc + 4) {
+		pair_ready = true;
+		pair_wreg = wreg;
+		pair_load = load_use ? 0 : load_reg;
+	}
+	if (privilege)
+		cycles += PENALTY_PRIVILEGE;
+	if (wreg) {
+		regs[wreg] = wval;
+		last.wen = true;
+		last.waddr = wreg;
+		last.wdata = wval;
+	}
+	load_reg = new_load;
+	bool in_slot = delay_slot;
+	delay_slot = jump && !in_slot;
+	if (delay_slot)
+		branch_pc = pc;
+	uint32_t next = taken ? target : npc + 4;
+	pc = npc;
+	npc = next;
+	inst_count++;
+	last.cycles = cycles - start;
+	return STEP_RETIRED;
+}
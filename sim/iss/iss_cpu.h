@@ -0,0 +1,187 @@
+#ifndef __ISS_CPU_H__
+#define __ISS_CPU_H__
+
+#include <stdint.h>
+
+class iss_soc;
+
+
+// CP0 registers, the same as mips_define.vh
+enum {
+	CP0_SR = 0,
+	CP0_EAR,
+	CP0_EPCR,
+	CP0_EHBR,
+	CP0_IER,
+	CP0_ICR,
+	CP0_PDBR,
+	CP0_TIR,
+	CP0_WDR,
+	CP0_IVBR,
+	CP0_IIDR,
+	CP0_IPR0,
+	CP0_IPR1,
+	CP0_CCRL,
+	CP0_CCRH,
+	CP0_SCR,
+	CP0_CIDR,  // read-only core identification, always 0 as only the first core is simulated
+	CP0_NUM
+};
+
+// exception codes
+enum {
+	EX_NONE = 0,
+	EX_INST_UNALIGN,
+	EX_MEM_UNALIGN,
+	EX_INST_UNRECOGNIZE,
+	EX_INST_ILLEGAL,
+	EX_PAGE_FAULT,
+	EX_UNAUTH_USER,
+	EX_UNAUTH_EXEC,
+	EX_UNAUTH_WRITE,
+	EX_MATH_OVERFLOW,
+	EX_MATH_DIVIDE_ZERO,
+	EX_INST_BUS_ERR,
+	EX_MEM_BUS_ERR
+};
+
+#define PC_RESET 0xFF000000
+
+// pipeline penalties of mips_core in cycles
+#define PENALTY_LOAD_USE 1  // NOP inserted between LW and a related instruction
+#define PENALTY_PRIVILEGE 3  // NOP inserted before privilege instruction, and IF held until it leaves EXE
+#define PENALTY_FLUSH 3  // IF, ID and EXE cancelled by exception, interrupt, system call and ERET
+
+// TLB and cache geometries, the same as WB_MIPS in top modules
+#define TLB_LINE_NUM 16
+#define PDE_LARGE 0x80  // page directory entry maps a 4MB page directly, the same as mmu.v
+#define CACHE_LINE_NUM 64
+#define CACHE_LINE_BYTES 16
+#define IC_LINE_WORDS 4  // default of instruction cache, which can be changed, the same as IC_LINE_WORDS of WB_MIPS
+#define PAGE_BYTES 4096  // instruction cache never prefetches across physical pages
+
+
+enum step_result {
+	STEP_RETIRED,  // one instruction completed
+	STEP_EXCEPTION,  // exception, interrupt, system call or ERET taken, no instruction completed
+	STEP_SLEEP  // halted by WAIT instruction
+};
+
+// what the last step did, for profiler and lock-step comparison
+struct retire_info {
+	uint32_t pc;
+	uint32_t inst;
+	bool wen;  // register written, never for $0
+	uint8_t waddr;
+	uint32_t wdata;
+	bool mem_wen;  // memory written
+	uint32_t mem_addr;  // logical address
+	uint32_t mem_data;  // value of rt, not shifted to byte lanes
+	bool external;  // written value comes from devices or free-running CP0 registers
+	uint32_t cycles;  // cycles spent by this step
+	bool paired;  // issued in the same cycle as the previous instruction, only with dual issue
+};
+
+
+// fully associative TLB with FIFO replacement, the same as tlb.v
+struct iss_tlb {
+	uint32_t page[TLB_LINE_NUM];
+	uint32_t data[TLB_LINE_NUM];  // {physical page, 2'b0, large, 4'b0, attributes}, large pages match the high 10 bits only
+	bool valid[TLB_LINE_NUM];
+	int replace;
+	uint32_t miss_count;
+	void flush();
+	bool lookup(uint32_t page_i, uint32_t &data_o) const;
+	void insert(uint32_t page_i, uint32_t data_i);
+};
+
+// direct mapped write-back cache, only tags are kept to count cycles, data always lives in memory
+struct iss_cache {
+	uint32_t tag[CACHE_LINE_NUM];
+	bool valid[CACHE_LINE_NUM];
+	bool dirty[CACHE_LINE_NUM];
+	uint32_t miss_count;
+	void flush();
+	uint32_t access(iss_soc *soc, uint32_t addr, bool write);  // returns cycles
+	uint32_t invalidate(iss_soc *soc);  // write back dirty lines, returns cycles
+};
+
+// read-only instruction cache with next-line prefetch into a buffer of one line, the same as wb_icmu
+// fetching the last word of a line starts the burst of the next one, and fetches of the buffered line wait for their
+// own words only, the line is taken into cache at its first use as wb_icmu copies it while the CPU reads the buffer
+struct iss_icache {
+	uint32_t tag[CACHE_LINE_NUM];
+	bool valid[CACHE_LINE_NUM];
+	uint32_t line_words;
+	bool prefetch;
+	uint32_t prefetch_ahead;  // words at the end of a line whose fetch starts prefetching, PREFETCH_AHEAD of wb_icmu
+	bool buf_valid;
+	uint32_t buf_line;  // address / line bytes
+	uint64_t buf_first;  // cycle when the first word of the buffer is ready
+	uint64_t buf_end;  // cycle when the burst ends
+	uint32_t miss_count;  // lines filled on demand
+	uint32_t prefetch_count;  // prefetch bursts
+	uint32_t prefetch_hit_count;  // lines taken from the buffer
+	void flush();
+	uint32_t access(iss_soc *soc, uint32_t addr, uint64_t now);  // returns stall cycles
+	bool cached(uint32_t line) const;
+};
+
+
+// instruction set simulator of mips_core, with MMU, caches and CP0 behaving as the RTL does
+class iss_cpu {
+public:
+	iss_cpu(iss_soc *soc);
+	void reset();
+	step_result step();
+	void sleep_until(uint64_t cycle);  // fast forward while halted by WAIT
+	uint64_t next_event() const;  // cycle of next CP0 timer interrupt
+	void take_interrupt(int id, int level);  // enter interrupt at current instruction, used by lock-step mode
+	uint32_t read_cp0(int addr) const;
+	uint32_t regs[32];
+	uint32_t pc;  // address of next instruction to execute
+	uint32_t cp0[CP0_NUM];
+	uint64_t cycles;
+	bool sleeping;
+	bool lockstep;  // interrupts are injected by RTL, and WAIT never halts
+	retire_info last;
+	// statistics
+	uint64_t inst_count;
+	uint64_t sleep_count;
+	uint32_t exception_count;
+	uint32_t interrupt_count;
+	uint64_t fetch_stall_count;  // cycles of instruction fetches waiting for cache misses and uncached reads
+	bool fetch_cached;  // fetch from RAM and PCM through instruction cache even when MMU is off, for estimating demos
+	bool dual_issue;  // pair instructions by the rules of DUAL_ISSUE in datapath.v, not for lock-step mode
+	uint64_t pair_count;  // instructions issued as the second one of a pair
+	iss_tlb itlb, dtlb;
+	iss_icache icache;
+	iss_cache dcache;
+private:
+	int fetch(uint32_t addr, uint32_t &inst);
+	int load(uint32_t addr, int size, bool ext, uint32_t &data);
+	int store(uint32_t addr, int size, uint32_t data);
+	int translate(uint32_t addr, iss_tlb &tlb, bool exec, bool write, uint32_t &physical, bool &cached);
+	uint32_t page_walk(uint32_t addr);
+	bool find_interrupt(int &id, int &level) const;
+	void enter(uint32_t target, uint32_t epc);
+	void exception(int code, uint32_t ear);
+	void write_cp0(int addr, uint32_t data);
+	void update_iidr(uint32_t service);
+	iss_soc *soc;
+	uint32_t npc;  // address of the one after next
+	bool delay_slot;  // next instruction is in delay slot
+	uint32_t branch_pc;  // address of the jump owning the delay slot
+	uint8_t load_reg;  // destination of previous load, for load-use stall
+	bool fetch_wide;  // last fetch came from cache or scratchpad, which delivers the next word as well
+	bool pair_ready;  // previous instruction can take the next one as its pair
+	uint8_t pair_wreg;  // destination of the first one of pair
+	uint8_t pair_load;  // destination of the load before the first one, the second one must wait for it alone
+	bool link_valid;  // link of LL, broken by exceptions, ERET and stores to the same cache line
+	uint32_t link_line;  // logical address of the linked cache line
+	uint64_t ccr_base;
+	uint64_t tir_next;
+	uint8_t ir_service_id[4];  // ID of the interrupt in service at each level
+};
+
+#endif
@@ -0,0 +1,263 @@
+#include "iss_cpu.h"
+#include "iss_soc.h"
+#include "iss_profile.h"
+#include "soc_models.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+
+static void usage(const char *name) {
+	printf("Usage: %s [options]\n", name);
+	printf("\t--flash <file>[@<offset>]  load image into PCM, offset in hex, repeatable\n");
+	printf("\t--script <file>            stimulus script, the same format as the Verilator simulator\n");
+	printf("\t--sd <file>                image of the SD card on SPI\n");
+	printf("\t--symbols <file>           ELF file or objdump listing for the function profile, repeatable\n");
+	printf("\t--profile <file>           write the function profile to <file> instead of stdout\n");
+	printf("\t--top <n>                  show only the first <n> functions of the profile, 0 for all\n");
+	printf("\t--time <ms>                stop after <ms> milliseconds of simulated time\n");
+	printf("\t--insts <n>                stop after <n> instructions\n");
+	printf("\t--switch <hex>             initial value of switches\n");
+	printf("\t--latency <ram>,<pcm>,<dev>  bus latencies in CPU cycles, default %d,%d,%d\n", LATENCY_RAM, LATENCY_PCM, LATENCY_DEV);
+	printf("\t--icache <words>[,<prefetch>]  words per-line of instruction cache and next-line prefetch (0 or 1), default %d,1\n", IC_LINE_WORDS);
+	printf("\t--cached                   fetch from RAM and PCM through instruction cache even when MMU is off\n");
+	printf("\t--dual                     issue pairs of instructions as the core built with DUAL_ISSUE=1\n");
+	printf("\t--trace                    print every executed instruction to stderr\n");
+}
+
+// script times are in picoseconds
+static uint64_t to_cycles(sim_time time, uint64_t cycles_per_ms) {
+	return time / PS_PER_MS * cycles_per_ms + time % PS_PER_MS * cycles_per_ms / PS_PER_MS;
+}
+
+static double host_time() {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+int main(int argc, char **argv) {
+	iss_soc soc;
+	iss_cpu cpu(&soc);
+	iss_profile profile;
+	sd_model sd;
+	std::vector<script_event> script;
+	size_t script_pos = 0;
+	const char *profile_file = NULL;
+	int top = 30;
+	uint64_t max_cycles = 0;
+	uint64_t max_insts = 0;
+	bool trace = false;
+
+	for (int i=1; i<argc; i++) {
+		bool more = (i + 1 < argc);
+		if (strcmp(argv[i], "--flash") == 0 && more) {
+			std::string arg = argv[++i];
+			uint32_t offset = 0;
+			size_t at = arg.find('@');
+			if (at != std::string::npos) {
+				offset = strtoul(arg.c_str() + at + 1, NULL, 16);
+				arg.resize(at);
+			}
+			if (!soc.load(arg.c_str(), offset)) {
+				fprintf(stderr, "can not open %s\n", arg.c_str());
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--script") == 0 && more) {
+			if (!load_script(argv[++i], script)) {
+				fprintf(stderr, "can not open %s\n", argv[i]);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--sd") == 0 && more) {
+			if (!sd.load(argv[++i])) {
+				fprintf(stderr, "can not open %s\n", argv[i]);
+				return 1;
+			}
+			soc.sd = &sd;
+		}
+		else if (strcmp(argv[i], "--symbols") == 0 && more) {
+			if (!profile.load(argv[++i])) {
+				fprintf(stderr, "can not load symbols from %s\n", argv[i]);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--profile") == 0 && more) {
+			profile_file = argv[++i];
+		}
+		else if (strcmp(argv[i], "--top") == 0 && more) {
+			top = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--time") == 0 && more) {
+			max_cycles = (uint64_t)(atof(argv[++i]) * soc.cpu_freq * 1000);
+		}
+		else if (strcmp(argv[i], "--insts") == 0 && more) {
+			max_insts = strtoull(argv[++i], NULL, 10);
+		}
+		else if (strcmp(argv[i], "--switch") == 0 && more) {
+			soc.set_switch(strtoul(argv[++i], NULL, 16));
+		}
+		else if (strcmp(argv[i], "--latency") == 0 && more) {
+			if (sscanf(argv[++i], "%u,%u,%u", &soc.lat_ram, &soc.lat_pcm, &soc.lat_dev) != 3) {
+				usage(argv[0]);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--icache") == 0 && more) {
+			unsigned words = 0, prefetch = 1;
+			if (sscanf(argv[++i], "%u,%u", &words, &prefetch) < 1 || words < 2 || (words & (words - 1))) {
+				usage(argv[0]);
+				return 1;
+			}
+			cpu.icache.line_words = words;
+			cpu.icache.prefetch = prefetch != 0;
+		}
+		else if (strcmp(argv[i], "--cached") == 0) {
+			cpu.fetch_cached = true;
+		}
+		else if (strcmp(argv[i], "--dual") == 0) {
+			cpu.dual_issue = true;
+			cpu.icache.prefetch_ahead = 2;  // the last pair is read by its even address
+		}
+		else if (strcmp(argv[i], "--trace") == 0) {
+			trace = true;
+		}
+		else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	soc.irq = 0;
+
+	double host_start = host_time();
+	uint64_t cycles_per_ms = soc.cpu_freq * 1000ULL;
+	bool quit = false;
+	while (!quit) {
+		// script
+		while (script_pos < script.size() && to_cycles(script[script_pos].time, cycles_per_ms) <= cpu.cycles) {
+			const script_event &e = script[script_pos++];
+			if (e.cmd == "key" || e.cmd == "press" || e.cmd == "release") {
+				std::vector<uint8_t> codes;
+				bool ok = true;
+				if (e.cmd != "release")
+					ok = ps2_key_codes(e.arg, true, codes);
+				if (e.cmd != "press")
+					ok = ps2_key_codes(e.arg, false, codes);
+				if (!ok)
+					fprintf(stderr, "unknown key \"%s\"\n", e.arg.c_str());
+				soc.ps2_send(codes);
+			}
+			else if (e.cmd == "ps2") {
+				std::vector<uint8_t> codes;
+				const char *p = e.arg.c_str();
+				char *end;
+				for (uint32_t c=strtoul(p, &end, 16); end!=p; c=strtoul(p, &end, 16)) {
+					codes.push_back(c);
+					p = end;
+				}
+				soc.ps2_send(codes);
+			}
+			else if (e.cmd == "uart") {
+				soc.uart_send(e.arg);
+			}
+			else if (e.cmd == "sw") {
+				soc.set_switch(strtoul(e.arg.c_str(), NULL, 16));
+			}
+			else if (e.cmd == "btn") {
+				int index = 0, value = 0;
+				sscanf(e.arg.c_str(), "%d %d", &index, &value);
+				soc.set_button(index, value);
+			}
+			else if (e.cmd == "rst") {
+				if (atoi(e.arg.c_str())) {
+					cpu.reset();
+					soc.reset();
+				}
+			}
+			else if (e.cmd == "quit") {
+				quit = true;
+			}
+			else {
+				fprintf(stderr, "unknown command \"%s\"\n", e.cmd.c_str());
+			}
+		}
+
+		soc.update(cpu.cycles);
+		step_result result = cpu.step();
+		if (result == STEP_SLEEP) {
+			// nothing happens until the next device event, CP0 timer or script command
+			uint64_t next = soc.next_event();
+			uint64_t next_cpu = cpu.next_event();
+			next = next_cpu < next ? next_cpu : next;
+			if (script_pos < script.size()) {
+				uint64_t next_script = to_cycles(script[script_pos].time, cycles_per_ms);
+				next = next_script < next ? next_script : next;
+			}
+			if (max_cycles && max_cycles < next)
+				next = max_cycles;
+			if (next == UINT64_MAX) {
+				fprintf(stderr, "CPU sleeps forever at %08x\n", cpu.pc);
+				quit = true;
+			}
+			else {
+				uint64_t start = cpu.cycles;
+				cpu.sleep_until(next > start ? next : start + 1);
+				profile.record_sleep(cpu.cycles - start);
+			}
+		}
+		else {
+			profile.record(cpu.last.pc, result == STEP_RETIRED, cpu.last.cycles, cpu.last.paired);
+			soc.trace_step(cpu.last.pc, result == STEP_RETIRED, cpu.cycles);
+			if (trace) {
+				if (result == STEP_RETIRED)
+					fprintf(stderr, "%08x: %08x", cpu.last.pc, cpu.last.inst);
+				else
+					fprintf(stderr, "%08x: exception, SR %08x, EAR %08x, to %08x", cpu.last.pc, cpu.cp0[CP0_SR], cpu.cp0[CP0_EAR], cpu.pc);
+				if (cpu.last.wen)
+					fprintf(stderr, "  $%d = %08x", cpu.last.waddr, cpu.last.wdata);
+				if (cpu.last.mem_wen)
+					fprintf(stderr, "  [%08x] = %08x", cpu.last.mem_addr, cpu.last.mem_data);
+				if (cpu.last.paired)
+					fprintf(stderr, "  paired");
+				fprintf(stderr, "\n");
+			}
+		}
+
+		if (max_cycles && cpu.cycles >= max_cycles)
+			quit = true;
+		if (max_insts && cpu.inst_count >= max_insts)
+			quit = true;
+	}
+
+	double host_elapsed = host_time() - host_start;
+	printf("\n");
+	printf("simulated time: %.3f ms, %llu CPU cycles, %llu instructions, CPI %.2f excluding %llu sleeping cycles\n",
+		(double)cpu.cycles / cycles_per_ms, (unsigned long long)cpu.cycles, (unsigned long long)cpu.inst_count,
+		cpu.inst_count ? (double)(cpu.cycles - cpu.sleep_count) / cpu.inst_count : 0.0, (unsigned long long)cpu.sleep_count);
+	printf("host time: %.3f s, %.2f MIPS\n", host_elapsed, host_elapsed > 0 ? cpu.inst_count / host_elapsed / 1e6 : 0);
+	printf("exceptions: %u, interrupts: %u; TLB misses: %u/%u, cache misses: %u/%u (instruction/data)\n",
+		cpu.exception_count, cpu.interrupt_count, cpu.itlb.miss_count, cpu.dtlb.miss_count, cpu.icache.miss_count, cpu.dcache.miss_count);
+	printf("instruction fetch: %llu stall cycles (%.1f%% of cycles excluding sleep), %u prefetches, %u lines taken from prefetch buffer\n",
+		(unsigned long long)cpu.fetch_stall_count, cpu.cycles > cpu.sleep_count ? 100.0 * cpu.fetch_stall_count / (cpu.cycles - cpu.sleep_count) : 0.0,
+		cpu.icache.prefetch_count, cpu.icache.prefetch_hit_count);
+	if (cpu.dual_issue)
+		printf("dual issue: %llu pairs, %.1f%% of instructions dual-issued\n", (unsigned long long)cpu.pair_count,
+			cpu.inst_count ? 200.0 * cpu.pair_count / cpu.inst_count : 0.0);
+	printf("UART: %u bytes sent, %u bytes received; PS/2: %u bytes sent; %u accesses to unmapped devices or PCM writes\n",
+		soc.uart_tx_count, soc.uart_rx_count, soc.ps2_count, soc.unmapped_count);
+	printf("board: LED %02x, 7-segment %04x\n", soc.led, soc.disp_text);
+	if (soc.sd)
+		printf("SPI: %u bytes exchanged; SD card: %u commands, %u blocks read\n", soc.spi_count, sd.cmd_count, sd.block_count);
+	if (!profile.empty()) {
+		FILE *fp = profile_file ? fopen(profile_file, "w") : stdout;
+		if (!fp) {
+			fprintf(stderr, "can not open %s\n", profile_file);
+			return 1;
+		}
+		profile.report(fp, top);
+		if (fp != stdout)
+			fclose(fp);
+	}
+	return 0;
+}
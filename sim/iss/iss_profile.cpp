@@ -0,0 +1,208 @@
+#include "iss_profile.h"
+#include <algorithm>
+#include <string.h>
+
+
+#define ELF_SHT_SYMTAB 2
+#define ELF_STT_NOTYPE 0
+#define ELF_STT_FUNC 2
+#define HISTOGRAM_WIDTH 20
+
+static uint16_t get16(const uint8_t *p) {
+	return p[0] | (p[1] << 8);
+}
+
+static uint32_t get32(const uint8_t *p) {
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+iss_profile::iss_profile() {
+	unknown.addr = 0;
+	unknown.size = 0;
+	unknown.name = "(unknown)";
+	unknown.insts = 0;
+	unknown.cycles = 0;
+	unknown.pairs = 0;
+	sleep_cycles = 0;
+	prepare();
+}
+
+bool iss_profile::load(const char *file) {
+	FILE *fp = fopen(file, "rb");
+	if (!fp)
+		return false;
+	char magic[4] = {0};
+	fread(magic, 1, 4, fp);
+	rewind(fp);
+	bool ok = (memcmp(magic, "\177ELF", 4) == 0) ? load_elf(fp) : load_listing(fp);
+	fclose(fp);
+	prepare();
+	return ok;
+}
+
+// functions and labels in symbol table of 32-bit little-endian ELF
+bool iss_profile::load_elf(FILE *fp) {
+	std::vector<uint8_t> elf;
+	uint8_t buf[4096];
+	size_t len;
+	while ((len = fread(buf, 1, sizeof(buf), fp)) > 0)
+		elf.insert(elf.end(), buf, buf + len);
+	if (elf.size() < 52 || elf[4] != 1 || elf[5] != 1)
+		return false;
+	uint32_t shoff = get32(&elf[32]);
+	uint32_t shentsize = get16(&elf[46]);
+	uint32_t shnum = get16(&elf[48]);
+	if (shoff + shnum * shentsize > elf.size())
+		return false;
+	for (uint32_t i=0; i<shnum; i++) {
+		const uint8_t *sh = &elf[shoff + i * shentsize];
+		if (get32(sh + 4) != ELF_SHT_SYMTAB)
+			continue;
+		uint32_t offset = get32(sh + 16);
+		uint32_t size = get32(sh + 20);
+		uint32_t link = get32(sh + 24);
+		if (link >= shnum || offset + size > elf.size())
+			return false;
+		const uint8_t *strtab_sh = &elf[shoff + link * shentsize];
+		uint32_t str_offset = get32(strtab_sh + 16);
+		uint32_t str_size = get32(strtab_sh + 20);
+		if (str_offset + str_size > elf.size())
+			return false;
+		for (uint32_t j=offset; j+16<=offset+size; j+=16) {
+			const uint8_t *sym = &elf[j];
+			uint32_t name = get32(sym);
+			uint8_t type = sym[12] & 0xF;
+			uint16_t shndx = get16(sym + 14);
+			if ((type != ELF_STT_FUNC && type != ELF_STT_NOTYPE) || shndx == 0 || name == 0 || name >= str_size)
+				continue;
+			symbol s;
+			s.addr = get32(sym + 4);
+			s.size = get32(sym + 8);
+			s.name = (const char *)&elf[str_offset + name];
+			s.insts = 0;
+			s.cycles = 0;
+			s.pairs = 0;
+			symbols.push_back(s);
+		}
+		return true;
+	}
+	return false;
+}
+
+// "ff000210 <mul>:" starts a symbol, "ff000214:\t..." is an instruction
+bool iss_profile::load_listing(FILE *fp) {
+	char line[1024];
+	uint32_t end = 0;
+	size_t first = symbols.size();
+	while (fgets(line, sizeof(line), fp)) {
+		uint32_t addr;
+		char name[512];
+		if (sscanf(line, "%8x <%511[^>]>:", &addr, name) == 2) {
+			symbol s;
+			s.addr = addr;
+			s.size = 0;
+			s.name = name;
+			s.insts = 0;
+			s.cycles = 0;
+			s.pairs = 0;
+			symbols.push_back(s);
+		}
+		else if (sscanf(line, " %8x:", &addr) == 1 && addr + 4 > end) {
+			end = addr + 4;
+		}
+	}
+	// the last symbol ends at the last instruction
+	if (symbols.size() > first && end > symbols.back().addr)
+		symbols.back().size = end - symbols.back().addr;
+	return symbols.size() > first;
+}
+
+void iss_profile::prepare() {
+	std::stable_sort(symbols.begin(), symbols.end());
+	std::vector<symbol> merged;
+	for (size_t i=0; i<symbols.size(); i++) {
+		if (!merged.empty() && merged.back().addr == symbols[i].addr)
+			continue;
+		merged.push_back(symbols[i]);
+	}
+	symbols.swap(merged);
+	// labels without size reach the next symbol, and no symbol overlaps the next one
+	for (size_t i=0; i+1<symbols.size(); i++) {
+		uint32_t gap = symbols[i+1].addr - symbols[i].addr;
+		if (symbols[i].size == 0 || symbols[i].size > gap)
+			symbols[i].size = gap;
+	}
+	if (!symbols.empty() && symbols.back().size == 0)
+		symbols.back().size = 4;
+	last = &unknown;
+	last_addr = 0;
+	last_size = 0;
+}
+
+void iss_profile::find(uint32_t pc) {
+	symbol key;
+	key.addr = pc;
+	std::vector<symbol>::iterator it = std::upper_bound(symbols.begin(), symbols.end(), key);
+	uint32_t gap_begin = 0;
+	uint32_t gap_end = it == symbols.end() ? 0xFFFFFFFF : it->addr;
+	if (it != symbols.begin()) {
+		--it;
+		if (pc - it->addr < it->size) {
+			last = &*it;
+			last_addr = it->addr;
+			last_size = it->size;
+			return;
+		}
+		gap_begin = it->addr + it->size;
+	}
+	last = &unknown;
+	last_addr = gap_begin;
+	last_size = gap_end - gap_begin;
+}
+
+void iss_profile::report(FILE *fp, int top) const {
+	std::vector<const symbol *> list;
+	uint64_t total_insts = unknown.insts;
+	uint64_t total_cycles = unknown.cycles + sleep_cycles;
+	uint64_t total_pairs = unknown.pairs;
+	for (size_t i=0; i<symbols.size(); i++) {
+		total_insts += symbols[i].insts;
+		total_cycles += symbols[i].cycles;
+		total_pairs += symbols[i].pairs;
+		if (symbols[i].cycles)
+			list.push_back(&symbols[i]);
+	}
+	if (unknown.cycles)
+		list.push_back(&unknown);
+	std::stable_sort(list.begin(), list.end(), [](const symbol *a, const symbol *b) { return a->cycles > b->cycles; });
+	fprintf(fp, "Profile: %llu instructions, %llu cycles", (unsigned long long)total_insts, (unsigned long long)total_cycles);
+	if (total_pairs)  // the column of dual-issued instructions, both ones of each pair, appears with dual issue only
+		fprintf(fp, ", %.1f%% dual-issued", 200.0 * total_pairs / total_insts);
+	fprintf(fp, "\n");
+	fprintf(fp, "%14s %7s %7s %12s %6s", "cycles", "%", "cumul%", "insts", "CPI");
+	if (total_pairs)
+		fprintf(fp, " %7s", "dual");
+	fprintf(fp, "  %-*s  %s\n", HISTOGRAM_WIDTH, "", "function");
+	if (total_cycles == 0)
+		return;
+	uint64_t cumul = 0;
+	for (size_t i=0; i<list.size() && (top <= 0 || (int)i < top); i++) {
+		const symbol *s = list[i];
+		cumul += s->cycles;
+		double share = 100.0 * s->cycles / total_cycles;
+		char bar[HISTOGRAM_WIDTH + 1];
+		int len = (int)(share * HISTOGRAM_WIDTH / 100 + 0.5);
+		memset(bar, '#', len);
+		memset(bar + len, ' ', HISTOGRAM_WIDTH - len);
+		bar[HISTOGRAM_WIDTH] = 0;
+		fprintf(fp, "%14llu %6.2f%% %6.2f%% %12llu %6.2f",
+			(unsigned long long)s->cycles, share, 100.0 * cumul / total_cycles,
+			(unsigned long long)s->insts, s->insts ? (double)s->cycles / s->insts : 0.0);
+		if (total_pairs)
+			fprintf(fp, " %6.1f%%", s->insts ? 200.0 * s->pairs / s->insts : 0.0);
+		fprintf(fp, "  %s  %s\n", bar, s->name.c_str());
+	}
+	if (sleep_cycles)
+		fprintf(fp, "%14llu %6.2f%% %7s %12s %6s%s  %-*s  %s\n", (unsigned long long)sleep_cycles, 100.0 * sleep_cycles / total_cycles,
+			"", "", "", total_pairs ? "         " : "", HISTOGRAM_WIDTH, "", "(sleep)");
+}
@@ -0,0 +1,47 @@
+#ifndef __ISS_PROFILE_H__
+#define __ISS_PROFILE_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+
+// per-function instruction and cycle histogram, functions are found by symbols from ELF or objdump listing
+class iss_profile {
+public:
+	iss_profile();
+	bool load(const char *file);  // ELF file, or disassembly listing like "2048.txt"
+	void record(uint32_t pc, uint32_t insts, uint32_t cycles, uint32_t pairs) {
+		if (pc - last_addr >= last_size)
+			find(pc);
+		last->insts += insts;
+		last->cycles += cycles;
+		last->pairs += pairs;
+	}
+	void record_sleep(uint64_t cycles) { sleep_cycles += cycles; }
+	void report(FILE *fp, int top) const;
+	bool empty() const { return symbols.empty(); }
+private:
+	struct symbol {
+		uint32_t addr;
+		uint32_t size;  // 0 if unknown, extended to the next symbol
+		std::string name;
+		uint64_t insts;
+		uint64_t cycles;
+		uint64_t pairs;  // instructions issued as the second one of a pair
+		bool operator<(const symbol &other) const { return addr < other.addr; }
+	};
+	bool load_elf(FILE *fp);
+	bool load_listing(FILE *fp);
+	void prepare();
+	void find(uint32_t pc);
+	std::vector<symbol> symbols;
+	symbol unknown;
+	symbol *last;  // cache of last hit
+	uint32_t last_addr;
+	uint32_t last_size;
+	uint64_t sleep_cycles;
+};
+
+#endif
@@ -0,0 +1,658 @@
+#include "iss_soc.h"
+#include "soc_models.h"
+#include <stdio.h>
+#include <string.h>
+
+
+// PS/2 keyboard sends one byte per 11 bits at about 12.5kHz, with a gap between bytes
+#define PS2_BYTE_US 1080
+// keyboard acknowledges each command from host
+#define PS2_ACK 0xFA
+// scan codes of set 2 to virtual-key codes, {extended << 8 | scan code, key code}, the same as ps2_decoder
+static const uint16_t PS2_KEYS[][2] = {
+	{0x001, 0x78}, {0x003, 0x74}, {0x004, 0x72}, {0x005, 0x70}, {0x006, 0x71}, {0x007, 0x7B}, {0x009, 0x79},
+	{0x00A, 0x77}, {0x00B, 0x75}, {0x00C, 0x73}, {0x00D, 0x09}, {0x00E, 0xC0}, {0x011, 0xA4}, {0x012, 0xA0},
+	{0x014, 0xA2}, {0x015, 0x51}, {0x016, 0x31}, {0x01A, 0x5A}, {0x01B, 0x53}, {0x01C, 0x41}, {0x01D, 0x57},
+	{0x01E, 0x32}, {0x021, 0x43}, {0x022, 0x58}, {0x023, 0x44}, {0x024, 0x45}, {0x025, 0x34}, {0x026, 0x33},
+	{0x029, 0x20}, {0x02A, 0x56}, {0x02B, 0x46}, {0x02C, 0x54}, {0x02D, 0x52}, {0x02E, 0x35}, {0x031, 0x4E},
+	{0x032, 0x42}, {0x033, 0x48}, {0x034, 0x47}, {0x035, 0x59}, {0x036, 0x36}, {0x03A, 0x4D}, {0x03B, 0x4A},
+	{0x03C, 0x55}, {0x03D, 0x37}, {0x03E, 0x38}, {0x041, 0xBC}, {0x042, 0x4B}, {0x043, 0x49}, {0x044, 0x4F},
+	{0x045, 0x30}, {0x046, 0x39}, {0x049, 0xBE}, {0x04A, 0xBF}, {0x04B, 0x4C}, {0x04C, 0xBA}, {0x04D, 0x50},
+	{0x04E, 0xBD}, {0x052, 0xDE}, {0x054, 0xDB}, {0x055, 0xBB}, {0x058, 0x14}, {0x059, 0xA1}, {0x05A, 0x0D},
+	{0x05B, 0xDD}, {0x05D, 0xDC}, {0x066, 0x08}, {0x069, 0x61}, {0x06B, 0x64}, {0x06C, 0x67}, {0x070, 0x60},
+	{0x071, 0x6E}, {0x072, 0x62}, {0x073, 0x65}, {0x074, 0x66}, {0x075, 0x68}, {0x076, 0x1B}, {0x077, 0x90},
+	{0x078, 0x7A}, {0x079, 0x6B}, {0x07A, 0x63}, {0x07B, 0x6D}, {0x07C, 0x6A}, {0x07D, 0x69}, {0x083, 0x76},
+	{0x110, 0xAA}, {0x111, 0xA5}, {0x114, 0xA3}, {0x115, 0xB1}, {0x118, 0xAB}, {0x11F, 0x5B}, {0x120, 0xA8},
+	{0x121, 0xAE}, {0x123, 0xAD}, {0x127, 0x5C}, {0x128, 0xA9}, {0x12F, 0x5D}, {0x130, 0xA7}, {0x132, 0xAF},
+	{0x134, 0xB3}, {0x138, 0xA6}, {0x13A, 0xAC}, {0x13B, 0xB2}, {0x148, 0xB4}, {0x14A, 0x6F}, {0x14D, 0xB0},
+	{0x150, 0xB5}, {0x15A, 0x0D}, {0x169, 0x23}, {0x16B, 0x25}, {0x16C, 0x24}, {0x170, 0x2D}, {0x171, 0x2E},
+	{0x172, 0x28}, {0x174, 0x27}, {0x175, 0x26}, {0x17A, 0x22}, {0x17D, 0x21}
+};
+// reset value of wb_random
+static const uint32_t RANDOM_SEED[4] = {0x9E3779B9, 0x7F4A7C15, 0xF39CC060, 0x5CEDC834};
+
+iss_soc::iss_soc() : ram(RAM_SIZE, 0), pcm(PCM_SIZE, 0xFF), spm(SPM_SIZE, 0), trace_buf(TRACE_ENTRY_NUM, 0) {
+	cpu_freq = 10;
+	dev_freq = 50;
+	baud = 115200;
+	lat_ram = LATENCY_RAM;
+	lat_pcm = LATENCY_PCM;
+	lat_dev = LATENCY_DEV;
+	uart_echo = true;
+	sd = NULL;
+	sw = 0;
+	btn = 0;
+	uart_tx_count = 0;
+	uart_rx_count = 0;
+	ps2_count = 0;
+	spi_count = 0;
+	unmapped_count = 0;
+	now = 0;
+	reset();
+}
+
+void iss_soc::reset() {
+	irq = 0;
+	memset(vga_regs, 0, sizeof(vga_regs));
+	led = 0;
+	disp_text = 0;
+	disp_ctrl = 0;
+	disp_graphic = 0;
+	ps2_next = now;
+	ps2_data = 0;
+	ps2_valid = false;
+	ps2_mode = 0;
+	ps2_decoder_reset();
+	timer_high = 0;
+	for (int i=0; i<TIMER_CHANNEL_NUM; i++) {
+		timer_cmp[i] = 0;
+		timer_period[i] = 0;
+		timer_ctrl[i] = 0;
+	}
+	timer_pending = 0;
+	spi_mode = 0;
+	spi_tx.clear();
+	spi_rx.clear();
+	spi_next = now;
+	spi_of = false;
+	spi_uf = false;
+	uart_mode = 0;
+	uart_rx.clear();
+	uart_next = now;
+	memcpy(random_state, RANDOM_SEED, sizeof(random_state));
+	random_begin = 0;
+	random_end = 0;
+	random_ctrl = 1;
+	trace_ctrl = 0;
+	trace_interval = 0;
+	trace_read = 0;
+	trace_count = 0;
+	trace_dropped = 0;
+	trace_base = now;
+	trace_sample = now;
+	trace_last_pc = 0;
+	trace_exception = false;
+}
+
+bool iss_soc::load(const char *file, uint32_t offset) {
+	FILE *fp = fopen(file, "rb");
+	if (!fp)
+		return false;
+	if (offset < pcm.size())
+		fread(&pcm[offset], 1, pcm.size() - offset, fp);
+	fclose(fp);
+	return true;
+}
+
+bool iss_soc::read(uint32_t addr, int size, uint32_t &data, uint32_t &latency) {
+	const uint8_t *p;
+	if (addr - RAM_BASE < RAM_SIZE) {
+		p = &ram[addr - RAM_BASE];
+		latency = lat_ram;
+	}
+	else if (addr >= DEV_BASE) {
+		uint32_t slot = (addr - DEV_BASE) >> DEV_SLOT_BITS;
+		if (slot >= DEV_SLOT_NUM)
+			return false;
+		uint32_t word = dev_read(addr & ~3);
+		data = word >> ((addr & 3) * 8);
+		if (size < 4)
+			data &= (1 << (size * 8)) - 1;
+		latency = lat_dev;
+		return true;
+	}
+	else if (addr - PCM_BASE < PCM_SIZE) {
+		p = &pcm[addr - PCM_BASE];
+		latency = lat_pcm;
+	}
+	else if (is_spm(addr)) {
+		p = &spm[addr - SPM_BASE];
+		latency = 0;
+	}
+	else {
+		return false;
+	}
+	switch (size) {
+		case 1: data = p[0]; break;
+		case 2: data = p[0] | (p[1] << 8); break;
+		default: data = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); break;
+	}
+	return true;
+}
+
+bool iss_soc::write(uint32_t addr, int size, uint32_t data, uint32_t &latency) {
+	if (addr - RAM_BASE < RAM_SIZE) {
+		uint8_t *p = &ram[addr - RAM_BASE];
+		for (int i=0; i<size; i++)
+			p[i] = data >> (i * 8);
+		latency = lat_ram;
+	}
+	else if (addr >= DEV_BASE) {
+		uint32_t slot = (addr - DEV_BASE) >> DEV_SLOT_BITS;
+		if (slot >= DEV_SLOT_NUM)
+			return false;
+		uint32_t shift = (addr & 3) * 8;
+		uint32_t sel = ((1 << size) - 1) << (addr & 3);
+		dev_write(addr & ~3, data << shift, sel);
+		latency = lat_dev;
+	}
+	else if (addr - PCM_BASE < PCM_SIZE) {
+		// programming PCM is not modeled, writes are dropped as the read mode controller does
+		unmapped_count++;
+		latency = lat_pcm;
+	}
+	else if (is_spm(addr)) {
+		uint8_t *p = &spm[addr - SPM_BASE];
+		for (int i=0; i<size; i++)
+			p[i] = data >> (i * 8);
+		latency = 0;
+	}
+	else {
+		return false;
+	}
+	return true;
+}
+
+uint32_t iss_soc::line_latency(uint32_t addr, uint32_t words) const {
+	uint32_t first = (addr - RAM_BASE < RAM_SIZE) ? lat_ram : lat_pcm;
+	return first + LATENCY_BURST * (words - 1);
+}
+
+uint32_t iss_soc::dev_read(uint32_t addr) {
+	uint32_t slot = (addr - DEV_BASE) >> DEV_SLOT_BITS;
+	uint32_t index = (addr & ((1 << DEV_SLOT_BITS) - 1)) >> 2;
+	switch (slot) {
+		case DEV_VGA:
+			return (index < 16 && index != 8) ? vga_regs[index] : 0;
+		case DEV_BOARD:
+			switch (index) {
+				case 0: return sw & 0xFF;
+				case 1: return btn & 0x1F;
+				case 4: return led;
+				case 6: return disp_text;
+				case 7: return disp_ctrl;
+				case 8: return disp_graphic;
+			}
+			return 0;
+		case DEV_KEYBOARD:
+			switch (index) {
+				case 0: return (ps2_event_of ? (1 << 4) : 0) | (ps2_events.empty() ? 0 : (1 << 3)) | (ps2_valid ? (1 << 2) : 0);
+				case 1: return (ps2_time_ms() << 16) | (uint32_t)ps2_events.size();
+				case 2: return ps2_mode;
+				case 3: ps2_valid = false; return ps2_data;
+				case 4: {
+					ps2_wait = now;
+					ps2_timeout_done = false;
+					if (ps2_events.empty())
+						return 0;
+					uint32_t event = ps2_events.front();
+					ps2_events.pop_front();
+					return event;
+				}
+			}
+			return 0;
+		case DEV_TIMER: {
+			uint64_t counter = timer_counter();
+			switch (index) {
+				case 0: timer_high = counter >> 32; return (uint32_t)counter;
+				case 1: return timer_high;
+				case 2: timer_check(); return timer_pending;
+				case 3: return dev_freq;
+			}
+			uint32_t ch = (index - 8) / 4;
+			if (index < 8 || ch >= TIMER_CHANNEL_NUM)
+				return 0;
+			switch (index & 3) {
+				case 0: return (uint32_t)timer_cmp[ch];
+				case 1: return timer_cmp[ch] >> 32;
+				case 2: return timer_period[ch];
+				default: return timer_ctrl[ch];
+			}
+		}
+		case DEV_SPI:
+			switch (index) {
+				case 0:
+					return (((spi_mode & 1) && !spi_tx.empty()) ? 0x80000000 : 0) | (spi_of ? 8 : 0) | (spi_uf ? 4 : 0)
+						| (spi_tx.size() + spi_rx.size() >= SPI_BUF_SIZE ? 2 : 0) | (spi_tx.empty() ? 1 : 0);
+				case 1: return ((uint32_t)spi_rx.size() << 16) | (uint32_t)(SPI_BUF_SIZE - spi_tx.size() - spi_rx.size());
+				case 2: return spi_mode;
+				case 3: {
+					if (spi_rx.empty()) {
+						spi_uf = true;
+						return 0;
+					}
+					uint8_t data = spi_rx.front();
+					spi_rx.pop_front();
+					return data;
+				}
+			}
+			return 0;
+		case DEV_UART:
+			switch (index) {
+				case 0: return (uart_rx.empty() ? 0 : 2) | 1;
+				// TX buffer is always empty as bytes are sent immediately
+				case 1: return ((uint32_t)(uart_rx.size() & 0xFF) << 16) | 0xFF;
+				case 2: return uart_mode;
+				case 3: {
+					if (uart_rx.empty())
+						return 0;
+					uint8_t data = uart_rx.front();
+					uart_rx.pop_front();
+					return data;
+				}
+			}
+			return 0;
+		case DEV_RANDOM:
+			switch (index) {
+				case 0: return random_next();
+				case 1: {
+					uint64_t range = (random_end == random_begin) ? (1ULL << 32) : (uint32_t)(random_end - random_begin);
+					return random_begin + (uint32_t)((random_next() * range) >> 32);
+				}
+				case 2: return random_begin;
+				case 3: return random_end;
+				case 4: return random_ctrl;
+				case 8: case 9: case 10: case 11: return random_state[index - 8];
+			}
+			return 0;
+		case DEV_TRACE:
+			switch (index) {
+				case 0: return trace_ctrl;
+				case 1: return trace_interval;
+				case 2: return trace_count;
+				case 3: return (uint32_t)(now - trace_base);
+				case 4: return trace_read;
+				case 5: {
+					uint64_t entry = trace_buf[(trace_read >> 1) % TRACE_ENTRY_NUM];
+					uint32_t data = (trace_read & 1) ? entry >> 32 : (uint32_t)entry;
+					trace_read = (trace_read + 1) % (TRACE_ENTRY_NUM * 2);
+					return data;
+				}
+				case 6: return TRACE_ENTRY_NUM;
+				case 7: return trace_dropped;
+			}
+			return 0;
+	}
+	// acknowledge signals of unused slots are left unconnected, which hangs the real bus
+	unmapped_count++;
+	return 0;
+}
+
+void iss_soc::dev_write(uint32_t addr, uint32_t data, uint32_t sel) {
+	uint32_t slot = (addr - DEV_BASE) >> DEV_SLOT_BITS;
+	uint32_t index = (addr & ((1 << DEV_SLOT_BITS) - 1)) >> 2;
+	uint32_t mask = 0;
+	for (int i=0; i<4; i++) {
+		if (sel & (1 << i))
+			mask |= 0xFF << (i * 8);
+	}
+	switch (slot) {
+		case DEV_VGA:
+			if (index < 16 && index != 8)
+				vga_regs[index] = (vga_regs[index] & ~mask) | (data & mask);
+			return;
+		case DEV_BOARD:
+			switch (index) {
+				case 4: led = (led & ~mask & 0xFF) | (data & mask & 0xFF); break;
+				case 6: disp_text = (disp_text & ~mask & 0xFFFF) | (data & mask & 0xFFFF); break;
+				case 7: disp_ctrl = (disp_ctrl & ~mask) | (data & mask & 0x80000F0F); break;
+				case 8: disp_graphic = (disp_graphic & ~mask) | (data & mask); break;
+			}
+			return;
+		case DEV_KEYBOARD:
+			if (index == 2) {
+				// decoder and event buffer are reset by writing mode, as wb_ps2 does
+				ps2_mode = (ps2_mode & ~mask) | (data & mask);
+				ps2_decoder_reset();
+			}
+			if (index == 3)
+				ps2_queue.push_front(PS2_ACK);
+			return;
+		case DEV_TIMER: {
+			// wbs_sel_i are ignored
+			timer_check();
+			if (index == 2) {
+				timer_pending &= ~data;
+				return;
+			}
+			uint32_t ch = (index - 8) / 4;
+			if (index < 8 || ch >= TIMER_CHANNEL_NUM)
+				return;
+			switch (index & 3) {
+				case 0: timer_cmp[ch] = (timer_cmp[ch] & 0xFFFFFFFF00000000ULL) | data; break;
+				case 1: timer_cmp[ch] = (timer_cmp[ch] & 0xFFFFFFFFULL) | ((uint64_t)data << 32); break;
+				case 2: timer_period[ch] = data; break;
+				default: timer_ctrl[ch] = data & 7; break;
+			}
+			timer_check();
+			return;
+		}
+		case DEV_SPI:
+			if (index == 2) {
+				// writing mode resets the buffers
+				spi_mode = data;
+				spi_tx.clear();
+				spi_rx.clear();
+				spi_of = false;
+				spi_uf = false;
+			}
+			else if (index == 3) {
+				if (spi_tx.size() + spi_rx.size() >= SPI_BUF_SIZE) {
+					spi_of = true;
+					return;
+				}
+				if (spi_tx.empty())
+					spi_next = now + spi_byte_cycles();
+				spi_tx.push_back(data & 0xFF);
+			}
+			return;
+		case DEV_UART:
+			if (index == 2) {
+				uart_mode = data;
+			}
+			else if (index == 3) {
+				if (uart_echo) {
+					putchar(data & 0xFF);
+					fflush(stdout);
+				}
+				uart_tx_count++;
+			}
+			return;
+		case DEV_RANDOM:
+			// wbs_sel_i are ignored
+			if (index == 2)
+				random_begin = data;
+			else if (index == 3)
+				random_end = data;
+			else if (index == 4)
+				random_ctrl = data & 1;
+			else if (index >= 8 && index <= 11)
+				random_state[index - 8] = data;
+			return;
+		case DEV_TRACE:
+			// wbs_sel_i are ignored
+			if (index == 0) {
+				trace_ctrl = data & 7;
+				if (data & 0x80000000) {
+					trace_count = 0;
+					trace_dropped = 0;
+					trace_base = now;
+					trace_last_pc = 0;
+					trace_exception = false;
+				}
+				trace_sample = now + trace_interval;
+			}
+			else if (index == 1) {
+				trace_interval = data;
+			}
+			else if (index == 4) {
+				trace_read = data % (TRACE_ENTRY_NUM * 2);
+			}
+			return;
+	}
+	unmapped_count++;
+}
+
+uint64_t iss_soc::timer_counter() const {
+	return now * dev_freq / cpu_freq;
+}
+
+// match all enabled channels against current counter, as wb_timer does on every clock
+void iss_soc::timer_check() {
+	uint64_t counter = timer_counter();
+	for (int i=0; i<TIMER_CHANNEL_NUM; i++) {
+		if (!(timer_ctrl[i] & 1) || counter < timer_cmp[i])
+			continue;
+		timer_pending |= 1 << i;
+		if ((timer_ctrl[i] & 2) && timer_period[i] != 0) {
+			while (timer_cmp[i] <= counter)
+				timer_cmp[i] += timer_period[i];
+		}
+		else {
+			timer_ctrl[i] &= ~1;
+		}
+	}
+	// level interrupt as wb_timer, held until pending flags are cleared
+	for (int i=0; i<TIMER_CHANNEL_NUM; i++) {
+		if ((timer_pending & (1 << i)) && (timer_ctrl[i] & 4))
+			irq |= 1 << IR_TIMER;
+	}
+}
+
+// xoshiro128** as wb_random, which steps on every clock when free-running, here it steps once per number in both modes
+uint32_t iss_soc::random_next() {
+	uint32_t *s = random_state;
+	if ((s[0] | s[1] | s[2] | s[3]) == 0)
+		memcpy(s, RANDOM_SEED, sizeof(random_state));
+	uint32_t x = s[1] * 5;
+	uint32_t result = ((x << 7) | (x >> 25)) * 9;
+	uint32_t t = s[1] << 9;
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = (s[3] << 11) | (s[3] >> 21);
+	return result;
+}
+
+void iss_soc::trace_record(uint32_t word, uint64_t cycle) {
+	if ((trace_ctrl & 4) && trace_count >= TRACE_ENTRY_NUM) {
+		trace_dropped++;
+		return;
+	}
+	trace_buf[trace_count % TRACE_ENTRY_NUM] = ((uint64_t)(uint32_t)(cycle - trace_base) << 32) | word;
+	trace_count++;
+}
+
+// wb_trace sees instructions leaving MEM stage, here they are recorded when they complete,
+// and samples falling inside one step are taken by the PC of that step
+void iss_soc::trace_step(uint32_t pc, bool retired, uint64_t cycle) {
+	if (!retired) {
+		trace_exception = true;
+		return;
+	}
+	if ((trace_ctrl & 1) && pc != trace_last_pc + 4)
+		trace_record((pc & ~3) | (trace_exception ? 2 : 1), cycle);
+	trace_last_pc = pc;
+	trace_exception = false;
+	if (trace_ctrl & 2) {
+		uint32_t interval = trace_interval ? trace_interval : 1;
+		while (trace_sample <= cycle) {
+			trace_record(pc & ~3, trace_sample);
+			trace_sample += interval;
+		}
+	}
+}
+
+void iss_soc::ps2_decoder_reset() {
+	ps2_events.clear();
+	ps2_event_of = false;
+	ps2_extended = false;
+	ps2_key_up = false;
+	ps2_skip = 0;
+	memset(ps2_key_down, 0, sizeof(ps2_key_down));
+	ps2_last_code = 0xFF;
+	ps2_last_time = 0;
+	ps2_last_up = false;
+	ps2_wait = now;
+	ps2_timeout_done = false;
+}
+
+// the same as ps2_decoder, events are {time in ms[31:16], 0[15:14], win, alt, ctrl, shift, repeat, key_up, key_code}
+void iss_soc::ps2_decode(uint8_t code) {
+	if (ps2_skip) {
+		ps2_skip--;
+		return;
+	}
+	switch (code) {
+		case 0xE1: ps2_skip = 7; return;
+		case 0xE0: ps2_extended = true; return;
+		case 0xF0: ps2_key_up = true; return;
+	}
+	uint32_t key = 0xFF;
+	for (size_t i=0; i<sizeof(PS2_KEYS)/sizeof(PS2_KEYS[0]); i++) {
+		if (PS2_KEYS[i][0] == ((ps2_extended ? 0x100 : 0) | code))
+			key = PS2_KEYS[i][1];
+	}
+	bool up = ps2_key_up;
+	ps2_extended = false;
+	ps2_key_up = false;
+	if (key == 0xFF)
+		return;
+	uint32_t time = ps2_time_ms();
+	bool modifier = (key >= 0xA0 && key <= 0xA5) || key == 0x5B || key == 0x5C;
+	bool repeated = ps2_key_down[key] == !up;
+	bool jitter = key == ps2_last_code && up == ps2_last_up && ((time - ps2_last_time) & 0xFFFF) < PS2_MIN_REPEAT_TIME;
+	if (jitter || (repeated && ((ps2_mode & 2) || modifier || up)))
+		return;
+	uint32_t event = (time << 16) | key | (up ? 1 << 8 : 0) | (repeated ? 1 << 9 : 0);
+	event |= (ps2_key_down[0xA0] || ps2_key_down[0xA1]) ? 1 << 10 : 0;
+	event |= (ps2_key_down[0xA2] || ps2_key_down[0xA3]) ? 1 << 11 : 0;
+	event |= (ps2_key_down[0xA4] || ps2_key_down[0xA5]) ? 1 << 12 : 0;
+	event |= (ps2_key_down[0x5B] || ps2_key_down[0x5C]) ? 1 << 13 : 0;
+	ps2_key_down[key] = !up;
+	ps2_last_code = key;
+	ps2_last_up = up;
+	ps2_last_time = time;
+	ps2_push(event);
+}
+
+// interrupt when the event count reaches mode[15:8], or on overflow
+void iss_soc::ps2_push(uint32_t event) {
+	if (ps2_events.size() >= PS2_EVENT_NUM) {
+		ps2_event_of = true;
+		irq |= 1 << IR_KEYBOARD;
+		return;
+	}
+	if (ps2_events.empty()) {
+		ps2_wait = now;
+		ps2_timeout_done = false;
+	}
+	ps2_events.push_back(event);
+	if (ps2_events.size() == ((ps2_mode >> 8) & 0xFF))
+		irq |= 1 << IR_KEYBOARD;
+}
+
+// millisecond counter of wb_ps2, counted from reset
+uint32_t iss_soc::ps2_time_ms() const {
+	return (uint32_t)(now / ((uint64_t)cpu_freq * 1000)) & 0xFFFF;
+}
+
+// cycle of the timeout interrupt for the oldest event, mode[23:16] in ms, 0 for never
+uint64_t iss_soc::ps2_timeout() const {
+	uint32_t timeout = (ps2_mode >> 16) & 0xFF;
+	return timeout ? ps2_wait + (uint64_t)timeout * cpu_freq * 1000 : UINT64_MAX;
+}
+
+void iss_soc::update(uint64_t cycle) {
+	now = cycle;
+	timer_check();
+	if (!ps2_queue.empty() && now >= ps2_next) {
+		ps2_data = ps2_queue.front();
+		ps2_queue.pop_front();
+		ps2_valid = true;
+		ps2_count++;
+		if (ps2_mode & 1)
+			ps2_decode(ps2_data);
+		else
+			irq |= 1 << IR_KEYBOARD;
+		ps2_next = now + (uint64_t)PS2_BYTE_US * cpu_freq;
+	}
+	if ((ps2_mode & 1) && !ps2_events.empty() && !ps2_timeout_done && now >= ps2_timeout()) {
+		ps2_timeout_done = true;
+		irq |= 1 << IR_KEYBOARD;
+	}
+	if (!uart_queue.empty() && now >= uart_next) {
+		// 10 bits per byte, the interrupt is approximated by raising it on every byte received
+		uart_rx.push_back(uart_queue.front());
+		uart_queue.pop_front();
+		uart_rx_count++;
+		irq |= 1 << IR_UART;
+		uart_next = now + (uint64_t)cpu_freq * 10000000 / baud;
+	}
+	while ((spi_mode & 1) && !spi_tx.empty() && now >= spi_next) {
+		// bytes go to the card only when it is selected, MISO is pulled up otherwise
+		uint8_t data = spi_tx.front();
+		spi_tx.pop_front();
+		spi_rx.push_back(sd ? sd->transfer((spi_mode >> 16) & 1, data) : 0xFF);
+		spi_count++;
+		if (spi_tx.empty())
+			irq |= 1 << IR_SPI;
+		else
+			spi_next += spi_byte_cycles();
+	}
+}
+
+// SCK is 5MHz / (baud_div + 1), the same as spi_core, 8 bits per byte
+uint64_t iss_soc::spi_byte_cycles() const {
+	return (uint64_t)16 * (((spi_mode >> 8) & 0xFF) + 1) * cpu_freq / 10;
+}
+
+uint64_t iss_soc::next_event() const {
+	uint64_t next = UINT64_MAX;
+	for (int i=0; i<TIMER_CHANNEL_NUM; i++) {
+		if ((timer_ctrl[i] & 1) && timer_cmp[i] < UINT64_MAX / cpu_freq) {
+			uint64_t cycle = (timer_cmp[i] * cpu_freq + dev_freq - 1) / dev_freq;
+			next = cycle < next ? cycle : next;
+		}
+	}
+	if (!ps2_queue.empty())
+		next = ps2_next < next ? ps2_next : next;
+	if ((ps2_mode & 1) && !ps2_events.empty() && !ps2_timeout_done)
+		next = ps2_timeout() < next ? ps2_timeout() : next;
+	if (!uart_queue.empty())
+		next = uart_next < next ? uart_next : next;
+	if ((spi_mode & 1) && !spi_tx.empty())
+		next = spi_next < next ? spi_next : next;
+	return next > now ? next : now;
+}
+
+void iss_soc::ps2_send(const std::vector<uint8_t> &codes) {
+	if (ps2_queue.empty() && ps2_next < now)
+		ps2_next = now;
+	ps2_queue.insert(ps2_queue.end(), codes.begin(), codes.end());
+}
+
+void iss_soc::uart_send(const std::string &text) {
+	if (uart_queue.empty() && uart_next < now)
+		uart_next = now;
+	uart_queue.insert(uart_queue.end(), text.begin(), text.end());
+}
+
+void iss_soc::set_switch(uint32_t value) {
+	if (value != sw)
+		irq |= 1 << IR_BOARD;
+	sw = value;
+}
+
+// BTNL, BTNR, BTNU, BTND, as {btn_s, btn_l, btn_r, btn_u, btn_d} in board register
+void iss_soc::set_button(int index, bool value) {
+	if (index < 0 || index > 3)
+		return;
+	uint32_t bit = 1 << (3 - index);
+	uint32_t prev = btn;
+	btn = value ? (btn | bit) : (btn & ~bit);
+	if (btn != prev)
+		irq |= 1 << IR_BOARD;
+}
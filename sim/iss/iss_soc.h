@@ -0,0 +1,159 @@
+#ifndef __ISS_SOC_H__
+#define __ISS_SOC_H__
+
+#include <stdint.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+class sd_model;
+
+// address map of Nexys3 SOC, the same as wb_arb, wb_memory_nexys3 and wb_dev_adapter
+#define RAM_BASE 0x00000000
+#define RAM_SIZE 0x01000000
+#define PCM_BASE 0xFF000000
+#define PCM_SIZE 0x01000000
+#define DEV_BASE 0xFFFF0000
+#define DEV_SLOT_BITS 8
+// scratchpad memory inside the core, the same as wb_mips, never cached and never on bus
+#define SPM_BASE 0xFE000000
+#define SPM_SIZE 0x00002000
+
+// device slots on wb_dev_adapter
+#define DEV_VGA 1
+#define DEV_BOARD 2
+#define DEV_KEYBOARD 3
+#define DEV_TIMER 4
+#define DEV_SPI 5
+#define DEV_UART 6
+#define DEV_RANDOM 7
+#define DEV_TRACE 8
+#define DEV_SLOT_NUM 10
+
+// interrupt bits in CP0 ICR
+#define IR_BOARD 2
+#define IR_KEYBOARD 3
+#define IR_TIMER 4
+#define IR_SPI 5
+#define IR_UART 6
+
+// default bus latencies in CPU cycles of one uncached word access, from request to acknowledge
+#define LATENCY_RAM 6
+#define LATENCY_PCM 8
+#define LATENCY_DEV 4
+#define LATENCY_BURST 1  // each following word of a cache line burst
+
+#define TIMER_CHANNEL_NUM 4
+#define PS2_EVENT_NUM 15  // key events held by wb_ps2, the same as EVENT_BUF_ADDR_WIDTH in top
+#define PS2_MIN_REPEAT_TIME 50  // in ms, the same as ps2_decoder
+#define SPI_BUF_SIZE 255  // bytes pending in TX and RX FIFOs of wb_spi together
+#define TRACE_ENTRY_NUM 1024  // the same as ENTRY_BITS of wb_trace in top
+
+
+// memories and devices seen by the CPU through wishbone bus, all times are in CPU cycles
+class iss_soc {
+public:
+	iss_soc();
+	void reset();
+	bool load(const char *file, uint32_t offset);  // load image into PCM
+	// physical accesses of 1, 2 or 4 bytes, data is right aligned, false on bus error
+	bool read(uint32_t addr, int size, uint32_t &data, uint32_t &latency);
+	bool write(uint32_t addr, int size, uint32_t data, uint32_t &latency);
+	uint32_t line_latency(uint32_t addr, uint32_t words) const;  // burst of one cache line
+	static bool is_device(uint32_t addr) { return addr >= DEV_BASE; }
+	static bool is_memory(uint32_t addr) { return addr - RAM_BASE < RAM_SIZE || addr - PCM_BASE < PCM_SIZE; }
+	static bool is_spm(uint32_t addr) { return addr - SPM_BASE < SPM_SIZE; }
+	void update(uint64_t now);  // advance devices to the given cycle
+	uint64_t next_event() const;  // earliest cycle that any device changes by itself
+	uint32_t irq;  // interrupt pulses since last taken by CPU, bits as CP0 ICR
+	// inputs
+	void ps2_send(const std::vector<uint8_t> &codes);
+	void uart_send(const std::string &text);
+	void set_switch(uint32_t value);
+	void set_button(int index, bool value);
+	// CPU, after each step, retired or exception
+	void trace_step(uint32_t pc, bool retired, uint64_t cycle);
+	// configurations
+	uint32_t cpu_freq;  // in MHz
+	uint32_t dev_freq;  // in MHz, clock of timer's counter
+	uint32_t baud;
+	uint32_t lat_ram, lat_pcm, lat_dev;
+	bool uart_echo;  // print UART output to stdout
+	sd_model *sd;  // card on the SD select line (bit 16 of SPI mode), NULL if none
+	// outputs
+	uint32_t led;
+	uint32_t disp_text;
+	// statistics
+	uint32_t uart_tx_count, uart_rx_count, ps2_count;
+	uint32_t spi_count;
+	uint32_t unmapped_count;
+private:
+	uint32_t dev_read(uint32_t addr);
+	void dev_write(uint32_t addr, uint32_t data, uint32_t sel);
+	void ps2_decoder_reset();
+	void ps2_decode(uint8_t code);
+	void ps2_push(uint32_t event);
+	uint32_t ps2_time_ms() const;
+	uint64_t ps2_timeout() const;
+	uint64_t timer_counter() const;
+	void timer_check();
+	uint64_t spi_byte_cycles() const;
+	uint32_t random_next();
+	void trace_record(uint32_t word, uint64_t cycle);
+	std::vector<uint8_t> ram;
+	std::vector<uint8_t> pcm;
+	std::vector<uint8_t> spm;
+	uint64_t now;
+	// VGA
+	uint32_t vga_regs[16];  // register 8 writes the tile map, which is not kept
+	// board
+	uint32_t sw;
+	uint32_t btn;
+	uint32_t disp_ctrl, disp_graphic;
+	// PS/2 keyboard
+	std::deque<uint8_t> ps2_queue;
+	uint64_t ps2_next;
+	uint8_t ps2_data;
+	bool ps2_valid;
+	// key event decoder of wb_ps2
+	uint32_t ps2_mode;
+	std::deque<uint32_t> ps2_events;
+	bool ps2_event_of;
+	bool ps2_extended, ps2_key_up;
+	uint32_t ps2_skip;
+	bool ps2_key_down[256];
+	uint32_t ps2_last_code, ps2_last_time;
+	bool ps2_last_up;
+	uint64_t ps2_wait;  // cycle that the oldest event starts to wait, reset by reading events
+	bool ps2_timeout_done;
+	// timer
+	uint32_t timer_high;
+	uint64_t timer_cmp[TIMER_CHANNEL_NUM];
+	uint32_t timer_period[TIMER_CHANNEL_NUM];
+	uint32_t timer_ctrl[TIMER_CHANNEL_NUM];
+	uint32_t timer_pending;
+	// SPI
+	uint32_t spi_mode;
+	std::deque<uint8_t> spi_tx, spi_rx;
+	uint64_t spi_next;  // cycle that the byte being shifted completes
+	bool spi_of, spi_uf;
+	// UART
+	uint32_t uart_mode;
+	std::deque<uint8_t> uart_queue;
+	std::deque<uint8_t> uart_rx;
+	uint64_t uart_next;
+	// random number generator
+	uint32_t random_state[4];
+	uint32_t random_begin, random_end;
+	uint32_t random_ctrl;
+	// trace unit
+	std::vector<uint64_t> trace_buf;  // {timestamp, word}
+	uint32_t trace_ctrl, trace_interval, trace_read;
+	uint32_t trace_count, trace_dropped;
+	uint64_t trace_base;  // cycle of timestamp 0
+	uint64_t trace_sample;  // cycle of next sample
+	uint32_t trace_last_pc;
+	bool trace_exception;  // exception taken since the last retired instruction
+};
+
+#endif
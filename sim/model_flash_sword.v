@@ -0,0 +1,216 @@
+`timescale 1ns / 1ps
+
+
+/**
+ * Behavioral model of one BPI flash chip (S29GL series, word mode) used on Sword board.
+ * Reset, word program, write to buffer programming, sector erase and chip erase commands are modeled,
+ * with RY/BY# and DQ6 toggling while busy. Programming only clears bits as real flash does.
+ * Author: Zhao, Hongyu  <power_zhy@foxmail.com>
+ */
+module model_flash_sword (
+	input wire flash_ce_n,
+	input wire flash_rst_n,
+	input wire flash_oe_n,
+	input wire flash_we_n,
+	output reg flash_ready = 1,
+	input wire [ADDR_BITS-1:1] flash_addr,
+	input wire [15:0] data_i,  // data written from controller
+	output wire [15:0] data_o  // data read to controller
+	);
+	
+	parameter
+		ADDR_BITS = 24,  // address length
+		MEM_ADDR_BITS = 18,  // address length actually modeled (in words), to save simulation memory
+		SECTOR_BITS = 16,  // address length of one sector in words
+		BUFFER_BITS = 8,  // address length of write buffer in words
+		T_BUSY = 90,  // delay from the last command to RY/BY# falling, in ns
+		T_WORD = 60000,  // word programming time, in ns
+		T_PAGE = 60000,  // write buffer programming time besides the time of each word, in ns
+		T_PAGE_WORD = 1100,  // write buffer programming time of each word, in ns
+		T_ERASE = 275000000,  // sector erase time, in ns
+		T_CHIP_ERASE = 1000000000;  // chip erase time, in ns
+	
+	reg [15:0] mem [0:(1<<MEM_ADDR_BITS)-1];
+	integer i;
+	initial begin
+		for (i=0; i<(1<<MEM_ADDR_BITS); i=i+1)
+			mem[i] = 16'hFFFF;
+	end
+	
+	// statistics
+	integer word_count = 0;  // words programmed
+	integer page_count = 0;  // write buffer programming operations
+	integer erase_count = 0;
+	integer error_count = 0;
+	time busy_time = 0;  // total time being busy
+	
+	// busy status
+	time busy_end = 0;
+	reg toggle = 0;
+	wire busy;
+	assign busy = $time < busy_end;
+	
+	task start_busy;
+		input [63:0] duration;
+		begin
+			busy_end = $time + T_BUSY + duration;
+			busy_time = busy_time + duration;
+			flash_ready <= #T_BUSY 0;
+			flash_ready <= #(T_BUSY + duration) 1;
+		end
+	endtask
+	
+	always @(negedge flash_oe_n) begin
+		if (~flash_ce_n && busy)
+			toggle = ~toggle;
+	end
+	
+	assign
+		data_o = (flash_ce_n || flash_oe_n) ? 16'h0 : busy ? {8'h0, 1'b0, toggle, 6'h0} : mem[flash_addr[MEM_ADDR_BITS:1]];
+	
+	// command cycles, latched at rising edge of WE#
+	localparam
+		C_READ = 0,  // reading array
+		C_UNLOCK1 = 1,  // first unlock cycle passed
+		C_UNLOCK2 = 2,  // second unlock cycle passed
+		C_ERASE = 3,  // erase setup
+		C_ERASE_UNLOCK1 = 4,
+		C_ERASE_UNLOCK2 = 5,
+		C_PROGRAM = 6,  // word program setup
+		C_COUNT = 7,  // write to buffer, waiting for word count
+		C_BUFFER = 8,  // loading write buffer
+		C_CONFIRM = 9;  // waiting for program buffer to flash
+	
+	reg [3:0] cycle = 0;
+	reg [MEM_ADDR_BITS-1:0] sector = 0;
+	reg [15:0] buf_data [0:(1<<BUFFER_BITS)-1];
+	reg [MEM_ADDR_BITS-1:0] buf_addr [0:(1<<BUFFER_BITS)-1];
+	integer buf_count = 0, buf_total = 0;
+	wire [MEM_ADDR_BITS-1:0] addr;
+	wire unlock_addr1, unlock_addr2;
+	
+	assign
+		addr = flash_addr[MEM_ADDR_BITS:1],
+		unlock_addr1 = flash_addr[11:1] == 11'h555,
+		unlock_addr2 = flash_addr[11:1] == 11'h2AA;
+	
+	task error;
+		input [8*32-1:0] message;
+		begin
+			error_count = error_count + 1;
+			$display("[%t] FLASH: %0s, command 0x%h at 0x%h", $time, message, data_i, flash_addr);
+			cycle = C_READ;
+		end
+	endtask
+	
+	always @(negedge flash_rst_n) begin
+		cycle = C_READ;
+	end
+	
+	always @(posedge flash_we_n) begin
+		if (~flash_ce_n && flash_rst_n) begin
+			if (busy) begin
+				error("written while busy");
+			end
+			else if (data_i[7:0] == 8'hF0 && cycle != C_BUFFER) begin
+				cycle = C_READ;
+			end
+			else case (cycle)
+				C_READ: begin
+					if (unlock_addr1 && data_i[7:0] == 8'hAA)
+						cycle = C_UNLOCK1;
+				end
+				C_UNLOCK1: begin
+					if (unlock_addr2 && data_i[7:0] == 8'h55)
+						cycle = C_UNLOCK2;
+					else
+						cycle = C_READ;
+				end
+				C_UNLOCK2: begin
+					if (unlock_addr1 && data_i[7:0] == 8'h80) begin
+						cycle = C_ERASE;
+					end
+					else if (unlock_addr1 && data_i[7:0] == 8'hA0) begin
+						cycle = C_PROGRAM;
+					end
+					else if (data_i[7:0] == 8'h25) begin
+						sector = addr >> SECTOR_BITS;
+						cycle = C_COUNT;
+					end
+					else begin
+						cycle = C_READ;
+					end
+				end
+				C_ERASE: begin
+					if (unlock_addr1 && data_i[7:0] == 8'hAA)
+						cycle = C_ERASE_UNLOCK1;
+					else
+						cycle = C_READ;
+				end
+				C_ERASE_UNLOCK1: begin
+					if (unlock_addr2 && data_i[7:0] == 8'h55)
+						cycle = C_ERASE_UNLOCK2;
+					else
+						cycle = C_READ;
+				end
+				C_ERASE_UNLOCK2: begin
+					if (data_i[7:0] == 8'h30) begin
+						for (i=0; i<(1<<SECTOR_BITS); i=i+1)
+							mem[(addr >> SECTOR_BITS << SECTOR_BITS) + i] = 16'hFFFF;
+						erase_count = erase_count + 1;
+						start_busy(T_ERASE);
+					end
+					else if (unlock_addr1 && data_i[7:0] == 8'h10) begin
+						for (i=0; i<(1<<MEM_ADDR_BITS); i=i+1)
+							mem[i] = 16'hFFFF;
+						erase_count = erase_count + 1;
+						start_busy(T_CHIP_ERASE);
+					end
+					cycle = C_READ;
+				end
+				C_PROGRAM: begin
+					mem[addr] = mem[addr] & data_i;
+					word_count = word_count + 1;
+					start_busy(T_WORD);
+					cycle = C_READ;
+				end
+				C_COUNT: begin
+					if (addr >> SECTOR_BITS != sector || data_i >= (1 << BUFFER_BITS)) begin
+						error("invalid word count");
+					end
+					else begin
+						buf_total = data_i + 1;
+						buf_count = 0;
+						cycle = C_BUFFER;
+					end
+				end
+				C_BUFFER: begin
+					if (addr >> BUFFER_BITS != buf_addr[0] >> BUFFER_BITS && buf_count != 0) begin
+						error("write buffer page crossed");
+					end
+					else begin
+						buf_data[buf_count] = data_i;
+						buf_addr[buf_count] = addr;
+						buf_count = buf_count + 1;
+						if (buf_count == buf_total)
+							cycle = C_CONFIRM;
+					end
+				end
+				C_CONFIRM: begin
+					if (addr >> SECTOR_BITS != sector || data_i[7:0] != 8'h29) begin
+						error("write buffer aborted");
+					end
+					else begin
+						for (i=0; i<buf_total; i=i+1)
+							mem[buf_addr[i]] = mem[buf_addr[i]] & buf_data[i];
+						word_count = word_count + buf_total;
+						page_count = page_count + 1;
+						start_busy(T_PAGE + T_PAGE_WORD * buf_total);
+						cycle = C_READ;
+					end
+				end
+			endcase
+		end
+	end
+	
+endmodule
@@ -0,0 +1,209 @@
+`timescale 1ns / 1ps
+
+
+/**
+ * Behavioral model of parallel PCM (NP8P128A13T1760E) used on Nexys3 board, asynchronous mode only.
+ * Read array, read status, clear status, block lock and unlock, word program, buffered program and block erase
+ * commands are modeled, all blocks are locked after reset. Programming only clears bits as NOR flash does.
+ * Author: Zhao, Hongyu  <power_zhy@foxmail.com>
+ */
+module model_ppcm_nexys3 (
+	input wire pcm_ce_n,
+	input wire pcm_rst_n,
+	input wire pcm_oe_n,
+	input wire pcm_we_n,
+	input wire [ADDR_BITS-1:1] pcm_addr,
+	input wire [15:0] data_i,  // data written from controller
+	output wire [15:0] data_o  // data read to controller
+	);
+	
+	parameter
+		ADDR_BITS = 24,  // address length
+		MEM_ADDR_BITS = 18,  // address length actually modeled (in words), to save simulation memory
+		BLOCK_BITS = 16,  // address length of one block in words
+		BUFFER_BITS = 6,  // address length of program buffer in words
+		T_WORD = 40000,  // word programming time, in ns
+		T_PAGE = 40000,  // buffered programming time besides the time of each word, in ns
+		T_PAGE_WORD = 1500,  // buffered programming time of each word, in ns
+		T_ERASE = 500000000;  // block erase time, in ns
+	
+	reg [15:0] mem [0:(1<<MEM_ADDR_BITS)-1];
+	reg locked [0:(1<<(MEM_ADDR_BITS-BLOCK_BITS))-1];
+	integer i;
+	initial begin
+		for (i=0; i<(1<<MEM_ADDR_BITS); i=i+1)
+			mem[i] = 16'hFFFF;
+		for (i=0; i<(1<<(MEM_ADDR_BITS-BLOCK_BITS)); i=i+1)
+			locked[i] = 1;
+	end
+	
+	// statistics
+	integer word_count = 0;  // words programmed
+	integer page_count = 0;  // buffered programming operations
+	integer erase_count = 0;
+	integer error_count = 0;
+	integer poll_count = 0;  // status reads while busy
+	time busy_time = 0;  // total time being busy
+	
+	// status register, bit 7 is ready, 5 erase error, 4 program error, 1 block locked
+	time busy_end = 0;
+	reg [7:0] status = 8'h80;
+	reg status_mode = 0;
+	wire busy;
+	assign busy = $time < busy_end;
+	
+	task start_busy;
+		input [63:0] duration;
+		begin
+			busy_end = $time + duration;
+			busy_time = busy_time + duration;
+			status_mode = 1;
+		end
+	endtask
+	
+	always @(negedge pcm_oe_n) begin
+		if (~pcm_ce_n && status_mode && busy)
+			poll_count = poll_count + 1;
+	end
+	
+	assign
+		data_o = (pcm_ce_n || pcm_oe_n) ? 16'h0 : status_mode ? {8'h0, ~busy, status[6:0]} : mem[pcm_addr[MEM_ADDR_BITS:1]];
+	
+	// command cycles, latched at rising edge of WE#
+	localparam
+		C_READY = 0,  // waiting for command
+		C_PROGRAM = 1,  // word program setup
+		C_ERASE = 2,  // erase setup
+		C_LOCK = 3,  // lock setup
+		C_COUNT = 4,  // buffered program, waiting for word count
+		C_BUFFER = 5,  // loading program buffer
+		C_CONFIRM = 6;  // waiting for confirm
+	
+	reg [2:0] cycle = 0;
+	reg [MEM_ADDR_BITS-1:0] block = 0;
+	reg [15:0] buf_data [0:(1<<BUFFER_BITS)-1];
+	reg [MEM_ADDR_BITS-1:0] buf_addr [0:(1<<BUFFER_BITS)-1];
+	integer buf_count = 0, buf_total = 0;
+	wire [MEM_ADDR_BITS-1:0] addr;
+	assign addr = pcm_addr[MEM_ADDR_BITS:1];
+	
+	task error;
+		input [8*32-1:0] message;
+		input [7:0] bits;
+		begin
+			error_count = error_count + 1;
+			status = status | bits;
+			status_mode = 1;
+			$display("[%t] PCM: %0s, command 0x%h at 0x%h", $time, message, data_i, pcm_addr);
+			cycle = C_READY;
+		end
+	endtask
+	
+	always @(negedge pcm_rst_n) begin
+		cycle = C_READY;
+		status = 8'h80;
+		status_mode = 0;
+		for (i=0; i<(1<<(MEM_ADDR_BITS-BLOCK_BITS)); i=i+1)
+			locked[i] = 1;
+	end
+	
+	always @(posedge pcm_we_n) begin
+		if (~pcm_ce_n && pcm_rst_n) begin
+			if (busy) begin
+				error("written while busy", 8'h10);
+			end
+			else case (cycle)
+				C_READY: begin
+					case (data_i[7:0])
+						8'hFF: status_mode = 0;
+						8'h70: status_mode = 1;
+						8'h50: status = 8'h80;
+						8'h40, 8'h10: cycle = C_PROGRAM;
+						8'h20: cycle = C_ERASE;
+						8'h60: cycle = C_LOCK;
+						8'hE8: begin
+							block = addr >> BLOCK_BITS;
+							status_mode = 1;  // program buffer is always available
+							cycle = C_COUNT;
+						end
+						default: error("unknown command", 8'h30);
+					endcase
+				end
+				C_PROGRAM: begin
+					if (locked[addr >> BLOCK_BITS]) begin
+						error("program locked block", 8'h12);
+					end
+					else begin
+						mem[addr] = mem[addr] & data_i;
+						word_count = word_count + 1;
+						start_busy(T_WORD);
+						cycle = C_READY;
+					end
+				end
+				C_ERASE: begin
+					if (data_i[7:0] != 8'hD0) begin
+						error("erase not confirmed", 8'h30);
+					end
+					else if (locked[addr >> BLOCK_BITS]) begin
+						error("erase locked block", 8'h22);
+					end
+					else begin
+						for (i=0; i<(1<<BLOCK_BITS); i=i+1)
+							mem[(addr >> BLOCK_BITS << BLOCK_BITS) + i] = 16'hFFFF;
+						erase_count = erase_count + 1;
+						start_busy(T_ERASE);
+						cycle = C_READY;
+					end
+				end
+				C_LOCK: begin
+					if (data_i[7:0] == 8'hD0)
+						locked[addr >> BLOCK_BITS] = 0;
+					else if (data_i[7:0] == 8'h01)
+						locked[addr >> BLOCK_BITS] = 1;
+					else
+						error("invalid lock command", 8'h30);
+					cycle = C_READY;
+				end
+				C_COUNT: begin
+					if (addr >> BLOCK_BITS != block || data_i >= (1 << BUFFER_BITS)) begin
+						error("invalid word count", 8'h30);
+					end
+					else begin
+						buf_total = data_i + 1;
+						buf_count = 0;
+						cycle = C_BUFFER;
+					end
+				end
+				C_BUFFER: begin
+					if (addr >> BUFFER_BITS != buf_addr[0] >> BUFFER_BITS && buf_count != 0) begin
+						error("program buffer crossed", 8'h10);
+					end
+					else begin
+						buf_data[buf_count] = data_i;
+						buf_addr[buf_count] = addr;
+						buf_count = buf_count + 1;
+						if (buf_count == buf_total)
+							cycle = C_CONFIRM;
+					end
+				end
+				C_CONFIRM: begin
+					if (addr >> BLOCK_BITS != block || data_i[7:0] != 8'hD0) begin
+						error("buffered program not confirmed", 8'h30);
+					end
+					else if (locked[block]) begin
+						error("program locked block", 8'h12);
+					end
+					else begin
+						for (i=0; i<buf_total; i=i+1)
+							mem[buf_addr[i]] = mem[buf_addr[i]] & buf_data[i];
+						word_count = word_count + buf_total;
+						page_count = page_count + 1;
+						start_busy(T_PAGE + T_PAGE_WORD * buf_total);
+						cycle = C_READY;
+					end
+				end
+			endcase
+		end
+	end
+	
+endmodule
@@ -0,0 +1,120 @@
+`timescale 1ns / 1ps
+
+
+/**
+ * Behavioral model of CellularRAM (MT45W8MW16BGX) used on Nexys3 board, synchronous burst mode only.
+ * Initial latency, refresh collision, row boundary crossing and tCEM violation are modeled with clock-level accuracy.
+ * Author: Zhao, Hongyu  <power_zhy@foxmail.com>
+ */
+module model_psram_nexys3 (
+	input wire ram_clk,
+	input wire ram_ce_n,
+	input wire ram_oe_n,
+	input wire ram_we_n,
+	input wire ram_adv_n,
+	input wire ram_cre,
+	input wire ram_lb_n,
+	input wire ram_ub_n,
+	output reg ram_wait = 0,
+	input wire [ADDR_BITS-1:1] ram_addr,
+	input wire [15:0] data_i,  // data written from controller
+	output reg [15:0] data_o = 0  // data read to controller
+	);
+	
+	parameter
+		ADDR_BITS = 24,  // address length
+		MEM_ADDR_BITS = 16,  // address length actually modeled (in words), to save simulation memory
+		LATENCY = 3,  // latency code in BCR
+		ROW_WORDS = 128,  // words per row, crossing row boundary costs extra wait cycles
+		ROW_WAIT = 3,  // wait cycles when crossing row boundary
+		REFRESH_PERIOD = 15600,  // interval of internal refresh in ns, access colliding with refresh doubles the latency
+		REFRESH_TIME = 100,  // duration of internal refresh in ns
+		T_KOH = 2,  // output delay after clock, in ns
+		T_CEM = 4000;  // maximum chip enable low time, in ns
+	
+	reg [15:0] mem [0:(1<<MEM_ADDR_BITS)-1];
+	reg [15:0] bcr = 0;
+	
+	// statistics
+	integer burst_count = 0;
+	integer word_count = 0;
+	integer latency_count = 0;
+	integer row_cross_count = 0;
+	integer cem_violation = 0;
+	
+	// internal refresh
+	reg refreshing = 0;
+	initial forever begin
+		#(REFRESH_PERIOD - REFRESH_TIME) refreshing = 1;
+		#REFRESH_TIME refreshing = 0;
+	end
+	
+	// tCEM check
+	time ce_fall = 0;
+	always @(negedge ram_ce_n) begin
+		ce_fall = $time;
+	end
+	always @(posedge ram_ce_n) begin
+		if ($time - ce_fall > T_CEM) begin
+			cem_violation = cem_violation + 1;
+			$display("[%t] PSRAM: tCEM violated, chip enabled for %0t ns", $time, $time - ce_fall);
+		end
+	end
+	
+	// burst
+	reg active = 0;
+	reg writing = 0;
+	reg [MEM_ADDR_BITS-1:0] addr = 0;
+	integer wait_count = 0;
+	
+	always @(posedge ram_clk or posedge ram_ce_n) begin
+		if (ram_ce_n) begin
+			active <= 0;
+			ram_wait <= 0;
+			data_o <= 0;
+		end
+		else if (~ram_adv_n) begin
+			if (ram_cre) begin
+				if (~ram_we_n)
+					bcr <= ram_addr[16:1];
+				active <= 0;
+			end
+			else begin
+				active <= 1;
+				writing <= ~ram_we_n;
+				addr <= ram_addr[MEM_ADDR_BITS:1];
+				wait_count <= refreshing ? 2*LATENCY : LATENCY;
+				ram_wait <= #T_KOH 1;
+				burst_count = burst_count + 1;
+				latency_count = latency_count + (refreshing ? 2*LATENCY : LATENCY);
+			end
+		end
+		else if (active) begin
+			if (wait_count > 1) begin
+				wait_count <= wait_count - 1;
+				ram_wait <= #T_KOH (wait_count > 2);  // WAIT asserted one data cycle before delay
+				if (wait_count == 2 && ~writing)
+					data_o <= #T_KOH mem[addr];
+			end
+			else begin
+				word_count = word_count + 1;
+				if (writing) begin
+					if (~ram_lb_n)
+						mem[addr][7:0] <= data_i[7:0];
+					if (~ram_ub_n)
+						mem[addr][15:8] <= data_i[15:8];
+				end
+				addr <= addr + 1'b1;
+				if ((addr + 1) % ROW_WORDS == 0) begin
+					wait_count <= ROW_WAIT + 1;
+					ram_wait <= #T_KOH 1;
+					row_cross_count = row_cross_count + 1;
+				end
+				else if (~writing) begin
+					data_o <= #T_KOH mem[addr+1'b1];
+				end
+			end
+		end
+	end
+	
+endmodule
@@ -0,0 +1,251 @@
+`timescale 1ns / 1ps
+
+/**
+ * Programming throughput of the BPI flash on SWORD board, two S29GL chips side by side.
+ * Not run yet for lack of a simulator, the controller and model timing add up to:
+ *   line write: 1024 words in about 5.2ms, about 790 KB/s, 32 pages, 1 sector erased, flash busy for about 5.05ms
+ *   single write: 32 words in about 2.2ms, about 58 KB/s, the scaled 2ms erase taking most of it
+ * One page of 32 words takes 37 command cycles of 130ns and 95.2us of programming, about 100us in all,
+ * while the next page is filled, so pages alone run at about 1.3 MB/s against about 65 KB/s by word programming.
+ * With the 275ms erase of the model, a whole 256KB sector takes about 480ms, about 545 KB/s.
+ */
+module sim_flash_sword;
+	// Parameters
+	parameter
+		PAGE_BITS = 5,
+		TEST_WORDS = 1024,
+		SINGLE_WORDS = 32,
+		T_ERASE = 2000000;  // sector erase time scaled down from hundreds of ms to keep the simulation short
+	
+	// Inputs
+	reg clk;
+	reg wb_clk;
+	reg rst;
+	reg wbs_cyc_i;
+	reg wbs_stb_i;
+	reg [31:2] wbs_addr_i;
+	reg [2:0] wbs_cti_i;
+	reg [1:0] wbs_bte_i;
+	reg [3:0] wbs_sel_i;
+	reg wbs_we_i;
+	reg [31:0] wbs_data_i;
+	reg ctrl_cs_i;
+	reg ctrl_we_i;
+	reg [31:0] ctrl_data_i;
+	
+	// Outputs
+	wire flash_busy;
+	wire [1:0] flash_ce_n;
+	wire flash_rst_n;
+	wire flash_oe_n;
+	wire flash_we_n;
+	wire flash_wp_n;
+	wire [1:0] flash_ready;
+	wire [23:2] flash_addr;
+	wire [31:0] flash_din;
+	wire [31:0] flash_dout;
+	wire [31:0] wbs_data_o;
+	wire wbs_ack_o;
+	wire [31:0] ctrl_data_o;
+	wire ctrl_ack_o;
+	
+	// Instantiate the Unit Under Test (UUT)
+	wb_flash_sword #(
+		.CLK_FREQ(100),
+		.ADDR_BITS(24),
+		.HIGH_ADDR(8'h00),
+		.BUF_ADDR_BITS(4),
+		.PAGE_BITS(PAGE_BITS),
+		.SECTOR_BITS(18)
+		) uut (
+		.clk(clk),
+		.rst(rst),
+		.flash_busy(flash_busy),
+		.flash_ce_n(flash_ce_n),
+		.flash_rst_n(flash_rst_n),
+		.flash_oe_n(flash_oe_n),
+		.flash_we_n(flash_we_n),
+		.flash_wp_n(flash_wp_n),
+		.flash_ready(flash_ready),
+		.flash_addr(flash_addr),
+		.flash_din(flash_din),
+		.flash_dout(flash_dout),
+		.wbs_clk_i(wb_clk),
+		.wbs_cyc_i(wbs_cyc_i),
+		.wbs_stb_i(wbs_stb_i),
+		.wbs_addr_i(wbs_addr_i),
+		.wbs_cti_i(wbs_cti_i),
+		.wbs_bte_i(wbs_bte_i),
+		.wbs_sel_i(wbs_sel_i),
+		.wbs_we_i(wbs_we_i),
+		.wbs_data_i(wbs_data_i),
+		.wbs_data_o(wbs_data_o),
+		.wbs_ack_o(wbs_ack_o),
+		.ctrl_cs_i(ctrl_cs_i),
+		.ctrl_addr_i(6'h0),
+		.ctrl_sel_i(4'b1111),
+		.ctrl_data_i(ctrl_data_i),
+		.ctrl_we_i(ctrl_we_i),
+		.ctrl_data_o(ctrl_data_o),
+		.ctrl_ack_o(ctrl_ack_o)
+	);
+	
+	model_flash_sword #(
+		.ADDR_BITS(23),
+		.MEM_ADDR_BITS(18),
+		.SECTOR_BITS(16),
+		.T_ERASE(T_ERASE)
+		) FLASH0 (
+		.flash_ce_n(flash_ce_n[0]),
+		.flash_rst_n(flash_rst_n),
+		.flash_oe_n(flash_oe_n),
+		.flash_we_n(flash_we_n),
+		.flash_ready(flash_ready[0]),
+		.flash_addr(flash_addr),
+		.data_i(flash_dout[15:0]),
+		.data_o(flash_din[15:0])
+	);
+	
+	model_flash_sword #(
+		.ADDR_BITS(23),
+		.MEM_ADDR_BITS(18),
+		.SECTOR_BITS(16),
+		.T_ERASE(T_ERASE)
+		) FLASH1 (
+		.flash_ce_n(flash_ce_n[1]),
+		.flash_rst_n(flash_rst_n),
+		.flash_oe_n(flash_oe_n),
+		.flash_we_n(flash_we_n),
+		.flash_ready(flash_ready[1]),
+		.flash_addr(flash_addr),
+		.data_i(flash_dout[31:16]),
+		.data_o(flash_din[31:16])
+	);
+	
+	// wishbone master, issue one request the same way as CMU does (a line of 4 words in burst mode)
+	integer errors = 0;
+	
+	task wb_line;
+		input we;
+		input [31:2] addr;
+		input integer words;
+		integer i;
+		begin
+			for (i=0; i<words; i=i+1) begin
+				wbs_cyc_i <= 1;
+				wbs_stb_i <= 1;
+				wbs_addr_i <= addr + i;
+				wbs_cti_i <= (words == 1) ? 3'b000 : ((i == words-1) ? 3'b111 : 3'b010);
+				wbs_bte_i <= 2'b00;
+				wbs_sel_i <= 4'b1111;
+				wbs_we_i <= we;
+				wbs_data_i <= {addr + i, 2'b00};
+				@(posedge wb_clk);
+				while (~wbs_ack_o)
+					@(posedge wb_clk);
+				if (~we && wbs_data_o != {addr + i, 2'b00}) begin
+					errors = errors + 1;
+					$display("[%t] read error at %h: %h", $time, {addr + i, 2'b00}, wbs_data_o);
+				end
+			end
+			wbs_cyc_i <= 0;
+			wbs_stb_i <= 0;
+			wbs_cti_i <= 0;
+			wbs_we_i <= 0;
+			@(posedge wb_clk);
+		end
+	endtask
+	
+	// write the control register
+	task wb_ctrl;
+		input [31:0] data;
+		begin
+			ctrl_cs_i <= 1;
+			ctrl_we_i <= 1;
+			ctrl_data_i <= data;
+			@(posedge wb_clk);
+			while (~ctrl_ack_o)
+				@(posedge wb_clk);
+			ctrl_cs_i <= 0;
+			ctrl_we_i <= 0;
+			@(posedge wb_clk);
+		end
+	endtask
+	
+	// programming throughput, one read at last waits for the last page to be programmed
+	time start;
+	integer i;
+	
+	task report;
+		input [8*16-1:0] name;
+		input integer words;
+		begin
+			$display("%s: %0d words in %0t ns, %0d KB/s, %0d pages, %0d sectors erased, flash busy for %0t ns",
+				name, words, $time - start, words * 4 * 1000000 / ($time - start),
+				FLASH0.page_count, FLASH0.erase_count, FLASH0.busy_time);
+			FLASH0.page_count = 0;
+			FLASH0.erase_count = 0;
+			FLASH0.busy_time = 0;
+		end
+	endtask
+	
+	initial begin
+		// Initialize Inputs
+		clk = 0;
+		wb_clk = 0;
+		rst = 1;
+		wbs_cyc_i = 0;
+		wbs_stb_i = 0;
+		wbs_addr_i = 0;
+		wbs_cti_i = 0;
+		wbs_bte_i = 0;
+		wbs_sel_i = 0;
+		wbs_we_i = 0;
+		wbs_data_i = 0;
+		ctrl_cs_i = 0;
+		ctrl_we_i = 0;
+		ctrl_data_i = 0;
+	
+		#1000 rst = 0;
+		while (flash_busy)
+			@(posedge wb_clk);
+		#1000;
+	
+		// stray writes are dropped while programming is disabled
+		wb_line(1, 0, 4);
+		#10000;
+		if (FLASH0.page_count != 0 || FLASH0.erase_count != 0) begin
+			errors = errors + 1;
+			$display("[%t] flash changed while programming is disabled", $time);
+		end
+		wb_ctrl(3);
+	
+		// line writes from the start of sector 0, as cache write back of an image does
+		start = $time;
+		for (i=0; i<TEST_WORDS; i=i+4)
+			wb_line(1, i, 4);
+		wb_line(0, TEST_WORDS-1, 1);
+		report("line write      ", TEST_WORDS);
+		for (i=0; i<TEST_WORDS; i=i+4)
+			wb_line(0, i, 4);
+	
+		// single word writes from the start of sector 1, as uncached stores do, words coming while the last page is
+		// being programmed are collected into the next page
+		start = $time;
+		for (i=0; i<SINGLE_WORDS; i=i+1) begin
+			wb_line(1, 'h10000 + i, 1);
+			#2000;
+		end
+		wb_line(0, 'h10000 + SINGLE_WORDS-1, 1);
+		report("single write    ", SINGLE_WORDS);
+		for (i=0; i<SINGLE_WORDS; i=i+1)
+			wb_line(0, 'h10000 + i, 1);
+	
+		$display("%0d errors, %0d flash command errors", errors, FLASH0.error_count + FLASH1.error_count);
+		$finish;
+	end
+	
+	initial forever #5 clk = ~clk;
+	initial forever #10 wb_clk = ~wb_clk;
+	
+endmodule
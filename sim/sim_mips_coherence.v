@@ -0,0 +1,461 @@
+`timescale 1ns / 1ps
+
+/**
+ * Coherence stress test of two cores sharing one wishbone bus, both running the same program from ROM with cached pages.
+ * Both cores increment their own counters inside one shared cache line, which loses updates if a line written by one core
+ * is written back stale by the other. Core 0 also passes messages to core 1 through a data line and a flag, and waits for
+ * every acknowledgement, which hangs if a core keeps hitting a stale copy in its cache.
+ * Both cores also increment one shared counter by LL/SC in every iteration, which loses updates if SC ever succeeds after
+ * the other core has written the counter since LL.
+ */
+module sim_mips_coherence;
+	`include "mips_define.vh"
+	// Parameters
+	parameter
+		COHERENT = 1,  // set to 0 to see the test fail without snooping
+		LOOP_COUNT = 64,  // iterations of each core
+		MEM_LATENCY = 3,  // clocks before the first word of an access
+		TIMEOUT = 200000;  // clocks before giving up
+	
+	// Inputs
+	reg clk;
+	reg rst;
+	
+	// bus signals of four masters and two slaves
+	wire ic0_cyc, ic0_stb, ic0_we, ic0_ack, ic0_err;
+	wire dc0_cyc, dc0_stb, dc0_we, dc0_ack, dc0_err;
+	wire ic1_cyc, ic1_stb, ic1_we, ic1_ack, ic1_err;
+	wire dc1_cyc, dc1_stb, dc1_we, dc1_ack, dc1_err;
+	wire [31:2] ic0_addr, dc0_addr, ic1_addr, dc1_addr;
+	wire [2:0] ic0_cti, dc0_cti, ic1_cti, dc1_cti;
+	wire [1:0] ic0_bte, dc0_bte, ic1_bte, dc1_bte;
+	wire [3:0] ic0_sel, dc0_sel, ic1_sel, dc1_sel;
+	wire [31:0] ic0_din, dc0_din, ic1_din, dc1_din;
+	wire [31:0] ic0_dout, dc0_dout, ic1_dout, dc1_dout;
+	wire ram_cyc, ram_stb, ram_we, rom_cyc, rom_stb, rom_we, dev_cyc, dev_stb, dev_we;
+	wire [31:2] ram_addr, rom_addr, dev_addr;
+	wire [3:0] ram_sel, rom_sel, dev_sel;
+	wire [31:0] ram_din, rom_din, dev_din;
+	reg [31:0] ram_dout, rom_dout;
+	reg ram_ack, rom_ack;
+	wire [31:2] snoop_addr;
+	wire snoop_we;
+	wire [2:0] snoop_master;
+	
+	// Instantiate the Unit Under Test (UUT)
+	wb_mips #(
+		.CLK_FREQ(10),
+		.CPU_ID(0),
+		.COHERENT(COHERENT),
+		.ICMU_MASTER(1),
+		.DCMU_MASTER(2)
+		) uut0 (
+		.clk(clk),
+		.rst(rst),
+		`ifdef DEBUG
+		.debug_en(1'b0),
+		.debug_step(1'b0),
+		.debug_addr(7'b0),
+		.debug_data(),
+		`endif
+		.icmu_clk_i(clk),
+		.icmu_cyc_o(ic0_cyc),
+		.icmu_stb_o(ic0_stb),
+		.icmu_addr_o(ic0_addr),
+		.icmu_cti_o(ic0_cti),
+		.icmu_bte_o(ic0_bte),
+		.icmu_sel_o(ic0_sel),
+		.icmu_we_o(ic0_we),
+		.icmu_data_i(ic0_din),
+		.icmu_data_o(ic0_dout),
+		.icmu_ack_i(ic0_ack),
+		.icmu_err_i(ic0_err),
+		.dcmu_clk_i(clk),
+		.dcmu_cyc_o(dc0_cyc),
+		.dcmu_stb_o(dc0_stb),
+		.dcmu_addr_o(dc0_addr),
+		.dcmu_cti_o(dc0_cti),
+		.dcmu_bte_o(dc0_bte),
+		.dcmu_sel_o(dc0_sel),
+		.dcmu_we_o(dc0_we),
+		.dcmu_data_i(dc0_din),
+		.dcmu_data_o(dc0_dout),
+		.dcmu_ack_i(dc0_ack),
+		.dcmu_err_i(dc0_err),
+		.snoop_addr(snoop_addr),
+		.snoop_we(snoop_we),
+		.snoop_master(snoop_master),
+		.ir_map(30'b0),
+		.wd_rst()
+	);
+	
+	wb_mips #(
+		.CLK_FREQ(10),
+		.CPU_ID(1),
+		.COHERENT(COHERENT),
+		.ICMU_MASTER(4),
+		.DCMU_MASTER(5)
+		) uut1 (
+		.clk(clk),
+		.rst(rst),
+		`ifdef DEBUG
+		.debug_en(1'b0),
+		.debug_step(1'b0),
+		.debug_addr(7'b0),
+		.debug_data(),
+		`endif
+		.icmu_clk_i(clk),
+		.icmu_cyc_o(ic1_cyc),
+		.icmu_stb_o(ic1_stb),
+		.icmu_addr_o(ic1_addr),
+		.icmu_cti_o(ic1_cti),
+		.icmu_bte_o(ic1_bte),
+		.icmu_sel_o(ic1_sel),
+		.icmu_we_o(ic1_we),
+		.icmu_data_i(ic1_din),
+		.icmu_data_o(ic1_dout),
+		.icmu_ack_i(ic1_ack),
+		.icmu_err_i(ic1_err),
+		.dcmu_clk_i(clk),
+		.dcmu_cyc_o(dc1_cyc),
+		.dcmu_stb_o(dc1_stb),
+		.dcmu_addr_o(dc1_addr),
+		.dcmu_cti_o(dc1_cti),
+		.dcmu_bte_o(dc1_bte),
+		.dcmu_sel_o(dc1_sel),
+		.dcmu_we_o(dc1_we),
+		.dcmu_data_i(dc1_din),
+		.dcmu_data_o(dc1_dout),
+		.dcmu_ack_i(dc1_ack),
+		.dcmu_err_i(dc1_err),
+		.snoop_addr(snoop_addr),
+		.snoop_we(snoop_we),
+		.snoop_master(snoop_master),
+		.ir_map(30'b0),
+		.wd_rst()
+	);
+	
+	wb_arb ARB (
+		.wb_clk(clk),
+		.wb_rst(rst),
+		.m0_cyc_i(1'b0),
+		.m0_stb_i(1'b0),
+		.m0_addr_i(30'b0),
+		.m0_cti_i(3'b0),
+		.m0_bte_i(2'b0),
+		.m0_sel_i(4'b0),
+		.m0_we_i(1'b0),
+		.m0_data_o(),
+		.m0_data_i(32'b0),
+		.m0_ack_o(),
+		.m0_err_o(),
+		.m1_cyc_i(ic0_cyc),
+		.m1_stb_i(ic0_stb),
+		.m1_addr_i(ic0_addr),
+		.m1_cti_i(ic0_cti),
+		.m1_bte_i(ic0_bte),
+		.m1_sel_i(ic0_sel),
+		.m1_we_i(ic0_we),
+		.m1_data_o(ic0_din),
+		.m1_data_i(ic0_dout),
+		.m1_ack_o(ic0_ack),
+		.m1_err_o(ic0_err),
+		.m2_cyc_i(dc0_cyc),
+		.m2_stb_i(dc0_stb),
+		.m2_addr_i(dc0_addr),
+		.m2_cti_i(dc0_cti),
+		.m2_bte_i(dc0_bte),
+		.m2_sel_i(dc0_sel),
+		.m2_we_i(dc0_we),
+		.m2_data_o(dc0_din),
+		.m2_data_i(dc0_dout),
+		.m2_ack_o(dc0_ack),
+		.m2_err_o(dc0_err),
+		.m3_cyc_i(1'b0),
+		.m3_stb_i(1'b0),
+		.m3_addr_i(30'b0),
+		.m3_cti_i(3'b0),
+		.m3_bte_i(2'b0),
+		.m3_sel_i(4'b0),
+		.m3_we_i(1'b0),
+		.m3_data_o(),
+		.m3_data_i(32'b0),
+		.m3_ack_o(),
+		.m3_err_o(),
+		.m4_cyc_i(ic1_cyc),
+		.m4_stb_i(ic1_stb),
+		.m4_addr_i(ic1_addr),
+		.m4_cti_i(ic1_cti),
+		.m4_bte_i(ic1_bte),
+		.m4_sel_i(ic1_sel),
+		.m4_we_i(ic1_we),
+		.m4_data_o(ic1_din),
+		.m4_data_i(ic1_dout),
+		.m4_ack_o(ic1_ack),
+		.m4_err_o(ic1_err),
+		.m5_cyc_i(dc1_cyc),
+		.m5_stb_i(dc1_stb),
+		.m5_addr_i(dc1_addr),
+		.m5_cti_i(dc1_cti),
+		.m5_bte_i(dc1_bte),
+		.m5_sel_i(dc1_sel),
+		.m5_we_i(dc1_we),
+		.m5_data_o(dc1_din),
+		.m5_data_i(dc1_dout),
+		.m5_ack_o(dc1_ack),
+		.m5_err_o(dc1_err),
+		.s0_cyc_o(ram_cyc),
+		.s0_stb_o(ram_stb),
+		.s0_addr_o(ram_addr),
+		.s0_cti_o(),
+		.s0_bte_o(),
+		.s0_sel_o(ram_sel),
+		.s0_we_o(ram_we),
+		.s0_data_i(ram_dout),
+		.s0_data_o(ram_din),
+		.s0_ack_i(ram_ack),
+		.s0_err_i(1'b0),
+		.s1_cyc_o(rom_cyc),
+		.s1_stb_o(rom_stb),
+		.s1_addr_o(rom_addr),
+		.s1_cti_o(),
+		.s1_bte_o(),
+		.s1_sel_o(rom_sel),
+		.s1_we_o(rom_we),
+		.s1_data_i(rom_dout),
+		.s1_data_o(rom_din),
+		.s1_ack_i(rom_ack),
+		.s1_err_i(1'b0),
+		.s2_cyc_o(dev_cyc),
+		.s2_stb_o(dev_stb),
+		.s2_addr_o(dev_addr),
+		.s2_cti_o(),
+		.s2_bte_o(),
+		.s2_sel_o(dev_sel),
+		.s2_we_o(dev_we),
+		.s2_data_i(32'b0),
+		.s2_data_o(dev_din),
+		.s2_ack_i(dev_cyc & dev_stb),
+		.s2_err_i(1'b0),
+		.snoop_addr_o(snoop_addr),
+		.snoop_we_o(snoop_we),
+		.snoop_master_o(snoop_master)
+	);
+	
+	// memories, the first word of each access is delayed, then one word per clock as bursts of memory adapters
+	reg [31:0] ram [0:16383];
+	reg [31:0] rom [0:1023];
+	reg [3:0] ram_wait, rom_wait;
+	
+	always @(*) begin
+		ram_ack = ram_cyc & ram_stb & (ram_wait == 0);
+		ram_dout = ram[ram_addr[15:2]];
+		rom_ack = rom_cyc & rom_stb & (rom_wait == 0);
+		rom_dout = rom[rom_addr[11:2]];
+	end
+	
+	always @(posedge clk) begin
+		if (~ram_cyc)
+			ram_wait <= MEM_LATENCY;
+		else if (ram_wait != 0)
+			ram_wait <= ram_wait - 1'h1;
+		if (~rom_cyc)
+			rom_wait <= MEM_LATENCY;
+		else if (rom_wait != 0)
+			rom_wait <= rom_wait - 1'h1;
+		if (ram_ack && ram_we) begin
+			if (ram_sel[0]) ram[ram_addr[15:2]][7:0] <= ram_din[7:0];
+			if (ram_sel[1]) ram[ram_addr[15:2]][15:8] <= ram_din[15:8];
+			if (ram_sel[2]) ram[ram_addr[15:2]][23:16] <= ram_din[23:16];
+			if (ram_sel[3]) ram[ram_addr[15:2]][31:24] <= ram_din[31:24];
+		end
+	end
+	
+	// instruction encoding
+	function [31:0] I_TYPE;
+		input [5:0] op;
+		input [4:0] rs, rt;
+		input [15:0] imm;
+		I_TYPE = {op, rs, rt, imm};
+	endfunction
+	
+	function [31:0] R_TYPE;
+		input [4:0] rs, rt, rd, sa;
+		input [5:0] func;
+		R_TYPE = {6'b000000, rs, rt, rd, sa, func};
+	endfunction
+	
+	function [31:0] J_TYPE;
+		input [5:0] op;
+		input [31:0] target;
+		J_TYPE = {op, target[27:2]};
+	endfunction
+	
+	function [31:0] CP0_TYPE;
+		input [3:0] func;
+		input [4:0] rt, rd;
+		CP0_TYPE = {INST_CP0, 1'b0, func, rt, rd, 11'b0};
+	endfunction
+	
+	localparam
+		NOP = 32'h0000_0000;
+	
+	// memory layout, the first 4MB of RAM is mapped to itself by one large page and the first 4KB of ROM by a page table, all cacheable
+	localparam
+		ADDR_MAIN = 32'hFF00_0000,
+		ADDR_PDT = 32'h0000_1000,
+		ADDR_PT_ROM = 32'h0000_3000,
+		ADDR_COUNTER = 32'h0000_4000,  // counters of both cores in one line
+		ADDR_FLAG = 32'h0000_4100,  // sequence number of the message
+		ADDR_DATA = 32'h0000_4200,  // message, one line filled with the sequence number
+		ADDR_ACK = 32'h0000_4300,  // sequence number acknowledged by core 1
+		ADDR_ERROR = 32'h0000_4400,  // messages found stale by core 1
+		ADDR_DONE = 32'h0000_4500,  // loop counts of both cores when finished
+		ADDR_ATOMIC = 32'h0000_4600;  // counter shared by both cores, incremented by LL/SC
+	localparam
+		PAGE_ATTR = 32'h1F,  // valid, user, write, execute, cache
+		PAGE_LARGE = 32'h80;  // 4MB page in page directory
+	
+	integer pc, i, loop;
+	integer addr_core1, addr_wait0, addr_wait1, addr_retry, addr_end;
+	
+	task emit;
+		input [31:0] inst;
+		begin
+			rom[pc[11:2]] = inst;
+			pc = pc + 4;
+		end
+	endtask
+	
+	task emit_atomic_inc;
+		begin
+			addr_retry = pc;
+			emit(I_TYPE(INST_LL, 0, GPR_T0, ADDR_ATOMIC[15:0]));
+			emit(I_TYPE(INST_ADDIU, GPR_T0, GPR_T0, 1));
+			emit(I_TYPE(INST_SC, 0, GPR_T0, ADDR_ATOMIC[15:0]));
+			emit(I_TYPE(INST_BEQ, GPR_T0, 0, (addr_retry - pc - 4) >> 2));
+			emit(NOP);
+		end
+	endtask
+	
+	initial begin
+		for (i=0; i<1024; i=i+1)
+			rom[i] = NOP;
+		for (i=0; i<16384; i=i+1)
+			ram[i] = 0;
+		ram[ADDR_PDT[15:2]] = PAGE_LARGE | PAGE_ATTR;
+		ram[ADDR_PDT[15:2] + 10'h3FC] = ADDR_PT_ROM | PAGE_ATTR;
+		ram[ADDR_PT_ROM[15:2]] = ADDR_MAIN | PAGE_ATTR;
+		// both cores: enable MMU, registers: s0 own counter, s2 flag, s3 data, s4 ack, s5 loop count, s6 sequence
+		// s7 CPU ID, fp errors
+		pc = ADDR_MAIN;
+		emit(CP0_TYPE(CP_FUNC_MF, GPR_S7, CP0_CIDR));
+		emit(I_TYPE(INST_ORI, 0, GPR_T0, ADDR_PDT[15:0] | 1));
+		emit(CP0_TYPE(CP_FUNC_MT, GPR_T0, CP0_PDBR));
+		emit(NOP);
+		emit(NOP);
+		emit(R_TYPE(0, GPR_S7, GPR_T1, 2, R_FUNC_SLL));
+		emit(I_TYPE(INST_ORI, GPR_T1, GPR_S0, ADDR_COUNTER[15:0]));
+		emit(I_TYPE(INST_ORI, 0, GPR_S2, ADDR_FLAG[15:0]));
+		emit(I_TYPE(INST_ORI, 0, GPR_S3, ADDR_DATA[15:0]));
+		emit(I_TYPE(INST_ORI, 0, GPR_S4, ADDR_ACK[15:0]));
+		emit(I_TYPE(INST_ORI, 0, GPR_S5, LOOP_COUNT));
+		emit(I_TYPE(INST_ORI, 0, GPR_S6, 0));
+		emit(I_TYPE(INST_ORI, 0, GPR_FP, 0));
+		emit(I_TYPE(INST_BNE, GPR_S7, 0, 16'hFFFF));  // patched below
+		emit(NOP);
+		// core 0: increment own counter, write message then flag, wait for acknowledgement
+		loop = pc;
+		emit(I_TYPE(INST_ADDIU, GPR_S6, GPR_S6, 1));
+		emit(I_TYPE(INST_LW, GPR_S0, GPR_T0, 0));
+		emit(NOP);
+		emit(I_TYPE(INST_ADDIU, GPR_T0, GPR_T0, 1));
+		emit(I_TYPE(INST_SW, GPR_S0, GPR_T0, 0));
+		emit_atomic_inc;
+		emit(I_TYPE(INST_SW, GPR_S3, GPR_S6, 0));
+		emit(I_TYPE(INST_SW, GPR_S3, GPR_S6, 4));
+		emit(I_TYPE(INST_SW, GPR_S3, GPR_S6, 8));
+		emit(I_TYPE(INST_SW, GPR_S3, GPR_S6, 12));
+		emit(I_TYPE(INST_SW, GPR_S2, GPR_S6, 0));
+		addr_wait0 = pc;
+		emit(I_TYPE(INST_LW, GPR_S4, GPR_T0, 0));
+		emit(NOP);
+		emit(I_TYPE(INST_BNE, GPR_T0, GPR_S6, (addr_wait0 - pc - 4) >> 2));
+		emit(NOP);
+		emit(I_TYPE(INST_BNE, GPR_S6, GPR_S5, (loop - pc - 4) >> 2));
+		emit(NOP);
+		emit(J_TYPE(INST_J, 0));  // patched below
+		emit(NOP);
+		// core 1: increment own counter, wait for flag, check message, acknowledge
+		addr_core1 = pc;
+		rom[(ADDR_MAIN[11:2] + 13)] = I_TYPE(INST_BNE, GPR_S7, 0, (addr_core1 - ADDR_MAIN - 13 * 4 - 4) >> 2);
+		loop = pc;
+		emit(I_TYPE(INST_ADDIU, GPR_S6, GPR_S6, 1));
+		emit(I_TYPE(INST_LW, GPR_S0, GPR_T0, 0));
+		emit(NOP);
+		emit(I_TYPE(INST_ADDIU, GPR_T0, GPR_T0, 1));
+		emit(I_TYPE(INST_SW, GPR_S0, GPR_T0, 0));
+		emit_atomic_inc;
+		addr_wait1 = pc;
+		emit(I_TYPE(INST_LW, GPR_S2, GPR_T0, 0));
+		emit(NOP);
+		emit(I_TYPE(INST_BNE, GPR_T0, GPR_S6, (addr_wait1 - pc - 4) >> 2));
+		emit(NOP);
+		for (i=0; i<4; i=i+1) begin
+			emit(I_TYPE(INST_LW, GPR_S3, GPR_T1, i * 4));
+			emit(NOP);
+			emit(R_TYPE(GPR_T1, GPR_S6, GPR_T1, 0, R_FUNC_XOR));
+			emit(R_TYPE(GPR_FP, GPR_T1, GPR_FP, 0, R_FUNC_OR));
+		end
+		emit(I_TYPE(INST_SW, GPR_S4, GPR_S6, 0));
+		emit(I_TYPE(INST_BNE, GPR_S6, GPR_S5, (loop - pc - 4) >> 2));
+		emit(NOP);
+		emit(I_TYPE(INST_SW, 0, GPR_FP, ADDR_ERROR[15:0]));
+		// both cores: report and stop
+		addr_end = pc;
+		rom[(addr_core1 - ADDR_MAIN - 8) >> 2] = J_TYPE(INST_J, addr_end);
+		emit(R_TYPE(0, GPR_S7, GPR_T1, 2, R_FUNC_SLL));
+		emit(I_TYPE(INST_ORI, GPR_T1, GPR_T0, ADDR_DONE[15:0]));
+		emit(I_TYPE(INST_SW, GPR_T0, GPR_S6, 0));
+		emit(J_TYPE(INST_J, pc));
+		emit(NOP);
+	end
+	
+	// bus statistics
+	integer cycle = 0, writes = 0, invalidations = 0;
+	
+	always @(posedge clk) begin
+		cycle = cycle + 1;
+		if (snoop_we) begin
+			writes = writes + 1;
+			if (uut0.ICMU.CACHE.snoop_hit || uut0.DCMU.CACHE.snoop_hit || uut1.ICMU.CACHE.snoop_hit || uut1.DCMU.CACHE.snoop_hit)
+				invalidations = invalidations + 1;
+		end
+	end
+	
+	initial begin
+		// Initialize Inputs
+		clk = 0;
+		rst = 1;
+		ram_wait = 0;
+		rom_wait = 0;
+	
+		#100 rst = 0;
+		wait ((ram[ADDR_DONE[15:2]] == LOOP_COUNT && ram[ADDR_DONE[15:2] + 1] == LOOP_COUNT) || cycle >= TIMEOUT);
+		#1000;
+		$display("%0d cycles, %0d bus writes, %0d of them invalidated cached copies", cycle, writes, invalidations);
+		$display("counters %0d %0d, shared counter %0d, flag %0d, ack %0d, stale messages %h",
+			ram[ADDR_COUNTER[15:2]], ram[ADDR_COUNTER[15:2] + 1], ram[ADDR_ATOMIC[15:2]], ram[ADDR_FLAG[15:2]], ram[ADDR_ACK[15:2]], ram[ADDR_ERROR[15:2]]);
+		if (cycle >= TIMEOUT)
+			$display("FAILED: timeout, a core is spinning on a stale copy");
+		else if (ram[ADDR_COUNTER[15:2]] != LOOP_COUNT || ram[ADDR_COUNTER[15:2] + 1] != LOOP_COUNT || ram[ADDR_ERROR[15:2]] != 0
+			|| ram[ADDR_ATOMIC[15:2]] != LOOP_COUNT * 2)
+			$display("FAILED: updates lost or stale data read");
+		else
+			$display("PASSED");
+		$finish;
+	end
+	
+	initial forever #50 clk = ~clk;  // 10MHz
+	
+endmodule
@@ -0,0 +1,277 @@
+`timescale 1ns / 1ps
+
+/**
+ * CPI and dual-issue rate of the MIPS core in both issue modes, on two hand-encoded kernels standing for the demo code:
+ * the tile mapping loop of the 2048 board drawing, and an xorshift chain like the software random generator.
+ * The demos themselves are not run, as they cannot be built into this testbench, and they would hardly pair anyway:
+ * they run without page tables and fetch uncached from PCM, where the instruction pair is never valid, only the code
+ * in scratchpad pairs. "sim/iss" models dual issue on the demos themselves with "--dual".
+ * Here instructions are fetched in pairs from a single cycle memory as from the instruction cache, so the results show
+ * what dual issue gives once code runs from cached pages.
+ */
+module sim_mips_dual;
+	// Parameters
+	parameter
+		DUAL_ISSUE = 1,  // 1 for dual-issue mode, 0 for single-issue mode
+		LOOP_COUNT = 64;  // iterations of each kernel
+	
+	// Inputs
+	reg clk;
+	reg rst;
+	wire [31:0] inst_data;
+	wire [31:0] inst_data_next;
+	wire inst_next_valid;
+	wire [31:0] mem_din;
+	
+	// Outputs
+	wire user_mode;
+	wire mmu_en;
+	wire mmu_inv;
+	wire [31:12] pdb_addr;
+	wire inst_ren;
+	wire [31:0] inst_addr;
+	wire ic_lock;
+	wire ic_inv;
+	wire mem_ren;
+	wire mem_wen;
+	wire [1:0] mem_type;
+	wire mem_ext;
+	wire [31:0] mem_addr;
+	wire [31:0] mem_dout;
+	wire dc_lock;
+	wire dc_inv;
+	wire wd_rst;
+	wire exception;
+	
+	// Instantiate the Unit Under Test (UUT)
+	mips_core #(
+		.CLK_FREQ(10),
+		.DUAL_ISSUE(DUAL_ISSUE)
+		) uut (
+		.clk(clk),
+		.rst(rst),
+		`ifdef DEBUG
+		.debug_en(1'b0),
+		.debug_step(1'b0),
+		.debug_addr(7'b0),
+		.debug_data(),
+		`endif
+		.user_mode(user_mode),
+		.mmu_en(mmu_en),
+		.mmu_inv(mmu_inv),
+		.pdb_addr(pdb_addr),
+		.inst_ren(inst_ren),
+		.inst_stall(1'b0),
+		.inst_addr(inst_addr),
+		.inst_data(inst_data),
+		.inst_data_next(inst_data_next),
+		.inst_next_valid(inst_next_valid),
+		.inst_unalign(1'b0),
+		.inst_bus_err(1'b0),
+		.inst_page_fault(1'b0),
+		.inst_unauth_user(1'b0),
+		.inst_unauth_exec(1'b0),
+		.ic_lock(ic_lock),
+		.ic_inv(ic_inv),
+		.mem_ren(mem_ren),
+		.mem_wen(mem_wen),
+		.mem_link(),
+		.mem_stall(1'b0),
+		.mem_type(mem_type),
+		.mem_ext(mem_ext),
+		.mem_addr(mem_addr),
+		.mem_dout(mem_dout),
+		.mem_din(mem_din),
+		.mem_unalign(1'b0),
+		.mem_bus_err(1'b0),
+		.mem_page_fault(1'b0),
+		.mem_unauth_user(1'b0),
+		.mem_unauth_write(1'b0),
+		.dc_lock(dc_lock),
+		.dc_inv(dc_inv),
+		.ir_map(30'b0),
+		.wd_rst(wd_rst),
+		.exception(exception),
+		.sleep()
+	);
+	
+	// single cycle memories, instruction memory is 64 bits wide as instruction cache does
+	reg [31:0] imem [0:1023];
+	reg [31:0] dmem [0:1023];
+	
+	assign
+		inst_data = imem[inst_addr[11:2]],
+		inst_data_next = imem[{inst_addr[11:3], 1'b1}],
+		inst_next_valid = inst_ren & ~inst_addr[2],
+		mem_din = dmem[mem_addr[11:2]];
+	
+	always @(posedge clk) begin
+		if (mem_wen)
+			dmem[mem_addr[11:2]] <= mem_dout;
+	end
+	
+	// instruction encoding
+	function [31:0] I_TYPE;
+		input [5:0] op;
+		input [4:0] rs, rt;
+		input [15:0] imm;
+		I_TYPE = {op, rs, rt, imm};
+	endfunction
+	
+	function [31:0] R_TYPE;
+		input [4:0] rs, rt, rd, sa;
+		input [5:0] func;
+		R_TYPE = {6'b000000, rs, rt, rd, sa, func};
+	endfunction
+	
+	function [31:0] J_TYPE;
+		input [5:0] op;
+		input [31:0] target;
+		J_TYPE = {op, target[27:2]};
+	endfunction
+	
+	localparam
+		NOP = 32'h0000_0000,
+		OP_J = 6'b000010,
+		OP_BNE = 6'b000101,
+		OP_ADDIU = 6'b001001,
+		OP_ANDI = 6'b001100,
+		OP_ORI = 6'b001101,
+		OP_SW = 6'b101011,
+		OP_LW = 6'b100011,
+		FUNC_SLL = 6'b000000,
+		FUNC_SRL = 6'b000010,
+		FUNC_ADDU = 6'b100001,
+		FUNC_OR = 6'b100101,
+		FUNC_XOR = 6'b100110;
+	
+	localparam
+		ADDR_MAIN = 32'hFF00_0000,
+		ADDR_SRC = 32'h0000_0100,
+		ADDR_DST = 32'h0000_0200;
+	
+	integer pc, i, loop;
+	integer addr_kernel1, addr_kernel2, addr_end;
+	
+	task emit;
+		input [31:0] inst;
+		begin
+			imem[pc[11:2]] = inst;
+			pc = pc + 4;
+		end
+	endtask
+	
+	task align;
+		begin
+			if (pc[2])
+				emit(NOP);
+		end
+	endtask
+	
+	initial begin
+		for (i=0; i<1024; i=i+1) begin
+			imem[i] = NOP;
+			dmem[i] = i * 32'h9E37_79B1;
+		end
+		pc = ADDR_MAIN;
+		// kernel 1: map cell values to tile colors, as render() does for the board
+		addr_kernel1 = pc;
+		emit(I_TYPE(OP_ORI, 0, 9, ADDR_SRC[15:0]));
+		emit(I_TYPE(OP_ORI, 0, 10, ADDR_DST[15:0]));
+		emit(I_TYPE(OP_ORI, 0, 8, LOOP_COUNT));
+		emit(I_TYPE(OP_ORI, 0, 13, 16'h0030));
+		align;
+		loop = pc;
+		emit(I_TYPE(OP_LW, 9, 11, 0));
+		emit(I_TYPE(OP_ADDIU, 9, 9, 4));
+		emit(I_TYPE(OP_ADDIU, 8, 8, -1));
+		emit(I_TYPE(OP_ADDIU, 10, 10, 4));
+		emit(I_TYPE(OP_ANDI, 11, 12, 16'h000F));
+		emit(R_TYPE(0, 8, 14, 1, FUNC_SLL));
+		emit(R_TYPE(0, 12, 12, 2, FUNC_SLL));
+		emit(R_TYPE(15, 14, 15, 0, FUNC_XOR));
+		emit(R_TYPE(12, 13, 12, 0, FUNC_OR));
+		emit(R_TYPE(15, 12, 15, 0, FUNC_ADDU));  // depends on the previous one
+		emit(I_TYPE(OP_BNE, 8, 0, (loop - pc - 4) >> 2));
+		emit(I_TYPE(OP_SW, 10, 12, -4));
+		// kernel 2: xorshift random number generator, a dependency chain
+		addr_kernel2 = pc;
+		emit(I_TYPE(OP_ORI, 0, 8, LOOP_COUNT));
+		emit(I_TYPE(OP_ORI, 0, 16, 16'h1234));
+		align;
+		loop = pc;
+		emit(R_TYPE(0, 16, 11, 13, FUNC_SLL));
+		emit(I_TYPE(OP_ADDIU, 8, 8, -1));
+		emit(R_TYPE(16, 11, 16, 0, FUNC_XOR));
+		emit(R_TYPE(0, 16, 11, 17, FUNC_SRL));
+		emit(R_TYPE(16, 11, 16, 0, FUNC_XOR));
+		emit(R_TYPE(0, 16, 11, 5, FUNC_SLL));
+		emit(R_TYPE(16, 11, 16, 0, FUNC_XOR));
+		emit(I_TYPE(OP_ANDI, 16, 12, 16'h000F));
+		emit(I_TYPE(OP_BNE, 8, 0, (loop - pc - 4) >> 2));
+		emit(R_TYPE(17, 12, 17, 0, FUNC_ADDU));
+		// dead loop
+		align;
+		addr_end = pc;
+		emit(J_TYPE(OP_J, pc));
+		emit(NOP);
+	end
+	
+	// performance measurement, counting instructions going from ID to EXE
+	integer cycle = 0, issued = 0, paired = 0;
+	integer start_cycle = 0, start_issued = 0, start_paired = 0;
+	integer phase = 0;
+	
+	task report;
+		input [8*16-1:0] name;
+		integer cycles, insts, pairs;
+		begin
+			cycles = cycle - start_cycle;
+			insts = issued - start_issued;
+			pairs = paired - start_paired;
+			$display("%s: %0d instructions in %0d cycles, CPI %0d.%02d, %0d%% dual-issued",
+				name, insts, cycles, cycles / insts, cycles * 100 / insts % 100, pairs * 200 / insts);
+			start_cycle = cycle;
+			start_issued = issued;
+			start_paired = paired;
+		end
+	endtask
+	
+	always @(posedge clk) begin
+		cycle = cycle + 1;
+		if (uut.exe_en && ~uut.exe_rst && uut.id_valid) begin
+			issued = issued + 1 + uut.DATAPATH.pair_issue;
+			paired = paired + uut.DATAPATH.pair_issue;
+		end
+		if (uut.id_valid) case (phase)
+			0: if (uut.DATAPATH.inst_addr_id == addr_kernel1) begin
+				start_cycle = cycle;
+				start_issued = issued;
+				start_paired = paired;
+				phase = 1;
+			end
+			1: if (uut.DATAPATH.inst_addr_id == addr_kernel2) begin
+				report("tile mapping    ");
+				phase = 2;
+			end
+			2: if (uut.DATAPATH.inst_addr_id == addr_end) begin
+				report("xorshift        ");
+				phase = 3;
+			end
+		endcase
+	end
+	
+	initial begin
+		// Initialize Inputs
+		clk = 0;
+		rst = 1;
+	
+		#100 rst = 0;
+		wait (phase == 3);
+		$display("%s: checksum %h", DUAL_ISSUE ? "dual-issue" : "single-issue", uut.DATAPATH.REGFILE.regfile[15] ^ uut.DATAPATH.REGFILE.regfile[17]);
+		$finish;
+	end
+	
+	initial forever #10 clk = ~clk;
+	
+endmodule
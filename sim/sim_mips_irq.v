@@ -0,0 +1,269 @@
+`timescale 1ns / 1ps
+
+module sim_mips_irq;
+	// Parameters
+	parameter
+		VECTORED = 1,  // 1 for vectored interrupt with caller-saved template, 0 for common handler which saves all registers
+		IDLE_WAIT = 1;  // 1 for idle loop with WAIT instruction, 0 for spinning idle loop
+	
+	// Inputs
+	reg clk;
+	reg rst;
+	reg [30:1] ir_map;
+	wire [31:0] inst_data;
+	wire [31:0] mem_din;
+	
+	// Outputs
+	wire user_mode;
+	wire mmu_en;
+	wire mmu_inv;
+	wire [31:12] pdb_addr;
+	wire inst_ren;
+	wire [31:0] inst_addr;
+	wire ic_lock;
+	wire ic_inv;
+	wire mem_ren;
+	wire mem_wen;
+	wire [1:0] mem_type;
+	wire mem_ext;
+	wire [31:0] mem_addr;
+	wire [31:0] mem_dout;
+	wire dc_lock;
+	wire dc_inv;
+	wire wd_rst;
+	wire exception;
+	
+	// Instantiate the Unit Under Test (UUT)
+	mips_core #(
+		.CLK_FREQ(10)
+		) uut (
+		.clk(clk),
+		.rst(rst),
+		`ifdef DEBUG
+		.debug_en(1'b0),
+		.debug_step(1'b0),
+		.debug_addr(7'b0),
+		.debug_data(),
+		`endif
+		.user_mode(user_mode),
+		.mmu_en(mmu_en),
+		.mmu_inv(mmu_inv),
+		.pdb_addr(pdb_addr),
+		.inst_ren(inst_ren),
+		.inst_stall(1'b0),
+		.inst_addr(inst_addr),
+		.inst_data(inst_data),
+		.inst_data_next(32'b0),
+		.inst_next_valid(1'b0),
+		.inst_unalign(1'b0),
+		.inst_bus_err(1'b0),
+		.inst_page_fault(1'b0),
+		.inst_unauth_user(1'b0),
+		.inst_unauth_exec(1'b0),
+		.ic_lock(ic_lock),
+		.ic_inv(ic_inv),
+		.mem_ren(mem_ren),
+		.mem_wen(mem_wen),
+		.mem_link(),
+		.mem_stall(1'b0),
+		.mem_type(mem_type),
+		.mem_ext(mem_ext),
+		.mem_addr(mem_addr),
+		.mem_dout(mem_dout),
+		.mem_din(mem_din),
+		.mem_unalign(1'b0),
+		.mem_bus_err(1'b0),
+		.mem_page_fault(1'b0),
+		.mem_unauth_user(1'b0),
+		.mem_unauth_write(1'b0),
+		.dc_lock(dc_lock),
+		.dc_inv(dc_inv),
+		.ir_map(ir_map),
+		.wd_rst(wd_rst),
+		.exception(exception),
+		.sleep()
+	);
+	
+	// single cycle memories, so that only pipeline latency is measured
+	reg [31:0] imem [0:1023];
+	reg [31:0] dmem [0:1023];
+	
+	assign
+		inst_data = imem[inst_addr[11:2]],
+		mem_din = dmem[mem_addr[11:2]];
+	
+	always @(posedge clk) begin
+		if (mem_wen)
+			dmem[mem_addr[11:2]] <= mem_dout;
+	end
+	
+	// instruction encoding
+	function [31:0] I_TYPE;
+		input [5:0] op;
+		input [4:0] rs, rt;
+		input [15:0] imm;
+		I_TYPE = {op, rs, rt, imm};
+	endfunction
+	
+	function [31:0] J_TYPE;
+		input [5:0] op;
+		input [31:0] target;
+		J_TYPE = {op, target[27:2]};
+	endfunction
+	
+	function [31:0] MTC0;
+		input [4:0] rt, rd;
+		MTC0 = {6'b010000, 5'b00100, rt, rd, 11'b0};
+	endfunction
+	
+	function [31:0] MFC0;
+		input [4:0] rt, rd;
+		MFC0 = {6'b010000, 5'b00000, rt, rd, 11'b0};
+	endfunction
+	
+	localparam
+		NOP = 32'h0000_0000,
+		ERET = 32'h4200_0018,
+		WAIT = 32'h4200_0020,
+		OP_J = 6'b000010,
+		OP_JAL = 6'b000011,
+		OP_BNE = 6'b000101,
+		OP_ADDIU = 6'b001001,
+		OP_ANDI = 6'b001100,
+		OP_ORI = 6'b001101,
+		OP_LUI = 6'b001111,
+		OP_SW = 6'b101011,
+		OP_LW = 6'b100011;
+	
+	localparam
+		ADDR_MAIN = 32'hFF00_0000,
+		ADDR_VECTOR = 32'hFF00_0100,
+		ADDR_STUB = 32'hFF00_0200,
+		ADDR_HANDLER = 32'hFF00_0300,
+		ADDR_ISR = 32'hFF00_0800;
+	
+	localparam
+		IR_ID = 3;
+	
+	integer pc, i, j;
+	
+	task emit;
+		input [31:0] inst;
+		begin
+			imem[pc[11:2]] = inst;
+			pc = pc + 4;
+		end
+	endtask
+	
+	initial begin
+		for (i=0; i<1024; i=i+1) begin
+			imem[i] = NOP;
+			dmem[i] = 0;
+		end
+		// main: set stack, EHBR, IVBR, IPR0 and IER, then spin
+		pc = ADDR_MAIN;
+		emit(I_TYPE(OP_ORI, 0, 29, 16'h0F00));  // sp
+		emit(I_TYPE(OP_LUI, 0, 8, ADDR_HANDLER[31:16]));
+		emit(I_TYPE(OP_ORI, 8, 8, ADDR_HANDLER[15:0]));
+		emit(MTC0(8, 3));  // EHBR
+		emit(I_TYPE(OP_LUI, 0, 8, ADDR_VECTOR[31:16]));
+		emit(I_TYPE(OP_ORI, 8, 8, ADDR_VECTOR[15:0] | VECTORED));
+		emit(MTC0(8, 9));  // IVBR
+		emit(I_TYPE(OP_ORI, 0, 8, 16'h0080));
+		emit(MTC0(8, 11));  // IPR0, level 2 for ID 3
+		emit(I_TYPE(OP_LUI, 0, 8, 16'h8000));
+		emit(I_TYPE(OP_ORI, 8, 8, 1 << IR_ID));
+		emit(MTC0(8, 4));  // IER
+		if (IDLE_WAIT) begin
+			emit(WAIT);  // idle loop
+			emit(J_TYPE(OP_J, pc - 4));
+		end
+		else begin
+			emit(J_TYPE(OP_J, pc));  // dead loop
+		end
+		emit(NOP);
+		// vector table
+		pc = ADDR_VECTOR + IR_ID * 8;
+		emit(J_TYPE(OP_J, ADDR_STUB));
+		emit(NOP);
+		// vectored stub, same as IR_HANDLER in boot.S
+		pc = ADDR_STUB;
+		emit(I_TYPE(OP_ADDIU, 29, 29, -88));
+		j = 0;
+		for (i=1; i<32; i=i+1) begin
+			if (i <= 15 || i == 24 || i == 25 || i == 31) begin
+				emit(I_TYPE(OP_SW, 29, i, 84 - 4 * j));
+				j = j + 1;
+			end
+		end
+		emit(J_TYPE(OP_JAL, ADDR_ISR));
+		emit(NOP);
+		// common handler, same as handler in boot.S followed by int_dispatch
+		pc = ADDR_HANDLER;
+		emit(I_TYPE(OP_ADDIU, 29, 29, -140));
+		for (i=1; i<32; i=i+1)
+			emit(I_TYPE(OP_SW, 29, i, 136 - 4 * i));
+		emit(MFC0(8, 1));
+		emit(I_TYPE(OP_SW, 29, 8, 8));
+		emit(MFC0(8, 2));
+		emit(I_TYPE(OP_SW, 29, 8, 4));
+		emit(MFC0(2, 5));  // int_dispatch
+		for (j=0; j<IR_ID; j=j+1) begin
+			emit(I_TYPE(OP_ANDI, 2, 3, 1 << j));
+			emit(I_TYPE(OP_BNE, 3, 0, 16'h0000));  // taken to the next instruction, never leaves
+			emit(NOP);
+		end
+		emit(I_TYPE(OP_ANDI, 2, 3, 1 << IR_ID));
+		emit(I_TYPE(OP_BNE, 3, 0, (ADDR_ISR - pc - 4) >> 2));
+		emit(NOP);
+		// interrupt service routine, acknowledge and return directly
+		pc = ADDR_ISR;
+		emit(I_TYPE(OP_ORI, 0, 8, 1 << IR_ID));
+		emit(MTC0(8, 5));  // ICR
+		emit(ERET);
+		emit(NOP);
+	end
+	
+	// latency measurement
+	integer cycle = 0;
+	integer ir_cycle = 0;
+	integer entry_cycle = 0;
+	integer total = 0;
+	integer count = 0;
+	
+	always @(posedge clk) begin
+		cycle <= cycle + 1;
+		if (inst_ren && inst_addr == ADDR_ISR && ir_cycle != 0) begin
+			total = total + (cycle - ir_cycle);
+			count = count + 1;
+			$display("interrupt %0d: %0d cycles to exception entry, %0d cycles to handler", count, entry_cycle - ir_cycle, cycle - ir_cycle);
+			ir_cycle = 0;
+		end
+		if (exception && ir_cycle != 0 && entry_cycle < ir_cycle)
+			entry_cycle = cycle;
+	end
+	
+	initial begin
+		// Initialize Inputs
+		clk = 0;
+		rst = 1;
+		ir_map = 0;
+	
+		#100 rst = 0;
+		#2000;
+		repeat (8) begin
+			@(posedge clk);
+			ir_map[IR_ID] <= 1;
+			ir_cycle = cycle + 1;
+			@(posedge clk);
+			ir_map[IR_ID] <= 0;
+			#3000;
+		end
+		$display("%s: average %0d cycles from interrupt request to handler", VECTORED ? "vectored" : "common", total / count);
+		$display("%0d of %0d cycles spent asleep", uut.CP0.scr, cycle);
+		$finish;
+	end
+	
+	initial forever #10 clk = ~clk;
+	
+endmodule
@@ -0,0 +1,233 @@
+`timescale 1ns / 1ps
+
+/**
+ * Programming throughput of the parallel PCM on Nexys3 board.
+ * Not run yet for lack of a simulator, the controller and model timing add up to:
+ *   line write: 1024 words in about 8.0ms, about 515 KB/s, 64 pages, 1 block erased, PCM busy for about 7.6ms
+ *   single write: 32 words in about 2.2ms, about 58 KB/s, the scaled 2ms erase taking most of it
+ * One page of 32 halfwords takes about 40 command cycles and status reads of 120ns and 88us of programming,
+ * about 93us in all, so pages alone run at about 690 KB/s against about 48 KB/s by word programming.
+ * With the 500ms erase of the model, a whole 128KB block takes about 690ms, about 190 KB/s.
+ */
+module sim_ppcm_nexys3;
+	// Parameters
+	parameter
+		PAGE_BITS = 5,
+		TEST_WORDS = 1024,
+		SINGLE_WORDS = 32,
+		T_ERASE = 2000000;  // block erase time scaled down from hundreds of ms to keep the simulation short
+	
+	// Inputs
+	reg clk;
+	reg wb_clk;
+	reg rst;
+	reg wbs_cyc_i;
+	reg wbs_stb_i;
+	reg [31:2] wbs_addr_i;
+	reg [2:0] wbs_cti_i;
+	reg [1:0] wbs_bte_i;
+	reg [3:0] wbs_sel_i;
+	reg wbs_we_i;
+	reg [31:0] wbs_data_i;
+	reg ctrl_cs_i;
+	reg ctrl_we_i;
+	reg [31:0] ctrl_data_i;
+	
+	// Outputs
+	wire pcm_busy;
+	wire pcm_ce_n;
+	wire pcm_rst_n;
+	wire pcm_oe_n;
+	wire pcm_we_n;
+	wire [23:1] pcm_addr;
+	wire [15:0] pcm_din;
+	wire [15:0] pcm_dout;
+	wire [31:0] wbs_data_o;
+	wire wbs_ack_o;
+	wire [31:0] ctrl_data_o;
+	wire ctrl_ack_o;
+	wire wbs_err_o;
+	
+	// Instantiate the Unit Under Test (UUT)
+	wb_ppcm_nexys3 #(
+		.CLK_FREQ(100),
+		.ADDR_BITS(24),
+		.HIGH_ADDR(8'h00),
+		.BUF_ADDR_BITS(4),
+		.PAGE_BITS(PAGE_BITS),
+		.BLOCK_BITS(17)
+		) uut (
+		.clk(clk),
+		.rst(rst),
+		.pcm_busy(pcm_busy),
+		.pcm_ce_n(pcm_ce_n),
+		.pcm_rst_n(pcm_rst_n),
+		.pcm_oe_n(pcm_oe_n),
+		.pcm_we_n(pcm_we_n),
+		.pcm_addr(pcm_addr),
+		.pcm_din(pcm_din),
+		.pcm_dout(pcm_dout),
+		.wbs_clk_i(wb_clk),
+		.wbs_cyc_i(wbs_cyc_i),
+		.wbs_stb_i(wbs_stb_i),
+		.wbs_addr_i(wbs_addr_i),
+		.wbs_cti_i(wbs_cti_i),
+		.wbs_bte_i(wbs_bte_i),
+		.wbs_sel_i(wbs_sel_i),
+		.wbs_we_i(wbs_we_i),
+		.wbs_data_i(wbs_data_i),
+		.wbs_data_o(wbs_data_o),
+		.wbs_ack_o(wbs_ack_o),
+		.wbs_err_o(wbs_err_o),
+		.ctrl_cs_i(ctrl_cs_i),
+		.ctrl_addr_i(6'h0),
+		.ctrl_sel_i(4'b1111),
+		.ctrl_data_i(ctrl_data_i),
+		.ctrl_we_i(ctrl_we_i),
+		.ctrl_data_o(ctrl_data_o),
+		.ctrl_ack_o(ctrl_ack_o)
+	);
+	
+	model_ppcm_nexys3 #(
+		.ADDR_BITS(24),
+		.MEM_ADDR_BITS(18),
+		.BLOCK_BITS(16),
+		.T_ERASE(T_ERASE)
+		) PCM (
+		.pcm_ce_n(pcm_ce_n),
+		.pcm_rst_n(pcm_rst_n),
+		.pcm_oe_n(pcm_oe_n),
+		.pcm_we_n(pcm_we_n),
+		.pcm_addr(pcm_addr),
+		.data_i(pcm_dout),
+		.data_o(pcm_din)
+	);
+	
+	// wishbone master, issue one request the same way as CMU does (a line of 4 words in burst mode)
+	integer errors = 0;
+	
+	task wb_line;
+		input we;
+		input [31:2] addr;
+		input integer words;
+		integer i;
+		begin
+			for (i=0; i<words; i=i+1) begin
+				wbs_cyc_i <= 1;
+				wbs_stb_i <= 1;
+				wbs_addr_i <= addr + i;
+				wbs_cti_i <= (words == 1) ? 3'b000 : ((i == words-1) ? 3'b111 : 3'b010);
+				wbs_bte_i <= 2'b00;
+				wbs_sel_i <= 4'b1111;
+				wbs_we_i <= we;
+				wbs_data_i <= {addr + i, 2'b00};
+				@(posedge wb_clk);
+				while (~wbs_ack_o)
+					@(posedge wb_clk);
+				if (~we && wbs_data_o != {addr + i, 2'b00}) begin
+					errors = errors + 1;
+					$display("[%t] read error at %h: %h", $time, {addr + i, 2'b00}, wbs_data_o);
+				end
+			end
+			wbs_cyc_i <= 0;
+			wbs_stb_i <= 0;
+			wbs_cti_i <= 0;
+			wbs_we_i <= 0;
+			@(posedge wb_clk);
+		end
+	endtask
+	
+	// write the control register
+	task wb_ctrl;
+		input [31:0] data;
+		begin
+			ctrl_cs_i <= 1;
+			ctrl_we_i <= 1;
+			ctrl_data_i <= data;
+			@(posedge wb_clk);
+			while (~ctrl_ack_o)
+				@(posedge wb_clk);
+			ctrl_cs_i <= 0;
+			ctrl_we_i <= 0;
+			@(posedge wb_clk);
+		end
+	endtask
+	
+	// programming throughput, one read at last waits for the last page to be programmed
+	time start;
+	integer i;
+	
+	task report;
+		input [8*16-1:0] name;
+		input integer words;
+		begin
+			$display("%s: %0d words in %0t ns, %0d KB/s, %0d pages, %0d blocks erased, PCM busy for %0t ns, polled %0d times",
+				name, words, $time - start, words * 4 * 1000000 / ($time - start),
+				PCM.page_count, PCM.erase_count, PCM.busy_time, PCM.poll_count);
+			PCM.page_count = 0;
+			PCM.erase_count = 0;
+			PCM.busy_time = 0;
+			PCM.poll_count = 0;
+		end
+	endtask
+	
+	initial begin
+		// Initialize Inputs
+		clk = 0;
+		wb_clk = 0;
+		rst = 1;
+		wbs_cyc_i = 0;
+		wbs_stb_i = 0;
+		wbs_addr_i = 0;
+		wbs_cti_i = 0;
+		wbs_bte_i = 0;
+		wbs_sel_i = 0;
+		wbs_we_i = 0;
+		wbs_data_i = 0;
+		ctrl_cs_i = 0;
+		ctrl_we_i = 0;
+		ctrl_data_i = 0;
+	
+		#1000 rst = 0;
+		while (pcm_busy)
+			@(posedge wb_clk);
+		#1000;
+	
+		// stray writes are dropped while programming is disabled
+		wb_line(1, 0, 4);
+		#10000;
+		if (PCM.page_count != 0 || PCM.erase_count != 0) begin
+			errors = errors + 1;
+			$display("[%t] flash changed while programming is disabled", $time);
+		end
+		wb_ctrl(3);
+	
+		// line writes from the start of block 0, as cache write back of an image does
+		start = $time;
+		for (i=0; i<TEST_WORDS; i=i+4)
+			wb_line(1, i, 4);
+		wb_line(0, TEST_WORDS-1, 1);
+		report("line write      ", TEST_WORDS);
+		for (i=0; i<TEST_WORDS; i=i+4)
+			wb_line(0, i, 4);
+	
+		// single word writes from the start of block 1, as uncached stores do, words coming while the last page is
+		// being programmed are collected into the next page
+		start = $time;
+		for (i=0; i<SINGLE_WORDS; i=i+1) begin
+			wb_line(1, 'h8000 + i, 1);
+			#2000;
+		end
+		wb_line(0, 'h8000 + SINGLE_WORDS-1, 1);
+		report("single write    ", SINGLE_WORDS);
+		for (i=0; i<SINGLE_WORDS; i=i+1)
+			wb_line(0, 'h8000 + i, 1);
+	
+		$display("%0d errors, %0d PCM command errors", errors, PCM.error_count);
+		$finish;
+	end
+	
+	initial forever #5 clk = ~clk;
+	initial forever #10 wb_clk = ~wb_clk;
+	
+endmodule
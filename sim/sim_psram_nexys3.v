@@ -0,0 +1,197 @@
+`timescale 1ns / 1ps
+
+module sim_psram_nexys3;
+	// Parameters
+	parameter
+		SUSPEND_EN = 1,
+		TEST_WORDS = 1024;
+	
+	// Inputs
+	reg clk;
+	reg wb_clk;
+	reg rst;
+	reg wbs_cyc_i;
+	reg wbs_stb_i;
+	reg [31:2] wbs_addr_i;
+	reg [2:0] wbs_cti_i;
+	reg [1:0] wbs_bte_i;
+	reg [3:0] wbs_sel_i;
+	reg wbs_we_i;
+	reg [31:0] wbs_data_i;
+	
+	// Outputs
+	wire ram_busy;
+	wire ram_clk;
+	wire ram_ce_n;
+	wire ram_oe_n;
+	wire ram_we_n;
+	wire ram_adv_n;
+	wire ram_cre;
+	wire ram_lb_n;
+	wire ram_ub_n;
+	wire ram_wait;
+	wire [23:1] ram_addr;
+	wire [15:0] ram_din;
+	wire [15:0] ram_dout;
+	wire [31:0] wbs_data_o;
+	wire wbs_ack_o;
+	wire wbs_err_o;
+	
+	// Instantiate the Unit Under Test (UUT)
+	wb_psram_nexys3 #(
+		.CLK_FREQ(50),
+		.ADDR_BITS(24),
+		.HIGH_ADDR(8'h00),
+		.BUF_ADDR_BITS(4),
+		.SUSPEND_EN(SUSPEND_EN)
+		) uut (
+		.clk(clk),
+		.rst(rst),
+		.ram_busy(ram_busy),
+		.ram_suspended(),
+		.ram_suspend_end(1'b0),
+		.ram_clk(ram_clk),
+		.ram_ce_n(ram_ce_n),
+		.ram_oe_n(ram_oe_n),
+		.ram_we_n(ram_we_n),
+		.ram_adv_n(ram_adv_n),
+		.ram_cre(ram_cre),
+		.ram_lb_n(ram_lb_n),
+		.ram_ub_n(ram_ub_n),
+		.ram_wait(ram_wait),
+		.ram_addr(ram_addr),
+		.ram_din(ram_din),
+		.ram_dout(ram_dout),
+		.wbs_clk_i(wb_clk),
+		.wbs_cyc_i(wbs_cyc_i),
+		.wbs_stb_i(wbs_stb_i),
+		.wbs_addr_i(wbs_addr_i),
+		.wbs_cti_i(wbs_cti_i),
+		.wbs_bte_i(wbs_bte_i),
+		.wbs_sel_i(wbs_sel_i),
+		.wbs_we_i(wbs_we_i),
+		.wbs_data_i(wbs_data_i),
+		.wbs_data_o(wbs_data_o),
+		.wbs_ack_o(wbs_ack_o),
+		.wbs_err_o(wbs_err_o)
+	);
+	
+	model_psram_nexys3 #(
+		.ADDR_BITS(24),
+		.MEM_ADDR_BITS(16)
+		) PSRAM (
+		.ram_clk(ram_clk),
+		.ram_ce_n(ram_ce_n),
+		.ram_oe_n(ram_oe_n),
+		.ram_we_n(ram_we_n),
+		.ram_adv_n(ram_adv_n),
+		.ram_cre(ram_cre),
+		.ram_lb_n(ram_lb_n),
+		.ram_ub_n(ram_ub_n),
+		.ram_wait(ram_wait),
+		.ram_addr(ram_addr),
+		.data_i(ram_dout),
+		.data_o(ram_din)
+	);
+	
+	// wishbone master, issue one request the same way as CMU does (a line of 4 words in burst mode)
+	integer errors = 0;
+	
+	task wb_line;
+		input we;
+		input [31:2] addr;
+		input integer words;
+		integer i;
+		begin
+			for (i=0; i<words; i=i+1) begin
+				wbs_cyc_i <= 1;
+				wbs_stb_i <= 1;
+				wbs_addr_i <= addr + i;
+				wbs_cti_i <= (words == 1) ? 3'b000 : ((i == words-1) ? 3'b111 : 3'b010);
+				wbs_bte_i <= 2'b00;
+				wbs_sel_i <= 4'b1111;
+				wbs_we_i <= we;
+				wbs_data_i <= {addr + i, 2'b00};
+				@(posedge wb_clk);
+				while (~wbs_ack_o)
+					@(posedge wb_clk);
+				if (~we && wbs_data_o != {addr + i, 2'b00}) begin
+					errors = errors + 1;
+					$display("[%t] read error at %h: %h", $time, {addr + i, 2'b00}, wbs_data_o);
+				end
+			end
+			wbs_cyc_i <= 0;
+			wbs_stb_i <= 0;
+			wbs_cti_i <= 0;
+			wbs_we_i <= 0;
+			@(posedge wb_clk);
+		end
+	endtask
+	
+	// bandwidth measurement
+	time start;
+	integer i;
+	reg [31:2] seed;
+	
+	task report;
+		input [8*16-1:0] name;
+		begin
+			$display("%s: %0d words in %0t ns, %0d KB/s, %0d bursts opened",
+				name, TEST_WORDS, $time - start, TEST_WORDS * 4 * 1000000 / ($time - start), PSRAM.burst_count);
+			PSRAM.burst_count = 0;
+		end
+	endtask
+	
+	initial begin
+		// Initialize Inputs
+		clk = 0;
+		wb_clk = 0;
+		rst = 1;
+		wbs_cyc_i = 0;
+		wbs_stb_i = 0;
+		wbs_addr_i = 0;
+		wbs_cti_i = 0;
+		wbs_bte_i = 0;
+		wbs_sel_i = 0;
+		wbs_we_i = 0;
+		wbs_data_i = 0;
+	
+		#1000 rst = 0;
+		while (ram_busy)
+			@(posedge wb_clk);
+		#1000;
+		PSRAM.burst_count = 0;
+	
+		// sequential line writes and reads, as instruction fetch and frame buffer filling do
+		start = $time;
+		for (i=0; i<TEST_WORDS; i=i+4)
+			wb_line(1, i, 4);
+		report("sequential write");
+		start = $time;
+		for (i=0; i<TEST_WORDS; i=i+4)
+			wb_line(0, i, 4);
+		report("sequential read ");
+	
+		// random line reads, as data cache misses do
+		seed = 1;
+		start = $time;
+		for (i=0; i<TEST_WORDS; i=i+4) begin
+			seed = seed * 1103515245 + 12345;
+			wb_line(0, {seed[15:4], 2'b00} % TEST_WORDS, 4);
+		end
+		report("random read     ");
+	
+		// sequential single word reads, as uncached accesses do
+		start = $time;
+		for (i=0; i<TEST_WORDS; i=i+1)
+			wb_line(0, i, 1);
+		report("single read     ");
+	
+		$display("%0d errors, %0d row boundaries crossed, %0d tCEM violations", errors, PSRAM.row_cross_count, PSRAM.cem_violation);
+		$finish;
+	end
+	
+	initial forever #10 clk = ~clk;
+	initial forever #50 wb_clk = ~wb_clk;
+	
+endmodule
@@ -0,0 +1,144 @@
+`timescale 1ns / 1ps
+
+module sim_random;
+	// Inputs
+	reg clk;
+	reg wb_clk;
+	reg rst;
+	reg wbs_cs_i;
+	reg [7:2] wbs_addr_i;
+	reg [3:0] wbs_sel_i;
+	reg [31:0] wbs_data_i;
+	reg wbs_we_i;
+	
+	// Outputs
+	wire [31:0] wbs_data_o;
+	wire wbs_ack_o;
+	
+	// Instantiate the Unit Under Test (UUT)
+	wb_random #(
+		.DEV_ADDR_BITS(8)
+		) uut (
+		.clk(clk),
+		.rst(rst),
+		.wbs_clk_i(wb_clk),
+		.wbs_cs_i(wbs_cs_i),
+		.wbs_addr_i(wbs_addr_i),
+		.wbs_sel_i(wbs_sel_i),
+		.wbs_data_i(wbs_data_i),
+		.wbs_we_i(wbs_we_i),
+		.wbs_data_o(wbs_data_o),
+		.wbs_ack_o(wbs_ack_o)
+	);
+	
+	reg [31:0] data;
+	
+	task wb_access;
+		input we;
+		input [7:2] addr;
+		input [31:0] din;
+		begin
+			wbs_cs_i <= 1;
+			wbs_addr_i <= addr;
+			wbs_sel_i <= 4'b1111;
+			wbs_data_i <= din;
+			wbs_we_i <= we;
+			@(posedge wb_clk);
+			while (~wbs_ack_o)
+				@(posedge wb_clk);
+			data = wbs_data_o;
+			wbs_cs_i <= 0;
+			wbs_we_i <= 0;
+			@(posedge wb_clk);
+		end
+	endtask
+	
+	// reference model of xoshiro128**
+	reg [31:0] s0, s1, s2, s3, t, expect;
+	
+	task ref_next;
+		begin
+			expect = s1 * 5;
+			expect = {expect[24:0], expect[31:25]} * 9;
+			t = s1 << 9;
+			s2 = s2 ^ s0;
+			s3 = s3 ^ s1;
+			s1 = s1 ^ s2;
+			s0 = s0 ^ s3;
+			s2 = s2 ^ t;
+			s3 = {s3[20:0], s3[31:21]};
+		end
+	endtask
+	
+	integer i, errors = 0;
+	integer hist [0:5];
+	
+	initial begin
+		// Initialize Inputs
+		clk = 0;
+		wb_clk = 0;
+		rst = 1;
+		wbs_cs_i = 0;
+		wbs_addr_i = 0;
+		wbs_sel_i = 0;
+		wbs_data_i = 0;
+		wbs_we_i = 0;
+		for (i=0; i<6; i=i+1)
+			hist[i] = 0;
+	
+		#200 rst = 0;
+		#1000;
+	
+		// seeded sequence in stepping-on-read mode
+		wb_access(1, 4, 0);
+		wb_access(1, 8, 1);
+		wb_access(1, 9, 2);
+		wb_access(1, 10, 3);
+		wb_access(1, 11, 4);
+		s0 = 1; s1 = 2; s2 = 3; s3 = 4;
+		for (i=0; i<16; i=i+1) begin
+			wb_access(0, 0, 0);
+			ref_next;
+			if (data != expect) begin
+				errors = errors + 1;
+				$display("number %0d: %h, expect %h", i, data, expect);
+			end
+		end
+	
+		// bounded numbers, a die
+		wb_access(1, 2, 1);
+		wb_access(1, 3, 7);
+		for (i=0; i<600; i=i+1) begin
+			wb_access(0, 1, 0);
+			if (data < 1 || data >= 7) begin
+				errors = errors + 1;
+				$display("bounded %0d out of range", data);
+			end
+			else begin
+				hist[data-1] = hist[data-1] + 1;
+			end
+		end
+		$display("die: %0d %0d %0d %0d %0d %0d", hist[0], hist[1], hist[2], hist[3], hist[4], hist[5]);
+	
+		// all zero state is replaced
+		wb_access(1, 8, 0);
+		wb_access(1, 9, 0);
+		wb_access(1, 10, 0);
+		wb_access(1, 11, 0);
+		#100;
+		wb_access(0, 8, 0);
+		$display("state s0 %h after seeding all zero", data);
+	
+		// free-running
+		wb_access(1, 4, 1);
+		wb_access(0, 0, 0);
+		$display("free-running number %h", data);
+	
+		$display("%0d errors", errors);
+		$finish;
+	end
+	
+	initial forever #10 clk = ~clk;
+	initial forever #50 wb_clk = ~wb_clk;
+	
+endmodule
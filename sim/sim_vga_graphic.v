@@ -0,0 +1,197 @@
+`timescale 1ns / 1ps
+
+/**
+ * Bus occupancy of VGA graphic mode at 800 * 600 @ 72Hz for every pixel depth.
+ * The wishbone master is counted as occupying the bus in every bus clock with cyc asserted,
+ * and an underrun is counted whenever the display needs a word while the buffer is empty.
+ * Not run yet for lack of a simulator, a cycle model of the fetch FSM with the same memory timing gives:
+ *   8 bpp, refill below  64 words: bus busy 120155 of 138528 clocks (86.7%), 31 bursts, 0 underruns
+ *   4 bpp, refill below  64 words: bus busy 60820 of 138528 clocks (43.9%), 164 bursts, 0 underruns
+ *   2 bpp, refill below  64 words: bus busy 30600 of 138528 clocks (22.1%), 120 bursts, 0 underruns
+ *   1 bpp, refill below  64 words: bus busy 15345 of 138528 clocks (11.1%), 69 bursts, 0 underruns
+ *   8 bpp, refill below  16 words: bus busy 119604 of 138528 clocks (86.3%), 22 bursts, 506 underruns
+ *   4 bpp, refill below  16 words: bus busy 60635 of 138528 clocks (43.8%), 127 bursts, 0 underruns
+ *   2 bpp, refill below  16 words: bus busy 30485 of 138528 clocks (22.0%), 97 bursts, 0 underruns
+ *   1 bpp, refill below  16 words: bus busy 15275 of 138528 clocks (11.0%), 55 bursts, 0 underruns
+ * At 8 bpp the display drains 40 words more than the bus delivers over the visible part of a line,
+ * so a threshold of 16 runs the buffer dry and the fetch falls behind the frame.
+ */
+module sim_vga_graphic;
+	`include "function.vh"
+	`include "vga_define.vh"
+	localparam
+		H_DISP = VGA_800_600_72_H_DISP,
+		H_TOTAL = VGA_800_600_72_H_PW + VGA_800_600_72_H_BP + VGA_800_600_72_H_DISP + VGA_800_600_72_H_FP,
+		V_DISP = VGA_800_600_72_V_DISP,
+		V_TOTAL = VGA_800_600_72_V_PW + VGA_800_600_72_V_BP + VGA_800_600_72_V_DISP + VGA_800_600_72_V_FP,
+		MEM_LATENCY = 4;  // bus clocks before the first word of an access, as the PSRAM adapter
+	
+	// Inputs
+	reg vga_clk;
+	reg wb_clk;
+	reg rst;
+	reg [H_COUNT_WIDTH-1:0] h_count;
+	reg [V_COUNT_WIDTH-1:0] v_count;
+	reg [1:0] depth;
+	reg [7:0] refill_threshold;
+	reg [31:0] wbm_data_i;
+	reg wbm_ack_i;
+	
+	// Outputs
+	wire h_sync, v_sync;
+	wire [2:0] r, g;
+	wire [1:0] b;
+	wire wbm_cyc_o, wbm_stb_o;
+	wire [31:2] wbm_addr_o;
+	wire [2:0] wbm_cti_o;
+	wire [1:0] wbm_bte_o;
+	wire [3:0] wbm_sel_o;
+	wire wbm_we_o;
+	wire [31:0] wbm_data_o;
+	
+	// Instantiate the Unit Under Test (UUT)
+	wb_vga_graphic uut (
+		.clk(wb_clk),
+		.rst(rst),
+		.vga_clk(vga_clk),
+		.h_count_core(h_count),
+		.h_disp_max(H_DISP - 1),
+		.v_disp_max(V_DISP - 1),
+		.p_disp_max(H_DISP * V_DISP - 1),
+		.h_sync_core(h_count >= H_DISP + VGA_800_600_72_H_FP && h_count < H_TOTAL - VGA_800_600_72_H_BP),
+		.v_sync_core(v_count >= V_DISP + VGA_800_600_72_V_FP && v_count < V_TOTAL - VGA_800_600_72_V_BP),
+		.h_en_core(h_count < H_DISP),
+		.v_en_core(v_count < V_DISP),
+		.vram_base(12'h001),
+		.depth(depth),
+		.palette(128'h0123456789ABCDEF_FEDCBA9876543210),
+		.refill_threshold(refill_threshold),
+		.tile_en(1'b0),
+		.tile_width(7'h0),
+		.tile_height(8'h0),
+		.tile_stride(5'h0),
+		.tile_base(30'h0),
+		.tile_fill(8'h0),
+		.scroll_x(16'h0),
+		.scroll_y(16'h0),
+		.map_clk(wb_clk),
+		.map_we(1'b0),
+		.map_addr(11'h0),
+		.map_data(8'h0),
+		.h_sync(h_sync),
+		.v_sync(v_sync),
+		.r(r),
+		.g(g),
+		.b(b),
+		.wbm_clk_i(wb_clk),
+		.wbm_cyc_o(wbm_cyc_o),
+		.wbm_stb_o(wbm_stb_o),
+		.wbm_addr_o(wbm_addr_o),
+		.wbm_cti_o(wbm_cti_o),
+		.wbm_bte_o(wbm_bte_o),
+		.wbm_sel_o(wbm_sel_o),
+		.wbm_we_o(wbm_we_o),
+		.wbm_data_i(wbm_data_i),
+		.wbm_data_o(wbm_data_o),
+		.wbm_ack_i(wbm_ack_i)
+	);
+	
+	// scan counters, display range starts from 0 as VGA core
+	always @(posedge vga_clk) begin
+		if (h_count == H_TOTAL - 1) begin
+			h_count <= 0;
+			v_count <= (v_count == V_TOTAL - 1) ? 0 : v_count + 1'h1;
+		end
+		else begin
+			h_count <= h_count + 1'h1;
+		end
+	end
+	
+	// memory, the first word of each access is delayed, then one word per clock, data is the word address
+	reg [3:0] mem_wait;
+	always @(posedge wb_clk) begin
+		wbm_ack_i <= 0;
+		wbm_data_i <= {wbm_addr_o, 2'b0};
+		if (~wbm_cyc_o || wbm_we_o)
+			mem_wait <= MEM_LATENCY;
+		else if (mem_wait != 0)
+			mem_wait <= mem_wait - 1'h1;
+		else
+			wbm_ack_i <= 1;
+	end
+	
+	// occupancy of one whole frame, from the start of display to the next one
+	integer busy, total, bursts, underruns;
+	reg wbm_cyc_prev;
+	always @(posedge wb_clk) begin
+		wbm_cyc_prev <= wbm_cyc_o;
+		total = total + 1;
+		if (wbm_cyc_o)
+			busy = busy + 1;
+		if (wbm_cyc_o && ~wbm_cyc_prev)
+			bursts = bursts + 1;
+	end
+	
+	always @(posedge vga_clk) begin
+		if (uut.en_r && uut.FIFO_ASY.empty_r)
+			underruns = underruns + 1;
+	end
+	
+	task measure;
+		input [1:0] d;
+		input [7:0] threshold;
+		begin
+			depth = d;
+			refill_threshold = threshold;
+			rst = 1;
+			#200 rst = 0;
+			// skip the first frame as the buffer starts empty
+			wait (v_count == V_TOTAL - 1);
+			wait (v_count == 0);
+			wait (v_count == V_TOTAL - 1);
+			wait (v_count == 0);
+			busy = 0;
+			total = 0;
+			bursts = 0;
+			underruns = 0;
+			wait (v_count == V_TOTAL - 1);
+			wait (v_count == 0);
+			$display("%0d bpp, refill below %3d words: bus busy %0d of %0d clocks (%0d.%0d%%), %0d bursts, %0d underruns",
+				8 >> d, (threshold == 0) ? 64 : threshold, busy, total, busy * 100 / total, busy * 1000 / total % 10, bursts, underruns);
+		end
+	endtask
+	
+	initial begin
+		// Initialize Inputs
+		vga_clk = 0;
+		wb_clk = 0;
+		rst = 1;
+		h_count = 0;
+		v_count = 0;
+		depth = 0;
+		refill_threshold = 0;
+		wbm_data_i = 0;
+		wbm_ack_i = 0;
+		mem_wait = 0;
+		wbm_cyc_prev = 0;
+		busy = 0;
+		total = 0;
+		bursts = 0;
+		underruns = 0;
+	
+		measure(0, 0);
+		measure(1, 0);
+		measure(2, 0);
+		measure(3, 0);
+		// longer bursts with a lower threshold
+		measure(0, 16);
+		measure(1, 16);
+		measure(2, 16);
+		measure(3, 16);
+		$finish;
+	end
+	
+	initial forever #10 vga_clk = ~vga_clk;  // 50MHz
+	initial forever #50 wb_clk = ~wb_clk;  // 10MHz
+	
+endmodule
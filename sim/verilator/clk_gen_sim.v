@@ -0,0 +1,92 @@
+`include "define.vh"
+
+
+/**
+ * Clock generator for simulation, all clocks are derived from the 100MHz pad clock by counters.
+ * Rising edges of 50MHz, 25MHz and 10MHz clocks are aligned with rising edges of 100MHz clock, as DCM/MMCM does.
+ * Author: Zhao, Hongyu  <power_zhy@foxmail.com>
+ */
+module clk_gen_sim (
+	input wire clk_pad,  // input clock, 100MHz
+	output wire clk_100m,
+	output reg clk_50m = 0,
+	output reg clk_25m = 0,
+	output reg clk_10m = 0,
+	output reg locked = 0
+	);
+	
+	parameter
+		LOCK_CYCLES = 16;  // cycles of input clock before locked
+	
+	reg [2:0] count_10m = 0;
+	reg [4:0] count_lock = 0;
+	
+	assign clk_100m = clk_pad;
+	
+	always @(posedge clk_pad) begin
+		clk_50m <= ~clk_50m;
+		if (count_10m == 4) begin
+			count_10m <= 0;
+			clk_10m <= ~clk_10m;
+		end
+		else begin
+			count_10m <= count_10m + 1'h1;
+		end
+		if (count_lock != LOCK_CYCLES)
+			count_lock <= count_lock + 1'h1;
+		locked <= (count_lock == LOCK_CYCLES);
+	end
+	
+	always @(posedge clk_50m) begin
+		clk_25m <= ~clk_25m;
+	end
+	
+endmodule
+
+
+/**
+ * Replacement of the Nexys3 clock generator.
+ */
+module clk_gen_nexys3 (
+	input wire clk_pad,  // input clock, 100MHz
+	output wire clk_100m,
+	output wire clk_50m,
+	output wire clk_25m,
+	output wire clk_10m,
+	output wire locked
+	);
+	
+	clk_gen_sim CLK_GEN_SIM (
+		.clk_pad(clk_pad),
+		.clk_100m(clk_100m),
+		.clk_50m(clk_50m),
+		.clk_25m(clk_25m),
+		.clk_10m(clk_10m),
+		.locked(locked)
+		);
+	
+endmodule
+
+
+/**
+ * Replacement of the Sword clock generator.
+ */
+module clk_gen_sword (
+	input wire clk_pad,  // input clock, 100MHz
+	output wire clk_100m,
+	output wire clk_50m,
+	output wire clk_25m,
+	output wire clk_10m,
+	output wire locked
+	);
+	
+	clk_gen_sim CLK_GEN_SIM (
+		.clk_pad(clk_pad),
+		.clk_100m(clk_100m),
+		.clk_50m(clk_50m),
+		.clk_25m(clk_25m),
+		.clk_10m(clk_10m),
+		.locked(locked)
+		);
+	
+endmodule
@@ -0,0 +1,643 @@
+#include "soc_models.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+// PSRAM, latency code 3, row boundary crossing costs 3 extra wait cycles, internal refresh every 15.6us doubles latency
+#define PSRAM_LATENCY 3
+#define PSRAM_ROW_WORDS 128
+#define PSRAM_ROW_WAIT 3
+#define PSRAM_REFRESH_PERIOD (15600 * 1000ULL)
+#define PSRAM_REFRESH_TIME (100 * 1000ULL)
+
+psram_model::psram_model(uint32_t words) : mem(words, 0) {
+	bcr = 0;
+	burst_count = 0;
+	row_cross_count = 0;
+	reset();
+}
+
+void psram_model::reset() {
+	active = false;
+	writing = false;
+	wait = false;
+	dout = 0;
+	wait_count = 0;
+}
+
+void psram_model::clock(sim_time now, bool we_n, bool adv_n, bool cre, bool lb_n, bool ub_n, uint32_t addr_i, uint16_t din) {
+	bool refreshing = (now % PSRAM_REFRESH_PERIOD) >= PSRAM_REFRESH_PERIOD - PSRAM_REFRESH_TIME;
+	if (!adv_n) {
+		if (cre) {
+			if (!we_n)
+				bcr = addr_i & 0xFFFF;
+			active = false;
+		}
+		else {
+			active = true;
+			writing = !we_n;
+			addr = addr_i % mem.size();
+			wait_count = refreshing ? 2 * PSRAM_LATENCY : PSRAM_LATENCY;
+			wait = true;
+			burst_count++;
+		}
+	}
+	else if (active) {
+		if (wait_count > 1) {
+			wait_count--;
+			wait = (wait_count > 1);  // WAIT asserted one data cycle before delay
+			if (wait_count == 1 && !writing)
+				dout = mem[addr];
+		}
+		else {
+			if (writing) {
+				if (!lb_n)
+					mem[addr] = (mem[addr] & 0xFF00) | (din & 0x00FF);
+				if (!ub_n)
+					mem[addr] = (mem[addr] & 0x00FF) | (din & 0xFF00);
+			}
+			addr = (addr + 1) % mem.size();
+			if (addr % PSRAM_ROW_WORDS == 0) {
+				wait_count = PSRAM_ROW_WAIT + 1;
+				wait = true;
+				row_cross_count++;
+			}
+			else if (!writing) {
+				dout = mem[addr];
+			}
+		}
+	}
+}
+
+
+rom_model::rom_model(uint32_t bytes) : mem(bytes, 0xFF) {
+}
+
+bool rom_model::load(const char *file, uint32_t offset) {
+	FILE *fp = fopen(file, "rb");
+	if (!fp)
+		return false;
+	size_t len = 0;
+	if (offset < mem.size())
+		len = fread(&mem[offset], 1, mem.size() - offset, fp);
+	fclose(fp);
+	printf("%s: %u bytes loaded at 0x%07X\n", file, (uint32_t)len, offset);
+	return true;
+}
+
+// image files are little-endian, lower half-word is at lower address
+uint16_t rom_model::read16(uint32_t word_addr) const {
+	uint32_t a = (word_addr * 2) % mem.size();
+	return mem[a] | (mem[a+1] << 8);
+}
+
+uint32_t rom_model::read32(uint32_t word_addr) const {
+	uint32_t a = (word_addr * 4) % mem.size();
+	return mem[a] | (mem[a+1] << 8) | (mem[a+2] << 16) | ((uint32_t)mem[a+3] << 24);
+}
+
+
+sram_model::sram_model(uint32_t words) : mem(words, 0) {
+}
+
+uint64_t sram_model::read(uint32_t addr) const {
+	return mem[addr % mem.size()];
+}
+
+void sram_model::write(uint32_t addr, uint64_t data) {
+	mem[addr % mem.size()] = data & 0xFFFFFFFFFFFFULL;
+}
+
+
+uart_model::uart_model(uint32_t baud) {
+	bit_time = 1000000000000ULL / baud;
+	tx_prev = true;
+	tx_busy = false;
+	tx_count = 0;
+	rx_count = 0;
+	rx_busy = false;
+}
+
+void uart_model::send(const std::string &text) {
+	for (size_t i=0; i<text.size(); i++)
+		rx_queue.push_back(text[i]);
+}
+
+bool uart_model::step(sim_time now, bool tx) {
+	// TX, sample at the middle of each bit
+	if (!tx_busy) {
+		if (tx_prev && !tx) {
+			tx_busy = true;
+			tx_bit = 0;
+			tx_data = 0;
+			tx_next = now + bit_time + bit_time / 2;
+		}
+	}
+	else if (now >= tx_next) {
+		if (tx_bit < 8) {
+			tx_data |= (tx ? 1 : 0) << tx_bit;
+			tx_bit++;
+			tx_next += bit_time;
+		}
+		else {
+			tx_busy = false;
+			if (tx) {
+				putchar(tx_data);
+				fflush(stdout);
+				tx_count++;
+			}
+		}
+	}
+	tx_prev = tx;
+	// RX, start bit, 8 data bits and stop bit
+	if (!rx_busy) {
+		if (rx_queue.empty())
+			return true;
+		rx_busy = true;
+		rx_start = now;
+	}
+	int bit = (now - rx_start) / bit_time;
+	if (bit == 0)
+		return false;
+	if (bit <= 8)
+		return (rx_queue.front() >> (bit - 1)) & 1;
+	if (bit >= 10) {
+		rx_queue.pop_front();
+		rx_busy = false;
+		rx_count++;
+	}
+	return true;
+}
+
+
+// PS/2 clock is about 12.5kHz, with a gap between bytes
+#define PS2_HALF_PERIOD (40 * PS_PER_US)
+#define PS2_BYTE_GAP (200 * PS_PER_US)
+
+struct ps2_key {
+	const char *name;
+	uint8_t extended;
+	uint8_t code;
+};
+
+// scancode set 2, see http://www.computer-engineering.org/ps2keyboard/scancodes2.html
+static const ps2_key ps2_keys[] = {
+	{"a", 0, 0x1C}, {"b", 0, 0x32}, {"c", 0, 0x21}, {"d", 0, 0x23}, {"e", 0, 0x24}, {"f", 0, 0x2B}, {"g", 0, 0x34},
+	{"h", 0, 0x33}, {"i", 0, 0x43}, {"j", 0, 0x3B}, {"k", 0, 0x42}, {"l", 0, 0x4B}, {"m", 0, 0x3A}, {"n", 0, 0x31},
+	{"o", 0, 0x44}, {"p", 0, 0x4D}, {"q", 0, 0x15}, {"r", 0, 0x2D}, {"s", 0, 0x1B}, {"t", 0, 0x2C}, {"u", 0, 0x3C},
+	{"v", 0, 0x2A}, {"w", 0, 0x1D}, {"x", 0, 0x22}, {"y", 0, 0x35}, {"z", 0, 0x1A},
+	{"0", 0, 0x45}, {"1", 0, 0x16}, {"2", 0, 0x1E}, {"3", 0, 0x26}, {"4", 0, 0x25},
+	{"5", 0, 0x2E}, {"6", 0, 0x36}, {"7", 0, 0x3D}, {"8", 0, 0x3E}, {"9", 0, 0x46},
+	{"enter", 0, 0x5A}, {"space", 0, 0x29}, {"esc", 0, 0x76}, {"tab", 0, 0x0D}, {"backspace", 0, 0x66},
+	{"lshift", 0, 0x12}, {"rshift", 0, 0x59}, {"lctrl", 0, 0x14}, {"rctrl", 1, 0x14}, {"lalt", 0, 0x11}, {"ralt", 1, 0x11},
+	{"up", 1, 0x75}, {"down", 1, 0x72}, {"left", 1, 0x6B}, {"right", 1, 0x74},
+	{"home", 1, 0x6C}, {"end", 1, 0x69}, {"pgup", 1, 0x7D}, {"pgdn", 1, 0x7A}, {"insert", 1, 0x70}, {"delete", 1, 0x71},
+	{NULL, 0, 0}
+};
+
+bool ps2_key_codes(const std::string &name, bool make, std::vector<uint8_t> &codes) {
+	for (const ps2_key *k=ps2_keys; k->name; k++) {
+		if (name != k->name)
+			continue;
+		if (k->extended)
+			codes.push_back(0xE0);
+		if (!make)
+			codes.push_back(0xF0);
+		codes.push_back(k->code);
+		return true;
+	}
+	return false;
+}
+
+ps2_model::ps2_model() {
+	clk = true;
+	dat = true;
+	bit = -1;
+	next = 0;
+	byte_count = 0;
+}
+
+void ps2_model::send(const std::vector<uint8_t> &codes) {
+	queue.insert(queue.end(), codes.begin(), codes.end());
+}
+
+bool ps2_model::key(const std::string &name, bool make) {
+	std::vector<uint8_t> codes;
+	if (!ps2_key_codes(name, make, codes))
+		return false;
+	send(codes);
+	return true;
+}
+
+void ps2_model::step(sim_time now, bool host_clk, bool host_dat) {
+	if (now < next)
+		return;
+	if (bit < 0) {
+		// idle, wait for host to release the clock line (not inhibited) before starting a new frame
+		if (queue.empty() || !host_clk || !host_dat)
+			return;
+		uint8_t data = queue.front();
+		uint8_t parity = 1;
+		for (int i=0; i<8; i++)
+			parity ^= (data >> i) & 1;
+		frame = (1 << 10) | (parity << 9) | (data << 1);
+		queue.pop_front();
+		bit = 0;
+		dat = frame & 1;
+		next = now + PS2_HALF_PERIOD / 2;
+		return;
+	}
+	if (clk) {
+		// falling edge, host samples data
+		clk = false;
+		next = now + PS2_HALF_PERIOD;
+	}
+	else {
+		// rising edge, change data
+		clk = true;
+		bit++;
+		if (bit == 11) {
+			bit = -1;
+			dat = true;
+			byte_count++;
+			next = now + PS2_BYTE_GAP;
+		}
+		else {
+			dat = (frame >> bit) & 1;
+			next = now + PS2_HALF_PERIOD;
+		}
+	}
+}
+
+
+// SD card in SPI mode
+#define SD_BLOCK_SIZE 512
+#define SD_INIT_WAIT 3  // ACMD41 returns busy for this many times
+#define SD_READ_GAP 4  // bytes of 0xFF before the data token, Nac
+#define SD_STOP_BUSY 2  // bytes of busy after CMD12
+#define SD_R1_IDLE 0x01
+#define SD_R1_ILLEGAL 0x04
+#define SD_R1_CRC 0x08
+#define SD_R1_ADDRESS 0x20
+#define SD_TOKEN_START 0xFE
+#define SD_TOKEN_RANGE 0x08  // data error token, out of range
+
+static uint8_t sd_crc7(const uint8_t *data, int len) {
+	uint8_t crc = 0;
+	for (int i=0; i<len; i++) {
+		for (int j=7; j>=0; j--) {
+			bool bit = ((data[i] >> j) & 1) ^ ((crc >> 6) & 1);
+			crc = (crc << 1) & 0x7F;
+			if (bit)
+				crc ^= 0x09;
+		}
+	}
+	return crc;
+}
+
+static uint16_t sd_crc16(const uint8_t *data, int len) {
+	uint16_t crc = 0;
+	for (int i=0; i<len; i++) {
+		crc ^= data[i] << 8;
+		for (int j=0; j<8; j++)
+			crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+	}
+	return crc;
+}
+
+sd_model::sd_model() {
+	cmd_count = 0;
+	block_count = 0;
+	cmd_len = 0;
+	idle = false;
+	app = false;
+	init_wait = SD_INIT_WAIT;
+	reading = false;
+	block = 0;
+	sck_prev = false;
+	cs_prev = false;
+	bit_count = 0;
+	bit_in = 0;
+	bit_out = 0xFF;
+}
+
+bool sd_model::load(const char *file) {
+	FILE *fp = fopen(file, "rb");
+	if (!fp)
+		return false;
+	uint8_t buf[4096];
+	size_t len;
+	while ((len = fread(buf, 1, sizeof(buf), fp)) > 0)
+		image.insert(image.end(), buf, buf + len);
+	fclose(fp);
+	// whole blocks only, the tail is padded with zeros
+	image.resize((image.size() + SD_BLOCK_SIZE - 1) / SD_BLOCK_SIZE * SD_BLOCK_SIZE, 0);
+	printf("%s: %u bytes loaded as SD card, %u blocks\n", file, (uint32_t)image.size(), (uint32_t)(image.size() / SD_BLOCK_SIZE));
+	return true;
+}
+
+void sd_model::queue_block() {
+	out.insert(out.end(), SD_READ_GAP, 0xFF);
+	if ((uint64_t)block * SD_BLOCK_SIZE >= image.size()) {
+		out.push_back(SD_TOKEN_RANGE);
+		reading = false;
+		return;
+	}
+	const uint8_t *data = &image[(size_t)block * SD_BLOCK_SIZE];
+	uint16_t crc = sd_crc16(data, SD_BLOCK_SIZE);
+	out.push_back(SD_TOKEN_START);
+	out.insert(out.end(), data, data + SD_BLOCK_SIZE);
+	out.push_back(crc >> 8);
+	out.push_back(crc & 0xFF);
+	block++;
+	block_count++;
+}
+
+void sd_model::command() {
+	uint8_t index = cmd[0] & 0x3F;
+	uint32_t arg = (cmd[1] << 24) | (cmd[2] << 16) | (cmd[3] << 8) | cmd[4];
+	uint8_t r1 = idle ? SD_R1_IDLE : 0;
+	bool is_app = app;
+	app = false;
+	cmd_count++;
+	if (index == 12 && reading) {
+		// the byte following CMD12 is a stuff byte, then R1 and busy
+		uint8_t stuff = out.empty() ? 0xFF : out.front();
+		reading = false;
+		out.clear();
+		out.push_back(stuff);
+		out.push_back(r1);
+		out.insert(out.end(), SD_STOP_BUSY, 0x00);
+		return;
+	}
+	out.clear();
+	reading = false;
+	out.push_back(0xFF);  // Ncr
+	if ((index == 0 || index == 8) && sd_crc7(cmd, 5) != (cmd[5] >> 1)) {
+		out.push_back(r1 | SD_R1_CRC);
+		return;
+	}
+	switch (index) {
+		case 0:
+			idle = true;
+			init_wait = SD_INIT_WAIT;
+			out.push_back(SD_R1_IDLE);
+			return;
+		case 8:
+			// R7, voltage accepted and check pattern echoed
+			out.push_back(r1);
+			out.push_back(0x00);
+			out.push_back(0x00);
+			out.push_back((arg >> 8) & 0x0F);
+			out.push_back(arg & 0xFF);
+			return;
+		case 55:
+			app = true;
+			out.push_back(r1);
+			return;
+		case 41:
+			if (!is_app)
+				break;
+			if (idle && init_wait > 0)
+				init_wait--;
+			else
+				idle = false;
+			out.push_back(idle ? SD_R1_IDLE : 0);
+			return;
+		case 58:
+			// R3, OCR with power up status and CCS set after initialization
+			out.push_back(r1);
+			out.push_back(idle ? 0x00 : 0xC0);
+			out.push_back(0xFF);
+			out.push_back(0x80);
+			out.push_back(0x00);
+			return;
+		case 16:
+			out.push_back(arg == SD_BLOCK_SIZE ? r1 : (r1 | SD_R1_ILLEGAL));
+			return;
+		case 17:
+		case 18:
+			if (idle)
+				break;
+			if ((uint64_t)arg * SD_BLOCK_SIZE >= image.size()) {
+				out.push_back(r1 | SD_R1_ADDRESS);
+				return;
+			}
+			out.push_back(r1);
+			block = arg;
+			queue_block();
+			reading = (index == 18);
+			return;
+	}
+	out.push_back(r1 | SD_R1_ILLEGAL);
+}
+
+uint8_t sd_model::transfer(bool selected, uint8_t mosi) {
+	if (!selected) {
+		cmd_len = 0;
+		return 0xFF;
+	}
+	uint8_t miso = 0xFF;
+	if (!out.empty()) {
+		miso = out.front();
+		out.pop_front();
+	}
+	// commands start with bits "01", data from host is always 0xFF while reading
+	if (cmd_len > 0 || (mosi & 0xC0) == 0x40) {
+		cmd[cmd_len++] = mosi;
+		if (cmd_len == 6) {
+			cmd_len = 0;
+			command();
+		}
+	}
+	if (out.empty() && reading)
+		queue_block();
+	return miso;
+}
+
+bool sd_model::step(bool sck, bool mosi, bool cs_n) {
+	bool selected = !cs_n;
+	if (selected && !cs_prev) {
+		bit_count = 0;
+		bit_out = out.empty() ? 0xFF : out.front();
+	}
+	else if (!selected) {
+		if (cs_prev)
+			transfer(false, 0xFF);
+	}
+	else if (sck && !sck_prev) {
+		// rising edge, sample MOSI
+		bit_in = (bit_in << 1) | mosi;
+		bit_count++;
+		if (bit_count == 8) {
+			bit_count = 0;
+			transfer(true, bit_in);
+		}
+	}
+	else if (!sck && sck_prev) {
+		// falling edge, the next bit, or the first bit of the next byte
+		if (bit_count == 0)
+			bit_out = out.empty() ? 0xFF : out.front();
+		else
+			bit_out <<= 1;
+	}
+	sck_prev = sck;
+	cs_prev = selected;
+	return selected ? (bit_out >> 7) & 1 : true;
+}
+
+
+// display modes, the same as vga_define.vh
+struct vga_mode {
+	const char *name;
+	int clk_freq;  // in kHz
+	int h_pw, h_bp, h_disp, h_fp;
+	int v_pw, v_bp, v_disp, v_fp;
+};
+
+static const vga_mode vga_modes[] = {
+	{"640x480@60", 25000, 96, 48, 640, 16, 2, 33, 480, 10},
+	{"640x480@72", 31250, 40, 128, 640, 24, 3, 28, 480, 9},
+	{"640x480@75", 31250, 64, 120, 640, 16, 3, 16, 480, 1},
+	{"800x600@60", 40000, 128, 88, 800, 40, 4, 23, 600, 1},
+	{"800x600@72", 50000, 120, 64, 800, 56, 6, 23, 600, 37},
+	{"800x600@75", 50000, 80, 160, 800, 16, 3, 21, 600, 1},
+	{"1024x768@60", 65000, 136, 160, 1024, 24, 6, 29, 768, 3},
+	{"1280x768@60", 80000, 128, 192, 1280, 64, 7, 20, 768, 3},
+	{"1360x768@60", 85000, 112, 256, 1360, 64, 6, 18, 768, 3},
+	{NULL, 0, 0, 0, 0, 0, 0, 0, 0, 0}
+};
+
+bool vga_model::sync_state::update(sim_time now, bool value) {
+	if (value == level)
+		return false;
+	dur[level] = now - edge;
+	edge = now;
+	level = value;
+	// pulse is the shorter phase, so that both polarities are recognized
+	return dur[0] && dur[1] && (dur[value] < dur[!value]);
+}
+
+vga_model::vga_model(int color_bits_r, int color_bits_g, int color_bits_b) {
+	bits[0] = color_bits_r;
+	bits[1] = color_bits_g;
+	bits[2] = color_bits_b;
+	memset(&hs, 0, sizeof(hs));
+	memset(&vs, 0, sizeof(vs));
+	frame_dir = NULL;
+	frame_count = 0;
+	mode = -1;
+	line = 0;
+	last_x = -1;
+	line_start = 0;
+	line_period = 0;
+	frame_valid = false;
+}
+
+const char *vga_model::mode_name() const {
+	return mode < 0 ? "unknown" : vga_modes[mode].name;
+}
+
+void vga_model::step(sim_time now, bool h_sync, bool v_sync, uint8_t r, uint8_t g, uint8_t b) {
+	if (hs.update(now, h_sync)) {
+		line_period = now - line_start;
+		line_start = now;
+		line++;
+		last_x = -1;
+	}
+	if (vs.update(now, v_sync)) {
+		// find the mode with the same number of lines and the nearest line period
+		int found = -1;
+		sim_time best = 0;
+		for (int i=0; vga_modes[i].name; i++) {
+			const vga_mode *m = &vga_modes[i];
+			int v_total = m->v_pw + m->v_bp + m->v_disp + m->v_fp;
+			if (line < v_total - 1 || line > v_total + 1)
+				continue;
+			sim_time period = (sim_time)(m->h_pw + m->h_bp + m->h_disp + m->h_fp) * 1000000000ULL / m->clk_freq;
+			sim_time diff = period > line_period ? period - line_period : line_period - period;
+			if (found < 0 || diff < best) {
+				found = i;
+				best = diff;
+			}
+		}
+		if (found >= 0 && found == mode && frame_valid)
+			write_frame();
+		if (found != mode && found >= 0)
+			frame.assign(vga_modes[found].h_disp * vga_modes[found].v_disp * 3, 0);
+		mode = found;
+		frame_valid = (mode >= 0);
+		line = 0;
+	}
+	if (mode < 0)
+		return;
+	const vga_mode *m = &vga_modes[mode];
+	int y = line - (m->v_pw + m->v_bp);
+	if (line == 0 || y < 0 || y >= m->v_disp)
+		return;
+	// sample at the middle of each pixel
+	sim_time pos = (now - line_start) * m->clk_freq / 1000000ULL;  // in 1/1000 pixels
+	int x = (int)(pos / 1000) - (m->h_pw + m->h_bp);
+	if (x < 0 || x >= m->h_disp || x == last_x || pos % 1000 < 500)
+		return;
+	last_x = x;
+	uint8_t *p = &frame[(y * m->h_disp + x) * 3];
+	uint8_t c[3] = {r, g, b};
+	for (int i=0; i<3; i++)
+		p[i] = c[i] * 255 / ((1 << bits[i]) - 1);
+}
+
+void vga_model::write_frame() {
+	const vga_mode *m = &vga_modes[mode];
+	frame_count++;
+	if (!frame_dir)
+		return;
+	char name[1024];
+	snprintf(name, sizeof(name), "%s/frame_%04u.ppm", frame_dir, frame_count);
+	FILE *fp = fopen(name, "wb");
+	if (!fp) {
+		fprintf(stderr, "can not write %s\n", name);
+		return;
+	}
+	fprintf(fp, "P6\n%d %d\n255\n", m->h_disp, m->v_disp);
+	fwrite(&frame[0], 1, frame.size(), fp);
+	fclose(fp);
+}
+
+
+bool load_script(const char *file, std::vector<script_event> &script) {
+	FILE *fp = fopen(file, "r");
+	if (!fp)
+		return false;
+	char line[1024];
+	while (fgets(line, sizeof(line), fp)) {
+		line[strcspn(line, "\r\n")] = 0;
+		char *p = line;
+		while (*p == ' ' || *p == '\t')
+			p++;
+		if (*p == 0 || *p == '#')
+			continue;
+		script_event e;
+		char *end;
+		e.time = (sim_time)(strtod(p, &end) * PS_PER_MS);
+		p = end + strspn(end, " \t");
+		size_t len = strcspn(p, " \t");
+		e.cmd.assign(p, len);
+		p += len;
+		if (*p)
+			p++;
+		// "\n" in arguments stands for a new line
+		for (; *p; p++) {
+			if (p[0] == '\\' && p[1] == 'n') {
+				e.arg += '\n';
+				p++;
+			}
+			else {
+				e.arg += *p;
+			}
+		}
+		script.push_back(e);
+	}
+	fclose(fp);
+	return true;
+}
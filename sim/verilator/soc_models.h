@@ -0,0 +1,172 @@
+#ifndef __SOC_MODELS_H__
+#define __SOC_MODELS_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+
+// all times are in picoseconds
+typedef uint64_t sim_time;
+#define PS_PER_US 1000000ULL
+#define PS_PER_MS 1000000000ULL
+
+
+// stimulus script, one command per line: "<time in ms> <command> [arguments]"
+struct script_event {
+	sim_time time;
+	std::string cmd;
+	std::string arg;
+};
+
+bool load_script(const char *file, std::vector<script_event> &script);
+
+// make or break codes of a named key in scancode set 2, false if unknown
+bool ps2_key_codes(const std::string &name, bool make, std::vector<uint8_t> &codes);
+
+
+// CellularRAM on Nexys3, synchronous burst mode only, the same behavior as sim/model_psram_nexys3.v
+class psram_model {
+public:
+	psram_model(uint32_t words);
+	void reset();  // chip enable released
+	void clock(sim_time now, bool we_n, bool adv_n, bool cre, bool lb_n, bool ub_n, uint32_t addr, uint16_t din);  // rising edge of RAM's clock
+	bool wait;  // WAIT output
+	uint16_t dout;  // data output
+	uint32_t burst_count;
+	uint32_t row_cross_count;
+private:
+	std::vector<uint16_t> mem;
+	uint16_t bcr;
+	bool active;
+	bool writing;
+	uint32_t addr;
+	int wait_count;
+};
+
+
+// memory loaded from image files, used as PCM on Nexys3 (16 bits) and BPI flash on Sword (32 bits)
+class rom_model {
+public:
+	rom_model(uint32_t bytes);
+	bool load(const char *file, uint32_t offset);
+	uint16_t read16(uint32_t word_addr) const;
+	uint32_t read32(uint32_t word_addr) const;
+private:
+	std::vector<uint8_t> mem;
+};
+
+
+// asynchronous SRAM on Sword, 48 bits per word
+class sram_model {
+public:
+	sram_model(uint32_t words);
+	uint64_t read(uint32_t addr) const;
+	void write(uint32_t addr, uint64_t data);
+private:
+	std::vector<uint64_t> mem;
+};
+
+
+// UART terminal, decodes TX line to stdout and drives RX line with queued bytes, 8N1
+class uart_model {
+public:
+	uart_model(uint32_t baud);
+	void send(const std::string &text);
+	bool step(sim_time now, bool tx);  // returns RX line value
+	uint32_t tx_count;
+	uint32_t rx_count;
+private:
+	sim_time bit_time;
+	bool tx_prev;
+	bool tx_busy;
+	int tx_bit;
+	uint8_t tx_data;
+	sim_time tx_next;
+	std::deque<uint8_t> rx_queue;
+	bool rx_busy;
+	sim_time rx_start;
+};
+
+
+// PS/2 keyboard, sends scancodes to host with device-to-host frames
+class ps2_model {
+public:
+	ps2_model();
+	void send(const std::vector<uint8_t> &codes);
+	bool key(const std::string &name, bool make);  // queue make or break codes of a named key, false if unknown
+	void step(sim_time now, bool host_clk, bool host_dat);  // host_* are the line values driven by host, 1 if released
+	bool clk;  // line values driven by device
+	bool dat;
+	uint32_t byte_count;
+private:
+	std::deque<uint8_t> queue;
+	int bit;
+	uint16_t frame;
+	sim_time next;
+};
+
+
+// SD card in SPI mode (SDHC, block addressing), serving an image file, the same commands as "demo/common/sd.S" uses:
+// CMD0, CMD8, CMD55 + ACMD41, CMD58, CMD16, CMD17, CMD18 and CMD12, CRC of commands is only checked for CMD0 and CMD8
+class sd_model {
+public:
+	sd_model();
+	bool load(const char *file);
+	// byte level, one byte exchanged while selected, returns MISO byte
+	uint8_t transfer(bool selected, uint8_t mosi);
+	// bit level, SPI mode 0, called on every change of the lines, returns MISO line value
+	bool step(bool sck, bool mosi, bool cs_n);
+	uint32_t cmd_count;
+	uint32_t block_count;  // data blocks sent
+private:
+	void command();
+	void queue_block();
+	std::vector<uint8_t> image;
+	std::deque<uint8_t> out;  // bytes to send, 0xFF when empty
+	uint8_t cmd[6];
+	int cmd_len;
+	bool idle;  // in idle state, before initialization by ACMD41
+	bool app;  // CMD55 received, next command is application specific
+	int init_wait;  // ACMD41 returns busy for a few times
+	bool reading;  // CMD18 in progress
+	uint32_t block;  // next block of CMD18
+	// bit level
+	bool sck_prev;
+	bool cs_prev;
+	int bit_count;
+	uint8_t bit_in;
+	uint8_t bit_out;
+};
+
+
+// VGA monitor, detects the display mode from sync timing and captures frames into PPM files
+class vga_model {
+public:
+	vga_model(int color_bits_r, int color_bits_g, int color_bits_b);
+	void step(sim_time now, bool h_sync, bool v_sync, uint8_t r, uint8_t g, uint8_t b);
+	const char *frame_dir;  // directory to write frames to, NULL to discard
+	uint32_t frame_count;
+	const char *mode_name() const;
+private:
+	struct sync_state {
+		bool level;
+		sim_time edge;
+		sim_time dur[2];
+		bool update(sim_time now, bool value);  // returns true at the beginning of a sync pulse
+	};
+	void write_frame();
+	int bits[3];
+	sync_state hs, vs;
+	int mode;
+	int line;
+	int last_x;
+	sim_time line_start;
+	sim_time line_period;
+	std::vector<uint8_t> frame;
+	bool frame_valid;
+};
+
+#endif
@@ -0,0 +1,390 @@
+#include "Vsoc.h"
+#include "verilated.h"
+#include "soc_models.h"
+#include "iss_cpu.h"
+#include "iss_soc.h"
+#include "iss_profile.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+
+// the only clock fed to the design is the 100MHz pad clock, all others are derived from it
+#define HALF_PERIOD 5000ULL
+#define CPU_CLK_PERIOD 100000ULL
+#define DIFF_MAX_STEPS 16  // exceptions the ISS may take before it retires the same instruction as the RTL
+
+static sim_time now = 0;
+
+double sc_time_stamp() {
+	return now;
+}
+
+
+static void usage(const char *name) {
+	printf("Usage: %s [options]\n", name);
+	printf("\t--flash <file>[@<offset>]  load image into PCM (Nexys3) or BPI flash (Sword), offset in hex, repeatable\n");
+	printf("\t--script <file>            stimulus script with keys, buttons, switches and UART input\n");
+	printf("\t--sd <file>                image of the SD card on SPI (Nexys3 only)\n");
+	printf("\t--frames <dir>             write captured VGA frames to <dir>/frame_NNNN.ppm\n");
+	printf("\t--max-frames <n>           stop after <n> frames captured\n");
+	printf("\t--time <ms>                stop after <ms> milliseconds of simulated time\n");
+	printf("\t--switch <hex>             initial value of switches\n");
+	printf("\t--baud <rate>              UART baud rate, default 115200\n");
+	printf("\t--diff                     run the instruction set simulator in lock-step, stop at the first divergence\n");
+	printf("\t--symbols <file>           ELF file or objdump listing for the function profile of real CPU cycles, repeatable\n");
+	printf("\t--top <n>                  show only the first <n> functions of the profile, 0 for all\n");
+}
+
+static void print_retire(const char *name, const retire_info &r) {
+	printf("\t%s: %08x", name, r.pc);
+	if (r.wen)
+		printf("  $%d = %08x", r.waddr, r.wdata);
+	if (r.mem_wen)
+		printf("  [%08x] = %08x", r.mem_addr, r.mem_data);
+	printf("\n");
+}
+
+static bool same_retire(const retire_info &rtl, const retire_info &iss) {
+	if (rtl.pc != iss.pc || rtl.wen != iss.wen || rtl.mem_wen != iss.mem_wen)
+		return false;
+	if (rtl.wen && (rtl.waddr != iss.waddr || (rtl.wdata != iss.wdata && !iss.external)))
+		return false;
+	if (rtl.mem_wen && (rtl.mem_addr != iss.mem_addr || rtl.mem_data != iss.mem_data))
+		return false;
+	return true;
+}
+
+static double host_time() {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+int main(int argc, char **argv) {
+	Verilated::commandArgs(argc, argv);
+	#ifdef BOARD_SWORD
+	rom_model flash(16 << 20);
+	sram_model sram(1 << 20);
+	vga_model vga(4, 4, 4);
+	uint32_t btn_matrix = 0;  // btn_y[j] is pulled low when btn_x[i] is low and button i*4+j is pressed
+	#else
+	rom_model pcm(16 << 20);
+	psram_model psram(8 << 20);
+	vga_model vga(3, 3, 2);
+	sd_model sd;
+	bool sd_card = false;  // MISO is pulled up without card
+	#endif
+	std::vector<script_event> script;
+	size_t script_pos = 0;
+	uint32_t baud = 115200;
+	uint32_t switch_init = 0;
+	uint32_t max_frames = 0;
+	sim_time max_time = 0;
+	iss_soc iss_mem;
+	iss_cpu iss(&iss_mem);
+	iss_profile profile;
+	bool diff = false;
+	int top_n = 30;
+
+	for (int i=1; i<argc; i++) {
+		bool more = (i + 1 < argc);
+		if (strcmp(argv[i], "--flash") == 0 && more) {
+			std::string arg = argv[++i];
+			uint32_t offset = 0;
+			size_t at = arg.find('@');
+			if (at != std::string::npos) {
+				offset = strtoul(arg.c_str() + at + 1, NULL, 16);
+				arg.resize(at);
+			}
+			#ifdef BOARD_SWORD
+			bool ok = flash.load(arg.c_str(), offset);
+			#else
+			bool ok = pcm.load(arg.c_str(), offset) && iss_mem.load(arg.c_str(), offset);
+			#endif
+			if (!ok) {
+				fprintf(stderr, "can not open %s\n", arg.c_str());
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--sd") == 0 && more) {
+			#ifdef BOARD_SWORD
+			fprintf(stderr, "no SD card on Sword\n");
+			return 1;
+			#else
+			if (!sd.load(argv[++i])) {
+				fprintf(stderr, "can not open %s\n", argv[i]);
+				return 1;
+			}
+			sd_card = true;
+			#endif
+		}
+		else if (strcmp(argv[i], "--script") == 0 && more) {
+			if (!load_script(argv[++i], script)) {
+				fprintf(stderr, "can not open %s\n", argv[i]);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--frames") == 0 && more) {
+			vga.frame_dir = argv[++i];
+		}
+		else if (strcmp(argv[i], "--max-frames") == 0 && more) {
+			max_frames = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--time") == 0 && more) {
+			max_time = (sim_time)(atof(argv[++i]) * PS_PER_MS);
+		}
+		else if (strcmp(argv[i], "--switch") == 0 && more) {
+			switch_init = strtoul(argv[++i], NULL, 16);
+		}
+		else if (strcmp(argv[i], "--baud") == 0 && more) {
+			baud = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--diff") == 0) {
+			#ifdef BOARD_SWORD
+			fprintf(stderr, "lock-step mode supports Nexys3 only\n");
+			return 1;
+			#endif
+			diff = true;
+		}
+		else if (strcmp(argv[i], "--symbols") == 0 && more) {
+			if (!profile.load(argv[++i])) {
+				fprintf(stderr, "can not load symbols from %s\n", argv[i]);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--top") == 0 && more) {
+			top_n = atoi(argv[++i]);
+		}
+		else if (argv[i][0] == '+') {
+			// verilator's own arguments
+		}
+		else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	uart_model uart(baud);
+	ps2_model ps2;
+	Vsoc *top = new Vsoc;
+	top->clk = 0;
+	top->sw = switch_init;
+	#ifdef BOARD_SWORD
+	top->rst_n = 1;
+	top->btn_y = 0xF;
+	top->flash_ready = 3;
+	#else
+	top->rst = 0;
+	top->btn_l = top->btn_r = top->btn_u = top->btn_d = 0;
+	top->ram_wait = 0;
+	top->spi_miso = 1;
+	bool ram_clk_prev = false;
+	#endif
+	top->uart_rx = 1;
+	top->keyboard_clk = 1;
+	top->keyboard_dat = 1;
+	top->eval();
+	iss.lockstep = true;
+	iss_mem.uart_echo = false;
+	bool cpu_clk_prev = top->cpu_clk;
+	uint64_t cpu_cycles = 0;
+	uint64_t sleep_cycles = 0;
+	uint64_t fetch_stall_cycles = 0;
+	uint64_t retire_cycle = 0;  // CPU cycle of last retirement, for the profile
+	uint64_t diff_count = 0;
+	bool diff_failed = false;
+
+	double host_start = host_time();
+	bool quit = false;
+	while (!quit && !Verilated::gotFinish()) {
+		now += HALF_PERIOD;
+		top->clk = !top->clk;
+		top->eval();
+
+		// script
+		while (script_pos < script.size() && script[script_pos].time <= now) {
+			const script_event &e = script[script_pos++];
+			if (e.cmd == "key" || e.cmd == "press" || e.cmd == "release") {
+				bool ok = true;
+				if (e.cmd != "release")
+					ok = ps2.key(e.arg, true);
+				if (e.cmd != "press")
+					ok = ps2.key(e.arg, false);
+				if (!ok)
+					fprintf(stderr, "unknown key \"%s\"\n", e.arg.c_str());
+			}
+			else if (e.cmd == "ps2") {
+				std::vector<uint8_t> codes;
+				const char *p = e.arg.c_str();
+				char *end;
+				for (uint32_t c=strtoul(p, &end, 16); end!=p; c=strtoul(p, &end, 16)) {
+					codes.push_back(c);
+					p = end;
+				}
+				ps2.send(codes);
+			}
+			else if (e.cmd == "uart") {
+				uart.send(e.arg);
+			}
+			else if (e.cmd == "sw") {
+				top->sw = strtoul(e.arg.c_str(), NULL, 16);
+			}
+			else if (e.cmd == "btn") {
+				int index = 0, value = 0;
+				sscanf(e.arg.c_str(), "%d %d", &index, &value);
+				#ifdef BOARD_SWORD
+				btn_matrix = value ? (btn_matrix | (1 << index)) : (btn_matrix & ~(1 << index));
+				#else
+				// BTNL, BTNR, BTNU, BTND
+				switch (index) {
+					case 0: top->btn_l = value; break;
+					case 1: top->btn_r = value; break;
+					case 2: top->btn_u = value; break;
+					case 3: top->btn_d = value; break;
+				}
+				#endif
+			}
+			else if (e.cmd == "rst") {
+				#ifdef BOARD_SWORD
+				top->rst_n = !atoi(e.arg.c_str());
+				#else
+				top->rst = atoi(e.arg.c_str());
+				#endif
+				if (atoi(e.arg.c_str())) {
+					iss.reset();
+					iss_mem.reset();
+				}
+			}
+			else if (e.cmd == "quit") {
+				quit = true;
+			}
+			else {
+				fprintf(stderr, "unknown command \"%s\"\n", e.cmd.c_str());
+			}
+		}
+
+		// memories
+		#ifdef BOARD_SWORD
+		if (!top->sram_ce_n && !top->sram_we_n)
+			sram.write(top->sram_addr, top->sram_data__out);
+		top->sram_data = (!top->sram_ce_n && !top->sram_oe_n) ? sram.read(top->sram_addr) : 0;
+		top->flash_data = (!(top->flash_ce_n & 1) && !top->flash_oe_n) ? flash.read32(top->flash_addr) : 0;
+		uint8_t btn_y = 0xF;
+		for (int i=0; i<5; i++) {
+			if (!((top->btn_x >> i) & 1))
+				btn_y &= ~(btn_matrix >> (i * 4));
+		}
+		top->btn_y = btn_y & 0xF;
+		#else
+		if (top->ram_ce_n)
+			psram.reset();
+		else if (top->ram_clk && !ram_clk_prev)
+			psram.clock(now, top->mem_we_n, top->ram_adv_n, top->ram_cre, top->ram_lb_n, top->ram_ub_n, top->mem_addr, top->mem_data__out);
+		ram_clk_prev = top->ram_clk;
+		top->ram_wait = psram.wait;
+		if (!top->ram_ce_n && !top->mem_oe_n)
+			top->mem_data = psram.dout;
+		else if (!top->pcm_ce_n && !top->mem_oe_n)
+			top->mem_data = pcm.read16(top->mem_addr);
+		else
+			top->mem_data = 0;
+		#endif
+
+		// peripherals
+		top->uart_rx = uart.step(now, top->uart_tx);
+		ps2.step(now, !top->keyboard_clk__en || top->keyboard_clk__out, !top->keyboard_dat__en || top->keyboard_dat__out);
+		top->keyboard_clk = ps2.clk && (!top->keyboard_clk__en || top->keyboard_clk__out);
+		top->keyboard_dat = ps2.dat && (!top->keyboard_dat__en || top->keyboard_dat__out);
+		vga.step(now, top->vga_h_sync, top->vga_v_sync, top->vga_red, top->vga_green, top->vga_blue);
+		#ifndef BOARD_SWORD
+		if (sd_card)
+			top->spi_miso = sd.step(top->spi_sck, top->spi_mosi, top->spi_sel_sd);
+		#endif
+
+		// inputs changed by models are seen by the design in the same half period
+		top->eval();
+
+		// CPU trace, interrupt is taken at the instruction which would retire next
+		if (top->cpu_clk && !cpu_clk_prev) {
+			cpu_cycles++;
+			if (top->cpu_sleep) {
+				sleep_cycles++;
+				profile.record_sleep(1);
+				retire_cycle = cpu_cycles;
+			}
+			if (top->fetch_stall)
+				fetch_stall_cycles++;
+			if (diff && top->irq_valid)
+				iss.take_interrupt(top->irq_id, top->irq_level);
+			if (top->retire_valid) {
+				profile.record(top->retire_pc, 1, cpu_cycles - retire_cycle);
+				retire_cycle = cpu_cycles;
+			}
+			if (diff && top->retire_valid) {
+				retire_info rtl;
+				rtl.pc = top->retire_pc;
+				rtl.wen = top->retire_wen;
+				rtl.waddr = top->retire_addr;
+				rtl.wdata = top->retire_data;
+				rtl.mem_wen = top->retire_mem_wen;
+				rtl.mem_addr = top->retire_mem_addr;
+				rtl.mem_data = top->retire_mem_data;
+				step_result result = STEP_EXCEPTION;
+				for (int n=0; n<DIFF_MAX_STEPS && result!=STEP_RETIRED; n++) {
+					iss_mem.update(iss.cycles);
+					result = iss.step();
+				}
+				if (result == STEP_RETIRED && same_retire(rtl, iss.last)) {
+					// values from devices and free-running counters are taken from the RTL
+					if (iss.last.external)
+						iss.regs[rtl.waddr] = rtl.wdata;
+					diff_count++;
+				}
+				else {
+					printf("\nlock-step divergence at %.6f ms, CPU cycle %llu, after %llu matched instructions:\n",
+						(double)now / PS_PER_MS, (unsigned long long)cpu_cycles, (unsigned long long)diff_count);
+					print_retire("RTL", rtl);
+					print_retire("ISS", iss.last);
+					printf("\tISS instruction %08x, next PC %08x, SR %08x, EPCR %08x\n", iss.last.inst, iss.pc, iss.cp0[CP0_SR], iss.cp0[CP0_EPCR]);
+					for (int i=0; i<32; i++)
+						printf("%s$%-2d %08x%s", i % 8 ? "  " : "\t", i, iss.regs[i], i % 8 == 7 ? "\n" : "");
+					diff_failed = true;
+					quit = true;
+				}
+			}
+		}
+		cpu_clk_prev = top->cpu_clk;
+
+		if (max_time && now >= max_time)
+			quit = true;
+		if (max_frames && vga.frame_count >= max_frames)
+			quit = true;
+	}
+	top->final();
+
+	double host_elapsed = host_time() - host_start;
+	uint64_t cycles = now / CPU_CLK_PERIOD;
+	printf("\n");
+	printf("simulated time: %.3f ms, %llu CPU cycles\n", (double)now / PS_PER_MS, (unsigned long long)cycles);
+	printf("host time: %.3f s, %.1f KHz\n", host_elapsed, host_elapsed > 0 ? cycles / host_elapsed / 1000 : 0);
+	printf("instruction fetch: %llu stall cycles (%.1f%% of cycles excluding sleep)\n", (unsigned long long)fetch_stall_cycles,
+		cycles > sleep_cycles ? 100.0 * fetch_stall_cycles / (cycles - sleep_cycles) : 0.0);
+	printf("VGA: %s, %u frames; UART: %u bytes sent, %u bytes received; PS/2: %u bytes sent\n",
+		vga.mode_name(), vga.frame_count, uart.tx_count, uart.rx_count, ps2.byte_count);
+	#ifndef BOARD_SWORD
+	printf("PSRAM: %u bursts, %u row boundaries crossed\n", psram.burst_count, psram.row_cross_count);
+	if (sd_card)
+		printf("SD card: %u commands, %u blocks read\n", sd.cmd_count, sd.block_count);
+	#endif
+	if (diff) {
+		uint64_t busy = cpu_cycles - sleep_cycles;
+		printf("lock-step: %llu instructions matched, %llu RTL cycles and %llu ISS estimated cycles excluding sleep (%+.1f%%)\n",
+			(unsigned long long)diff_count, (unsigned long long)busy, (unsigned long long)iss.cycles,
+			busy ? 100.0 * ((double)iss.cycles - busy) / busy : 0.0);
+	}
+	if (!profile.empty())
+		profile.report(stdout, top_n);
+	delete top;
+	return diff_failed ? 1 : 0;
+}
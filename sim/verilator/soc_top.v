@@ -0,0 +1,189 @@
+`include "define.vh"
+
+
+/**
+ * Top module for Verilator simulation, wraps the board's top module with ports accessible from C++.
+ * Port "switch" is renamed as it is a keyword in C++, LEDs and 7-segment display are left unconnected.
+ * Retired instructions and taken interrupts are traced out for lock-step comparison with the instruction set simulator.
+ * Author: Zhao, Hongyu  <power_zhy@foxmail.com>
+ */
+module soc_top (
+	input wire clk,  // on board clock, 100MHz
+	`ifdef BOARD_SWORD
+	input wire rst_n,
+	input wire [15:0] sw,
+	output wire [4:0] btn_x,
+	input wire [3:0] btn_y,
+	output wire sram_ce_n,
+	output wire sram_oe_n,
+	output wire sram_we_n,
+	output wire [19:0] sram_addr,
+	inout wire [47:0] sram_data,
+	output wire [1:0] flash_ce_n,
+	output wire flash_oe_n,
+	output wire flash_we_n,
+	input wire [1:0] flash_ready,
+	output wire [25:0] flash_addr,
+	inout wire [31:0] flash_data,
+	output wire vga_h_sync,
+	output wire vga_v_sync,
+	output wire [3:0] vga_red,
+	output wire [3:0] vga_green,
+	output wire [3:0] vga_blue,
+	`else
+	input wire rst,
+	input wire [7:0] sw,
+	input wire btn_l,
+	input wire btn_r,
+	input wire btn_u,
+	input wire btn_d,
+	output wire ram_ce_n,
+	output wire ram_clk,
+	output wire ram_adv_n,
+	output wire ram_cre,
+	output wire ram_lb_n,
+	output wire ram_ub_n,
+	input wire ram_wait,
+	output wire pcm_ce_n,
+	output wire mem_oe_n,
+	output wire mem_we_n,
+	output wire [23:1] mem_addr,
+	inout wire [15:0] mem_data,
+	output wire vga_h_sync,
+	output wire vga_v_sync,
+	output wire [2:0] vga_red,
+	output wire [2:0] vga_green,
+	output wire [2:1] vga_blue,
+	output wire spi_sck,
+	output wire spi_mosi,
+	input wire spi_miso,
+	output wire spi_sel_sd,
+	`endif
+	inout wire keyboard_clk,
+	inout wire keyboard_dat,
+	input wire uart_rx,
+	output wire uart_tx,
+	// CPU trace, registered at rising edge of CPU clock, valid for single issue only
+	output wire cpu_clk,
+	output reg retire_valid,  // one instruction left MEM stage without exception
+	output reg [31:0] retire_pc,
+	output reg retire_wen,  // register written
+	output reg [4:0] retire_addr,
+	output reg [31:0] retire_data,
+	output reg retire_mem_wen,  // memory written
+	output reg [31:0] retire_mem_addr,  // logical address
+	output reg [31:0] retire_mem_data,  // value of rt, not shifted to byte lanes
+	output reg irq_valid,  // interrupt taken at the instruction in MEM stage
+	output reg [4:0] irq_id,
+	output reg [1:0] irq_level,
+	output reg cpu_sleep,  // pipeline halted by WAIT instruction
+	output reg fetch_stall  // pipeline stalled by ICMU
+	);
+	
+	`include "mips_define.vh"
+	
+	`ifdef BOARD_SWORD
+	SystemOnFPGA_Sword SOC (
+		.clk(clk),
+		.rst_n(rst_n),
+		.switch(sw),
+		.btn_x(btn_x),
+		.btn_y(btn_y),
+		.led_clk(),
+		.led_pen(),
+		.led_clr_n(),
+		.led_do(),
+		.seg_clk(),
+		.seg_pen(),
+		.seg_clr_n(),
+		.seg_do(),
+		.tri_led0_r_n(),
+		.tri_led0_g_n(),
+		.tri_led0_b_n(),
+		.tri_led1_r_n(),
+		.tri_led1_g_n(),
+		.tri_led1_b_n(),
+		.sram_ce_n(sram_ce_n),
+		.sram_oe_n(sram_oe_n),
+		.sram_we_n(sram_we_n),
+		.sram_addr(sram_addr),
+		.sram_data(sram_data),
+		.flash_ce_n(flash_ce_n),
+		.flash_rst_n(),
+		.flash_oe_n(flash_oe_n),
+		.flash_we_n(flash_we_n),
+		.flash_ready(flash_ready),
+		.flash_addr(flash_addr),
+		.flash_data(flash_data),
+		.vga_h_sync(vga_h_sync),
+		.vga_v_sync(vga_v_sync),
+		.vga_red(vga_red),
+		.vga_green(vga_green),
+		.vga_blue(vga_blue),
+		.keyboard_clk(keyboard_clk),
+		.keyboard_dat(keyboard_dat),
+		.uart_rx(uart_rx),
+		.uart_tx(uart_tx)
+		);
+	`else
+	SystemOnFPGA_Nexys3 SOC (
+		.clk(clk),
+		.rst(rst),
+		.switch(sw),
+		.led(),
+		.btn_l(btn_l),
+		.btn_r(btn_r),
+		.btn_u(btn_u),
+		.btn_d(btn_d),
+		.segment(),
+		.anode(),
+		.ram_ce_n(ram_ce_n),
+		.ram_clk(ram_clk),
+		.ram_adv_n(ram_adv_n),
+		.ram_cre(ram_cre),
+		.ram_lb_n(ram_lb_n),
+		.ram_ub_n(ram_ub_n),
+		.ram_wait(ram_wait),
+		.pcm_ce_n(pcm_ce_n),
+		.pcm_rst_n(),
+		.mem_oe_n(mem_oe_n),
+		.mem_we_n(mem_we_n),
+		.mem_addr(mem_addr),
+		.mem_data(mem_data),
+		.vga_h_sync(vga_h_sync),
+		.vga_v_sync(vga_v_sync),
+		.vga_red(vga_red),
+		.vga_green(vga_green),
+		.vga_blue(vga_blue),
+		.keyboard_clk(keyboard_clk),
+		.keyboard_dat(keyboard_dat),
+		.spi_sck(spi_sck),
+		.spi_mosi(spi_mosi),
+		.spi_miso(spi_miso),
+		.spi_sel_sd(spi_sel_sd),
+		.uart_rx(uart_rx),
+		.uart_tx(uart_tx)
+		);
+	`endif
+	
+	// CPU trace
+	assign
+		cpu_clk = SOC.clk_cpu;
+	
+	always @(posedge cpu_clk) begin
+		retire_valid <= SOC.WB_MIPS.MIPS_CORE.mem_valid & SOC.WB_MIPS.MIPS_CORE.mem_en & ~SOC.WB_MIPS.MIPS_CORE.exception;
+		retire_pc <= SOC.WB_MIPS.MIPS_CORE.DATAPATH.inst_addr_mem;
+		retire_wen <= SOC.WB_MIPS.MIPS_CORE.DATAPATH.wb_wen_mem && SOC.WB_MIPS.MIPS_CORE.DATAPATH.regw_addr_mem != 0;
+		retire_addr <= SOC.WB_MIPS.MIPS_CORE.DATAPATH.regw_addr_mem;
+		retire_data <= SOC.WB_MIPS.MIPS_CORE.DATAPATH.wb_data_src_mem == WB_DATA_MEM ? SOC.WB_MIPS.MIPS_CORE.mem_din : SOC.WB_MIPS.MIPS_CORE.DATAPATH.alu_out_mem;
+		retire_mem_wen <= SOC.WB_MIPS.MIPS_CORE.mem_wen & ~(SOC.WB_MIPS.MIPS_CORE.mem_link & ~SOC.WB_MIPS.MIPS_CORE.mem_din[0]);  // failed SC writes nothing
+		retire_mem_addr <= SOC.WB_MIPS.MIPS_CORE.mem_addr;
+		retire_mem_data <= SOC.WB_MIPS.MIPS_CORE.mem_dout;
+		irq_valid <= SOC.WB_MIPS.MIPS_CORE.CP0.ir_valid & ~SOC.WB_MIPS.MIPS_CORE.CP0.ex;
+		irq_id <= SOC.WB_MIPS.MIPS_CORE.CP0.ir_id;
+		irq_level <= SOC.WB_MIPS.MIPS_CORE.CP0.ir_level;
+		cpu_sleep <= SOC.WB_MIPS.MIPS_CORE.CP0.sleep;
+		fetch_stall <= SOC.WB_MIPS.icache_stall;
+	end
+	
+endmodule
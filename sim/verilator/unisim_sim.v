@@ -0,0 +1,172 @@
+`include "define.vh"
+
+
+/**
+ * Behavioral models of Xilinx primitives used in the design, for simulators without UNISIM library.
+ * Only the features used by SystemOnFPGA are modeled.
+ * Author: Zhao, Hongyu  <power_zhy@foxmail.com>
+ */
+module IBUFG (
+	input wire I,
+	output wire O
+	);
+	
+	assign O = I;
+	
+endmodule
+
+
+module BUFG (
+	input wire I,
+	output wire O
+	);
+	
+	assign O = I;
+	
+endmodule
+
+
+module BUFGCE (
+	input wire I,
+	input wire CE,
+	output wire O
+	);
+	
+	reg ce_latch = 0;
+	
+	// glitch free clock gating, enable signal is latched while clock is low
+	always @(negedge I) begin
+		ce_latch <= CE;
+	end
+	
+	assign O = I & ce_latch;
+	
+endmodule
+
+
+module ODDR2 (
+	output wire Q,
+	input wire C0,
+	input wire C1,
+	input wire CE,
+	input wire D0,
+	input wire D1,
+	input wire R,
+	input wire S
+	);
+	
+	parameter
+		DDR_ALIGNMENT = "NONE",
+		INIT = 1'b0,
+		SRTYPE = "SYNC";
+	
+	reg q0 = INIT, q1 = INIT;
+	
+	always @(posedge C0) begin
+		if (R)
+			q0 <= 0;
+		else if (S)
+			q0 <= 1;
+		else if (CE)
+			q0 <= D0;
+	end
+	
+	always @(posedge C1) begin
+		if (R)
+			q1 <= 0;
+		else if (S)
+			q1 <= 1;
+		else if (CE)
+			q1 <= D1;
+	end
+	
+	// C1 is always the inversion of C0 in this design
+	assign Q = C0 ? q0 : q1;
+	
+endmodule
+
+
+/**
+ * Frequency synthesizer with dynamic reconfiguration, output is CLKIN * M / D.
+ * Output edges are generated on both edges of input clock by an accumulator, so the frequency is exact on average
+ * while each period has a jitter of half input period at most, and output can not be faster than input.
+ */
+module DCM_CLKGEN (
+	input wire CLKIN,
+	input wire RST,
+	input wire FREEZEDCM,
+	output reg CLKFX = 0,
+	output wire CLKFX180,
+	output wire CLKFXDV,
+	output wire LOCKED,
+	input wire PROGEN,
+	input wire PROGCLK,
+	input wire PROGDATA,
+	output reg PROGDONE = 1,
+	output wire [2:1] STATUS
+	);
+	
+	parameter
+		CLKFXDV_DIVIDE = 2,
+		CLKFX_DIVIDE = 1,
+		CLKFX_MULTIPLY = 4,
+		CLKFX_MD_MAX = 0.0,
+		CLKIN_PERIOD = 0.0,
+		SPREAD_SPECTRUM = "NONE",
+		STARTUP_WAIT = "FALSE";
+	
+	reg [8:0] mul = CLKFX_MULTIPLY;
+	reg [8:0] div = CLKFX_DIVIDE;
+	reg [8:0] mul_next = CLKFX_MULTIPLY;
+	reg [8:0] div_next = CLKFX_DIVIDE;
+	reg [9:0] acc = 0;
+	
+	// output toggles every D/M input half periods
+	always @(posedge CLKIN or negedge CLKIN) begin
+		if (RST) begin
+			acc <= 0;
+			CLKFX <= 0;
+		end
+		else if (acc + mul >= div) begin
+			acc <= (acc + mul >= div + div) ? 10'h0 : acc + mul - div;  // saturated when faster than input
+			CLKFX <= ~CLKFX;
+		end
+		else begin
+			acc <= acc + mul;
+		end
+	end
+	
+	assign
+		CLKFX180 = ~CLKFX,
+		CLKFXDV = 0,
+		LOCKED = ~RST,
+		STATUS = 0;
+	
+	// programming interface, 10 bits of command and value (LSB first), then GO command to apply
+	reg [9:0] prog_shift = 0;
+	reg [3:0] prog_count = 0;
+	reg prog_en_prev = 0;
+	
+	always @(posedge PROGCLK) begin
+		prog_en_prev <= PROGEN;
+		if (PROGEN) begin
+			prog_shift <= {PROGDATA, prog_shift[9:1]};
+			prog_count <= prog_count + 1'h1;
+			PROGDONE <= 0;
+		end
+		else if (prog_en_prev) begin
+			prog_count <= 0;
+			if (prog_count == 1) begin
+				// GO command
+				mul <= mul_next;
+				div <= div_next;
+				PROGDONE <= 1;
+			end
+			else case (prog_shift[1:0])
+				2'b01: div_next <= prog_shift[9:2] + 1'h1;
+				2'b11: mul_next <= prog_shift[9:2] + 1'h1;
+			endcase
+		end
+	end
+	
+endmodule
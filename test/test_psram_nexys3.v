@@ -89,6 +89,8 @@ module test_psram_nexys3 (
 		.clk(clk),
 		.rst(rst),
 		.ram_busy(busy),
+		.ram_suspended(),
+		.ram_suspend_end(1'b0),
 		.ram_clk(ram_clk),
 		.ram_ce_n(ram_ce_n),
 		.ram_oe_n(ram_oe_n),
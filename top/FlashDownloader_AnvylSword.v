@@ -152,7 +152,7 @@ module FlashDownloader_AnvylSword (
 		sram_dout = s_write;
 	
 	// flash
-	reg f_cs, f_we;
+	reg f_cs, f_we, f_prog, f_erase;
 	reg [24:2] f_addr;
 	reg f_burst;
 	wire f_busy, f_ack;
@@ -168,12 +168,15 @@ module FlashDownloader_AnvylSword (
 	flash_core_program #(
 		.CLK_FREQ(CLK_FREQ_MEM),
 		.ADDR_BITS(24),
-		.ADDR_BURST(4)
+		.ADDR_BURST(4),
+		.PAGE_BITS(8)
 		) FLASH_CORE0 (
 		.clk(clk_mem),
 		.rst(rst_all),
 		.cs(f_cs),
 		.we(f_we),
+		.prog(f_prog),
+		.erase(f_erase),
 		.addr(f_addr),
 		.burst(f_burst),
 		.din(f_write[15:0]),
@@ -194,12 +197,15 @@ module FlashDownloader_AnvylSword (
 	flash_core_program #(
 		.CLK_FREQ(CLK_FREQ_MEM),
 		.ADDR_BITS(24),
-		.ADDR_BURST(4)
+		.ADDR_BURST(4),
+		.PAGE_BITS(8)
 		) FLASH_CORE1 (
 		.clk(clk_mem),
 		.rst(rst_all),
 		.cs(f_cs),
 		.we(f_we),
+		.prog(f_prog),
+		.erase(f_erase),
 		.addr(f_addr),
 		.burst(f_burst),
 		.din(f_write[31:16]),
@@ -397,10 +403,8 @@ module FlashDownloader_AnvylSword (
 		S_ERASE = 2,
 		S_PROG1 = 3,
 		S_PROG2 = 4,
-		S_PROG3 = 5,
-		S_PROG4 = 6,
-		S_S2TX1 = 7,
-		S_S2TX2 = 8;
+		S_S2TX1 = 5,
+		S_S2TX2 = 6;
 	
 	reg [3:0] state = 0;
 	reg [3:0] next_state;
@@ -452,30 +456,17 @@ module FlashDownloader_AnvylSword (
 					next_state = S_ERASE;
 			end
 			S_PROG1: begin
-				disp_count = f_count;
-				if (f_ack && f_count == 3)
-					next_state = S_PROG2;
-				else
-					next_state = S_PROG1;
-			end
-			S_PROG2: begin
 				disp_count = tx_count;
-				next_state = S_PROG3;
+				next_state = S_PROG2;
 			end
-			S_PROG3: begin
+			S_PROG2: begin
 				disp_count = tx_count;
-				if (f_ack && tx_count[7:0] == 0)
-					next_state = S_PROG4;
-				else if (f_ack)
-					next_state = S_PROG2;
-				else
-					next_state = S_PROG3;
-			end
-			S_PROG4: begin
-				if (tx_count >= rx_count)
+				if (f_ack && tx_count >= rx_count)
 					next_state = S_IDLE;
-				else
+				else if (f_ack)
 					next_state = S_PROG1;
+				else
+					next_state = S_PROG2;
 			end
 			S_S2TX1: begin
 				disp_count = tx_count;
@@ -509,6 +500,8 @@ module FlashDownloader_AnvylSword (
 		s_we <= 0;
 		f_cs <= 0;
 		f_we <= 0;
+		f_prog <= 0;
+		f_erase <= 0;
 		f_burst <= 0;
 		if (rst_all) begin
 			rx_count <= 0;
@@ -574,51 +567,21 @@ module FlashDownloader_AnvylSword (
 					f_count <= f_count + 1'h1;
 			end
 			S_PROG1: begin
-				f_cs <= 1;
-				f_we <= 1;
-				case (f_count)
-					0: begin
-						f_addr <= 23'h555;
-						f_write <= 32'hAA;
-					end
-					1: begin
-						f_addr <= 23'h2AA;
-						f_write <= 32'h55;
-					end
-					2: begin
-						f_addr <= {switch_buf[4:0], tx_count};
-						f_write <= 32'h25;
-					end
-					3: begin
-						f_addr <= {switch_buf[4:0], tx_count};
-						f_write <= 32'h100;
-					end
-				endcase
-				if (f_ack)
-					f_count <= f_count + 1'h1;
-			end
-			S_PROG2: begin
-				f_count <= 0;
 				s_cs <= 1;
 				s_addr <= tx_count;
 				tx_count <= tx_count + 1'h1;
 			end
-			S_PROG3: begin
-				f_count <= 0;
+			S_PROG2: begin
+				// words go into the program buffers, each sector is erased when its first word comes
 				f_cs <= 1;
 				f_we <= 1;
+				f_prog <= 1;
+				f_erase <= (s_addr[17:2] == 0);
 				f_addr <= {switch_buf[4:0], s_addr[19:2]};
 				if (s_cs) begin
 					f_write <= s_read;
 				end
 			end
-			S_PROG4: begin
-				f_count <= 0;
-				f_cs <= 1;
-				f_we <= 1;
-				f_addr <= {switch_buf[4:0], s_addr[19:2]};
-				f_write <= 32'h29;
-			end
 			S_S2TX1: begin
 				s_cs <= 1;
 				s_addr <= tx_count;
@@ -57,8 +57,13 @@ module SystemOnFPGA_Nexys3 (
 	//`define NO_VGA
 	//`define NO_BOARD
 	//`define NO_KEYBOARD
+	//`define NO_TIMER
 	//`define NO_SPI
 	//`define NO_UART
+	//`define NO_RANDOM
+	//`define NO_TRACE
+	// uncomment below line to add the second CPU core, caches of both cores are kept coherent by bus snooping
+	//`define DUAL_CORE
 	
 	// clock & reset
 	wire clk_100m, clk_50m, clk_25m, clk_10m;
@@ -118,6 +123,37 @@ module SystemOnFPGA_Nexys3 (
 	wire dcmu_ack_i;
 	wire dcmu_err_i;
 	
+	// wishbone master - ICMU of the second core
+	wire icmu1_cyc_o;
+	wire icmu1_stb_o;
+	wire [31:2] icmu1_addr_o;
+	wire [2:0] icmu1_cti_o;
+	wire [1:0] icmu1_bte_o;
+	wire [3:0] icmu1_sel_o;
+	wire icmu1_we_o;
+	wire [31:0] icmu1_data_i;
+	wire [31:0] icmu1_data_o;
+	wire icmu1_ack_i;
+	wire icmu1_err_i;
+	
+	// wishbone master - DCMU of the second core
+	wire dcmu1_cyc_o;
+	wire dcmu1_stb_o;
+	wire [31:2] dcmu1_addr_o;
+	wire [2:0] dcmu1_cti_o;
+	wire [1:0] dcmu1_bte_o;
+	wire [3:0] dcmu1_sel_o;
+	wire dcmu1_we_o;
+	wire [31:0] dcmu1_data_i;
+	wire [31:0] dcmu1_data_o;
+	wire dcmu1_ack_i;
+	wire dcmu1_err_i;
+	
+	// bus snooping
+	wire [31:2] snoop_addr;
+	wire snoop_we;
+	wire [2:0] snoop_master;
+	
 	// wishbone slave - RAM
 	wire ram_cyc_i;
 	wire ram_stb_i;
@@ -157,6 +193,15 @@ module SystemOnFPGA_Nexys3 (
 	wire dev_ack_o;
 	wire dev_err_o;
 	
+	// peripheral wishbone - control of PCM
+	wire rom_ctrl_cs_i;
+	wire [7:2] rom_ctrl_addr_i;
+	wire [3:0] rom_ctrl_sel_i;
+	wire rom_ctrl_we_i;
+	wire [31:0] rom_ctrl_data_o;
+	wire [31:0] rom_ctrl_data_i;
+	wire rom_ctrl_ack_o;
+	
 	// peripheral wishbone - VGA
 	wire vga_cs_i;
 	wire [7:2] vga_addr_i;
@@ -184,6 +229,15 @@ module SystemOnFPGA_Nexys3 (
 	wire [31:0] keyboard_data_i;
 	wire keyboard_ack_o;
 	
+	// peripheral wishbone - timer
+	wire timer_cs_i;
+	wire [7:2] timer_addr_i;
+	wire [3:0] timer_sel_i;
+	wire timer_we_i;
+	wire [31:0] timer_data_o;
+	wire [31:0] timer_data_i;
+	wire timer_ack_o;
+	
 	// peripheral wishbone - SPI
 	wire spi_cs_i;
 	wire [7:2] spi_addr_i;
@@ -202,6 +256,30 @@ module SystemOnFPGA_Nexys3 (
 	wire [31:0] uart_data_i;
 	wire uart_ack_o;
 	
+	// peripheral wishbone - random number generator
+	wire random_cs_i;
+	wire [7:2] random_addr_i;
+	wire [3:0] random_sel_i;
+	wire random_we_i;
+	wire [31:0] random_data_o;
+	wire [31:0] random_data_i;
+	wire random_ack_o;
+	
+	// peripheral wishbone - trace unit of CPU
+	wire trace_cs_i;
+	wire [7:2] trace_addr_i;
+	wire [3:0] trace_sel_i;
+	wire trace_we_i;
+	wire [31:0] trace_data_o;
+	wire [31:0] trace_data_i;
+	wire trace_ack_o;
+	
+	// CPU trace
+	wire retire_valid;
+	wire [31:0] retire_pc;
+	wire retire_pair;
+	wire retire_exception;
+	
 	// anti-jitter
 	wire [7:0] switch_buf;
 	wire btn_l_buf, btn_r_buf, btn_u_buf, btn_d_buf, rst_buf;
@@ -232,7 +310,8 @@ module SystemOnFPGA_Nexys3 (
 		btn_r_buf = btn_r,
 		btn_u_buf = btn_u,
 		btn_d_buf = btn_d,
-		rst_buf = rst;
+		rst_buf = rst,
+		uart_rx_buf = uart_rx;
 	`endif
 	
 	// clock generator
@@ -254,11 +333,11 @@ module SystemOnFPGA_Nexys3 (
 	end
 	
 	// interrupts
-	wire ir_board, ir_keyboard, ir_spi, ir_uart;
+	wire ir_board, ir_keyboard, ir_timer, ir_spi, ir_uart;
 	wire [30:1] ir_orig, ir_map;
 	
 	assign
-		ir_orig = {24'b0, ir_uart, ir_spi, 1'b0, ir_keyboard, ir_board, 1'b0};
+		ir_orig = {24'b0, ir_uart, ir_spi, ir_timer, ir_keyboard, ir_board, 1'b0};
 	
 	ir_conv #(
 		.INTERRUPT_NUMBER(30),
@@ -349,6 +428,28 @@ module SystemOnFPGA_Nexys3 (
 		.m3_data_i(),
 		.m3_ack_o(),
 		.m3_err_o(),
+		.m4_cyc_i(icmu1_cyc_o),
+		.m4_stb_i(icmu1_stb_o),
+		.m4_addr_i(icmu1_addr_o),
+		.m4_cti_i(icmu1_cti_o),
+		.m4_bte_i(icmu1_bte_o),
+		.m4_sel_i(icmu1_sel_o),
+		.m4_we_i(icmu1_we_o),
+		.m4_data_o(icmu1_data_i),
+		.m4_data_i(icmu1_data_o),
+		.m4_ack_o(icmu1_ack_i),
+		.m4_err_o(icmu1_err_i),
+		.m5_cyc_i(dcmu1_cyc_o),
+		.m5_stb_i(dcmu1_stb_o),
+		.m5_addr_i(dcmu1_addr_o),
+		.m5_cti_i(dcmu1_cti_o),
+		.m5_bte_i(dcmu1_bte_o),
+		.m5_sel_i(dcmu1_sel_o),
+		.m5_we_i(dcmu1_we_o),
+		.m5_data_o(dcmu1_data_i),
+		.m5_data_i(dcmu1_data_o),
+		.m5_ack_o(dcmu1_ack_i),
+		.m5_err_o(dcmu1_err_i),
 		.s0_cyc_o(ram_cyc_i),
 		.s0_stb_o(ram_stb_i),
 		.s0_addr_o(ram_addr_i),
@@ -381,16 +482,32 @@ module SystemOnFPGA_Nexys3 (
 		.s2_data_i(dev_data_o),
 		.s2_data_o(dev_data_i),
 		.s2_ack_i(dev_ack_o),
-		.s2_err_i(dev_err_o)
+		.s2_err_i(dev_err_o),
+		.snoop_addr_o(snoop_addr),
+		.snoop_we_o(snoop_we),
+		.snoop_master_o(snoop_master)
 		);
 	
 	// CPU
+	`ifdef DUAL_CORE
+	localparam
+		CPU_COHERENT = 1;  // write through data caches and snoop each other
+	`else
+	localparam
+		CPU_COHERENT = 0;
+	`endif
+	
 	wb_mips #(
 		.CLK_FREQ(CLK_FREQ_CPU),
 		.IT_LINE_NUM(16),
 		.DT_LINE_NUM(16),
 		.IC_LINE_NUM(64),
-		.DC_LINE_NUM(64)
+		.DC_LINE_NUM(64),
+		.IC_LINE_WORDS(4),
+		.CPU_ID(0),
+		.COHERENT(CPU_COHERENT),
+		.ICMU_MASTER(1),
+		.DCMU_MASTER(2)
 		) WB_MIPS (
 		.clk(clk_cpu),
 		.rst(rst_all),
@@ -424,9 +541,88 @@ module SystemOnFPGA_Nexys3 (
 		.dcmu_data_o(dcmu_data_o),
 		.dcmu_ack_i(dcmu_ack_i),
 		.dcmu_err_i(dcmu_err_i),
+		.snoop_addr(snoop_addr),
+		.snoop_we(snoop_we),
+		.snoop_master(snoop_master),
+		.ir_map(ir_map),
+		.wd_rst(wd_rst),
+		.retire_valid(retire_valid),
+		.retire_pc(retire_pc),
+		.retire_pair(retire_pair),
+		.retire_exception(retire_exception)
+		);
+	
+	`ifdef DUAL_CORE
+	// the second core, starting from the same boot code and identified by CP0 register CIDR
+	wb_mips #(
+		.CLK_FREQ(CLK_FREQ_CPU),
+		.IT_LINE_NUM(16),
+		.DT_LINE_NUM(16),
+		.IC_LINE_NUM(64),
+		.DC_LINE_NUM(64),
+		.IC_LINE_WORDS(4),
+		.CPU_ID(1),
+		.COHERENT(CPU_COHERENT),
+		.ICMU_MASTER(4),
+		.DCMU_MASTER(5)
+		) WB_MIPS1 (
+		.clk(clk_cpu),
+		.rst(rst_all),
+		`ifdef DEBUG
+		.debug_en(1'b0),
+		.debug_step(1'b0),
+		.debug_addr(7'b0),
+		.debug_data(),
+		`endif
+		.icmu_clk_i(clk_bus),
+		.icmu_cyc_o(icmu1_cyc_o),
+		.icmu_stb_o(icmu1_stb_o),
+		.icmu_addr_o(icmu1_addr_o),
+		.icmu_cti_o(icmu1_cti_o),
+		.icmu_bte_o(icmu1_bte_o),
+		.icmu_sel_o(icmu1_sel_o),
+		.icmu_we_o(icmu1_we_o),
+		.icmu_data_i(icmu1_data_i),
+		.icmu_data_o(icmu1_data_o),
+		.icmu_ack_i(icmu1_ack_i),
+		.icmu_err_i(icmu1_err_i),
+		.dcmu_clk_i(clk_bus),
+		.dcmu_cyc_o(dcmu1_cyc_o),
+		.dcmu_stb_o(dcmu1_stb_o),
+		.dcmu_addr_o(dcmu1_addr_o),
+		.dcmu_cti_o(dcmu1_cti_o),
+		.dcmu_bte_o(dcmu1_bte_o),
+		.dcmu_sel_o(dcmu1_sel_o),
+		.dcmu_we_o(dcmu1_we_o),
+		.dcmu_data_i(dcmu1_data_i),
+		.dcmu_data_o(dcmu1_data_o),
+		.dcmu_ack_i(dcmu1_ack_i),
+		.dcmu_err_i(dcmu1_err_i),
+		.snoop_addr(snoop_addr),
+		.snoop_we(snoop_we),
+		.snoop_master(snoop_master),
 		.ir_map(ir_map),
-		.wd_rst(wd_rst)
+		.wd_rst()
 		);
+	`else
+	assign
+		icmu1_cyc_o = 0,
+		icmu1_stb_o = 0,
+		icmu1_addr_o = 0,
+		icmu1_cti_o = 0,
+		icmu1_bte_o = 0,
+		icmu1_sel_o = 0,
+		icmu1_we_o = 0,
+		icmu1_data_o = 0,
+		dcmu1_cyc_o = 0,
+		dcmu1_stb_o = 0,
+		dcmu1_addr_o = 0,
+		dcmu1_cti_o = 0,
+		dcmu1_bte_o = 0,
+		dcmu1_sel_o = 0,
+		dcmu1_we_o = 0,
+		dcmu1_data_o = 0;
+	`endif
 	
 	// memory (including RAM and ROM)
 	`ifndef NO_MEMORY
@@ -467,6 +663,13 @@ module SystemOnFPGA_Nexys3 (
 		.pcm_data_o(rom_data_o),
 		.pcm_ack_o(rom_ack_o),
 		.pcm_err_o(rom_err_o),
+		.pcm_ctrl_cs_i(rom_ctrl_cs_i),
+		.pcm_ctrl_addr_i(rom_ctrl_addr_i),
+		.pcm_ctrl_sel_i(rom_ctrl_sel_i),
+		.pcm_ctrl_data_i(rom_ctrl_data_i),
+		.pcm_ctrl_we_i(rom_ctrl_we_i),
+		.pcm_ctrl_data_o(rom_ctrl_data_o),
+		.pcm_ctrl_ack_o(rom_ctrl_ack_o),
 		.ram_ce_n(ram_ce_n),
 		.ram_clk(ram_clk),
 		.ram_adv_n(ram_adv_n),
@@ -519,6 +722,10 @@ module SystemOnFPGA_Nexys3 (
 		.wbs_err_o(rom_err_o)
 		);
 	
+	assign
+		rom_ctrl_data_o = 0,
+		rom_ctrl_ack_o = rom_ctrl_cs_i;
+	
 	assign
 		ram_ce_n = 1,
 		ram_clk = 0,
@@ -554,13 +761,13 @@ module SystemOnFPGA_Nexys3 (
 		.wbs_data_o(dev_data_o),
 		.wbs_ack_o(dev_ack_o),
 		.wbs_err_o(dev_err_o),
-		.d0_cs_o(),
-		.d0_addr_o(),
-		.d0_sel_o(),
-		.d0_we_o(),
-		.d0_data_o(),
-		.d0_data_i(),
-		.d0_ack_i(),
+		.d0_cs_o(rom_ctrl_cs_i),
+		.d0_addr_o(rom_ctrl_addr_i),
+		.d0_sel_o(rom_ctrl_sel_i),
+		.d0_we_o(rom_ctrl_we_i),
+		.d0_data_o(rom_ctrl_data_i),
+		.d0_data_i(rom_ctrl_data_o),
+		.d0_ack_i(rom_ctrl_ack_o),
 		.d1_cs_o(vga_cs_i),
 		.d1_addr_o(vga_addr_i),
 		.d1_sel_o(vga_sel_i),
@@ -582,13 +789,13 @@ module SystemOnFPGA_Nexys3 (
 		.d3_data_o(keyboard_data_i),
 		.d3_data_i(keyboard_data_o),
 		.d3_ack_i(keyboard_ack_o),
-		.d4_cs_o(),
-		.d4_addr_o(),
-		.d4_sel_o(),
-		.d4_we_o(),
-		.d4_data_o(),
-		.d4_data_i(),
-		.d4_ack_i(),
+		.d4_cs_o(timer_cs_i),
+		.d4_addr_o(timer_addr_i),
+		.d4_sel_o(timer_sel_i),
+		.d4_we_o(timer_we_i),
+		.d4_data_o(timer_data_i),
+		.d4_data_i(timer_data_o),
+		.d4_ack_i(timer_ack_o),
 		.d5_cs_o(spi_cs_i),
 		.d5_addr_o(spi_addr_i),
 		.d5_sel_o(spi_sel_i),
@@ -603,20 +810,20 @@ module SystemOnFPGA_Nexys3 (
 		.d6_data_o(uart_data_i),
 		.d6_data_i(uart_data_o),
 		.d6_ack_i(uart_ack_o),
-		.d7_cs_o(),
-		.d7_addr_o(),
-		.d7_sel_o(),
-		.d7_we_o(),
-		.d7_data_o(),
-		.d7_data_i(),
-		.d7_ack_i(),
-		.d8_cs_o(),
-		.d8_addr_o(),
-		.d8_sel_o(),
-		.d8_we_o(),
-		.d8_data_o(),
-		.d8_data_i(),
-		.d8_ack_i(),
+		.d7_cs_o(random_cs_i),
+		.d7_addr_o(random_addr_i),
+		.d7_sel_o(random_sel_i),
+		.d7_we_o(random_we_i),
+		.d7_data_o(random_data_i),
+		.d7_data_i(random_data_o),
+		.d7_ack_i(random_ack_o),
+		.d8_cs_o(trace_cs_i),
+		.d8_addr_o(trace_addr_i),
+		.d8_sel_o(trace_sel_i),
+		.d8_we_o(trace_we_i),
+		.d8_data_o(trace_data_i),
+		.d8_data_i(trace_data_o),
+		.d8_ack_i(trace_ack_o),
 		.d9_cs_o(),
 		.d9_addr_o(),
 		.d9_sel_o(),
@@ -646,8 +853,11 @@ module SystemOnFPGA_Nexys3 (
 		`define NO_VGA
 		`define NO_BOARD
 		`define NO_KEYBOARD
+		`define NO_TIMER
 		`define NO_SPI
 		`define NO_UART
+		`define NO_RANDOM
+		`define NO_TRACE
 	`endif
 	
 	`ifndef NO_VGA
@@ -786,6 +996,30 @@ module SystemOnFPGA_Nexys3 (
 		ir_keyboard = 0;
 	`endif
 	
+	`ifndef NO_TIMER
+	// timer
+	wb_timer #(
+		.CLK_FREQ(CLK_FREQ_DEV),
+		.DEV_ADDR_BITS(DEV_SINGAL_ADDR_BITS),
+		.CHANNEL_NUM(4)
+		) WB_TIMER (
+		.clk(clk_dev),
+		.rst(1'b0),
+		.wbs_clk_i(clk_bus),
+		.wbs_cs_i(timer_cs_i),
+		.wbs_addr_i(timer_addr_i),
+		.wbs_sel_i(timer_sel_i),
+		.wbs_data_i(timer_data_i),
+		.wbs_we_i(timer_we_i),
+		.wbs_data_o(timer_data_o),
+		.wbs_ack_o(timer_ack_o),
+		.interrupt(ir_timer)
+		);
+	`else
+	assign
+		ir_timer = 0;
+	`endif
+	
 	`ifndef NO_SPI
 	// SPI
 	wire [15:1] spi_sel_tmp;
@@ -848,4 +1082,45 @@ module SystemOnFPGA_Nexys3 (
 		uart_tx = 1,
 		ir_uart = 0;
 	`endif
+	
+	`ifndef NO_RANDOM
+	// random number generator
+	wb_random #(
+		.DEV_ADDR_BITS(DEV_SINGAL_ADDR_BITS)
+		) WB_RANDOM (
+		.clk(clk_dev),
+		.rst(1'b0),
+		.wbs_clk_i(clk_bus),
+		.wbs_cs_i(random_cs_i),
+		.wbs_addr_i(random_addr_i),
+		.wbs_sel_i(random_sel_i),
+		.wbs_data_i(random_data_i),
+		.wbs_we_i(random_we_i),
+		.wbs_data_o(random_data_o),
+		.wbs_ack_o(random_ack_o)
+		);
+	`endif
+	
+	`ifndef NO_TRACE
+	// trace unit of the first core, drained by software through UART
+	wb_trace #(
+		.DEV_ADDR_BITS(DEV_SINGAL_ADDR_BITS),
+		.ENTRY_BITS(10)
+		) WB_TRACE (
+		.clk(clk_cpu),
+		.rst(1'b0),
+		.retire_valid(retire_valid),
+		.retire_pc(retire_pc),
+		.retire_pair(retire_pair),
+		.retire_exception(retire_exception),
+		.wbs_clk_i(clk_bus),
+		.wbs_cs_i(trace_cs_i),
+		.wbs_addr_i(trace_addr_i),
+		.wbs_sel_i(trace_sel_i),
+		.wbs_data_i(trace_data_i),
+		.wbs_we_i(trace_we_i),
+		.wbs_data_o(trace_data_o),
+		.wbs_ack_o(trace_ack_o)
+		);
+	`endif
 endmodule